@@ -0,0 +1,438 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationtracker.cpp
+// ============
+// count the heap allocations of the render thread per frame and subsystem
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// frames between allocation reports
+	const unsigned int REPORT_INTERVAL = 300;
+	// deepest scope nesting that is attributed
+	const int MAX_SCOPE_DEPTH = 16;
+	// distinct scopes and call sites counted per report interval
+	const int MAX_SCOPES = 64;
+	const int MAX_CALL_SITES = 256;
+	// frames kept of each call stack, and call sites printed per report
+	const int STACK_DEPTH = 8;
+	const int REPORTED_CALL_SITES = 5;
+
+	struct SCOPE_STATS
+	{
+		const char* label;
+		uint64_t    allocations;
+		uint64_t    bytes;
+	};
+
+	struct CALL_SITE
+	{
+		uint64_t hash;
+		int      depth;
+		void*    frames[STACK_DEPTH];
+		uint64_t allocations;
+		uint64_t bytes;
+	};
+
+	// everything below is plain data, so it is ready before any
+	// static constructor allocates, and is never allocated itself
+	bool g_bEnabled = false;
+	bool g_bCallSites = false;
+	bool g_bAssert = false;
+	unsigned int g_warmupFrames = 0;
+	unsigned int g_frame = 0;
+
+	AllocationTracker::FRAME_STATS g_frameStats;
+	AllocationTracker::FRAME_STATS g_lastFrameStats;
+	AllocationTracker::FRAME_STATS g_intervalStats;
+	uint64_t g_intervalMaxAllocations = 0;
+
+	SCOPE_STATS g_scopes[MAX_SCOPES];
+	int g_scopeCount = 0;
+	CALL_SITE g_callSites[MAX_CALL_SITES];
+	uint64_t g_droppedCallSites = 0;
+
+	// first allocation breaking the assertion this frame
+	bool g_bViolation = false;
+	size_t g_violationSize = 0;
+	const char* g_violationScope = NULL;
+	int g_violationDepth = 0;
+	void* g_violationFrames[STACK_DEPTH];
+
+	// only the thread that enabled tracking is counted, and the
+	// tracker's own allocations (reporting, stack capture) are not
+	thread_local bool t_bTrackedThread = false;
+	thread_local bool t_bInside = false;
+	thread_local const char* t_scopes[MAX_SCOPE_DEPTH];
+	thread_local int t_scopeDepth = 0;
+
+	int CaptureStack(void** frames)
+	{
+#if defined(_WIN32)
+		// skip this function, OnAllocate and operator new
+		return (int)CaptureStackBackTrace(3, STACK_DEPTH, frames, NULL);
+#elif defined(__linux__)
+		void* buffer[STACK_DEPTH + 3];
+		int depth = backtrace(buffer, STACK_DEPTH + 3) - 3;
+		if (depth <= 0)
+			return 0;
+		memcpy(frames, buffer + 3, depth * sizeof(void*));
+		return depth;
+#else
+		(void)frames;
+		return 0;
+#endif
+	}
+
+	void PrintStack(void* const* frames, int depth)
+	{
+#if defined(__linux__)
+		std::cout.flush();
+		backtrace_symbols_fd(frames, depth, STDOUT_FILENO);
+#else
+		for (int i = 0; i < depth; i++)
+			std::cout << "        " << frames[i] << std::endl;
+#endif
+	}
+
+	const char* CurrentScope()
+	{
+		if (t_scopeDepth == 0)
+			return NULL;
+		return t_scopes[std::min(t_scopeDepth, MAX_SCOPE_DEPTH) - 1];
+	}
+
+	void CountScope(const char* label, size_t size)
+	{
+		for (int i = 0; i < g_scopeCount; i++)
+		{
+			if (g_scopes[i].label == label)
+			{
+				g_scopes[i].allocations++;
+				g_scopes[i].bytes += size;
+				return;
+			}
+		}
+
+		if (g_scopeCount < MAX_SCOPES)
+		{
+			SCOPE_STATS& scope = g_scopes[g_scopeCount++];
+			scope.label = label;
+			scope.allocations = 1;
+			scope.bytes = size;
+		}
+	}
+
+	void CountCallSite(void* const* frames, int depth, size_t size)
+	{
+		// FNV-1a over the return addresses
+		uint64_t hash = 14695981039346656037ull;
+		for (int i = 0; i < depth; i++)
+			hash = (hash ^ (uint64_t)(uintptr_t)frames[i]) * 1099511628211ull;
+		hash |= 1;
+
+		for (int probe = 0; probe < MAX_CALL_SITES; probe++)
+		{
+			CALL_SITE& site = g_callSites[(hash + probe) % MAX_CALL_SITES];
+			if (site.hash == hash)
+			{
+				site.allocations++;
+				site.bytes += size;
+				return;
+			}
+			if (site.hash == 0)
+			{
+				site.hash = hash;
+				site.depth = depth;
+				memcpy(site.frames, frames, depth * sizeof(void*));
+				site.allocations = 1;
+				site.bytes = size;
+				return;
+			}
+		}
+		g_droppedCallSites++;
+	}
+
+	void Report(unsigned int frames)
+	{
+		std::cout << "[ALLOC] " << (double)g_intervalStats.allocations / frames << " allocations/frame (max "
+			<< g_intervalMaxAllocations << "), " << (double)g_intervalStats.bytes / frames << " bytes/frame, "
+			<< (double)g_intervalStats.frees / frames << " frees/frame" << std::endl;
+
+		std::sort(g_scopes, g_scopes + g_scopeCount,
+			[](const SCOPE_STATS& a, const SCOPE_STATS& b) { return a.allocations > b.allocations; });
+		for (int i = 0; i < g_scopeCount; i++)
+		{
+			std::cout << "[ALLOC]   " << (g_scopes[i].label ? g_scopes[i].label : "(no scope)") << ": "
+				<< (double)g_scopes[i].allocations / frames << " allocations/frame, "
+				<< (double)g_scopes[i].bytes / frames << " bytes/frame" << std::endl;
+		}
+
+		if (!g_bCallSites)
+			return;
+
+		std::sort(g_callSites, g_callSites + MAX_CALL_SITES,
+			[](const CALL_SITE& a, const CALL_SITE& b) { return a.allocations > b.allocations; });
+		for (int i = 0; i < REPORTED_CALL_SITES && g_callSites[i].hash != 0; i++)
+		{
+			std::cout << "[ALLOC]   call site " << i + 1 << ": " << (double)g_callSites[i].allocations / frames
+				<< " allocations/frame, " << (double)g_callSites[i].bytes / frames << " bytes/frame" << std::endl;
+			PrintStack(g_callSites[i].frames, g_callSites[i].depth);
+		}
+		if (g_droppedCallSites > 0)
+			std::cout << "[ALLOC]   " << g_droppedCallSites << " allocations from call sites beyond the table" << std::endl;
+	}
+
+	void ResetInterval()
+	{
+		memset(&g_intervalStats, 0, sizeof(g_intervalStats));
+		g_intervalMaxAllocations = 0;
+		g_scopeCount = 0;
+		memset(g_callSites, 0, sizeof(g_callSites));
+		g_droppedCallSites = 0;
+	}
+}
+
+/***********************************************************
+ *  Enable() / Disable()
+ *
+ *  These methods are used for starting and stopping the
+ *  tracking of the calling thread's allocations.
+ ***********************************************************/
+void AllocationTracker::Enable(bool bCallSites)
+{
+	t_bInside = true;
+#if defined(__linux__)
+	// the first backtrace loads the unwinder, which allocates
+	void* frames[STACK_DEPTH];
+	backtrace(frames, STACK_DEPTH);
+#endif
+	t_bInside = false;
+
+	memset(&g_frameStats, 0, sizeof(g_frameStats));
+	memset(&g_lastFrameStats, 0, sizeof(g_lastFrameStats));
+	ResetInterval();
+	g_frame = 0;
+	g_bCallSites = bCallSites;
+	t_bTrackedThread = true;
+	g_bEnabled = true;
+}
+
+void AllocationTracker::Disable()
+{
+	g_bEnabled = false;
+	t_bTrackedThread = false;
+}
+
+bool AllocationTracker::IsEnabled()
+{
+	return g_bEnabled;
+}
+
+/***********************************************************
+ *  AssertNoAllocations()
+ *
+ *  This method is used for failing the run when a frame after
+ *  the warm-up allocates. The first offending allocation is
+ *  reported with its scope and call stack.
+ ***********************************************************/
+void AllocationTracker::AssertNoAllocations(unsigned int warmupFrames)
+{
+	g_warmupFrames = warmupFrames;
+	g_bAssert = true;
+}
+
+/***********************************************************
+ *  PushScope() / PopScope()
+ *
+ *  These methods are used for tracking the scope allocations
+ *  are attributed to.
+ ***********************************************************/
+void AllocationTracker::PushScope(const char* label)
+{
+	if (t_scopeDepth < MAX_SCOPE_DEPTH)
+		t_scopes[t_scopeDepth] = label;
+	t_scopeDepth++;
+}
+
+void AllocationTracker::PopScope()
+{
+	if (t_scopeDepth > 0)
+		t_scopeDepth--;
+}
+
+/***********************************************************
+ *  OnAllocate() / OnFree()
+ *
+ *  These methods are used for counting one allocation or
+ *  release. They must not allocate themselves.
+ ***********************************************************/
+void AllocationTracker::OnAllocate(size_t size)
+{
+	if (!g_bEnabled || !t_bTrackedThread || t_bInside)
+		return;
+	t_bInside = true;
+
+	g_frameStats.allocations++;
+	g_frameStats.bytes += size;
+	CountScope(CurrentScope(), size);
+
+	bool bViolation = g_bAssert && !g_bViolation && g_frame >= g_warmupFrames;
+	if (g_bCallSites || bViolation)
+	{
+		void* frames[STACK_DEPTH];
+		int depth = CaptureStack(frames);
+		if (g_bCallSites)
+			CountCallSite(frames, depth, size);
+		if (bViolation)
+		{
+			g_bViolation = true;
+			g_violationSize = size;
+			g_violationScope = CurrentScope();
+			g_violationDepth = depth;
+			memcpy(g_violationFrames, frames, depth * sizeof(void*));
+		}
+	}
+
+	t_bInside = false;
+}
+
+void AllocationTracker::OnFree()
+{
+	if (!g_bEnabled || !t_bTrackedThread || t_bInside)
+		return;
+	g_frameStats.frees++;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing the frame's counts,
+ *  printing the periodic report and stopping the run if the
+ *  assertion mode caught an allocation.
+ ***********************************************************/
+void AllocationTracker::EndFrame()
+{
+	if (!g_bEnabled || !t_bTrackedThread)
+		return;
+	t_bInside = true;
+
+	g_lastFrameStats = g_frameStats;
+	g_intervalStats.allocations += g_frameStats.allocations;
+	g_intervalStats.frees += g_frameStats.frees;
+	g_intervalStats.bytes += g_frameStats.bytes;
+	g_intervalMaxAllocations = std::max(g_intervalMaxAllocations, g_frameStats.allocations);
+	memset(&g_frameStats, 0, sizeof(g_frameStats));
+	g_frame++;
+
+	if (g_bViolation)
+	{
+		std::cout << "[ERROR] Frame " << g_frame - 1 << " made " << g_lastFrameStats.allocations
+			<< " heap allocations after the warm-up; the first, of " << g_violationSize << " bytes in "
+			<< (g_violationScope ? g_violationScope : "(no scope)") << ", came from:" << std::endl;
+		PrintStack(g_violationFrames, g_violationDepth);
+		Report((g_frame % REPORT_INTERVAL) ? (g_frame % REPORT_INTERVAL) : REPORT_INTERVAL);
+		std::cout.flush();
+		std::abort();
+	}
+
+	if ((g_frame % REPORT_INTERVAL) == 0)
+	{
+		Report(REPORT_INTERVAL);
+		ResetInterval();
+	}
+
+	t_bInside = false;
+}
+
+/***********************************************************
+ *  GetLastFrameStats()
+ *
+ *  This method is used for getting the counts of the last
+ *  finished frame, e.g. to check them from a test.
+ ***********************************************************/
+const AllocationTracker::FRAME_STATS& AllocationTracker::GetLastFrameStats()
+{
+	return g_lastFrameStats;
+}
+
+/***********************************************************
+ *  operator new / operator delete
+ *
+ *  The replacements of the global allocation functions, they
+ *  forward to malloc and free and report to the tracker.
+ ***********************************************************/
+void* operator new(size_t size)
+{
+	AllocationTracker::OnAllocate(size);
+	void* pMemory = malloc(size ? size : 1);
+	if (NULL == pMemory)
+		throw std::bad_alloc();
+	return pMemory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	AllocationTracker::OnAllocate(size);
+	return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	if (NULL == pMemory)
+		return;
+	AllocationTracker::OnFree();
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	operator delete(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	operator delete(pMemory);
+}
+
+void operator delete[](void* pMemory, size_t) noexcept
+{
+	operator delete(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	operator delete(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	operator delete(pMemory);
+}
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationtracker.h
+// ============
+// count the heap allocations of the render thread per frame and subsystem
+//
+//	The global operator new and delete are replaced so every allocation
+//	of the thread that enabled tracking is counted, including the hidden
+//	ones of std::string temporaries and container copies. Allocations are
+//	attributed to the innermost open Scope (CpuTimer stages open one too)
+//	and, optionally, to the call stack that made them. In the assertion
+//	mode any allocation after the warm-up frames fails the run, so the
+//	steady state frame loop can be kept allocation free.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class AllocationTracker
+{
+public:
+	// attributes the allocations of the enclosing block to the label
+	class Scope
+	{
+	public:
+		Scope(const char* label) { PushScope(label); }
+		~Scope() { PopScope(); }
+
+	private:
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+	};
+
+	// allocation counts of one frame
+	struct FRAME_STATS
+	{
+		uint64_t allocations;
+		uint64_t frees;
+		uint64_t bytes;
+	};
+
+	// start tracking the calling thread, optionally with call stacks
+	static void Enable(bool bCallSites);
+	// stop tracking
+	static void Disable();
+	static bool IsEnabled();
+
+	// fail the run on any allocation once warmupFrames frames have passed
+	static void AssertNoAllocations(unsigned int warmupFrames);
+
+	// open and close an attribution scope, the label must outlive it
+	static void PushScope(const char* label);
+	static void PopScope();
+
+	// finish the frame, report periodically and enforce the assertion
+	static void EndFrame();
+
+	// counts of the last finished frame
+	static const FRAME_STATS& GetLastFrameStats();
+
+	// called by the replaced operators only
+	static void OnAllocate(size_t size);
+	static void OnFree();
+};
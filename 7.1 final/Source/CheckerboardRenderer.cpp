@@ -0,0 +1,326 @@
+///////////////////////////////////////////////////////////////////////////////
+// checkerboardrenderer.cpp
+// ============
+// shade half of the pixels each frame and reconstruct the rest
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CheckerboardRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_ResolveShaderFile = "checkerboard_resolve.comp";
+	const char* g_CompareShaderFile = "checkerboard_compare.comp";
+
+	// compute work group size used by both passes
+	const int g_GroupSize = 8;
+
+	// the passes sample from units above the ones the scene textures
+	// stay bound to (see SceneManager::BindGLTextures)
+	const int g_TextureUnitBase = 16;
+
+	void BindTexture(int unit, GLuint textureID)
+	{
+		glActiveTexture(GL_TEXTURE0 + g_TextureUnitBase + unit);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+	}
+
+	GLuint CreateTexture2D(GLenum format, int width, int height, int levels)
+	{
+		GLuint textureID = 0;
+		GLint filter = (format == GL_R32UI) ? GL_NEAREST : GL_LINEAR;
+
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glTexStorage2D(GL_TEXTURE_2D, levels, format, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_NEAREST : filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		return textureID;
+	}
+}
+
+/***********************************************************
+ *  CheckerboardRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CheckerboardRenderer::CheckerboardRenderer()
+	: m_timer("Checkerboard reconstruction")
+{
+	m_historyTextures[0] = 0;
+	m_historyTextures[1] = 0;
+	m_historyObjectIDs[0] = 0;
+	m_historyObjectIDs[1] = 0;
+	m_historyIndex = 0;
+	m_bHistoryValid = false;
+	m_referenceTexture = 0;
+	m_errorTexture = 0;
+	m_errorLevels = 0;
+	m_width = 0;
+	m_height = 0;
+	m_phase = 0;
+}
+
+/***********************************************************
+ *  ~CheckerboardRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CheckerboardRenderer::~CheckerboardRenderer()
+{
+	DestroyTextures();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the compute passes.
+ ***********************************************************/
+bool CheckerboardRenderer::Initialize()
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "Checkerboard rendering disabled: OpenGL 4.3 is required" << std::endl;
+		return false;
+	}
+
+	return m_resolveProgram.Load(g_ResolveShaderFile) &&
+		m_compareProgram.Load(g_CompareShaderFile);
+}
+
+/***********************************************************
+ *  DestroyTextures()
+ *
+ *  This method is used for freeing the history textures.
+ ***********************************************************/
+void CheckerboardRenderer::DestroyTextures()
+{
+	if (m_historyTextures[0] != 0)
+	{
+		glDeleteTextures(2, m_historyTextures);
+		glDeleteTextures(2, m_historyObjectIDs);
+		glDeleteTextures(1, &m_referenceTexture);
+		glDeleteTextures(1, &m_errorTexture);
+	}
+
+	m_historyTextures[0] = 0;
+	m_historyTextures[1] = 0;
+	m_historyObjectIDs[0] = 0;
+	m_historyObjectIDs[1] = 0;
+	m_referenceTexture = 0;
+	m_errorTexture = 0;
+}
+
+/***********************************************************
+ *  ResizeTextures()
+ *
+ *  This method is used for matching the history textures and
+ *  the stencil pattern to the render target size.
+ ***********************************************************/
+void CheckerboardRenderer::ResizeTextures(SceneRenderTarget& target)
+{
+	if (m_historyTextures[0] != 0 && target.GetWidth() == m_width && target.GetHeight() == m_height)
+		return;
+
+	DestroyTextures();
+
+	m_width = target.GetWidth();
+	m_height = target.GetHeight();
+
+	m_errorLevels = 1;
+	while ((std::max(m_width, m_height) >> m_errorLevels) > 0)
+		m_errorLevels++;
+
+	for (int i = 0; i < 2; i++)
+	{
+		m_historyTextures[i] = CreateTexture2D(GL_RGBA16F, m_width, m_height, 1);
+		m_historyObjectIDs[i] = CreateTexture2D(GL_R32UI, m_width, m_height, 1);
+	}
+	m_referenceTexture = CreateTexture2D(GL_RGBA16F, m_width, m_height, 1);
+	m_errorTexture = CreateTexture2D(GL_R32F, m_width, m_height, m_errorLevels);
+	m_bHistoryValid = false;
+
+	WriteStencilPattern(target);
+}
+
+/***********************************************************
+ *  WriteStencilPattern()
+ *
+ *  This method is used for filling the target's stencil
+ *  buffer with the checker pattern, (x + y) & 1. It is only
+ *  written when the target is resized; the main pass clears
+ *  color and depth but leaves the stencil alone.
+ ***********************************************************/
+void CheckerboardRenderer::WriteStencilPattern(SceneRenderTarget& target)
+{
+	// 24 bit depth cleared to the far plane, stencil in the low byte
+	const GLuint farDepth = 0xFFFFFF00u;
+	std::vector<GLuint> pattern((size_t)m_width * (size_t)m_height);
+
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			pattern[(size_t)y * m_width + x] = farDepth | (GLuint)((x + y) & 1);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, target.GetDepthTexture());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height,
+		GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, pattern.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  BeginShading()
+ *
+ *  This method is used for restricting the following draws
+ *  to the pixels of this frame's checker phase. The stencil
+ *  test runs before the fragment shader, so the other half
+ *  costs no shading at all.
+ ***********************************************************/
+void CheckerboardRenderer::BeginShading(SceneRenderTarget& target)
+{
+	ResizeTextures(target);
+
+	glEnable(GL_STENCIL_TEST);
+	glStencilMask(0x00);
+	glStencilFunc(GL_EQUAL, m_phase, 0x01);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+}
+
+/***********************************************************
+ *  EndShading()
+ *
+ *  This method is used for turning the stencil test off.
+ ***********************************************************/
+void CheckerboardRenderer::EndShading()
+{
+	glDisable(GL_STENCIL_TEST);
+	glStencilMask(0xFF);
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method is used for reconstructing the full frame
+ *  from the shaded half and the reprojected history, then
+ *  writing it back into the target's color attachment.
+ ***********************************************************/
+void CheckerboardRenderer::Resolve(SceneRenderTarget& target)
+{
+	if (!m_resolveProgram.IsLoaded() || m_historyTextures[0] == 0)
+		return;
+
+	int writeIndex = 1 - m_historyIndex;
+
+	m_timer.Begin();
+
+	m_resolveProgram.use();
+	m_resolveProgram.setIntValue("uPhase", m_phase);
+	m_resolveProgram.setIntValue("uHistoryValid", m_bHistoryValid);
+	m_resolveProgram.setIntValue("uColor", g_TextureUnitBase + 0);
+	m_resolveProgram.setIntValue("uVelocity", g_TextureUnitBase + 1);
+	m_resolveProgram.setIntValue("uObjectID", g_TextureUnitBase + 2);
+	m_resolveProgram.setIntValue("uDepth", g_TextureUnitBase + 3);
+	m_resolveProgram.setIntValue("uHistory", g_TextureUnitBase + 4);
+	m_resolveProgram.setIntValue("uHistoryObjectID", g_TextureUnitBase + 5);
+
+	BindTexture(0, target.GetColorTexture());
+	BindTexture(1, target.GetVelocityTexture());
+	BindTexture(2, target.GetObjectIDTexture());
+	BindTexture(3, target.GetDepthTexture());
+	BindTexture(4, m_historyTextures[m_historyIndex]);
+	BindTexture(5, m_historyObjectIDs[m_historyIndex]);
+	glBindImageTexture(0, m_historyTextures[writeIndex], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glBindImageTexture(1, m_historyObjectIDs[writeIndex], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+
+	m_resolveProgram.Dispatch(
+		(GLuint)((m_width + g_GroupSize - 1) / g_GroupSize),
+		(GLuint)((m_height + g_GroupSize - 1) / g_GroupSize),
+		1);
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glCopyImageSubData(
+		m_historyTextures[writeIndex], GL_TEXTURE_2D, 0, 0, 0, 0,
+		target.GetColorTexture(), GL_TEXTURE_2D, 0, 0, 0, 0,
+		m_width, m_height, 1);
+
+	for (int unit = 0; unit < 6; unit++)
+		BindTexture(unit, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_timer.End();
+
+	m_historyIndex = writeIndex;
+	m_bHistoryValid = true;
+	m_phase = 1 - m_phase;
+}
+
+/***********************************************************
+ *  CaptureReference()
+ *
+ *  This method is used for copying a full rate frame from
+ *  the target's color attachment.
+ ***********************************************************/
+void CheckerboardRenderer::CaptureReference(SceneRenderTarget& target)
+{
+	ResizeTextures(target);
+
+	glCopyImageSubData(
+		target.GetColorTexture(), GL_TEXTURE_2D, 0, 0, 0, 0,
+		m_referenceTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+		m_width, m_height, 1);
+}
+
+/***********************************************************
+ *  CompareWithReference()
+ *
+ *  This method is used for measuring the reconstruction
+ *  quality as the PSNR against the captured reference. The
+ *  squared error is averaged by the mip chain and read back
+ *  synchronously, so it is only meant for on-demand use.
+ ***********************************************************/
+double CheckerboardRenderer::CompareWithReference()
+{
+	if (!m_compareProgram.IsLoaded() || m_referenceTexture == 0)
+		return 0.0;
+
+	m_compareProgram.use();
+	m_compareProgram.setIntValue("uResolved", g_TextureUnitBase + 0);
+	m_compareProgram.setIntValue("uReference", g_TextureUnitBase + 1);
+
+	BindTexture(0, m_historyTextures[m_historyIndex]);
+	BindTexture(1, m_referenceTexture);
+	glBindImageTexture(0, m_errorTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+	m_compareProgram.Dispatch(
+		(GLuint)((m_width + g_GroupSize - 1) / g_GroupSize),
+		(GLuint)((m_height + g_GroupSize - 1) / g_GroupSize),
+		1);
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+	float meanSquaredError = 0.0f;
+	glBindTexture(GL_TEXTURE_2D, m_errorTexture);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glGetTexImage(GL_TEXTURE_2D, m_errorLevels - 1, GL_RED, GL_FLOAT, &meanSquaredError);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	BindTexture(0, 0);
+	BindTexture(1, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	if (meanSquaredError <= 0.0f)
+		return INFINITY;
+
+	return 10.0 * std::log10(1.0 / meanSquaredError);
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// checkerboardrenderer.h
+// ============
+// shade half of the pixels each frame and reconstruct the rest
+//
+//	A checker pattern is written once into the stencil buffer of the scene
+//	render target and the stencil test alternates between the two halves
+//	every frame, so rejected pixels never reach the fragment shader. The
+//	missing half is rebuilt from the previous reconstructed frame using
+//	motion vectors, with object IDs rejecting history from other surfaces
+//	and a spatial fallback from the four shaded neighbors.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "ComputeProgram.h"
+#include "GpuTimer.h"
+#include "SceneRenderTarget.h"
+
+class CheckerboardRenderer
+{
+public:
+	// constructor
+	CheckerboardRenderer();
+	// destructor
+	~CheckerboardRenderer();
+
+	// compile the reconstruction and comparison passes
+	bool Initialize();
+	// enable the stencil test for this frame's half of the pixels
+	void BeginShading(SceneRenderTarget& target);
+	// disable the stencil test again
+	void EndShading();
+	// rebuild the unshaded pixels into the target's color attachment
+	void Resolve(SceneRenderTarget& target);
+
+	// keep a copy of a full rate frame for the quality comparison
+	void CaptureReference(SceneRenderTarget& target);
+	// compare the last resolved frame with the reference, returns PSNR in dB
+	double CompareWithReference();
+
+	// half of the checker pattern shaded this frame (0 or 1)
+	int GetPhase() const { return m_phase; }
+	// GPU cost of the reconstruction pass
+	const GpuTimer& GetTimer() const { return m_timer; }
+
+private:
+	ComputeProgram m_resolveProgram;
+	ComputeProgram m_compareProgram;
+
+	// reconstructed color and object IDs, ping-ponged as history
+	GLuint m_historyTextures[2];
+	GLuint m_historyObjectIDs[2];
+	int    m_historyIndex;
+	bool   m_bHistoryValid;
+	// full rate reference and per-pixel squared error mip chain
+	GLuint m_referenceTexture;
+	GLuint m_errorTexture;
+	int    m_errorLevels;
+
+	int m_width;
+	int m_height;
+	int m_phase;
+	GpuTimer m_timer;
+
+	void ResizeTextures(SceneRenderTarget& target);
+	void DestroyTextures();
+	void WriteStencilPattern(SceneRenderTarget& target);
+};
@@ -0,0 +1,596 @@
+///////////////////////////////////////////////////////////////////////////////
+// computeprogram.cpp
+// ============
+// load, compile and drive an OpenGL compute shader program
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ComputeProgram.h"
+
+#include "GLTrace.h"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// declaration of the global variables and defines
+namespace
+{
+	// where the build writes the optimized SPIR-V of each shader
+	const char* g_SpirvDirectory = "spirv/";
+
+	// pass-through shaders ShaderManager compiles to create the main
+	// program object, which the SPIR-V is then linked into
+	const char* g_StubVertexShaderFile = "program_stub.vert";
+	const char* g_StubFragmentShaderFile = "program_stub.frag";
+
+	// the shader.frag permutations the build compiles, by their USE_ switches
+	struct FRAGMENT_PERMUTATION
+	{
+		bool        bDirLight;
+		int         pointLights;
+		bool        bSpotLight;
+		const char* suffix;
+	};
+	const FRAGMENT_PERMUTATION g_FragmentPermutations[] =
+	{
+		{ true,  2, true,  "" },
+		{ true,  0, false, ".dir" },
+		{ false, 1, false, ".point" },
+		{ false, 0, true,  ".spot" },
+		{ false, 0, false, ".unlit" }
+	};
+
+	// programs loaded and milliseconds spent compiling and linking them
+	struct LOAD_TIMES
+	{
+		int programs;
+		double milliseconds;
+	};
+
+	bool g_bPreferSpirv = true;
+	LOAD_TIMES g_BinaryLoads = { 0, 0.0 };
+	LOAD_TIMES g_SpirvLoads = { 0, 0.0 };
+	LOAD_TIMES g_GlslLoads = { 0, 0.0 };
+	// the main program, from one of the paths
+	const char* g_MainProgramPath = NULL;
+	double g_MainProgramMilliseconds = 0.0;
+
+	// snapshot chunk of a program binary, followed by the binary itself
+	struct PROGRAM_BINARY_HEADER
+	{
+		uint32_t format;
+		uint32_t reserved;
+		uint64_t sourceSize;
+		int64_t  sourceTime;
+	};
+
+	// the snapshot binaries are loaded from, and every live program so
+	// their binaries can be saved
+	const SceneSnapshot* g_pSnapshot = NULL;
+	unsigned int g_SnapshotMisses = 0;
+	std::vector<ComputeProgram*> g_Programs;
+
+	bool CanLoadSpirv()
+	{
+		// binaries are not part of GL traces, so recordings stay on GLSL
+		return g_bPreferSpirv && (GLEW_VERSION_4_6 || GLEW_ARB_gl_spirv) && !GLTrace::IsRecording();
+	}
+
+	// spirv/<file><suffix>.spv of a shader
+	std::string GetSpirvFile(const char* shaderFile, const char* suffix)
+	{
+		const char* baseName = strrchr(shaderFile, '/');
+		baseName = (baseName != NULL) ? baseName + 1 : shaderFile;
+		return std::string(g_SpirvDirectory) + baseName + suffix + ".spv";
+	}
+
+	// returns 0 when there is no binary or the driver rejects it
+	GLuint CreateSpirvShader(const std::string& binaryFile, GLenum stage)
+	{
+		std::ifstream file(binaryFile.c_str(), std::ios::binary);
+		if (!file.is_open())
+			return 0;
+
+		std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (binary.empty() || (binary.size() % 4) != 0)
+		{
+			std::cout << "[WARNING] Invalid SPIR-V binary " << binaryFile << ", compiling the GLSL" << std::endl;
+			return 0;
+		}
+
+		GLuint shaderID = glCreateShader(stage);
+		glShaderBinary(1, &shaderID, GL_SHADER_BINARY_FORMAT_SPIR_V_ARB, &binary[0], (GLsizei)binary.size());
+		if (GLEW_VERSION_4_6)
+			glSpecializeShader(shaderID, "main", 0, NULL, NULL);
+		else
+			glSpecializeShaderARB(shaderID, "main", 0, NULL, NULL);
+
+		GLint success = 0;
+		glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[1024];
+			glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+			std::cout << "[WARNING] SPIR-V specialization failed for " << binaryFile << ", compiling the GLSL:\n" << infoLog << std::endl;
+			glDeleteShader(shaderID);
+			return 0;
+		}
+		return shaderID;
+	}
+
+	GLuint CompileGlslShader(const char* shaderFile, GLenum stage)
+	{
+		std::ifstream file(shaderFile);
+		if (!file.is_open())
+		{
+			std::cout << "Could not open shader:" << shaderFile << std::endl;
+			return 0;
+		}
+
+		std::stringstream sourceStream;
+		sourceStream << file.rdbuf();
+		std::string source = sourceStream.str();
+		const char* sourceText = source.c_str();
+
+		GLuint shaderID = glCreateShader(stage);
+		glShaderSource(shaderID, 1, &sourceText, NULL);
+		glCompileShader(shaderID);
+
+		GLint success = 0;
+		glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[1024];
+			glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+			std::cout << "Shader compile error in " << shaderFile << ":\n" << infoLog << std::endl;
+			glDeleteShader(shaderID);
+			return 0;
+		}
+		return shaderID;
+	}
+
+	// the uniforms are set by name, which SPIR-V only carries as
+	// optional debug names that not every driver keeps
+	bool KeepsUniformNames(GLuint programID, const std::string& binaryFile)
+	{
+		GLint uniforms = 0;
+		glGetProgramInterfaceiv(programID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniforms);
+		for (GLint i = 0; i < uniforms; i++)
+		{
+			const GLenum property = GL_NAME_LENGTH;
+			GLint nameLength = 0;
+			glGetProgramResourceiv(programID, GL_UNIFORM, (GLuint)i, 1, &property, 1, NULL, &nameLength);
+			if (nameLength <= 1)
+			{
+				std::cout << "[WARNING] Driver drops the SPIR-V uniform names of " << binaryFile << ", compiling the GLSL" << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// replace the shaders of a program and link it again, it keeps its name
+	bool RelinkProgram(GLuint programID, GLuint vertexShaderID, GLuint fragmentShaderID)
+	{
+		GLuint attached[8];
+		GLsizei attachedCount = 0;
+		glGetAttachedShaders(programID, 8, &attachedCount, attached);
+		for (GLsizei i = 0; i < attachedCount; i++)
+			glDetachShader(programID, attached[i]);
+
+		glAttachShader(programID, vertexShaderID);
+		glAttachShader(programID, fragmentShaderID);
+		glLinkProgram(programID);
+		glDetachShader(programID, vertexShaderID);
+		glDetachShader(programID, fragmentShaderID);
+
+		GLint success = 0;
+		glGetProgramiv(programID, GL_LINK_STATUS, &success);
+		return success != 0;
+	}
+}
+
+/***********************************************************
+ *  ComputeProgram()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ComputeProgram::ComputeProgram()
+{
+	m_programID = 0;
+	g_Programs.push_back(this);
+}
+
+/***********************************************************
+ *  ~ComputeProgram()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ComputeProgram::~ComputeProgram()
+{
+	g_Programs.erase(std::remove(g_Programs.begin(), g_Programs.end(), this), g_Programs.end());
+	if (m_programID != 0)
+	{
+		glDeleteProgram(m_programID);
+		m_programID = 0;
+	}
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading the compute program from
+ *  the SPIR-V compiled for the passed in file when the driver
+ *  can consume it, falling back to compiling the GLSL source.
+ ***********************************************************/
+bool ComputeProgram::Load(const char* computeShaderFile)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// binaries are not part of GL traces, so recordings stay on GLSL
+	GLuint programID = 0;
+	LOAD_TIMES* pTimes = &g_GlslLoads;
+	if (NULL != g_pSnapshot && !GLTrace::IsRecording())
+	{
+		programID = LoadBinary(computeShaderFile);
+		pTimes = &g_BinaryLoads;
+		if (programID == 0)
+			g_SnapshotMisses++;
+	}
+	if (programID == 0 && CanLoadSpirv())
+	{
+		programID = LoadSpirv(computeShaderFile);
+		pTimes = &g_SpirvLoads;
+	}
+	if (programID == 0)
+	{
+		programID = LoadGlsl(computeShaderFile);
+		pTimes = &g_GlslLoads;
+	}
+	if (programID == 0)
+		return false;
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	LOAD_TIMES& times = *pTimes;
+	times.programs++;
+	times.milliseconds += milliseconds;
+
+	if (m_programID != 0)
+		glDeleteProgram(m_programID);
+
+	m_programID = programID;
+	m_shaderFile = computeShaderFile;
+	m_uniformLocations.clear();
+
+	return true;
+}
+
+/***********************************************************
+ *  LoadBinary()
+ *
+ *  This method is used for creating the program from the
+ *  binary the driver returned on the last launch, kept in
+ *  the warm start snapshot. It returns 0 when there is no
+ *  binary, the shader file changed since, or the driver no
+ *  longer accepts it, e.g. after an update.
+ ***********************************************************/
+GLuint ComputeProgram::LoadBinary(const char* computeShaderFile)
+{
+	size_t size = 0;
+	const PROGRAM_BINARY_HEADER* pHeader =
+		(const PROGRAM_BINARY_HEADER*)g_pSnapshot->FindChunk(SNAPSHOT_PROGRAM, computeShaderFile, &size);
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if (NULL == pHeader || size <= sizeof(PROGRAM_BINARY_HEADER) ||
+		!SceneSnapshot::GetFileStamp(computeShaderFile, sourceSize, sourceTime) ||
+		pHeader->sourceSize != sourceSize || pHeader->sourceTime != sourceTime)
+	{
+		return 0;
+	}
+
+	GLuint programID = glCreateProgram();
+	glProgramBinary(programID, pHeader->format, pHeader + 1, (GLsizei)(size - sizeof(PROGRAM_BINARY_HEADER)));
+
+	GLint success = 0;
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(programID);
+		return 0;
+	}
+	return programID;
+}
+
+/***********************************************************
+ *  LoadSpirv()
+ *
+ *  This method is used for creating the program from the
+ *  offline compiled spirv/<file>.spv. It returns 0 when there
+ *  is no binary, the driver rejects it or the uniforms lost
+ *  their names, so the caller can compile the GLSL instead.
+ ***********************************************************/
+GLuint ComputeProgram::LoadSpirv(const char* computeShaderFile)
+{
+	std::string binaryFile = GetSpirvFile(computeShaderFile, "");
+	GLuint shaderID = CreateSpirvShader(binaryFile, GL_COMPUTE_SHADER);
+	if (shaderID == 0)
+		return 0;
+
+	GLuint programID = glCreateProgram();
+	glAttachShader(programID, shaderID);
+	glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(programID);
+	glDeleteShader(shaderID);
+
+	GLint success = 0;
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		std::cout << "[WARNING] SPIR-V program link failed for " << binaryFile << ", compiling the GLSL" << std::endl;
+		glDeleteProgram(programID);
+		return 0;
+	}
+	if (!KeepsUniformNames(programID, binaryFile))
+	{
+		glDeleteProgram(programID);
+		return 0;
+	}
+
+	return programID;
+}
+
+/***********************************************************
+ *  LoadGlsl()
+ *
+ *  This method is used for reading the compute shader source
+ *  from the passed in file, then compiling and linking it.
+ ***********************************************************/
+GLuint ComputeProgram::LoadGlsl(const char* computeShaderFile)
+{
+	GLuint shaderID = CompileGlslShader(computeShaderFile, GL_COMPUTE_SHADER);
+	if (shaderID == 0)
+		return 0;
+
+	GLuint programID = glCreateProgram();
+	glAttachShader(programID, shaderID);
+	glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(programID);
+	glDeleteShader(shaderID);
+
+	GLint success = 0;
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		char infoLog[1024];
+		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Compute program link error in " << computeShaderFile << ":\n" << infoLog << std::endl;
+		glDeleteProgram(programID);
+		return 0;
+	}
+
+	return programID;
+}
+
+/***********************************************************
+ *  LoadMainProgram()
+ *
+ *  This method is used for loading the main program of the
+ *  scene from spirv/<vertex>.spv and the SPIR-V permutation
+ *  of the fragment shader for the passed in lights. The
+ *  ShaderManager links the pass-through stub shaders into a
+ *  program object, and the SPIR-V is linked into that object
+ *  in place, so the uniforms the ShaderManager sets by name
+ *  reach it. When the binaries are missing or rejected the
+ *  same object is linked from the GLSL instead; without
+ *  SPIR-V support the ShaderManager compiles the GLSL.
+ ***********************************************************/
+bool ComputeProgram::LoadMainProgram(ShaderManager* pShaderManager, const char* vertexShaderFile, const char* fragmentShaderFile,
+	bool bDirLight, int pointLights, bool bSpotLight)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	const FRAGMENT_PERMUTATION* pPermutation = NULL;
+	for (size_t i = 0; i < sizeof(g_FragmentPermutations) / sizeof(g_FragmentPermutations[0]); i++)
+	{
+		const FRAGMENT_PERMUTATION& permutation = g_FragmentPermutations[i];
+		if (permutation.bDirLight == bDirLight && permutation.pointLights == pointLights && permutation.bSpotLight == bSpotLight)
+			pPermutation = &permutation;
+	}
+
+	GLuint programID = 0;
+	GLint linked = 0;
+	if (NULL != pPermutation && CanLoadSpirv())
+	{
+		programID = pShaderManager->LoadShaders(g_StubVertexShaderFile, g_StubFragmentShaderFile);
+		if (programID != 0)
+		{
+			std::string vertexBinaryFile = GetSpirvFile(vertexShaderFile, "");
+			std::string fragmentBinaryFile = GetSpirvFile(fragmentShaderFile, pPermutation->suffix);
+			GLuint vertexShaderID = CreateSpirvShader(vertexBinaryFile, GL_VERTEX_SHADER);
+			GLuint fragmentShaderID = (vertexShaderID != 0) ? CreateSpirvShader(fragmentBinaryFile, GL_FRAGMENT_SHADER) : 0;
+			if (fragmentShaderID != 0)
+			{
+				if (!RelinkProgram(programID, vertexShaderID, fragmentShaderID))
+					std::cout << "[WARNING] SPIR-V program link failed for " << fragmentBinaryFile << ", compiling the GLSL" << std::endl;
+				else if (KeepsUniformNames(programID, fragmentBinaryFile))
+					g_MainProgramPath = "SPIR-V";
+			}
+			if (vertexShaderID != 0)
+				glDeleteShader(vertexShaderID);
+			if (fragmentShaderID != 0)
+				glDeleteShader(fragmentShaderID);
+		}
+
+		// the ShaderManager keeps the program object, so the GLSL goes into it too
+		if (NULL == g_MainProgramPath && programID != 0)
+		{
+			GLuint vertexShaderID = CompileGlslShader(vertexShaderFile, GL_VERTEX_SHADER);
+			GLuint fragmentShaderID = (vertexShaderID != 0) ? CompileGlslShader(fragmentShaderFile, GL_FRAGMENT_SHADER) : 0;
+			if (fragmentShaderID != 0 && RelinkProgram(programID, vertexShaderID, fragmentShaderID))
+				g_MainProgramPath = "GLSL";
+			if (vertexShaderID != 0)
+				glDeleteShader(vertexShaderID);
+			if (fragmentShaderID != 0)
+				glDeleteShader(fragmentShaderID);
+		}
+	}
+	else
+	{
+		programID = pShaderManager->LoadShaders(vertexShaderFile, fragmentShaderFile);
+		if (programID != 0)
+			glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+		if (linked)
+			g_MainProgramPath = "GLSL";
+	}
+
+	g_MainProgramMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (NULL == g_MainProgramPath)
+	{
+		std::cout << "[ERROR] The main program did not link from " << vertexShaderFile << " and " << fragmentShaderFile << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  SetPreferSpirv() / ReportLoadTimes()
+ *
+ *  These methods are used for switching the SPIR-V path off,
+ *  so the GLSL compile time can be measured, and for printing
+ *  the time spent loading the programs of each path.
+ ***********************************************************/
+void ComputeProgram::SetPreferSpirv(bool bPreferSpirv)
+{
+	g_bPreferSpirv = bPreferSpirv;
+}
+
+void ComputeProgram::ReportLoadTimes()
+{
+	std::cout << "[SHADER] compute programs: " << g_BinaryLoads.programs << " from snapshot binaries in "
+		<< g_BinaryLoads.milliseconds << " ms, " << g_SpirvLoads.programs << " from SPIR-V in " << g_SpirvLoads.milliseconds
+		<< " ms, " << g_GlslLoads.programs << " from GLSL in " << g_GlslLoads.milliseconds << " ms" << std::endl;
+	if (NULL != g_MainProgramPath)
+		std::cout << "[SHADER] main program: from " << g_MainProgramPath << " in " << g_MainProgramMilliseconds << " ms" << std::endl;
+}
+
+/***********************************************************
+ *  SetSnapshot() / AddBinariesToSnapshot() / GetSnapshotMisses()
+ *
+ *  These methods are used for loading the programs from the
+ *  binaries of a mapped warm start snapshot, for saving the
+ *  binaries of every loaded program into a new one, and for
+ *  telling whether the mapped one is out of date.
+ ***********************************************************/
+void ComputeProgram::SetSnapshot(const SceneSnapshot* pSnapshot)
+{
+	g_pSnapshot = pSnapshot;
+	g_SnapshotMisses = 0;
+}
+
+unsigned int ComputeProgram::GetSnapshotMisses()
+{
+	return g_SnapshotMisses;
+}
+
+void ComputeProgram::AddBinariesToSnapshot(SceneSnapshot& snapshot)
+{
+	for (size_t i = 0; i < g_Programs.size(); i++)
+	{
+		const ComputeProgram* pProgram = g_Programs[i];
+		if (pProgram->m_programID == 0)
+			continue;
+
+		GLint length = 0;
+		glGetProgramiv(pProgram->m_programID, GL_PROGRAM_BINARY_LENGTH, &length);
+		PROGRAM_BINARY_HEADER header;
+		header.reserved = 0;
+		if (length <= 0 || !SceneSnapshot::GetFileStamp(pProgram->m_shaderFile.c_str(), header.sourceSize, header.sourceTime))
+			continue;
+
+		std::vector<char> chunk(sizeof(PROGRAM_BINARY_HEADER) + length);
+		GLenum format = 0;
+		glGetProgramBinary(pProgram->m_programID, length, &length, &format, &chunk[sizeof(PROGRAM_BINARY_HEADER)]);
+		header.format = format;
+		memcpy(&chunk[0], &header, sizeof(header));
+		snapshot.AddChunk(SNAPSHOT_PROGRAM, pProgram->m_shaderFile.c_str(), &chunk[0], sizeof(PROGRAM_BINARY_HEADER) + length);
+	}
+}
+
+/***********************************************************
+ *  use()
+ *
+ *  This method is used for making the compute program the
+ *  active OpenGL program.
+ ***********************************************************/
+void ComputeProgram::use() const
+{
+	glUseProgram(m_programID);
+}
+
+/***********************************************************
+ *  Dispatch()
+ *
+ *  This method is used for launching the compute program.
+ ***********************************************************/
+void ComputeProgram::Dispatch(GLuint groupsX, GLuint groupsY, GLuint groupsZ) const
+{
+	glDispatchCompute(groupsX, groupsY, groupsZ);
+}
+
+/***********************************************************
+ *  GetUniformLocation()
+ *
+ *  This method is used for looking up a uniform location,
+ *  caching it so the name is only queried once. Only the
+ *  first set of a name allocates, the frame loop does not.
+ ***********************************************************/
+GLint ComputeProgram::GetUniformLocation(const char* name)
+{
+	for (size_t i = 0; i < m_uniformLocations.size(); i++)
+	{
+		if (strcmp(m_uniformLocations[i].name.c_str(), name) == 0)
+			return m_uniformLocations[i].location;
+	}
+
+	UNIFORM_LOCATION uniform;
+	uniform.name = name;
+	uniform.location = glGetUniformLocation(m_programID, name);
+	m_uniformLocations.push_back(uniform);
+	return uniform.location;
+}
+
+void ComputeProgram::setIntValue(const char* name, int value)
+{
+	glUniform1i(GetUniformLocation(name), value);
+}
+
+void ComputeProgram::setFloatValue(const char* name, float value)
+{
+	glUniform1f(GetUniformLocation(name), value);
+}
+
+void ComputeProgram::setVec2Value(const char* name, glm::vec2 value)
+{
+	glUniform2fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ComputeProgram::setVec3Value(const char* name, glm::vec3 value)
+{
+	glUniform3fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ComputeProgram::setVec4Value(const char* name, glm::vec4 value)
+{
+	glUniform4fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void ComputeProgram::setMat4Value(const char* name, glm::mat4 value)
+{
+	glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+}
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// computeprogram.h
+// ============
+// load, compile and drive an OpenGL compute shader program
+//
+//	A program is loaded from the SPIR-V the build compiled and optimized
+//	offline (spirv/<file>.spv, see Tools/ShaderBuild) when the driver
+//	supports GL_ARB_gl_spirv, and from the GLSL source otherwise. The
+//	time spent compiling and linking is summed per path so the startup
+//	cost of both can be compared. With a warm start snapshot mapped, the
+//	driver's program binary from the last launch is tried before either.
+//
+//	The main vertex and fragment program of the scene is loaded from its
+//	SPIR-V the same way, see LoadMainProgram. ShaderManager creates the
+//	program object and sets its uniforms by name, so the SPIR-V is linked
+//	into that program object in place.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "SceneSnapshot.h"
+#include "ShaderManager.h"
+
+class ComputeProgram
+{
+public:
+	// constructor
+	ComputeProgram();
+	// destructor
+	~ComputeProgram();
+
+	// load the compute shader, from its SPIR-V when available or else
+	// by compiling the GLSL file
+	bool Load(const char* computeShaderFile);
+	// set the compute program as the active program
+	void use() const;
+	// launch the compute program with the given work group counts
+	void Dispatch(GLuint groupsX, GLuint groupsY, GLuint groupsZ) const;
+
+	bool IsLoaded() const { return m_programID != 0; }
+	GLuint GetProgramID() const { return m_programID; }
+
+	// uniform setters, matching the ShaderManager naming
+	void setIntValue(const char* name, int value);
+	void setFloatValue(const char* name, float value);
+	void setVec2Value(const char* name, glm::vec2 value);
+	void setVec3Value(const char* name, glm::vec3 value);
+	void setVec4Value(const char* name, glm::vec4 value);
+	void setMat4Value(const char* name, glm::mat4 value);
+
+	// load the main program of the passed in ShaderManager from the SPIR-V
+	// of the shaders, the fragment shader in the permutation of the passed
+	// in lights, or else from their GLSL; false if neither links
+	static bool LoadMainProgram(ShaderManager* pShaderManager, const char* vertexShaderFile, const char* fragmentShaderFile,
+		bool bDirLight, int pointLights, bool bSpotLight);
+
+	// allow loading precompiled SPIR-V, on by default
+	static void SetPreferSpirv(bool bPreferSpirv);
+	// print the compile and link time of the programs loaded so far
+	static void ReportLoadTimes();
+	// load program binaries from the passed in snapshot, NULL stops it
+	static void SetSnapshot(const SceneSnapshot* pSnapshot);
+	// add the binaries of every loaded program to the snapshot
+	static void AddBinariesToSnapshot(SceneSnapshot& snapshot);
+	// programs that were compiled since the snapshot had no usable binary
+	static unsigned int GetSnapshotMisses();
+
+private:
+	GLuint m_programID;
+	// the shader file the program was loaded for
+	std::string m_shaderFile;
+	// uniform locations are looked up once per name; a program has a
+	// handful of uniforms, so a scan compares the names in place and a
+	// set never builds a std::string
+	struct UNIFORM_LOCATION
+	{
+		std::string name;
+		GLint       location;
+	};
+	std::vector<UNIFORM_LOCATION> m_uniformLocations;
+
+	GLint GetUniformLocation(const char* name);
+	GLuint LoadBinary(const char* computeShaderFile);
+	GLuint LoadSpirv(const char* computeShaderFile);
+	GLuint LoadGlsl(const char* computeShaderFile);
+};
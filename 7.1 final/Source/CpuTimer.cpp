@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// cputimer.cpp
+// ============
+// measure the CPU time spent in a stage of the frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CpuTimer.h"
+#include "AllocationTracker.h"
+#include "GLDebugOutput.h"
+
+#include <cstddef>
+
+// declaration of the global variables and defines
+namespace
+{
+	// weight of a new sample in the smoothed timing
+	const double g_AverageWeight = 0.1;
+
+	// receives the samples of every timer
+	CpuTimer::Listener* g_pListener = NULL;
+}
+
+/***********************************************************
+ *  CpuTimer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CpuTimer::CpuTimer(const char* name)
+{
+	m_name = name;
+	m_bActive = false;
+	m_lastMilliseconds = 0.0;
+	m_averageMilliseconds = 0.0;
+	m_sampleCount = 0;
+	m_bHardwareCounters = false;
+
+	for (int i = 0; i < PerfCounters::COUNTER_COUNT; i++)
+	{
+		m_startCounters[i] = 0;
+		m_lastCounters[i] = 0;
+		m_averageCounters[i] = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetListener()
+ *
+ *  This method is used for passing every sample recorded by
+ *  any timer on to the passed in listener.
+ ***********************************************************/
+void CpuTimer::SetListener(Listener* pListener)
+{
+	g_pListener = pListener;
+}
+
+/***********************************************************
+ *  EnableHardwareCounters()
+ *
+ *  This method is used for recording the CPU hardware
+ *  counters along with the time of each sample. Without
+ *  permission for the counters only the time is recorded.
+ ***********************************************************/
+bool CpuTimer::EnableHardwareCounters()
+{
+	m_bHardwareCounters = PerfCounters::Initialize();
+	return m_bHardwareCounters;
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for recording the start time of the
+ *  stage.
+ ***********************************************************/
+void CpuTimer::Begin()
+{
+	// counters are read first so the clock is not counted in them
+	if (m_bHardwareCounters)
+		PerfCounters::Read(m_startCounters);
+
+	m_start = CLOCK::now();
+	m_bActive = true;
+	GLDebugOutput::PushScope(m_name);
+	AllocationTracker::PushScope(m_name);
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method is used for recording the elapsed time since
+ *  Begin() as a new sample.
+ ***********************************************************/
+void CpuTimer::End()
+{
+	if (!m_bActive)
+		return;
+
+	std::chrono::duration<double, std::milli> elapsed = CLOCK::now() - m_start;
+	m_bActive = false;
+	GLDebugOutput::PopScope();
+	AllocationTracker::PopScope();
+
+	if (m_bHardwareCounters)
+	{
+		uint64_t counters[PerfCounters::COUNTER_COUNT];
+		if (PerfCounters::Read(counters))
+		{
+			for (int i = 0; i < PerfCounters::COUNTER_COUNT; i++)
+			{
+				m_lastCounters[i] = counters[i] - m_startCounters[i];
+				if (m_sampleCount == 0)
+					m_averageCounters[i] = (double)m_lastCounters[i];
+				else
+					m_averageCounters[i] += ((double)m_lastCounters[i] - m_averageCounters[i]) * g_AverageWeight;
+			}
+		}
+	}
+
+	m_lastMilliseconds = elapsed.count();
+	if (m_sampleCount == 0)
+		m_averageMilliseconds = m_lastMilliseconds;
+	else
+		m_averageMilliseconds += (m_lastMilliseconds - m_averageMilliseconds) * g_AverageWeight;
+	m_sampleCount++;
+
+	if (NULL != g_pListener)
+		g_pListener->OnSample(*this);
+}
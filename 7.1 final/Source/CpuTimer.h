@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// cputimer.h
+// ============
+// measure the CPU time spent in a stage of the frame
+//
+//	The CPU side counterpart of GpuTimer, used to profile stages such as
+//	culling and draw submission. A Scope times the block it lives in.
+//	Selected timers also record CPU hardware counters for each sample.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+
+#include "PerfCounters.h"
+
+class CpuTimer
+{
+public:
+	// times the enclosing block with the passed in timer
+	class Scope
+	{
+	public:
+		Scope(CpuTimer& timer) : m_timer(timer) { m_timer.Begin(); }
+		~Scope() { m_timer.End(); }
+
+	private:
+		CpuTimer& m_timer;
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+	};
+
+	// receives every sample recorded by any timer, e.g. for tracing
+	class Listener
+	{
+	public:
+		virtual ~Listener() {}
+		virtual void OnSample(const CpuTimer& timer) = 0;
+	};
+
+	// set the listener for all timers, NULL to remove it
+	static void SetListener(Listener* pListener);
+
+	// constructor
+	CpuTimer(const char* name);
+
+	// start timing the stage
+	void Begin();
+	// stop timing the stage and record the sample
+	void End();
+	// also record hardware counters, returns false if they are not available
+	bool EnableHardwareCounters();
+
+	// name used when reporting the timing
+	const char* GetName() const { return m_name; }
+	// most recent CPU time, in milliseconds
+	double GetLastMilliseconds() const { return m_lastMilliseconds; }
+	// smoothed CPU time, in milliseconds
+	double GetAverageMilliseconds() const { return m_averageMilliseconds; }
+	// number of samples recorded
+	unsigned int GetSampleCount() const { return m_sampleCount; }
+	// whether hardware counters are recorded for this stage
+	bool HasHardwareCounters() const { return m_bHardwareCounters; }
+	// most recent and smoothed count of a hardware counter per sample
+	uint64_t GetLastCounter(PerfCounters::COUNTER counter) const { return m_lastCounters[counter]; }
+	double GetAverageCounter(PerfCounters::COUNTER counter) const { return m_averageCounters[counter]; }
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	const char*       m_name;
+	CLOCK::time_point m_start;
+	bool              m_bActive;
+	double            m_lastMilliseconds;
+	double            m_averageMilliseconds;
+	unsigned int      m_sampleCount;
+
+	bool              m_bHardwareCounters;
+	uint64_t          m_startCounters[PerfCounters::COUNTER_COUNT];
+	uint64_t          m_lastCounters[PerfCounters::COUNTER_COUNT];
+	double            m_averageCounters[PerfCounters::COUNTER_COUNT];
+};
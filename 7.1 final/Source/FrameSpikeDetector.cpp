@@ -0,0 +1,336 @@
+///////////////////////////////////////////////////////////////////////////////
+// framespikedetector.cpp
+// ============
+// catch intermittent frame hitches and dump the frames around them
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameSpikeDetector.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// resource event type counted as a texture upload in the dump context
+	const char* g_TextureUploadType = "texture upload";
+
+	// thread lanes of the trace viewer
+	const int g_FrameLane = 1;
+	const int g_CpuLane = 2;
+	const int g_ResourceLane = 3;
+
+	void WriteEscaped(std::ostream& out, const char* text)
+	{
+		for (const char* c = text; *c != '\0'; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				out << '\\' << *c;
+			else if ((unsigned char)*c >= 0x20)
+				out << *c;
+		}
+	}
+}
+
+/***********************************************************
+ *  FrameSpikeDetector()
+ *
+ *  The constructor for the class. The event ring is sized
+ *  up front so recording never allocates during a frame.
+ ***********************************************************/
+FrameSpikeDetector::FrameSpikeDetector()
+{
+	m_spikeMultiple = 2.0;
+	m_windowSeconds = 3.0;
+	m_tracePrefix = "frame_spike";
+
+	m_events.resize(EVENT_CAPACITY);
+	m_nextEvent = 0;
+	m_eventCount = 0;
+
+	m_frameTimes.resize(FRAME_HISTORY, 0.0);
+	m_sortedFrameTimes.reserve(FRAME_HISTORY);
+	m_nextFrameTime = 0;
+	m_frameTimeCount = 0;
+
+	m_epoch = CLOCK::now();
+	m_frameStartUs = 0.0;
+	m_bFrameStarted = false;
+	m_frameNumber = 0;
+	m_lastDumpUs = -1e30;
+	m_dumpCount = 0;
+	m_loadsInFlight = 0;
+
+	CpuTimer::SetListener(this);
+}
+
+/***********************************************************
+ *  ~FrameSpikeDetector()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameSpikeDetector::~FrameSpikeDetector()
+{
+	CpuTimer::SetListener(NULL);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for closing the previous frame. Its
+ *  time from start to start, which includes the buffer swap,
+ *  is compared with the median of the recent frames and the
+ *  history is dumped when it is a spike.
+ ***********************************************************/
+void FrameSpikeDetector::BeginFrame()
+{
+	double nowUs = Now();
+
+	if (m_bFrameStarted)
+	{
+		double frameUs = nowUs - m_frameStartUs;
+		TRACE_EVENT& frame = AddEvent(EVENT_FRAME, "Frame", m_frameStartUs);
+		frame.durationUs = frameUs;
+		frame.value = (double)m_frameNumber;
+
+		if (m_spikeMultiple > 0.0 && m_frameTimeCount >= MIN_FRAMES)
+		{
+			double medianUs = MedianFrameTime();
+			// one dump per window, so a burst of slow frames is one trace
+			if (frameUs > medianUs * m_spikeMultiple && (nowUs - m_lastDumpUs) > m_windowSeconds * 1000000.0)
+			{
+				WriteTrace(frameUs, medianUs, nowUs);
+				m_lastDumpUs = nowUs;
+			}
+		}
+
+		m_frameTimes[m_nextFrameTime] = frameUs;
+		m_nextFrameTime = (m_nextFrameTime + 1) % FRAME_HISTORY;
+		m_frameTimeCount = std::min(m_frameTimeCount + 1, (int)FRAME_HISTORY);
+		m_frameNumber++;
+	}
+
+	m_frameStartUs = nowUs;
+	m_bFrameStarted = true;
+}
+
+/***********************************************************
+ *  OnSample()
+ *
+ *  This method is used for recording a finished CPU scope,
+ *  along with its hardware counters when it has them.
+ ***********************************************************/
+void FrameSpikeDetector::OnSample(const CpuTimer& timer)
+{
+	double durationUs = timer.GetLastMilliseconds() * 1000.0;
+	TRACE_EVENT& event = AddEvent(EVENT_CPU_SCOPE, timer.GetName(), Now() - durationUs);
+	event.durationUs = durationUs;
+
+	event.bCounters = timer.HasHardwareCounters();
+	for (int i = 0; i < PerfCounters::COUNTER_COUNT && event.bCounters; i++)
+		event.counters[i] = timer.GetLastCounter((PerfCounters::COUNTER)i);
+}
+
+/***********************************************************
+ *  RecordGpuTime()
+ *
+ *  This method is used for recording the latest result of a
+ *  GPU timer. Results are read back a few frames late, so
+ *  they land after the frame that issued the work.
+ ***********************************************************/
+void FrameSpikeDetector::RecordGpuTime(const char* name, double milliseconds)
+{
+	TRACE_EVENT& event = AddEvent(EVENT_GPU_TIME, name, Now());
+	event.value = milliseconds;
+}
+
+/***********************************************************
+ *  RecordResourceEvent()
+ *
+ *  This method is used for recording a resource event, with
+ *  the name of the resource and the number of bytes moved.
+ ***********************************************************/
+void FrameSpikeDetector::RecordResourceEvent(const char* type, const char* name, uint64_t bytes)
+{
+	TRACE_EVENT& event = AddEvent(EVENT_RESOURCE, type, Now());
+	event.bytes = bytes;
+
+	size_t length = 0;
+	while (name != NULL && name[length] != '\0' && length < sizeof(event.detail) - 1)
+	{
+		event.detail[length] = name[length];
+		length++;
+	}
+	event.detail[length] = '\0';
+}
+
+/***********************************************************
+ *  RecordTextureUpload()
+ *
+ *  This method is used for recording a texture upload, which
+ *  is summed up in the context of a dump.
+ ***********************************************************/
+void FrameSpikeDetector::RecordTextureUpload(const char* name, uint64_t bytes)
+{
+	RecordResourceEvent(g_TextureUploadType, name, bytes);
+}
+
+/***********************************************************
+ *  BeginResourceLoad()
+ *  EndResourceLoad()
+ *
+ *  These methods are used for counting the resource loads
+ *  that are in flight.
+ ***********************************************************/
+void FrameSpikeDetector::BeginResourceLoad()
+{
+	m_loadsInFlight++;
+}
+
+void FrameSpikeDetector::EndResourceLoad()
+{
+	if (m_loadsInFlight > 0)
+		m_loadsInFlight--;
+}
+
+/***********************************************************
+ *  Now()
+ *
+ *  This method is used for getting the time since the
+ *  detector was created, in microseconds.
+ ***********************************************************/
+double FrameSpikeDetector::Now() const
+{
+	std::chrono::duration<double, std::micro> elapsed = CLOCK::now() - m_epoch;
+	return elapsed.count();
+}
+
+/***********************************************************
+ *  AddEvent()
+ *
+ *  This method is used for taking the next slot of the event
+ *  ring, overwriting the oldest event once it is full.
+ ***********************************************************/
+FrameSpikeDetector::TRACE_EVENT& FrameSpikeDetector::AddEvent(EVENT_TYPE type, const char* name, double timestampUs)
+{
+	TRACE_EVENT& event = m_events[m_nextEvent];
+	m_nextEvent = (m_nextEvent + 1) % EVENT_CAPACITY;
+	m_eventCount = std::min(m_eventCount + 1, (int)EVENT_CAPACITY);
+
+	event.type = type;
+	event.name = name;
+	event.detail[0] = '\0';
+	event.timestampUs = timestampUs;
+	event.durationUs = 0.0;
+	event.value = 0.0;
+	event.bytes = 0;
+	event.bCounters = false;
+
+	return event;
+}
+
+/***********************************************************
+ *  MedianFrameTime()
+ *
+ *  This method is used for finding the median of the frame
+ *  time history, which unlike the mean is not pulled up by
+ *  the spikes themselves.
+ ***********************************************************/
+double FrameSpikeDetector::MedianFrameTime()
+{
+	m_sortedFrameTimes.assign(m_frameTimes.begin(), m_frameTimes.begin() + m_frameTimeCount);
+	std::vector<double>::iterator middle = m_sortedFrameTimes.begin() + m_frameTimeCount / 2;
+	std::nth_element(m_sortedFrameTimes.begin(), middle, m_sortedFrameTimes.end());
+	return *middle;
+}
+
+/***********************************************************
+ *  WriteTrace()
+ *
+ *  This method is used for writing the events of the last
+ *  window to a Chrome trace file, with the spike and the
+ *  resource loading context stored as metadata.
+ ***********************************************************/
+void FrameSpikeDetector::WriteTrace(double frameUs, double medianUs, double nowUs)
+{
+	std::ostringstream fileName;
+	fileName << m_tracePrefix << "_" << m_frameNumber << ".json";
+
+	std::ofstream out(fileName.str().c_str());
+	if (!out)
+	{
+		std::cout << "[ERROR] Could not write frame spike trace " << fileName.str() << std::endl;
+		return;
+	}
+
+	double windowStartUs = nowUs - m_windowSeconds * 1000000.0;
+	int texturesUploaded = 0;
+	uint64_t bytesUploaded = 0;
+
+	out << "{\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << g_FrameLane << ",\"args\":{\"name\":\"Frames\"}},\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << g_CpuLane << ",\"args\":{\"name\":\"CPU scopes\"}},\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << g_ResourceLane << ",\"args\":{\"name\":\"Resources\"}}";
+
+	int first = (m_nextEvent - m_eventCount + EVENT_CAPACITY) % EVENT_CAPACITY;
+	for (int i = 0; i < m_eventCount; i++)
+	{
+		const TRACE_EVENT& event = m_events[(first + i) % EVENT_CAPACITY];
+		if (event.timestampUs + event.durationUs < windowStartUs)
+			continue;
+
+		out << ",\n{\"name\":\"";
+		WriteEscaped(out, event.name);
+		out << "\",\"pid\":1,\"ts\":" << (uint64_t)event.timestampUs;
+
+		switch (event.type)
+		{
+		case EVENT_FRAME:
+			out << ",\"ph\":\"X\",\"tid\":" << g_FrameLane << ",\"dur\":" << (uint64_t)event.durationUs
+				<< ",\"args\":{\"frame\":" << (unsigned int)event.value << "}}";
+			break;
+		case EVENT_CPU_SCOPE:
+			out << ",\"ph\":\"X\",\"tid\":" << g_CpuLane << ",\"dur\":" << (uint64_t)event.durationUs << ",\"args\":{";
+			for (int c = 0, written = 0; c < PerfCounters::COUNTER_COUNT && event.bCounters; c++)
+			{
+				if (!PerfCounters::IsCounterAvailable((PerfCounters::COUNTER)c))
+					continue;
+				out << (written++ > 0 ? "," : "") << "\"" << PerfCounters::GetCounterName((PerfCounters::COUNTER)c)
+					<< "\":" << event.counters[c];
+			}
+			out << "}}";
+			break;
+		case EVENT_GPU_TIME:
+			out << ",\"ph\":\"C\",\"args\":{\"ms\":" << event.value << "}}";
+			break;
+		case EVENT_RESOURCE:
+			out << ",\"ph\":\"i\",\"s\":\"g\",\"tid\":" << g_ResourceLane << ",\"args\":{\"name\":\"";
+			WriteEscaped(out, event.detail);
+			out << "\",\"bytes\":" << event.bytes << "}}";
+
+			if (strcmp(event.name, g_TextureUploadType) == 0)
+			{
+				texturesUploaded++;
+				bytesUploaded += event.bytes;
+			}
+			break;
+		}
+	}
+
+	out << "\n],\n\"otherData\":{"
+		<< "\"spikeFrame\":" << m_frameNumber
+		<< ",\"frameMs\":" << frameUs / 1000.0
+		<< ",\"medianMs\":" << medianUs / 1000.0
+		<< ",\"spikeMultiple\":" << m_spikeMultiple
+		<< ",\"loadsInFlight\":" << m_loadsInFlight
+		<< ",\"texturesUploaded\":" << texturesUploaded
+		<< ",\"bytesUploaded\":" << bytesUploaded
+		<< "}}\n";
+
+	m_dumpCount++;
+	std::cout << "[SPIKE] Frame " << m_frameNumber << " took " << frameUs / 1000.0 << " ms (median "
+		<< medianUs / 1000.0 << " ms), trace written to " << fileName.str() << std::endl;
+}
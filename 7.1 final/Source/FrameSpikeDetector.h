@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// framespikedetector.h
+// ============
+// catch intermittent frame hitches and dump the frames around them
+//
+//	Every CPU scope, GPU timer result and resource event of the last few
+//	seconds is kept in a fixed size ring of trace events. When a frame
+//	takes longer than a multiple of the median of the recent frames, the
+//	window is written to a Chrome trace file (chrome://tracing, Perfetto)
+//	together with the loading context of the moment.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+
+#include "CpuTimer.h"
+
+class FrameSpikeDetector : public CpuTimer::Listener
+{
+public:
+	// constructor
+	FrameSpikeDetector();
+	// destructor
+	~FrameSpikeDetector();
+
+	// mark the start of a frame, which ends the previous one
+	void BeginFrame();
+	// record the latest result of a GPU timer
+	void RecordGpuTime(const char* name, double milliseconds);
+	// record a resource event such as a texture upload
+	void RecordResourceEvent(const char* type, const char* name, uint64_t bytes);
+	void RecordTextureUpload(const char* name, uint64_t bytes);
+	// bracket a resource load so dumps show the loads in flight
+	void BeginResourceLoad();
+	void EndResourceLoad();
+
+	// CpuTimer::Listener, records every CPU scope
+	void OnSample(const CpuTimer& timer);
+
+	// number of trace files written so far
+	unsigned int GetDumpCount() const { return m_dumpCount; }
+	// resource loads between BeginResourceLoad and EndResourceLoad
+	int GetLoadsInFlight() const { return m_loadsInFlight; }
+
+	// a frame longer than this multiple of the median is a spike, 0 disables
+	double      m_spikeMultiple;
+	// seconds of history written to a trace file
+	double      m_windowSeconds;
+	// prefix of the trace file names
+	const char* m_tracePrefix;
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	// capacity of the event ring and the frame time history
+	static const int EVENT_CAPACITY = 8192;
+	static const int FRAME_HISTORY = 120;
+	// frames recorded before spikes are detected
+	static const int MIN_FRAMES = 30;
+
+	enum EVENT_TYPE
+	{
+		EVENT_FRAME,
+		EVENT_CPU_SCOPE,
+		EVENT_GPU_TIME,
+		EVENT_RESOURCE
+	};
+
+	// one entry of the ring, fixed size so recording never allocates
+	struct TRACE_EVENT
+	{
+		EVENT_TYPE  type;
+		const char* name;
+		char        detail[96];
+		double      timestampUs;
+		double      durationUs;
+		double      value;
+		uint64_t    bytes;
+		bool        bCounters;
+		uint64_t    counters[PerfCounters::COUNTER_COUNT];
+	};
+
+	std::vector<TRACE_EVENT> m_events;
+	int                m_nextEvent;
+	int                m_eventCount;
+
+	std::vector<double> m_frameTimes;
+	std::vector<double> m_sortedFrameTimes;
+	int                m_nextFrameTime;
+	int                m_frameTimeCount;
+
+	CLOCK::time_point  m_epoch;
+	double             m_frameStartUs;
+	bool               m_bFrameStarted;
+	unsigned int       m_frameNumber;
+	double             m_lastDumpUs;
+	unsigned int       m_dumpCount;
+	int                m_loadsInFlight;
+
+	double Now() const;
+	TRACE_EVENT& AddEvent(EVENT_TYPE type, const char* name, double timestampUs);
+	double MedianFrameTime();
+	void WriteTrace(double frameUs, double medianUs, double nowUs);
+};
@@ -0,0 +1,319 @@
+///////////////////////////////////////////////////////////////////////////////
+// gldebugoutput.cpp
+// ============
+// collect driver warnings reported through the KHR_debug output
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLDebugOutput.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_CategoryNames[GLDebugOutput::CATEGORY_COUNT] = {
+		"error",
+		"implicit sync",
+		"shader recompile",
+		"buffer reallocation",
+		"performance",
+		"undefined behavior",
+		"deprecated",
+		"portability",
+		"other" };
+
+	// message text fragments identifying the common performance problems
+	struct CATEGORY_HINT
+	{
+		const char*             fragment;
+		GLDebugOutput::CATEGORY category;
+	};
+
+	const CATEGORY_HINT g_CategoryHints[] = {
+		{ "recompil",   GLDebugOutput::CATEGORY_SHADER_RECOMPILE },
+		{ "stall",      GLDebugOutput::CATEGORY_IMPLICIT_SYNC },
+		{ "synchroniz", GLDebugOutput::CATEGORY_IMPLICIT_SYNC },
+		{ "wait",       GLDebugOutput::CATEGORY_IMPLICIT_SYNC },
+		{ "busy",       GLDebugOutput::CATEGORY_IMPLICIT_SYNC },
+		{ "realloc",    GLDebugOutput::CATEGORY_BUFFER_REALLOCATION },
+		{ "orphan",     GLDebugOutput::CATEGORY_BUFFER_REALLOCATION },
+		{ "moved from", GLDebugOutput::CATEGORY_BUFFER_REALLOCATION },
+		{ "evict",      GLDebugOutput::CATEGORY_BUFFER_REALLOCATION } };
+
+	// one distinct message in one scope
+	struct MESSAGE_RECORD
+	{
+		GLDebugOutput::CATEGORY category;
+		std::string  scope;
+		std::string  text;
+		unsigned int firstFrame;
+		unsigned int count;
+	};
+
+	// deepest scope nesting that is attributed
+	const int MAX_SCOPE_DEPTH = 16;
+
+	bool g_bEnabled = false;
+	const char* g_scopes[MAX_SCOPE_DEPTH];
+	int g_scopeDepth = 0;
+
+	unsigned int g_frame = 0;
+	unsigned int g_frameCounts[GLDebugOutput::CATEGORY_COUNT];
+	unsigned int g_lastFrameCounts[GLDebugOutput::CATEGORY_COUNT];
+	std::map<std::string, MESSAGE_RECORD> g_messages;
+
+	GLDebugOutput::CATEGORY Classify(GLenum type, const std::string& lowerText)
+	{
+		switch (type)
+		{
+		case GL_DEBUG_TYPE_ERROR:
+			return GLDebugOutput::CATEGORY_ERROR;
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+			return GLDebugOutput::CATEGORY_UNDEFINED_BEHAVIOR;
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+			return GLDebugOutput::CATEGORY_DEPRECATED;
+		case GL_DEBUG_TYPE_PORTABILITY:
+			return GLDebugOutput::CATEGORY_PORTABILITY;
+		}
+
+		// drivers report performance problems as either type
+		for (size_t i = 0; i < sizeof(g_CategoryHints) / sizeof(g_CategoryHints[0]); i++)
+		{
+			if (lowerText.find(g_CategoryHints[i].fragment) != std::string::npos)
+				return g_CategoryHints[i].category;
+		}
+
+		return (type == GL_DEBUG_TYPE_PERFORMANCE) ? GLDebugOutput::CATEGORY_PERFORMANCE : GLDebugOutput::CATEGORY_OTHER;
+	}
+
+	std::string CurrentScope()
+	{
+		if (g_scopeDepth == 0)
+			return "(no scope)";
+
+		std::string scope;
+		for (int i = 0; i < std::min(g_scopeDepth, MAX_SCOPE_DEPTH); i++)
+		{
+			if (i > 0)
+				scope += " / ";
+			scope += g_scopes[i];
+		}
+		return scope;
+	}
+
+	void GLAPIENTRY OnDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity,
+		GLsizei length, const GLchar* message, const void* userParam)
+	{
+		// markers of the application itself
+		if (source == GL_DEBUG_SOURCE_APPLICATION || type == GL_DEBUG_TYPE_PUSH_GROUP ||
+			type == GL_DEBUG_TYPE_POP_GROUP || type == GL_DEBUG_TYPE_MARKER)
+		{
+			return;
+		}
+
+		std::string text = (length < 0) ? std::string(message) : std::string(message, length);
+		std::string lowerText = text;
+		std::transform(lowerText.begin(), lowerText.end(), lowerText.begin(),
+			[](unsigned char c) { return (char)tolower(c); });
+
+		GLDebugOutput::CATEGORY category = Classify(type, lowerText);
+		g_frameCounts[category]++;
+
+		// the same message from the same place is only printed once,
+		// drivers put object names in the text so it is part of the key
+		std::string scope = CurrentScope();
+		std::string key = std::to_string(source) + ":" + std::to_string(id) + ":" + scope + ":" + text;
+		std::map<std::string, MESSAGE_RECORD>::iterator it = g_messages.find(key);
+		if (it != g_messages.end())
+		{
+			it->second.count++;
+			return;
+		}
+
+		MESSAGE_RECORD record;
+		record.category = category;
+		record.scope = scope;
+		record.text = text;
+		record.firstFrame = g_frame;
+		record.count = 1;
+		g_messages[key] = record;
+
+		std::cout << ((severity == GL_DEBUG_SEVERITY_HIGH || category == GLDebugOutput::CATEGORY_ERROR) ? "[ERROR]" : "[WARNING]")
+			<< " GL " << g_CategoryNames[category] << " in " << scope << " (frame " << g_frame << "): " << text << std::endl;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for installing the debug callback.
+ *  Output is made synchronous so messages arrive inside the
+ *  call that caused them, which is what the attribution to
+ *  scopes relies on; it does slow the driver down, so the
+ *  collector is only enabled on request.
+ ***********************************************************/
+bool GLDebugOutput::Initialize()
+{
+	if (g_bEnabled)
+		return true;
+
+	if (!GLEW_VERSION_4_3 && !GLEW_KHR_debug)
+	{
+		std::cout << "[WARNING] KHR_debug is not supported, driver warnings are not collected" << std::endl;
+		return false;
+	}
+
+	GLint flags = 0;
+	glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+	if ((flags & GL_CONTEXT_FLAG_DEBUG_BIT) == 0)
+		std::cout << "[WARNING] The context is not a debug context, most drivers will not report performance warnings" << std::endl;
+
+	for (int i = 0; i < CATEGORY_COUNT; i++)
+	{
+		g_frameCounts[i] = 0;
+		g_lastFrameCounts[i] = 0;
+	}
+
+	glEnable(GL_DEBUG_OUTPUT);
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageCallback(OnDebugMessage, NULL);
+	// notifications are mostly informational (buffer placement and
+	// the like) except for the ones typed as performance
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+	glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_TRUE);
+
+	g_bEnabled = true;
+	std::cout << "INFO: Collecting driver warnings through KHR_debug" << std::endl;
+	return true;
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for removing the callback and listing
+ *  every distinct message, most frequent first.
+ ***********************************************************/
+void GLDebugOutput::Shutdown()
+{
+	if (!g_bEnabled)
+		return;
+
+	glDebugMessageCallback(NULL, NULL);
+	glDisable(GL_DEBUG_OUTPUT);
+	g_bEnabled = false;
+
+	std::vector<const MESSAGE_RECORD*> records;
+	for (std::map<std::string, MESSAGE_RECORD>::const_iterator it = g_messages.begin(); it != g_messages.end(); ++it)
+		records.push_back(&it->second);
+	std::sort(records.begin(), records.end(),
+		[](const MESSAGE_RECORD* a, const MESSAGE_RECORD* b) { return a->count > b->count; });
+
+	std::cout << "[GLDEBUG] " << records.size() << " distinct driver messages in " << g_frame << " frames" << std::endl;
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		const MESSAGE_RECORD& record = *records[i];
+		std::cout << "[GLDEBUG]   " << record.count << "x " << g_CategoryNames[record.category]
+			<< " in " << record.scope << " since frame " << record.firstFrame << ": " << record.text << std::endl;
+	}
+	g_messages.clear();
+}
+
+/***********************************************************
+ *  IsEnabled()
+ *
+ *  This method is used for checking whether messages are
+ *  being collected.
+ ***********************************************************/
+bool GLDebugOutput::IsEnabled()
+{
+	return g_bEnabled;
+}
+
+/***********************************************************
+ *  PushScope() / PopScope()
+ *
+ *  These methods are used for tracking the scopes messages
+ *  are attributed to. Only the label pointer is stored, so
+ *  they are cheap enough to stay in place when disabled.
+ ***********************************************************/
+void GLDebugOutput::PushScope(const char* label)
+{
+	if (g_scopeDepth < MAX_SCOPE_DEPTH)
+		g_scopes[g_scopeDepth] = label;
+	g_scopeDepth++;
+}
+
+void GLDebugOutput::PopScope()
+{
+	if (g_scopeDepth > 0)
+		g_scopeDepth--;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for reporting the message counts of
+ *  the frame. A frame is reported when its counts differ
+ *  from the previous frame, so a warning repeating at the
+ *  same rate every frame is not printed over and over.
+ ***********************************************************/
+void GLDebugOutput::EndFrame()
+{
+	if (!g_bEnabled)
+		return;
+
+	bool bChanged = false;
+	unsigned int total = 0;
+	for (int i = 0; i < CATEGORY_COUNT; i++)
+	{
+		bChanged = bChanged || (g_frameCounts[i] != g_lastFrameCounts[i]);
+		total += g_frameCounts[i];
+	}
+
+	if (bChanged)
+	{
+		std::cout << "[GLDEBUG] Frame " << g_frame << ": " << total << " driver messages";
+		for (int i = 0; i < CATEGORY_COUNT; i++)
+		{
+			if (g_frameCounts[i] > 0)
+				std::cout << ", " << g_frameCounts[i] << " " << g_CategoryNames[i];
+		}
+		std::cout << std::endl;
+	}
+
+	for (int i = 0; i < CATEGORY_COUNT; i++)
+	{
+		g_lastFrameCounts[i] = g_frameCounts[i];
+		g_frameCounts[i] = 0;
+	}
+	g_frame++;
+}
+
+/***********************************************************
+ *  GetFrameCount()
+ *
+ *  This method is used for getting the number of messages
+ *  of a category in the last finished frame.
+ ***********************************************************/
+unsigned int GLDebugOutput::GetFrameCount(CATEGORY category)
+{
+	return g_lastFrameCounts[category];
+}
+
+/***********************************************************
+ *  GetCategoryName()
+ *
+ *  This method is used for getting the name of a category.
+ ***********************************************************/
+const char* GLDebugOutput::GetCategoryName(CATEGORY category)
+{
+	return g_CategoryNames[category];
+}
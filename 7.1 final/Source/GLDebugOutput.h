@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// gldebugoutput.h
+// ============
+// collect driver warnings reported through the KHR_debug output
+//
+//	Requires a context created with GLFW_OPENGL_DEBUG_CONTEXT. Messages
+//	are delivered synchronously, so each one is attributed to the scopes
+//	open on the render thread when the offending call was made: CpuTimer
+//	stages, SceneManager calls such as SetShaderTexture and the tag of
+//	the object being drawn. Messages are classified (implicit syncs,
+//	shader recompiles, buffer reallocations, ...), printed the first time
+//	they occur in a scope and counted every frame after that.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+class GLDebugOutput
+{
+public:
+	// kinds of messages the driver reports
+	enum CATEGORY
+	{
+		CATEGORY_ERROR,
+		CATEGORY_IMPLICIT_SYNC,
+		CATEGORY_SHADER_RECOMPILE,
+		CATEGORY_BUFFER_REALLOCATION,
+		CATEGORY_PERFORMANCE,
+		CATEGORY_UNDEFINED_BEHAVIOR,
+		CATEGORY_DEPRECATED,
+		CATEGORY_PORTABILITY,
+		CATEGORY_OTHER,
+		CATEGORY_COUNT
+	};
+
+	// attributes the messages of the enclosing block to the label
+	class Scope
+	{
+	public:
+		Scope(const char* label) { PushScope(label); }
+		~Scope() { PopScope(); }
+
+	private:
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+	};
+
+	// install the callback, returns false if debug output is not supported
+	static bool Initialize();
+	// print the summary of every distinct message
+	static void Shutdown();
+	// whether the callback is installed
+	static bool IsEnabled();
+
+	// open and close an attribution scope, the label must outlive it
+	static void PushScope(const char* label);
+	static void PopScope();
+
+	// report this frame's counts and start the next frame
+	static void EndFrame();
+
+	// messages of a category in the last finished frame
+	static unsigned int GetFrameCount(CATEGORY category);
+	// name used when reporting the category
+	static const char* GetCategoryName(CATEGORY category);
+};
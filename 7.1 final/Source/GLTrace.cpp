@@ -0,0 +1,798 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltrace.cpp
+// ============
+// record the GL command stream of the application into a binary trace
+///////////////////////////////////////////////////////////////////////////////
+
+// this file calls the real GL entry points
+#ifndef GLTRACE_NO_HOOKS
+#define GLTRACE_NO_HOOKS
+#endif
+
+#include "GLTrace.h"
+#include "GLTraceFormat.h"
+
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <vector>
+
+using namespace GLTraceFormat;
+
+// declaration of the global variables and defines
+namespace
+{
+	// bytes buffered before they are written to the file
+	const size_t g_FlushSize = 4 * 1024 * 1024;
+
+	bool                       g_bRecording = false;
+	std::ofstream              g_file;
+	std::vector<unsigned char> g_buffer;
+	unsigned int               g_framesLeft = 0;
+	unsigned int               g_framesRecorded = 0;
+	uint64_t                   g_callCount = 0;
+	uint64_t                   g_bytesWritten = 0;
+
+	// argument words are raw 32-bit patterns of ints, enums and floats
+	uint32_t F(float value)
+	{
+		uint32_t word;
+		memcpy(&word, &value, sizeof(word));
+		return word;
+	}
+
+	void Flush()
+	{
+		if (!g_buffer.empty())
+		{
+			g_file.write((const char*)&g_buffer[0], g_buffer.size());
+			g_bytesWritten += g_buffer.size();
+			g_buffer.clear();
+		}
+	}
+
+	void Append(const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		g_buffer.insert(g_buffer.end(), bytes, bytes + size);
+	}
+
+	void Record(OPCODE op, std::initializer_list<uint32_t> words)
+	{
+		unsigned char opcode = (unsigned char)op;
+		Append(&opcode, 1);
+		for (std::initializer_list<uint32_t>::const_iterator it = words.begin(); it != words.end(); ++it)
+			Append(&*it, sizeof(uint32_t));
+		g_callCount++;
+
+		if (g_buffer.size() > g_FlushSize)
+			Flush();
+	}
+
+	void RecordBlob(OPCODE op, std::initializer_list<uint32_t> words, const void* data, size_t size)
+	{
+		// a missing payload (e.g. glTexImage2D without pixels) is an empty blob
+		uint32_t length = (NULL != data) ? (uint32_t)size : 0;
+		Record(op, words);
+		Append(&length, sizeof(length));
+		if (length > 0)
+			Append(data, length);
+	}
+
+	// size of client pixel data as read by glTexImage2D and glTexSubImage2D
+	size_t ImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+	{
+		size_t pixelSize = 0;
+		if (type == GL_UNSIGNED_INT_24_8 || type == GL_UNSIGNED_INT_8_8_8_8 || type == GL_UNSIGNED_INT_2_10_10_10_REV)
+		{
+			pixelSize = 4;
+		}
+		else
+		{
+			size_t components = 4;
+			switch (format)
+			{
+			case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+				components = 1;
+				break;
+			case GL_RG: case GL_RG_INTEGER:
+				components = 2;
+				break;
+			case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+				components = 3;
+				break;
+			}
+
+			size_t componentSize = 4;
+			switch (type)
+			{
+			case GL_UNSIGNED_BYTE: case GL_BYTE:
+				componentSize = 1;
+				break;
+			case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+				componentSize = 2;
+				break;
+			}
+			pixelSize = components * componentSize;
+		}
+
+		GLint alignment = 4;
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+		size_t rowSize = (size_t)width * pixelSize;
+		rowSize = (rowSize + alignment - 1) / alignment * alignment;
+
+		return rowSize * (size_t)height;
+	}
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for opening the trace file. It has to
+ *  be called before any GL object is created, because the
+ *  replayer rebuilds every object from the trace.
+ ***********************************************************/
+bool GLTrace::Start(const char* filename, unsigned int frameCount)
+{
+	if (g_bRecording)
+		Stop();
+
+	g_file.open(filename, std::ios::binary | std::ios::trunc);
+	if (!g_file)
+	{
+		std::cout << "[ERROR] Could not create GL trace " << filename << std::endl;
+		return false;
+	}
+
+	TRACE_HEADER header;
+	header.magic = TRACE_MAGIC;
+	header.version = TRACE_VERSION;
+	Append(&header, sizeof(header));
+
+	g_framesLeft = frameCount;
+	g_framesRecorded = 0;
+	g_callCount = 0;
+	g_bytesWritten = 0;
+	g_bRecording = true;
+
+	std::cout << "[GLTRACE] Recording GL calls to " << filename << std::endl;
+	return true;
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for writing out the remaining calls
+ *  and closing the trace file.
+ ***********************************************************/
+void GLTrace::Stop()
+{
+	if (!g_bRecording)
+		return;
+
+	g_bRecording = false;
+	Flush();
+	g_file.close();
+
+	std::cout << "[GLTRACE] Recorded " << g_framesRecorded << " frames, " << g_callCount << " calls, "
+		<< g_bytesWritten / 1024 << " KB" << std::endl;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for marking the end of a frame and
+ *  stopping once the requested number of frames is recorded.
+ ***********************************************************/
+void GLTrace::EndFrame()
+{
+	if (!g_bRecording)
+		return;
+
+	Record(OP_FRAME_END, {});
+	Flush();
+	g_framesRecorded++;
+
+	if (g_framesLeft > 0 && --g_framesLeft == 0)
+		Stop();
+}
+
+/***********************************************************
+ *  IsRecording()
+ *
+ *  This method is used for checking whether calls are being
+ *  recorded.
+ ***********************************************************/
+bool GLTrace::IsRecording()
+{
+	return g_bRecording;
+}
+
+/***********************************************************
+ *  GLTrace_Gen*() / GLTrace_Create*()
+ *
+ *  These wrappers record the names GL returned, which the
+ *  replayer maps onto the names it gets.
+ ***********************************************************/
+void GLTrace_GenTextures(GLsizei n, GLuint* textures)
+{
+	glGenTextures(n, textures);
+	if (g_bRecording)
+		RecordBlob(OP_GEN_TEXTURES, {}, textures, n * sizeof(GLuint));
+}
+
+void GLTrace_GenBuffers(GLsizei n, GLuint* buffers)
+{
+	glGenBuffers(n, buffers);
+	if (g_bRecording)
+		RecordBlob(OP_GEN_BUFFERS, {}, buffers, n * sizeof(GLuint));
+}
+
+void GLTrace_GenVertexArrays(GLsizei n, GLuint* arrays)
+{
+	glGenVertexArrays(n, arrays);
+	if (g_bRecording)
+		RecordBlob(OP_GEN_VERTEX_ARRAYS, {}, arrays, n * sizeof(GLuint));
+}
+
+void GLTrace_GenFramebuffers(GLsizei n, GLuint* framebuffers)
+{
+	glGenFramebuffers(n, framebuffers);
+	if (g_bRecording)
+		RecordBlob(OP_GEN_FRAMEBUFFERS, {}, framebuffers, n * sizeof(GLuint));
+}
+
+void GLTrace_GenQueries(GLsizei n, GLuint* ids)
+{
+	glGenQueries(n, ids);
+	if (g_bRecording)
+		RecordBlob(OP_GEN_QUERIES, {}, ids, n * sizeof(GLuint));
+}
+
+GLuint GLTrace_CreateShader(GLenum type)
+{
+	GLuint shader = glCreateShader(type);
+	if (g_bRecording)
+		Record(OP_CREATE_SHADER, { type, shader });
+	return shader;
+}
+
+GLuint GLTrace_CreateProgram(void)
+{
+	GLuint program = glCreateProgram();
+	if (g_bRecording)
+		Record(OP_CREATE_PROGRAM, { program });
+	return program;
+}
+
+/***********************************************************
+ *  GLTrace_Delete*()
+ *
+ *  These wrappers record the deletion of GL objects.
+ ***********************************************************/
+void GLTrace_DeleteTextures(GLsizei n, const GLuint* textures)
+{
+	glDeleteTextures(n, textures);
+	if (g_bRecording)
+		RecordBlob(OP_DELETE_TEXTURES, {}, textures, n * sizeof(GLuint));
+}
+
+void GLTrace_DeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+	glDeleteBuffers(n, buffers);
+	if (g_bRecording)
+		RecordBlob(OP_DELETE_BUFFERS, {}, buffers, n * sizeof(GLuint));
+}
+
+void GLTrace_DeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+	glDeleteVertexArrays(n, arrays);
+	if (g_bRecording)
+		RecordBlob(OP_DELETE_VERTEX_ARRAYS, {}, arrays, n * sizeof(GLuint));
+}
+
+void GLTrace_DeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+	glDeleteFramebuffers(n, framebuffers);
+	if (g_bRecording)
+		RecordBlob(OP_DELETE_FRAMEBUFFERS, {}, framebuffers, n * sizeof(GLuint));
+}
+
+void GLTrace_DeleteQueries(GLsizei n, const GLuint* ids)
+{
+	glDeleteQueries(n, ids);
+	if (g_bRecording)
+		RecordBlob(OP_DELETE_QUERIES, {}, ids, n * sizeof(GLuint));
+}
+
+void GLTrace_DeleteShader(GLuint shader)
+{
+	glDeleteShader(shader);
+	if (g_bRecording)
+		Record(OP_DELETE_SHADER, { shader });
+}
+
+void GLTrace_DeleteProgram(GLuint program)
+{
+	glDeleteProgram(program);
+	if (g_bRecording)
+		Record(OP_DELETE_PROGRAM, { program });
+}
+
+/***********************************************************
+ *  GLTrace_Bind*()
+ *
+ *  These wrappers record binding changes.
+ ***********************************************************/
+void GLTrace_ActiveTexture(GLenum texture)
+{
+	glActiveTexture(texture);
+	if (g_bRecording)
+		Record(OP_ACTIVE_TEXTURE, { texture });
+}
+
+void GLTrace_BindTexture(GLenum target, GLuint texture)
+{
+	glBindTexture(target, texture);
+	if (g_bRecording)
+		Record(OP_BIND_TEXTURE, { target, texture });
+}
+
+void GLTrace_BindBuffer(GLenum target, GLuint buffer)
+{
+	glBindBuffer(target, buffer);
+	if (g_bRecording)
+		Record(OP_BIND_BUFFER, { target, buffer });
+}
+
+void GLTrace_BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	glBindBufferBase(target, index, buffer);
+	if (g_bRecording)
+		Record(OP_BIND_BUFFER_BASE, { target, index, buffer });
+}
+
+void GLTrace_BindVertexArray(GLuint array)
+{
+	glBindVertexArray(array);
+	if (g_bRecording)
+		Record(OP_BIND_VERTEX_ARRAY, { array });
+}
+
+void GLTrace_BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	glBindFramebuffer(target, framebuffer);
+	if (g_bRecording)
+		Record(OP_BIND_FRAMEBUFFER, { target, framebuffer });
+}
+
+void GLTrace_UseProgram(GLuint program)
+{
+	glUseProgram(program);
+	if (g_bRecording)
+		Record(OP_USE_PROGRAM, { program });
+}
+
+void GLTrace_BindImageTexture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format)
+{
+	glBindImageTexture(unit, texture, level, layered, layer, access, format);
+	if (g_bRecording)
+		Record(OP_BIND_IMAGE_TEXTURE, { unit, texture, (uint32_t)level, layered, (uint32_t)layer, access, format });
+}
+
+/***********************************************************
+ *  GLTrace_Tex*() / GLTrace_Buffer*() / framebuffers
+ *
+ *  These wrappers record resource storage and contents,
+ *  including the texture and buffer payloads.
+ ***********************************************************/
+void GLTrace_TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+	glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	if (g_bRecording)
+	{
+		RecordBlob(OP_TEX_IMAGE_2D, { target, (uint32_t)level, (uint32_t)internalformat, (uint32_t)width, (uint32_t)height,
+			(uint32_t)border, format, type }, pixels, (NULL != pixels) ? ImageSize(width, height, format, type) : 0);
+	}
+}
+
+void GLTrace_TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+	glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+	if (g_bRecording)
+	{
+		RecordBlob(OP_TEX_SUB_IMAGE_2D, { target, (uint32_t)level, (uint32_t)xoffset, (uint32_t)yoffset, (uint32_t)width,
+			(uint32_t)height, format, type }, pixels, (NULL != pixels) ? ImageSize(width, height, format, type) : 0);
+	}
+}
+
+void GLTrace_TexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
+{
+	glTexStorage2D(target, levels, internalformat, width, height);
+	if (g_bRecording)
+		Record(OP_TEX_STORAGE_2D, { target, (uint32_t)levels, internalformat, (uint32_t)width, (uint32_t)height });
+}
+
+void GLTrace_TexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth)
+{
+	glTexStorage3D(target, levels, internalformat, width, height, depth);
+	if (g_bRecording)
+		Record(OP_TEX_STORAGE_3D, { target, (uint32_t)levels, internalformat, (uint32_t)width, (uint32_t)height, (uint32_t)depth });
+}
+
+void GLTrace_TexParameteri(GLenum target, GLenum pname, GLint param)
+{
+	glTexParameteri(target, pname, param);
+	if (g_bRecording)
+		Record(OP_TEX_PARAMETER_I, { target, pname, (uint32_t)param });
+}
+
+void GLTrace_GenerateMipmap(GLenum target)
+{
+	glGenerateMipmap(target);
+	if (g_bRecording)
+		Record(OP_GENERATE_MIPMAP, { target });
+}
+
+void GLTrace_BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	glBufferData(target, size, data, usage);
+	if (g_bRecording)
+		RecordBlob(OP_BUFFER_DATA, { target, (uint32_t)size, usage }, data, (size_t)size);
+}
+
+void GLTrace_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	glBufferSubData(target, offset, size, data);
+	if (g_bRecording)
+		RecordBlob(OP_BUFFER_SUB_DATA, { target, (uint32_t)offset }, data, (size_t)size);
+}
+
+void GLTrace_CopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth)
+{
+	glCopyImageSubData(srcName, srcTarget, srcLevel, srcX, srcY, srcZ, dstName, dstTarget, dstLevel, dstX, dstY, dstZ, srcWidth, srcHeight, srcDepth);
+	if (g_bRecording)
+	{
+		Record(OP_COPY_IMAGE_SUB_DATA, { srcName, srcTarget, (uint32_t)srcLevel, (uint32_t)srcX, (uint32_t)srcY, (uint32_t)srcZ,
+			dstName, dstTarget, (uint32_t)dstLevel, (uint32_t)dstX, (uint32_t)dstY, (uint32_t)dstZ,
+			(uint32_t)srcWidth, (uint32_t)srcHeight, (uint32_t)srcDepth });
+	}
+}
+
+void GLTrace_FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+{
+	glFramebufferTexture2D(target, attachment, textarget, texture, level);
+	if (g_bRecording)
+		Record(OP_FRAMEBUFFER_TEXTURE_2D, { target, attachment, textarget, texture, (uint32_t)level });
+}
+
+void GLTrace_DrawBuffers(GLsizei n, const GLenum* bufs)
+{
+	glDrawBuffers(n, bufs);
+	if (g_bRecording)
+		RecordBlob(OP_DRAW_BUFFERS, {}, bufs, n * sizeof(GLenum));
+}
+
+void GLTrace_ReadBuffer(GLenum src)
+{
+	glReadBuffer(src);
+	if (g_bRecording)
+		Record(OP_READ_BUFFER, { src });
+}
+
+/***********************************************************
+ *  GLTrace_*VertexAttrib*()
+ *
+ *  These wrappers record the vertex layout. Attribute data
+ *  always comes from buffer objects in the core profile, so
+ *  the pointer is an offset.
+ ***********************************************************/
+void GLTrace_VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+	if (g_bRecording)
+		Record(OP_VERTEX_ATTRIB_POINTER, { index, (uint32_t)size, type, normalized, (uint32_t)stride, (uint32_t)(size_t)pointer });
+}
+
+void GLTrace_EnableVertexAttribArray(GLuint index)
+{
+	glEnableVertexAttribArray(index);
+	if (g_bRecording)
+		Record(OP_ENABLE_VERTEX_ATTRIB_ARRAY, { index });
+}
+
+void GLTrace_DisableVertexAttribArray(GLuint index)
+{
+	glDisableVertexAttribArray(index);
+	if (g_bRecording)
+		Record(OP_DISABLE_VERTEX_ATTRIB_ARRAY, { index });
+}
+
+/***********************************************************
+ *  GLTrace_*Shader*() / GLTrace_*Program*()
+ *
+ *  These wrappers record shader sources and program setup.
+ *  Uniform locations are recorded with the name they were
+ *  looked up with, since the replaying driver may differ.
+ ***********************************************************/
+void GLTrace_ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+	glShaderSource(shader, count, string, length);
+	if (g_bRecording)
+	{
+		std::vector<GLchar> source;
+		for (GLsizei i = 0; i < count; i++)
+		{
+			size_t size = (NULL != length && length[i] >= 0) ? (size_t)length[i] : strlen(string[i]);
+			source.insert(source.end(), string[i], string[i] + size);
+		}
+		RecordBlob(OP_SHADER_SOURCE, { shader }, source.empty() ? "" : &source[0], source.size());
+	}
+}
+
+void GLTrace_CompileShader(GLuint shader)
+{
+	glCompileShader(shader);
+	if (g_bRecording)
+		Record(OP_COMPILE_SHADER, { shader });
+}
+
+void GLTrace_AttachShader(GLuint program, GLuint shader)
+{
+	glAttachShader(program, shader);
+	if (g_bRecording)
+		Record(OP_ATTACH_SHADER, { program, shader });
+}
+
+void GLTrace_LinkProgram(GLuint program)
+{
+	glLinkProgram(program);
+	if (g_bRecording)
+		Record(OP_LINK_PROGRAM, { program });
+}
+
+GLint GLTrace_GetUniformLocation(GLuint program, const GLchar* name)
+{
+	GLint location = glGetUniformLocation(program, name);
+	if (g_bRecording)
+		RecordBlob(OP_GET_UNIFORM_LOCATION, { program, (uint32_t)location }, name, strlen(name) + 1);
+	return location;
+}
+
+/***********************************************************
+ *  GLTrace_Uniform*()
+ *
+ *  These wrappers record uniform updates of the program in
+ *  use.
+ ***********************************************************/
+void GLTrace_Uniform1i(GLint location, GLint v0)
+{
+	glUniform1i(location, v0);
+	if (g_bRecording)
+		Record(OP_UNIFORM_1I, { (uint32_t)location, (uint32_t)v0 });
+}
+
+void GLTrace_Uniform1f(GLint location, GLfloat v0)
+{
+	glUniform1f(location, v0);
+	if (g_bRecording)
+		Record(OP_UNIFORM_1F, { (uint32_t)location, F(v0) });
+}
+
+void GLTrace_Uniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+	glUniform2f(location, v0, v1);
+	if (g_bRecording)
+		Record(OP_UNIFORM_2F, { (uint32_t)location, F(v0), F(v1) });
+}
+
+void GLTrace_Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+	glUniform3f(location, v0, v1, v2);
+	if (g_bRecording)
+		Record(OP_UNIFORM_3F, { (uint32_t)location, F(v0), F(v1), F(v2) });
+}
+
+void GLTrace_Uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+	glUniform4f(location, v0, v1, v2, v3);
+	if (g_bRecording)
+		Record(OP_UNIFORM_4F, { (uint32_t)location, F(v0), F(v1), F(v2), F(v3) });
+}
+
+void GLTrace_Uniform2fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	glUniform2fv(location, count, value);
+	if (g_bRecording)
+		RecordBlob(OP_UNIFORM_2FV, { (uint32_t)location }, value, count * 2 * sizeof(GLfloat));
+}
+
+void GLTrace_Uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	glUniform3fv(location, count, value);
+	if (g_bRecording)
+		RecordBlob(OP_UNIFORM_3FV, { (uint32_t)location }, value, count * 3 * sizeof(GLfloat));
+}
+
+void GLTrace_Uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	glUniform4fv(location, count, value);
+	if (g_bRecording)
+		RecordBlob(OP_UNIFORM_4FV, { (uint32_t)location }, value, count * 4 * sizeof(GLfloat));
+}
+
+void GLTrace_UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+	glUniformMatrix4fv(location, count, transpose, value);
+	if (g_bRecording)
+		RecordBlob(OP_UNIFORM_MATRIX_4FV, { (uint32_t)location, transpose }, value, count * 16 * sizeof(GLfloat));
+}
+
+/***********************************************************
+ *  GLTrace_*() fixed function state
+ *
+ *  These wrappers record render state changes and clears.
+ ***********************************************************/
+void GLTrace_Enable(GLenum cap)
+{
+	glEnable(cap);
+	if (g_bRecording)
+		Record(OP_ENABLE, { cap });
+}
+
+void GLTrace_Disable(GLenum cap)
+{
+	glDisable(cap);
+	if (g_bRecording)
+		Record(OP_DISABLE, { cap });
+}
+
+void GLTrace_Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	glViewport(x, y, width, height);
+	if (g_bRecording)
+		Record(OP_VIEWPORT, { (uint32_t)x, (uint32_t)y, (uint32_t)width, (uint32_t)height });
+}
+
+void GLTrace_ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	glClearColor(red, green, blue, alpha);
+	if (g_bRecording)
+		Record(OP_CLEAR_COLOR, { F(red), F(green), F(blue), F(alpha) });
+}
+
+void GLTrace_Clear(GLbitfield mask)
+{
+	glClear(mask);
+	if (g_bRecording)
+		Record(OP_CLEAR, { mask });
+}
+
+void GLTrace_ClearBufferuiv(GLenum buffer, GLint drawbuffer, const GLuint* value)
+{
+	glClearBufferuiv(buffer, drawbuffer, value);
+	if (g_bRecording)
+		RecordBlob(OP_CLEAR_BUFFER_UIV, { buffer, (uint32_t)drawbuffer }, value, (buffer == GL_COLOR ? 4 : 1) * sizeof(GLuint));
+}
+
+void GLTrace_ClearBufferfv(GLenum buffer, GLint drawbuffer, const GLfloat* value)
+{
+	glClearBufferfv(buffer, drawbuffer, value);
+	if (g_bRecording)
+		RecordBlob(OP_CLEAR_BUFFER_FV, { buffer, (uint32_t)drawbuffer }, value, (buffer == GL_COLOR ? 4 : 1) * sizeof(GLfloat));
+}
+
+void GLTrace_BlendFunc(GLenum sfactor, GLenum dfactor)
+{
+	glBlendFunc(sfactor, dfactor);
+	if (g_bRecording)
+		Record(OP_BLEND_FUNC, { sfactor, dfactor });
+}
+
+void GLTrace_DepthFunc(GLenum func)
+{
+	glDepthFunc(func);
+	if (g_bRecording)
+		Record(OP_DEPTH_FUNC, { func });
+}
+
+void GLTrace_DepthMask(GLboolean flag)
+{
+	glDepthMask(flag);
+	if (g_bRecording)
+		Record(OP_DEPTH_MASK, { flag });
+}
+
+void GLTrace_CullFace(GLenum mode)
+{
+	glCullFace(mode);
+	if (g_bRecording)
+		Record(OP_CULL_FACE, { mode });
+}
+
+void GLTrace_StencilFunc(GLenum func, GLint ref, GLuint mask)
+{
+	glStencilFunc(func, ref, mask);
+	if (g_bRecording)
+		Record(OP_STENCIL_FUNC, { func, (uint32_t)ref, mask });
+}
+
+void GLTrace_StencilOp(GLenum fail, GLenum zfail, GLenum zpass)
+{
+	glStencilOp(fail, zfail, zpass);
+	if (g_bRecording)
+		Record(OP_STENCIL_OP, { fail, zfail, zpass });
+}
+
+void GLTrace_StencilMask(GLuint mask)
+{
+	glStencilMask(mask);
+	if (g_bRecording)
+		Record(OP_STENCIL_MASK, { mask });
+}
+
+void GLTrace_PolygonMode(GLenum face, GLenum mode)
+{
+	glPolygonMode(face, mode);
+	if (g_bRecording)
+		Record(OP_POLYGON_MODE, { face, mode });
+}
+
+void GLTrace_MemoryBarrier(GLbitfield barriers)
+{
+	glMemoryBarrier(barriers);
+	if (g_bRecording)
+		Record(OP_MEMORY_BARRIER, { barriers });
+}
+
+/***********************************************************
+ *  GLTrace_*() work submission
+ *
+ *  These wrappers record draws, dispatches, blits and the
+ *  timer queries around them.
+ ***********************************************************/
+void GLTrace_DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	glDrawArrays(mode, first, count);
+	if (g_bRecording)
+		Record(OP_DRAW_ARRAYS, { mode, (uint32_t)first, (uint32_t)count });
+}
+
+void GLTrace_DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+	glDrawElements(mode, count, type, indices);
+	if (g_bRecording)
+		Record(OP_DRAW_ELEMENTS, { mode, (uint32_t)count, type, (uint32_t)(size_t)indices });
+}
+
+void GLTrace_DispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z)
+{
+	glDispatchCompute(num_groups_x, num_groups_y, num_groups_z);
+	if (g_bRecording)
+		Record(OP_DISPATCH_COMPUTE, { num_groups_x, num_groups_y, num_groups_z });
+}
+
+void GLTrace_BlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
+{
+	glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	if (g_bRecording)
+	{
+		Record(OP_BLIT_FRAMEBUFFER, { (uint32_t)srcX0, (uint32_t)srcY0, (uint32_t)srcX1, (uint32_t)srcY1,
+			(uint32_t)dstX0, (uint32_t)dstY0, (uint32_t)dstX1, (uint32_t)dstY1, mask, filter });
+	}
+}
+
+void GLTrace_BeginQuery(GLenum target, GLuint id)
+{
+	glBeginQuery(target, id);
+	if (g_bRecording)
+		Record(OP_BEGIN_QUERY, { target, id });
+}
+
+void GLTrace_EndQuery(GLenum target)
+{
+	glEndQuery(target);
+	if (g_bRecording)
+		Record(OP_END_QUERY, { target });
+}
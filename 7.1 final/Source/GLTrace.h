@@ -0,0 +1,253 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltrace.h
+// ============
+// record the GL command stream of the application into a binary trace
+//
+//	This header is force-included into every translation unit of the
+//	application, including the shader manager and shape meshes, so every
+//	call of the functions below goes through a GLTrace_ wrapper. While no
+//	trace is being recorded a wrapper only checks a flag and forwards the
+//	call. GLTrace.cpp itself is built with GLTRACE_NO_HOOKS so it reaches
+//	the real entry points. Replay a trace with the GLReplay tool.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+class GLTrace
+{
+public:
+	// start recording into the passed in file, for frameCount frames (0 = until Stop)
+	static bool Start(const char* filename, unsigned int frameCount);
+	// finish the trace file
+	static void Stop();
+	// mark the end of a frame, call after swapping buffers
+	static void EndFrame();
+	// whether calls are being recorded
+	static bool IsRecording();
+};
+
+// recording wrappers of the traced GL functions
+void GLTrace_GenTextures(GLsizei n, GLuint* textures);
+void GLTrace_GenBuffers(GLsizei n, GLuint* buffers);
+void GLTrace_GenVertexArrays(GLsizei n, GLuint* arrays);
+void GLTrace_GenFramebuffers(GLsizei n, GLuint* framebuffers);
+void GLTrace_GenQueries(GLsizei n, GLuint* ids);
+GLuint GLTrace_CreateShader(GLenum type);
+GLuint GLTrace_CreateProgram(void);
+void GLTrace_DeleteTextures(GLsizei n, const GLuint* textures);
+void GLTrace_DeleteBuffers(GLsizei n, const GLuint* buffers);
+void GLTrace_DeleteVertexArrays(GLsizei n, const GLuint* arrays);
+void GLTrace_DeleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+void GLTrace_DeleteQueries(GLsizei n, const GLuint* ids);
+void GLTrace_DeleteShader(GLuint shader);
+void GLTrace_DeleteProgram(GLuint program);
+void GLTrace_ActiveTexture(GLenum texture);
+void GLTrace_BindTexture(GLenum target, GLuint texture);
+void GLTrace_BindBuffer(GLenum target, GLuint buffer);
+void GLTrace_BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void GLTrace_BindVertexArray(GLuint array);
+void GLTrace_BindFramebuffer(GLenum target, GLuint framebuffer);
+void GLTrace_UseProgram(GLuint program);
+void GLTrace_BindImageTexture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+void GLTrace_TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels);
+void GLTrace_TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+void GLTrace_TexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+void GLTrace_TexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth);
+void GLTrace_TexParameteri(GLenum target, GLenum pname, GLint param);
+void GLTrace_GenerateMipmap(GLenum target);
+void GLTrace_BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+void GLTrace_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+void GLTrace_CopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth);
+void GLTrace_FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+void GLTrace_DrawBuffers(GLsizei n, const GLenum* bufs);
+void GLTrace_ReadBuffer(GLenum src);
+void GLTrace_VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+void GLTrace_EnableVertexAttribArray(GLuint index);
+void GLTrace_DisableVertexAttribArray(GLuint index);
+void GLTrace_ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+void GLTrace_CompileShader(GLuint shader);
+void GLTrace_AttachShader(GLuint program, GLuint shader);
+void GLTrace_LinkProgram(GLuint program);
+GLint GLTrace_GetUniformLocation(GLuint program, const GLchar* name);
+void GLTrace_Uniform1i(GLint location, GLint v0);
+void GLTrace_Uniform1f(GLint location, GLfloat v0);
+void GLTrace_Uniform2f(GLint location, GLfloat v0, GLfloat v1);
+void GLTrace_Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2);
+void GLTrace_Uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+void GLTrace_Uniform2fv(GLint location, GLsizei count, const GLfloat* value);
+void GLTrace_Uniform3fv(GLint location, GLsizei count, const GLfloat* value);
+void GLTrace_Uniform4fv(GLint location, GLsizei count, const GLfloat* value);
+void GLTrace_UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+void GLTrace_Enable(GLenum cap);
+void GLTrace_Disable(GLenum cap);
+void GLTrace_Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void GLTrace_ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void GLTrace_Clear(GLbitfield mask);
+void GLTrace_ClearBufferuiv(GLenum buffer, GLint drawbuffer, const GLuint* value);
+void GLTrace_ClearBufferfv(GLenum buffer, GLint drawbuffer, const GLfloat* value);
+void GLTrace_BlendFunc(GLenum sfactor, GLenum dfactor);
+void GLTrace_DepthFunc(GLenum func);
+void GLTrace_DepthMask(GLboolean flag);
+void GLTrace_CullFace(GLenum mode);
+void GLTrace_StencilFunc(GLenum func, GLint ref, GLuint mask);
+void GLTrace_StencilOp(GLenum fail, GLenum zfail, GLenum zpass);
+void GLTrace_StencilMask(GLuint mask);
+void GLTrace_PolygonMode(GLenum face, GLenum mode);
+void GLTrace_MemoryBarrier(GLbitfield barriers);
+void GLTrace_DrawArrays(GLenum mode, GLint first, GLsizei count);
+void GLTrace_DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+void GLTrace_DispatchCompute(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+void GLTrace_BlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
+void GLTrace_BeginQuery(GLenum target, GLuint id);
+void GLTrace_EndQuery(GLenum target);
+
+#if !defined(GLTRACE_NO_HOOKS)
+#undef glGenTextures
+#define glGenTextures GLTrace_GenTextures
+#undef glGenBuffers
+#define glGenBuffers GLTrace_GenBuffers
+#undef glGenVertexArrays
+#define glGenVertexArrays GLTrace_GenVertexArrays
+#undef glGenFramebuffers
+#define glGenFramebuffers GLTrace_GenFramebuffers
+#undef glGenQueries
+#define glGenQueries GLTrace_GenQueries
+#undef glCreateShader
+#define glCreateShader GLTrace_CreateShader
+#undef glCreateProgram
+#define glCreateProgram GLTrace_CreateProgram
+#undef glDeleteTextures
+#define glDeleteTextures GLTrace_DeleteTextures
+#undef glDeleteBuffers
+#define glDeleteBuffers GLTrace_DeleteBuffers
+#undef glDeleteVertexArrays
+#define glDeleteVertexArrays GLTrace_DeleteVertexArrays
+#undef glDeleteFramebuffers
+#define glDeleteFramebuffers GLTrace_DeleteFramebuffers
+#undef glDeleteQueries
+#define glDeleteQueries GLTrace_DeleteQueries
+#undef glDeleteShader
+#define glDeleteShader GLTrace_DeleteShader
+#undef glDeleteProgram
+#define glDeleteProgram GLTrace_DeleteProgram
+#undef glActiveTexture
+#define glActiveTexture GLTrace_ActiveTexture
+#undef glBindTexture
+#define glBindTexture GLTrace_BindTexture
+#undef glBindBuffer
+#define glBindBuffer GLTrace_BindBuffer
+#undef glBindBufferBase
+#define glBindBufferBase GLTrace_BindBufferBase
+#undef glBindVertexArray
+#define glBindVertexArray GLTrace_BindVertexArray
+#undef glBindFramebuffer
+#define glBindFramebuffer GLTrace_BindFramebuffer
+#undef glUseProgram
+#define glUseProgram GLTrace_UseProgram
+#undef glBindImageTexture
+#define glBindImageTexture GLTrace_BindImageTexture
+#undef glTexImage2D
+#define glTexImage2D GLTrace_TexImage2D
+#undef glTexSubImage2D
+#define glTexSubImage2D GLTrace_TexSubImage2D
+#undef glTexStorage2D
+#define glTexStorage2D GLTrace_TexStorage2D
+#undef glTexStorage3D
+#define glTexStorage3D GLTrace_TexStorage3D
+#undef glTexParameteri
+#define glTexParameteri GLTrace_TexParameteri
+#undef glGenerateMipmap
+#define glGenerateMipmap GLTrace_GenerateMipmap
+#undef glBufferData
+#define glBufferData GLTrace_BufferData
+#undef glBufferSubData
+#define glBufferSubData GLTrace_BufferSubData
+#undef glCopyImageSubData
+#define glCopyImageSubData GLTrace_CopyImageSubData
+#undef glFramebufferTexture2D
+#define glFramebufferTexture2D GLTrace_FramebufferTexture2D
+#undef glDrawBuffers
+#define glDrawBuffers GLTrace_DrawBuffers
+#undef glReadBuffer
+#define glReadBuffer GLTrace_ReadBuffer
+#undef glVertexAttribPointer
+#define glVertexAttribPointer GLTrace_VertexAttribPointer
+#undef glEnableVertexAttribArray
+#define glEnableVertexAttribArray GLTrace_EnableVertexAttribArray
+#undef glDisableVertexAttribArray
+#define glDisableVertexAttribArray GLTrace_DisableVertexAttribArray
+#undef glShaderSource
+#define glShaderSource GLTrace_ShaderSource
+#undef glCompileShader
+#define glCompileShader GLTrace_CompileShader
+#undef glAttachShader
+#define glAttachShader GLTrace_AttachShader
+#undef glLinkProgram
+#define glLinkProgram GLTrace_LinkProgram
+#undef glGetUniformLocation
+#define glGetUniformLocation GLTrace_GetUniformLocation
+#undef glUniform1i
+#define glUniform1i GLTrace_Uniform1i
+#undef glUniform1f
+#define glUniform1f GLTrace_Uniform1f
+#undef glUniform2f
+#define glUniform2f GLTrace_Uniform2f
+#undef glUniform3f
+#define glUniform3f GLTrace_Uniform3f
+#undef glUniform4f
+#define glUniform4f GLTrace_Uniform4f
+#undef glUniform2fv
+#define glUniform2fv GLTrace_Uniform2fv
+#undef glUniform3fv
+#define glUniform3fv GLTrace_Uniform3fv
+#undef glUniform4fv
+#define glUniform4fv GLTrace_Uniform4fv
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv GLTrace_UniformMatrix4fv
+#undef glEnable
+#define glEnable GLTrace_Enable
+#undef glDisable
+#define glDisable GLTrace_Disable
+#undef glViewport
+#define glViewport GLTrace_Viewport
+#undef glClearColor
+#define glClearColor GLTrace_ClearColor
+#undef glClear
+#define glClear GLTrace_Clear
+#undef glClearBufferuiv
+#define glClearBufferuiv GLTrace_ClearBufferuiv
+#undef glClearBufferfv
+#define glClearBufferfv GLTrace_ClearBufferfv
+#undef glBlendFunc
+#define glBlendFunc GLTrace_BlendFunc
+#undef glDepthFunc
+#define glDepthFunc GLTrace_DepthFunc
+#undef glDepthMask
+#define glDepthMask GLTrace_DepthMask
+#undef glCullFace
+#define glCullFace GLTrace_CullFace
+#undef glStencilFunc
+#define glStencilFunc GLTrace_StencilFunc
+#undef glStencilOp
+#define glStencilOp GLTrace_StencilOp
+#undef glStencilMask
+#define glStencilMask GLTrace_StencilMask
+#undef glPolygonMode
+#define glPolygonMode GLTrace_PolygonMode
+#undef glMemoryBarrier
+#define glMemoryBarrier GLTrace_MemoryBarrier
+#undef glDrawArrays
+#define glDrawArrays GLTrace_DrawArrays
+#undef glDrawElements
+#define glDrawElements GLTrace_DrawElements
+#undef glDispatchCompute
+#define glDispatchCompute GLTrace_DispatchCompute
+#undef glBlitFramebuffer
+#define glBlitFramebuffer GLTrace_BlitFramebuffer
+#undef glBeginQuery
+#define glBeginQuery GLTrace_BeginQuery
+#undef glEndQuery
+#define glEndQuery GLTrace_EndQuery
+#endif
@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltraceformat.h
+// ============
+// binary layout of GL command traces, shared by recorder and replayer
+//
+//	A trace starts with TRACE_HEADER and is followed by one record per GL
+//	call: the opcode byte, the fixed number of 32-bit argument words the
+//	opcode table lists for it and, for opcodes that have one, a blob of a
+//	32-bit length followed by that many bytes. Variable sized arguments,
+//	texture and buffer payloads, shader sources and the names returned by
+//	glGen* calls all travel in the blob, so every record can be decoded
+//	without knowing the call. OP_FRAME_END marks a buffer swap.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+namespace GLTraceFormat
+{
+	// "GLTR" and the version of the record layout
+	const uint32_t TRACE_MAGIC = 0x52544c47;
+	const uint32_t TRACE_VERSION = 1;
+
+	// most argument words of any opcode (glCopyImageSubData)
+	const int MAX_WORDS = 15;
+
+	struct TRACE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+	};
+
+	enum OPCODE
+	{
+		OP_FRAME_END,
+
+		// object creation, blob holds the returned names
+		OP_GEN_TEXTURES,
+		OP_GEN_BUFFERS,
+		OP_GEN_VERTEX_ARRAYS,
+		OP_GEN_FRAMEBUFFERS,
+		OP_GEN_QUERIES,
+		OP_CREATE_SHADER,
+		OP_CREATE_PROGRAM,
+
+		// object deletion, blob holds the names
+		OP_DELETE_TEXTURES,
+		OP_DELETE_BUFFERS,
+		OP_DELETE_VERTEX_ARRAYS,
+		OP_DELETE_FRAMEBUFFERS,
+		OP_DELETE_QUERIES,
+		OP_DELETE_SHADER,
+		OP_DELETE_PROGRAM,
+
+		// bindings
+		OP_ACTIVE_TEXTURE,
+		OP_BIND_TEXTURE,
+		OP_BIND_BUFFER,
+		OP_BIND_BUFFER_BASE,
+		OP_BIND_VERTEX_ARRAY,
+		OP_BIND_FRAMEBUFFER,
+		OP_USE_PROGRAM,
+		OP_BIND_IMAGE_TEXTURE,
+
+		// resource contents
+		OP_TEX_IMAGE_2D,
+		OP_TEX_SUB_IMAGE_2D,
+		OP_TEX_STORAGE_2D,
+		OP_TEX_STORAGE_3D,
+		OP_TEX_PARAMETER_I,
+		OP_GENERATE_MIPMAP,
+		OP_BUFFER_DATA,
+		OP_BUFFER_SUB_DATA,
+		OP_COPY_IMAGE_SUB_DATA,
+		OP_FRAMEBUFFER_TEXTURE_2D,
+		OP_DRAW_BUFFERS,
+		OP_READ_BUFFER,
+
+		// vertex layout
+		OP_VERTEX_ATTRIB_POINTER,
+		OP_ENABLE_VERTEX_ATTRIB_ARRAY,
+		OP_DISABLE_VERTEX_ATTRIB_ARRAY,
+
+		// shaders and programs
+		OP_SHADER_SOURCE,
+		OP_COMPILE_SHADER,
+		OP_ATTACH_SHADER,
+		OP_LINK_PROGRAM,
+		OP_GET_UNIFORM_LOCATION,
+
+		// uniforms of the program in use
+		OP_UNIFORM_1I,
+		OP_UNIFORM_1F,
+		OP_UNIFORM_2F,
+		OP_UNIFORM_3F,
+		OP_UNIFORM_4F,
+		OP_UNIFORM_2FV,
+		OP_UNIFORM_3FV,
+		OP_UNIFORM_4FV,
+		OP_UNIFORM_MATRIX_4FV,
+
+		// fixed function state
+		OP_ENABLE,
+		OP_DISABLE,
+		OP_VIEWPORT,
+		OP_CLEAR_COLOR,
+		OP_CLEAR,
+		OP_CLEAR_BUFFER_UIV,
+		OP_CLEAR_BUFFER_FV,
+		OP_BLEND_FUNC,
+		OP_DEPTH_FUNC,
+		OP_DEPTH_MASK,
+		OP_CULL_FACE,
+		OP_STENCIL_FUNC,
+		OP_STENCIL_OP,
+		OP_STENCIL_MASK,
+		OP_POLYGON_MODE,
+		OP_MEMORY_BARRIER,
+
+		// work
+		OP_DRAW_ARRAYS,
+		OP_DRAW_ELEMENTS,
+		OP_DISPATCH_COMPUTE,
+		OP_BLIT_FRAMEBUFFER,
+		OP_BEGIN_QUERY,
+		OP_END_QUERY,
+
+		OPCODE_COUNT
+	};
+
+	// decoding information of an opcode
+	struct OPCODE_INFO
+	{
+		const char* name;
+		uint8_t     words;
+		bool        bBlob;
+	};
+
+	// indexed by OPCODE, must follow the order of the enum
+	const OPCODE_INFO OPCODES[OPCODE_COUNT] = {
+		{ "FrameEnd",                 0, false },
+
+		{ "glGenTextures",            0, true },
+		{ "glGenBuffers",             0, true },
+		{ "glGenVertexArrays",        0, true },
+		{ "glGenFramebuffers",        0, true },
+		{ "glGenQueries",             0, true },
+		{ "glCreateShader",           2, false },  // type, returned name
+		{ "glCreateProgram",          1, false },  // returned name
+
+		{ "glDeleteTextures",         0, true },
+		{ "glDeleteBuffers",          0, true },
+		{ "glDeleteVertexArrays",     0, true },
+		{ "glDeleteFramebuffers",     0, true },
+		{ "glDeleteQueries",          0, true },
+		{ "glDeleteShader",           1, false },
+		{ "glDeleteProgram",          1, false },
+
+		{ "glActiveTexture",          1, false },
+		{ "glBindTexture",            2, false },
+		{ "glBindBuffer",             2, false },
+		{ "glBindBufferBase",         3, false },
+		{ "glBindVertexArray",        1, false },
+		{ "glBindFramebuffer",        2, false },
+		{ "glUseProgram",             1, false },
+		{ "glBindImageTexture",       7, false },
+
+		{ "glTexImage2D",             8, true },
+		{ "glTexSubImage2D",          8, true },
+		{ "glTexStorage2D",           5, false },
+		{ "glTexStorage3D",           6, false },
+		{ "glTexParameteri",          3, false },
+		{ "glGenerateMipmap",         1, false },
+		{ "glBufferData",             3, true },   // target, size, usage
+		{ "glBufferSubData",          2, true },   // target, offset
+		{ "glCopyImageSubData",      15, false },
+		{ "glFramebufferTexture2D",   5, false },
+		{ "glDrawBuffers",            0, true },
+		{ "glReadBuffer",             1, false },
+
+		{ "glVertexAttribPointer",    6, false },
+		{ "glEnableVertexAttribArray", 1, false },
+		{ "glDisableVertexAttribArray", 1, false },
+
+		{ "glShaderSource",           1, true },
+		{ "glCompileShader",          1, false },
+		{ "glAttachShader",           2, false },
+		{ "glLinkProgram",            1, false },
+		{ "glGetUniformLocation",     2, true },   // program, returned location
+
+		{ "glUniform1i",              2, false },
+		{ "glUniform1f",              2, false },
+		{ "glUniform2f",              3, false },
+		{ "glUniform3f",              4, false },
+		{ "glUniform4f",              5, false },
+		{ "glUniform2fv",             1, true },
+		{ "glUniform3fv",             1, true },
+		{ "glUniform4fv",             1, true },
+		{ "glUniformMatrix4fv",       2, true },   // location, transpose
+
+		{ "glEnable",                 1, false },
+		{ "glDisable",                1, false },
+		{ "glViewport",               4, false },
+		{ "glClearColor",             4, false },
+		{ "glClear",                  1, false },
+		{ "glClearBufferuiv",         2, true },
+		{ "glClearBufferfv",          2, true },
+		{ "glBlendFunc",              2, false },
+		{ "glDepthFunc",              1, false },
+		{ "glDepthMask",              1, false },
+		{ "glCullFace",               1, false },
+		{ "glStencilFunc",            3, false },
+		{ "glStencilOp",              3, false },
+		{ "glStencilMask",            1, false },
+		{ "glPolygonMode",            2, false },
+		{ "glMemoryBarrier",          1, false },
+
+		{ "glDrawArrays",             3, false },
+		{ "glDrawElements",           4, false },
+		{ "glDispatchCompute",        3, false },
+		{ "glBlitFramebuffer",       10, false },
+		{ "glBeginQuery",             2, false },
+		{ "glEndQuery",               1, false },
+	};
+}
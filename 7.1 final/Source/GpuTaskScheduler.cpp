@@ -0,0 +1,225 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputaskscheduler.cpp
+// ============
+// spread expensive periodic GPU work over frames within a time budget
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuTaskScheduler.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// weight of a new frame in the averaged planned time
+	const double g_AverageWeight = 0.1;
+}
+
+/***********************************************************
+ *  GpuTaskScheduler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuTaskScheduler::GpuTaskScheduler()
+{
+	m_budgetMilliseconds = 2.0;
+	m_starvationPeriods = 4;
+	m_frame = 0;
+	m_stats = SCHEDULE_STATS();
+	m_averagePlanned = 0.0;
+}
+
+/***********************************************************
+ *  ~GpuTaskScheduler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuTaskScheduler::~GpuTaskScheduler()
+{
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		delete m_tasks[i]->pOwnTimer;
+		delete m_tasks[i];
+	}
+	m_tasks.clear();
+}
+
+/***********************************************************
+ *  AddTask()
+ *
+ *  This method is used for registering periodic GPU work.
+ *  The estimate is used until the task's timer has results,
+ *  and the period is the number of frames the task wants
+ *  between its runs. New tasks are due at once.
+ ***********************************************************/
+int GpuTaskScheduler::AddTask(const char* name, TASK_FUNCTION function, void* pContext, int priority,
+	double estimatedMilliseconds, unsigned int periodFrames, const GpuTimer* pTaskTimer)
+{
+	TASK* pTask = new TASK();
+	pTask->name = name;
+	pTask->function = function;
+	pTask->pContext = pContext;
+	pTask->priority = (priority > 0) ? priority : 1;
+	pTask->estimatedMilliseconds = estimatedMilliseconds;
+	pTask->periodFrames = (periodFrames > 0) ? periodFrames : 1;
+	pTask->bEnabled = true;
+	pTask->pOwnTimer = (NULL == pTaskTimer) ? new GpuTimer(pTask->name.c_str()) : NULL;
+	pTask->pTimer = (NULL == pTaskTimer) ? pTask->pOwnTimer : pTaskTimer;
+	pTask->addedFrame = m_frame;
+	// unsigned frame differences wrap, so this makes the task due
+	pTask->lastRunFrame = m_frame - pTask->periodFrames;
+	pTask->runCount = 0;
+	pTask->deferredCount = 0;
+	pTask->urgency = 0.0;
+
+	m_tasks.push_back(pTask);
+	return (int)m_tasks.size() - 1;
+}
+
+/***********************************************************
+ *  SetTaskEnabled()
+ *
+ *  This method is used for pausing and resuming a task. A
+ *  resumed task is due at once.
+ ***********************************************************/
+void GpuTaskScheduler::SetTaskEnabled(int id, bool bEnabled)
+{
+	if (id < 0 || id >= (int)m_tasks.size())
+		return;
+
+	TASK& task = *m_tasks[id];
+	if (bEnabled && !task.bEnabled)
+		task.lastRunFrame = m_frame - task.periodFrames;
+	task.bEnabled = bEnabled;
+}
+
+/***********************************************************
+ *  HasRunThisFrame()
+ *
+ *  This method is used for telling the frames a task ran
+ *  from the frames it was deferred or not due, whose timer
+ *  readings are those of an earlier run.
+ ***********************************************************/
+bool GpuTaskScheduler::HasRunThisFrame(int id) const
+{
+	if (id < 0 || id >= (int)m_tasks.size())
+		return false;
+
+	const TASK& task = *m_tasks[id];
+	return task.runCount > 0 && task.lastRunFrame == m_frame;
+}
+
+/***********************************************************
+ *  RunFrame()
+ *
+ *  This method is used for picking and running the work of
+ *  this frame. The due tasks are ordered by priority times
+ *  the number of periods they have waited, and run while the
+ *  sum of their costs fits the budget; the rest wait for a
+ *  later frame with a higher urgency.
+ ***********************************************************/
+void GpuTaskScheduler::RunFrame()
+{
+	m_frame++;
+	m_stats = SCHEDULE_STATS();
+
+	m_dueTasks.clear();
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		TASK& task = *m_tasks[i];
+		if (!task.bEnabled)
+			continue;
+
+		unsigned int waited = m_frame - task.lastRunFrame;
+		if (waited < task.periodFrames)
+			continue;
+
+		task.urgency = task.priority * (double)waited / (double)task.periodFrames;
+		m_dueTasks.push_back(&task);
+	}
+	m_stats.tasksDue = (int)m_dueTasks.size();
+
+	std::stable_sort(m_dueTasks.begin(), m_dueTasks.end(),
+		[](const TASK* a, const TASK* b) { return a->urgency > b->urgency; });
+
+	for (size_t i = 0; i < m_dueTasks.size(); i++)
+	{
+		TASK& task = *m_dueTasks[i];
+		double cost = GetCost(task);
+		bool bFits = (m_stats.plannedMilliseconds + cost) <= m_budgetMilliseconds;
+		// a task too expensive for any budget still runs, alone, once
+		// it has waited long enough
+		bool bStarved = m_stats.tasksRun == 0 && task.urgency >= task.priority * (double)m_starvationPeriods;
+		if (!bFits && !bStarved)
+		{
+			task.deferredCount++;
+			m_stats.tasksDeferred++;
+			continue;
+		}
+
+		RunTask(task);
+		m_stats.plannedMilliseconds += cost;
+		m_stats.tasksRun++;
+	}
+
+	m_averagePlanned += (m_stats.plannedMilliseconds - m_averagePlanned) * g_AverageWeight;
+}
+
+/***********************************************************
+ *  GetCost()
+ *
+ *  This method is used for the GPU time a run of the task is
+ *  expected to take: the measured average once there is one.
+ ***********************************************************/
+double GpuTaskScheduler::GetCost(const TASK& task) const
+{
+	if (task.pTimer->GetSampleCount() > 0)
+		return task.pTimer->GetAverageMilliseconds();
+	return task.estimatedMilliseconds;
+}
+
+/***********************************************************
+ *  RunTask()
+ *
+ *  This method is used for running a task, inside the
+ *  scheduler's timer when the task has none of its own.
+ ***********************************************************/
+void GpuTaskScheduler::RunTask(TASK& task)
+{
+	if (NULL != task.pOwnTimer)
+		task.pOwnTimer->Begin();
+	task.function(task.pContext);
+	if (NULL != task.pOwnTimer)
+		task.pOwnTimer->End();
+
+	task.lastRunFrame = m_frame;
+	task.runCount++;
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for printing the average budget use
+ *  and, per task, how often it ran against its period and
+ *  the cost the scheduler plans with.
+ ***********************************************************/
+void GpuTaskScheduler::Report() const
+{
+	std::cout << "[SCHEDULE] budget " << m_budgetMilliseconds << " ms, planned " << m_averagePlanned
+		<< " ms per frame, last frame " << m_stats.tasksRun << "/" << m_stats.tasksDue << " due tasks run" << std::endl;
+
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		const TASK& task = *m_tasks[i];
+		if (!task.bEnabled)
+			continue;
+
+		std::cout << "[SCHEDULE] " << task.name << ": " << GetCost(task)
+			<< (task.pTimer->GetSampleCount() > 0 ? " ms measured" : " ms estimated");
+		if (task.runCount > 0)
+			std::cout << ", every " << (double)(m_frame - task.addedFrame) / task.runCount << " frames";
+		std::cout << " (period " << task.periodFrames << ", priority " << task.priority << "), "
+			<< task.deferredCount << " deferrals" << std::endl;
+	}
+}
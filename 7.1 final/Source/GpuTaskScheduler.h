@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputaskscheduler.h
+// ============
+// spread expensive periodic GPU work over frames within a time budget
+//
+//	Work that only has to run every few frames, such as shadow map or
+//	probe updates and history passes, registers as a task with a
+//	priority, a period in frames and an estimated GPU cost. Each frame
+//	the tasks that are due are ordered by priority times how overdue
+//	they are and run while their cost fits the frame's budget, so they
+//	do not all land in the same frame. Once a task's GpuTimer has
+//	results, its measured average replaces the estimate. A task that
+//	alone exceeds the budget still runs, as the only one of its frame,
+//	after it has waited several periods.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "GpuTimer.h"
+
+class GpuTaskScheduler
+{
+public:
+	// the work of a task, called with the context it was added with
+	typedef void (*TASK_FUNCTION)(void* pContext);
+
+	// per frame statistics
+	struct SCHEDULE_STATS
+	{
+		int    tasksDue;
+		int    tasksRun;
+		int    tasksDeferred;       // due but over the budget
+		double plannedMilliseconds; // summed cost of the tasks run
+	};
+
+	// constructor
+	GpuTaskScheduler();
+	// destructor
+	~GpuTaskScheduler();
+
+	// add a task and return its ID; a task that measures itself passes
+	// its timer, since elapsed time queries cannot be nested, otherwise
+	// the scheduler times each run
+	int AddTask(const char* name, TASK_FUNCTION function, void* pContext, int priority,
+		double estimatedMilliseconds, unsigned int periodFrames, const GpuTimer* pTaskTimer = NULL);
+	// disabled tasks are never due
+	void SetTaskEnabled(int id, bool bEnabled);
+	// whether the last RunFrame ran the task, so its timer has new results
+	bool HasRunThisFrame(int id) const;
+
+	// run the tasks picked for this frame
+	void RunFrame();
+
+	// print the budget use and the cost and rate of every task
+	void Report() const;
+	const SCHEDULE_STATS& GetStats() const { return m_stats; }
+
+	// GPU milliseconds per frame the tasks may take together
+	double       m_budgetMilliseconds;
+	// periods a task waits before it runs over the budget
+	unsigned int m_starvationPeriods;
+
+private:
+	struct TASK
+	{
+		std::string    name;
+		TASK_FUNCTION  function;
+		void*          pContext;
+		int            priority;
+		double         estimatedMilliseconds;
+		unsigned int   periodFrames;
+		bool           bEnabled;
+		const GpuTimer* pTimer;         // the task's own or pOwnTimer
+		GpuTimer*      pOwnTimer;
+		unsigned int   addedFrame;
+		unsigned int   lastRunFrame;
+		unsigned int   runCount;
+		unsigned int   deferredCount;
+		double         urgency;         // of the current frame
+	};
+
+	std::vector<TASK*> m_tasks;
+	std::vector<TASK*> m_dueTasks;
+	unsigned int       m_frame;
+	SCHEDULE_STATS     m_stats;
+	// planned milliseconds per frame, averaged for the report
+	double             m_averagePlanned;
+
+	double GetCost(const TASK& task) const;
+	void RunTask(TASK& task);
+};
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputimer.cpp
+// ============
+// measure the GPU execution time of a block of OpenGL commands
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuTimer.h"
+
+// declaration of the global variables and defines
+namespace
+{
+	// weight of a new sample in the smoothed timing
+	const double g_AverageWeight = 0.1;
+}
+
+/***********************************************************
+ *  GpuTimer()
+ *
+ *  The constructor for the class. The query objects are
+ *  created lazily because a GL context may not exist yet.
+ ***********************************************************/
+GpuTimer::GpuTimer(const char* name)
+{
+	m_name = name;
+	m_current = 0;
+	m_bActive = false;
+	m_lastMilliseconds = 0.0;
+	m_averageMilliseconds = 0.0;
+	m_sampleCount = 0;
+
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_queries[i] = 0;
+		m_pending[i] = false;
+	}
+}
+
+/***********************************************************
+ *  ~GpuTimer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuTimer::~GpuTimer()
+{
+	if (m_queries[0] != 0)
+	{
+		glDeleteQueries(QUERY_COUNT, m_queries);
+	}
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for starting the elapsed time query
+ *  in the next free slot of the query ring.
+ ***********************************************************/
+void GpuTimer::Begin()
+{
+	if (m_queries[0] == 0)
+	{
+		glGenQueries(QUERY_COUNT, m_queries);
+	}
+
+	CollectResults();
+
+	// if every query is still in flight, skip this sample
+	// rather than waiting on the GPU
+	if (m_pending[m_current])
+		return;
+
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[m_current]);
+	m_bActive = true;
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method is used for ending the active elapsed time
+ *  query and advancing to the next slot of the ring.
+ ***********************************************************/
+void GpuTimer::End()
+{
+	if (!m_bActive)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_pending[m_current] = true;
+	m_current = (m_current + 1) % QUERY_COUNT;
+	m_bActive = false;
+}
+
+/***********************************************************
+ *  CollectResults()
+ *
+ *  This method is used for reading back any query results
+ *  that are already available, without blocking.
+ ***********************************************************/
+void GpuTimer::CollectResults()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		if (!m_pending[i])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(m_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(m_queries[i], GL_QUERY_RESULT, &elapsed);
+		m_pending[i] = false;
+
+		m_lastMilliseconds = static_cast<double>(elapsed) / 1000000.0;
+		if (m_sampleCount == 0)
+			m_averageMilliseconds = m_lastMilliseconds;
+		else
+			m_averageMilliseconds += (m_lastMilliseconds - m_averageMilliseconds) * g_AverageWeight;
+		m_sampleCount++;
+	}
+}
@@ -0,0 +1,50 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputimer.h
+// ============
+// measure the GPU execution time of a block of OpenGL commands
+//
+//	Uses a small ring of GL_TIME_ELAPSED queries so that results are
+//	read back a few frames late instead of stalling the pipeline.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+class GpuTimer
+{
+public:
+	// constructor
+	GpuTimer(const char* name);
+	// destructor
+	~GpuTimer();
+
+	// start timing the GL commands issued after this call
+	void Begin();
+	// stop timing the GL commands issued since Begin()
+	void End();
+
+	// name used when reporting the timing
+	const char* GetName() const { return m_name; }
+	// most recent GPU time that was read back, in milliseconds
+	double GetLastMilliseconds() const { return m_lastMilliseconds; }
+	// smoothed GPU time, in milliseconds
+	double GetAverageMilliseconds() const { return m_averageMilliseconds; }
+	// number of query results that have been read back
+	unsigned int GetSampleCount() const { return m_sampleCount; }
+
+private:
+	// number of queries kept in flight
+	static const int QUERY_COUNT = 4;
+
+	const char* m_name;
+	GLuint      m_queries[QUERY_COUNT];
+	bool        m_pending[QUERY_COUNT];
+	int         m_current;
+	bool        m_bActive;
+	double      m_lastMilliseconds;
+	double      m_averageMilliseconds;
+	unsigned int m_sampleCount;
+
+	void CollectResults();
+};
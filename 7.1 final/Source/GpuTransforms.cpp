@@ -0,0 +1,375 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputransforms.cpp
+// ============
+// compose the world and normal matrices of a transform hierarchy on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuTransforms.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_UpdateShaderFile = "transform_update.comp";
+
+	// work group size of transform_update.comp
+	const int g_GroupSize = 64;
+
+	// ObjectTransform of transform_update.comp and shader.vert, the world
+	// and the normal matrix
+	const GLsizeiptr g_TransformBytes = 2 * sizeof(glm::mat4);
+
+	// unchanged slots between two changed ones that are uploaded along
+	// with them rather than splitting the upload
+	const int g_MaxRunGap = 8;
+
+	// slots the buffers are created with
+	const size_t g_InitialCapacity = 256;
+}
+
+/***********************************************************
+ *  GpuTransforms()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuTransforms::GpuTransforms()
+	: m_timer("Transform update")
+{
+	for (int stream = 0; stream < STREAM_COUNT; stream++)
+		m_streamBuffers[stream] = 0;
+	m_parentBuffer = 0;
+	m_transformBuffer = 0;
+	m_capacity = 0;
+	m_bLayoutDirty = false;
+	m_valuesPending = 0;
+	m_stats = UPDATE_STATS();
+}
+
+/***********************************************************
+ *  ~GpuTransforms()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuTransforms::~GpuTransforms()
+{
+	if (m_streamBuffers[0] != 0)
+		glDeleteBuffers(STREAM_COUNT, m_streamBuffers);
+	if (m_parentBuffer != 0)
+		glDeleteBuffers(1, &m_parentBuffer);
+	if (m_transformBuffer != 0)
+		glDeleteBuffers(1, &m_transformBuffer);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the compute program and
+ *  creating the buffers. Compute shaders and the storage
+ *  buffers shader.vert reads need OpenGL 4.3.
+ ***********************************************************/
+bool GpuTransforms::Initialize()
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "GPU transform update disabled: OpenGL 4.3 is required" << std::endl;
+		return false;
+	}
+
+	if (!m_program.Load(g_UpdateShaderFile))
+		return false;
+
+	glGenBuffers(STREAM_COUNT, m_streamBuffers);
+	glGenBuffers(1, &m_parentBuffer);
+	glGenBuffers(1, &m_transformBuffer);
+	return true;
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a node to the hierarchy.
+ *  The nodes are stored level by level, so adding one moves
+ *  the slots and the next Update uploads everything.
+ ***********************************************************/
+int GpuTransforms::AddNode(int parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+	int node = (int)m_nodeParents.size();
+	if (parent >= node)
+	{
+		std::cout << "[WARNING] Transform node " << node << " is added before its parent " << parent
+			<< ", it becomes a root" << std::endl;
+		parent = -1;
+	}
+
+	// appended for now, UpdateLayout moves it to its level
+	m_nodeParents.push_back(parent);
+	m_nodeSlots.push_back(node);
+	m_nodeRanks.push_back(node);
+	m_streams[STREAM_TRANSLATION].push_back(glm::vec4(translation, 0.0f));
+	m_streams[STREAM_ROTATION].push_back(glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
+	m_streams[STREAM_SCALE].push_back(glm::vec4(scale, 0.0f));
+	m_bLayoutDirty = true;
+	return node;
+}
+
+/***********************************************************
+ *  SetTranslation() / SetRotation() / SetScale()
+ *
+ *  These methods are used for changing one component of a
+ *  node's local transform; only the changed component of
+ *  the node is uploaded.
+ ***********************************************************/
+void GpuTransforms::SetTranslation(int node, const glm::vec3& translation)
+{
+	SetStream(STREAM_TRANSLATION, node, glm::vec4(translation, 0.0f));
+}
+
+void GpuTransforms::SetRotation(int node, const glm::quat& rotation)
+{
+	SetStream(STREAM_ROTATION, node, glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
+}
+
+void GpuTransforms::SetScale(int node, const glm::vec3& scale)
+{
+	SetStream(STREAM_SCALE, node, glm::vec4(scale, 0.0f));
+}
+
+/***********************************************************
+ *  SetNodeRank()
+ *
+ *  This method is used for ordering the slots of a level,
+ *  by rank and then by the order the nodes were added.
+ ***********************************************************/
+void GpuTransforms::SetNodeRank(int node, int rank)
+{
+	if (node < 0 || node >= (int)m_nodeRanks.size() || m_nodeRanks[node] == rank)
+		return;
+
+	m_nodeRanks[node] = rank;
+	m_bLayoutDirty = true;
+}
+
+/***********************************************************
+ *  SetStream()
+ *
+ *  This method is used for storing a value of a node and
+ *  remembering its slot for the next upload.
+ ***********************************************************/
+void GpuTransforms::SetStream(STREAM stream, int node, const glm::vec4& value)
+{
+	if (node < 0 || node >= (int)m_nodeSlots.size())
+		return;
+
+	int slot = m_nodeSlots[node];
+	m_streams[stream][slot] = value;
+	m_valuesPending++;
+
+	// a new layout uploads every slot anyway
+	if (m_bLayoutDirty || m_bDirty[stream][slot])
+		return;
+	m_bDirty[stream][slot] = true;
+	m_dirtySlots[stream].push_back(slot);
+}
+
+/***********************************************************
+ *  UpdateLayout()
+ *
+ *  This method is used for sorting the slots by the depth
+ *  of their nodes in the hierarchy, so every level is one
+ *  range the compute shader can run after its parents, and
+ *  by rank within a level, and uploading all of the buffers.
+ ***********************************************************/
+void GpuTransforms::UpdateLayout()
+{
+	size_t nodeCount = m_nodeParents.size();
+
+	// parents come before their children, so one pass finds the depths
+	std::vector<int>& depths = m_layoutDepths;
+	std::vector<int>& order = m_layoutOrder;
+	depths.resize(nodeCount);
+	order.resize(nodeCount);
+	for (size_t node = 0; node < nodeCount; node++)
+	{
+		int parent = m_nodeParents[node];
+		depths[node] = (parent >= 0) ? depths[parent] + 1 : 0;
+		order[node] = (int)node;
+	}
+	const std::vector<int>& ranks = m_nodeRanks;
+	std::sort(order.begin(), order.end(), [&depths, &ranks](int a, int b)
+	{
+		if (depths[a] != depths[b])
+			return depths[a] < depths[b];
+		if (ranks[a] != ranks[b])
+			return ranks[a] < ranks[b];
+		return a < b;
+	});
+
+	std::vector<int>& parentSlots = m_layoutParentSlots;
+	std::vector<int>& slots = m_layoutSlots;
+	parentSlots.resize(nodeCount);
+	slots.resize(nodeCount);
+	for (int stream = 0; stream < STREAM_COUNT; stream++)
+		m_layoutStreams[stream].resize(nodeCount);
+	for (size_t slot = 0; slot < nodeCount; slot++)
+		slots[order[slot]] = (int)slot;
+	m_levels.clear();
+	for (size_t slot = 0; slot < nodeCount; slot++)
+	{
+		int node = order[slot];
+		for (int stream = 0; stream < STREAM_COUNT; stream++)
+			m_layoutStreams[stream][slot] = m_streams[stream][m_nodeSlots[node]];
+		parentSlots[slot] = (m_nodeParents[node] >= 0) ? slots[m_nodeParents[node]] : -1;
+
+		if (m_levels.empty() || depths[node] >= (int)m_levels.size())
+		{
+			LEVEL level = { (int)slot, 0 };
+			m_levels.push_back(level);
+		}
+		m_levels.back().slotCount++;
+	}
+	m_nodeSlots.swap(slots);
+
+	// the buffers grow to twice the slots they need
+	if (nodeCount > m_capacity)
+	{
+		m_capacity = std::max(g_InitialCapacity, nodeCount * 2);
+		for (int stream = 0; stream < STREAM_COUNT; stream++)
+		{
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_streamBuffers[stream]);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, m_capacity * sizeof(glm::vec4), NULL, GL_DYNAMIC_DRAW);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_parentBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_capacity * sizeof(GLint), NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_transformBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_capacity * g_TransformBytes, NULL, GL_DYNAMIC_COPY);
+	}
+
+	for (int stream = 0; stream < STREAM_COUNT; stream++)
+	{
+		m_streams[stream].swap(m_layoutStreams[stream]);
+		m_dirtySlots[stream].clear();
+		m_bDirty[stream].assign(nodeCount, false);
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_streamBuffers[stream]);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, nodeCount * sizeof(glm::vec4), &m_streams[stream][0]);
+		m_stats.uploadRuns++;
+		m_stats.uploadBytes += nodeCount * sizeof(glm::vec4);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_parentBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, nodeCount * sizeof(GLint), &parentSlots[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	m_stats.uploadBytes += nodeCount * sizeof(GLint);
+
+	m_bLayoutDirty = false;
+}
+
+/***********************************************************
+ *  UploadStream()
+ *
+ *  This method is used for uploading the changed slots of a
+ *  stream, as runs of neighbouring slots with short gaps of
+ *  unchanged ones folded in.
+ ***********************************************************/
+void GpuTransforms::UploadStream(STREAM stream)
+{
+	std::vector<int>& dirtySlots = m_dirtySlots[stream];
+	if (dirtySlots.empty())
+		return;
+
+	std::sort(dirtySlots.begin(), dirtySlots.end());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_streamBuffers[stream]);
+
+	size_t runStart = 0;
+	for (size_t i = 1; i <= dirtySlots.size(); i++)
+	{
+		if (i < dirtySlots.size() && dirtySlots[i] - dirtySlots[i - 1] <= g_MaxRunGap)
+			continue;
+
+		int firstSlot = dirtySlots[runStart];
+		int slotCount = dirtySlots[i - 1] - firstSlot + 1;
+		GLsizeiptr bytes = slotCount * sizeof(glm::vec4);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, firstSlot * sizeof(glm::vec4), bytes, &m_streams[stream][firstSlot]);
+		m_stats.uploadRuns++;
+		m_stats.uploadBytes += bytes;
+		runStart = i;
+	}
+
+	for (size_t i = 0; i < dirtySlots.size(); i++)
+		m_bDirty[stream][dirtySlots[i]] = false;
+	dirtySlots.clear();
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for uploading the changed values and
+ *  running one dispatch per hierarchy level, from the first
+ *  level with a change down, with a barrier between levels
+ *  so children read the finished matrices of their parents.
+ ***********************************************************/
+bool GpuTransforms::Update()
+{
+	m_stats = UPDATE_STATS();
+	m_stats.valuesChanged = m_valuesPending;
+	m_valuesPending = 0;
+
+	if (!m_program.IsLoaded() || m_nodeParents.empty())
+		return false;
+
+	// the levels above the first change keep their matrices
+	int firstLevel = (int)m_levels.size();
+	if (m_bLayoutDirty)
+	{
+		UpdateLayout();
+		firstLevel = 0;
+	}
+	else
+	{
+		for (int stream = 0; stream < STREAM_COUNT; stream++)
+		{
+			if (m_dirtySlots[stream].empty())
+				continue;
+			int firstSlot = *std::min_element(m_dirtySlots[stream].begin(), m_dirtySlots[stream].end());
+			int level = 0;
+			while (level + 1 < (int)m_levels.size() && m_levels[level + 1].firstSlot <= firstSlot)
+				level++;
+			firstLevel = std::min(firstLevel, level);
+			UploadStream((STREAM)stream);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+	if (firstLevel >= (int)m_levels.size())
+		return false;
+
+	m_timer.Begin();
+	m_program.use();
+	for (int stream = 0; stream < STREAM_COUNT; stream++)
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, stream, m_streamBuffers[stream]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_parentBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_transformBuffer);
+
+	for (int level = firstLevel; level < (int)m_levels.size(); level++)
+	{
+		m_program.setIntValue("uLevelStart", m_levels[level].firstSlot);
+		m_program.setIntValue("uLevelCount", m_levels[level].slotCount);
+		m_program.Dispatch((m_levels[level].slotCount + g_GroupSize - 1) / g_GroupSize, 1, 1);
+		// the next level and the vertex shader read these matrices
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		m_stats.levelsDispatched++;
+	}
+	m_timer.End();
+	return true;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the matrices to the
+ *  storage buffer binding of shader.vert.
+ ***********************************************************/
+void GpuTransforms::Bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TRANSFORM_BINDING, m_transformBuffer);
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// gputransforms.h
+// ============
+// compose the world and normal matrices of a transform hierarchy on the GPU
+//
+//	The local translation, rotation and scale of every node live in three
+//	storage buffers, structure of arrays, next to the parent index of the
+//	node. The nodes are stored level by level of the hierarchy, and one
+//	compute dispatch per level (transform_update.comp) writes the world
+//	and normal matrices of its nodes into the ObjectTransforms buffer,
+//	which the VERTEX_PULLING path of shader.vert indexes with objectIndex.
+//	The CPU never composes a matrix: only the TRS values that changed
+//	since the last update are uploaded, as runs of neighbouring slots.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "ComputeProgram.h"
+#include "GpuTimer.h"
+
+class GpuTransforms
+{
+public:
+	// storage buffer binding of the matrices in shader.vert
+	static const int TRANSFORM_BINDING = 2;
+
+	// per update statistics
+	struct UPDATE_STATS
+	{
+		int      valuesChanged;     // translations, rotations and scales set
+		int      uploadRuns;        // glBufferSubData calls for the TRS values
+		uint64_t uploadBytes;
+		int      levelsDispatched;
+	};
+
+	// constructor
+	GpuTransforms();
+	// destructor
+	~GpuTransforms();
+
+	// load the compute program, needs OpenGL 4.3
+	bool Initialize();
+
+	// add a node below the passed in parent, -1 for a root, and return
+	// its ID; parents are added before their children
+	int AddNode(int parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+	// change the local transform of a node, uploaded by the next Update
+	void SetTranslation(int node, const glm::vec3& translation);
+	void SetRotation(int node, const glm::quat& rotation);
+	void SetScale(int node, const glm::vec3& scale);
+	// place the node within its level by rank, e.g. the storage order of
+	// the objects; a change moves the slots and the next Update uploads
+	// everything
+	void SetNodeRank(int node, int rank);
+
+	// upload the changes and recompose the matrices, level by level; false
+	// when nothing changed and no compute program was used
+	bool Update();
+	// bind the matrices to TRANSFORM_BINDING for drawing
+	void Bind() const;
+	// the index of a node's matrices, the objectIndex of shader.vert
+	int GetSlot(int node) const { return m_nodeSlots[node]; }
+	int GetNodeCount() const { return (int)m_nodeParents.size(); }
+
+	const UPDATE_STATS& GetStats() const { return m_stats; }
+	const GpuTimer& GetTimer() const { return m_timer; }
+
+private:
+	// the TRS streams, in the order of the storage buffers
+	enum STREAM
+	{
+		STREAM_TRANSLATION,
+		STREAM_ROTATION,
+		STREAM_SCALE,
+		STREAM_COUNT
+	};
+
+	// one level of the hierarchy, a range of slots
+	struct LEVEL
+	{
+		int firstSlot;
+		int slotCount;
+	};
+
+	ComputeProgram m_program;
+	GpuTimer       m_timer;
+	GLuint         m_streamBuffers[STREAM_COUNT];
+	GLuint         m_parentBuffer;
+	GLuint         m_transformBuffer;
+	size_t         m_capacity;          // slots the buffers hold
+
+	// per node, in the order the nodes were added
+	std::vector<int>       m_nodeParents;
+	std::vector<int>       m_nodeSlots;
+	std::vector<int>       m_nodeRanks;
+	// per slot, the values the GPU has or gets with the next upload
+	std::vector<glm::vec4> m_streams[STREAM_COUNT];
+	std::vector<int>       m_dirtySlots[STREAM_COUNT];
+	std::vector<bool>      m_bDirty[STREAM_COUNT];
+	std::vector<LEVEL>     m_levels;
+	bool                   m_bLayoutDirty;
+	// UpdateLayout's work, kept so a new layout reuses the memory
+	std::vector<int>       m_layoutDepths;
+	std::vector<int>       m_layoutOrder;
+	std::vector<int>       m_layoutSlots;
+	std::vector<int>       m_layoutParentSlots;
+	std::vector<glm::vec4> m_layoutStreams[STREAM_COUNT];
+	int                    m_valuesPending;    // set since the last Update
+	UPDATE_STATS           m_stats;
+
+	void SetStream(STREAM stream, int node, const glm::vec4& value);
+	void UpdateLayout();
+	void UploadStream(STREAM stream);
+};
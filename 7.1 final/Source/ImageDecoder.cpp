@@ -0,0 +1,504 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagedecoder.cpp
+// ============
+// decode texture image files with the fastest decoder available
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageDecoder.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(IMAGEDECODER_TURBOJPEG)
+#include <turbojpeg.h>
+#endif
+#if defined(IMAGEDECODER_SPNG)
+#include <spng.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// images and time spent per decoder
+	struct DECODE_TIMES
+	{
+		unsigned int images;
+		double       megapixels;
+		double       milliseconds;
+	};
+
+	DECODE_TIMES g_DecodeTimes[IMAGE_DECODER_COUNT] = { { 0, 0.0, 0.0 }, { 0, 0.0, 0.0 }, { 0, 0.0, 0.0 } };
+	const char* g_DecoderNames[IMAGE_DECODER_COUNT] = { "stb_image", "libjpeg-turbo", "libspng" };
+	bool g_bStbOnly = false;
+
+	bool DecodeStb(const unsigned char* pData, size_t size, DECODED_IMAGE& image)
+	{
+		if (size > INT_MAX)
+			return false;
+		stbi_set_flip_vertically_on_load(true);
+		image.pPixels = stbi_load_from_memory(pData, (int)size, &image.width, &image.height, &image.channels, 0);
+		image.decoder = IMAGE_DECODER_STB;
+		image.threads = 1;
+		return NULL != image.pPixels;
+	}
+
+#if defined(IMAGEDECODER_TURBOJPEG)
+	// JPEGs with fewer pixels are decoded on one thread
+	const long long g_ParallelJpegPixels = 2048 * 2048;
+	const unsigned int g_MaxDecodeThreads = 8;
+
+	bool IsJpeg(const unsigned char* pData, size_t size)
+	{
+		return size >= 3 && pData[0] == 0xFF && pData[1] == 0xD8 && pData[2] == 0xFF;
+	}
+
+	// where the restart intervals of a baseline JPEG lie
+	struct JPEG_LAYOUT
+	{
+		size_t              sofHeightOffset;    // frame height in the SOF segment
+		size_t              scanStart;          // first entropy coded byte
+		size_t              scanEnd;            // offset of the EOI marker
+		int                 height;
+		int                 mcuHeight;
+		int                 mcusPerRow;
+		int                 restartInterval;    // in MCUs
+		std::vector<size_t> restarts;           // offsets of the RST markers
+	};
+
+	// a horizontal band decoded on its own, as a JPEG of its own
+	struct JPEG_BAND
+	{
+		std::vector<unsigned char> jpeg;
+		int                        rowStart;
+		int                        rows;
+		int                        bDecoded;
+	};
+
+	int GreatestCommonDivisor(int a, int b)
+	{
+		while (b != 0)
+		{
+			int remainder = a % b;
+			a = b;
+			b = remainder;
+		}
+		return a;
+	}
+
+	// only a single interleaved Huffman scan with restart markers splits
+	bool ParseJpegLayout(const unsigned char* pData, size_t size, JPEG_LAYOUT& layout)
+	{
+		int width = 0;
+		int components = 0;
+		int maxHorizontal = 1;
+		int maxVertical = 1;
+		layout.sofHeightOffset = 0;
+		layout.scanStart = 0;
+		layout.scanEnd = 0;
+		layout.height = 0;
+		layout.restartInterval = 0;
+
+		size_t position = 2;
+		while (position + 4 <= size && layout.scanStart == 0)
+		{
+			if (pData[position] != 0xFF)
+				return false;
+			unsigned char marker = pData[position + 1];
+			if (marker == 0xFF)
+			{
+				position++;
+				continue;
+			}
+			size_t length = ((size_t)pData[position + 2] << 8) | pData[position + 3];
+			const unsigned char* pSegment = pData + position + 4;
+			if (length < 2 || position + 2 + length > size)
+				return false;
+
+			if (marker == 0xC0 || marker == 0xC1)
+			{
+				if (length < 8)
+					return false;
+				layout.sofHeightOffset = position + 5;
+				layout.height = (pSegment[1] << 8) | pSegment[2];
+				width = (pSegment[3] << 8) | pSegment[4];
+				components = pSegment[5];
+				if (length < 8 + 3 * (size_t)components)
+					return false;
+				for (int i = 0; i < components; i++)
+				{
+					maxHorizontal = std::max(maxHorizontal, pSegment[7 + i * 3] >> 4);
+					maxVertical = std::max(maxVertical, pSegment[7 + i * 3] & 15);
+				}
+			}
+			else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+			{
+				// progressive, lossless and arithmetic coded frames
+				return false;
+			}
+			else if (marker == 0xDD && length >= 4)
+			{
+				layout.restartInterval = (pSegment[0] << 8) | pSegment[1];
+			}
+			else if (marker == 0xDA)
+			{
+				if (layout.sofHeightOffset == 0 || pSegment[0] != components)
+					return false;
+				layout.scanStart = position + 2 + length;
+			}
+			position += 2 + length;
+		}
+		if (layout.scanStart == 0 || layout.restartInterval == 0 || width == 0 || layout.height == 0)
+			return false;
+
+		// a single component scan is coded block by block
+		int mcuWidth = (components == 1) ? 8 : 8 * maxHorizontal;
+		layout.mcuHeight = (components == 1) ? 8 : 8 * maxVertical;
+		layout.mcusPerRow = (width + mcuWidth - 1) / mcuWidth;
+		int mcuRows = (layout.height + layout.mcuHeight - 1) / layout.mcuHeight;
+
+		// 0xFF 0x00 is a stuffed data byte, any other marker ends the scan
+		layout.restarts.clear();
+		size_t index = layout.scanStart;
+		while (index + 1 < size && layout.scanEnd == 0)
+		{
+			const unsigned char* pMarker = (const unsigned char*)memchr(pData + index, 0xFF, size - 1 - index);
+			if (NULL == pMarker)
+				break;
+			index = (size_t)(pMarker - pData);
+			unsigned char marker = pData[index + 1];
+			if (marker == 0x00)
+				index += 2;
+			else if (marker >= 0xD0 && marker <= 0xD7)
+			{
+				layout.restarts.push_back(index);
+				index += 2;
+			}
+			else if (marker == 0xFF)
+				index++;
+			else
+				layout.scanEnd = index;
+		}
+
+		// a second scan or a truncated file is left to a single decoder
+		long long intervals = ((long long)layout.mcusPerRow * mcuRows + layout.restartInterval - 1) / layout.restartInterval;
+		return layout.scanEnd != 0 && pData[layout.scanEnd + 1] == 0xD9 && (long long)layout.restarts.size() + 1 == intervals;
+	}
+
+	bool DecompressJpeg(const unsigned char* pData, size_t size, unsigned char* pDestination, int width, int height)
+	{
+		tjhandle handle = tj3Init(TJINIT_DECOMPRESS);
+		if (NULL == handle)
+			return false;
+		tj3Set(handle, TJPARAM_BOTTOMUP, 1);
+		bool bDecoded = tj3DecompressHeader(handle, pData, size) == 0 &&
+			tj3Get(handle, TJPARAM_JPEGWIDTH) == width && tj3Get(handle, TJPARAM_JPEGHEIGHT) == height &&
+			tj3Decompress8(handle, pData, size, pDestination, width * tjPixelSize[TJPF_RGB], TJPF_RGB) == 0;
+		tj3Destroy(handle);
+		return bDecoded;
+	}
+
+	// the band is written bottom up into its rows of the whole image
+	void DecodeJpegBand(JPEG_BAND* pBand, DECODED_IMAGE* pImage)
+	{
+		size_t rowBytes = (size_t)pImage->width * 3;
+		unsigned char* pDestination = pImage->pPixels + (size_t)(pImage->height - pBand->rowStart - pBand->rows) * rowBytes;
+		pBand->bDecoded = DecompressJpeg(&pBand->jpeg[0], pBand->jpeg.size(), pDestination, pImage->width, pBand->rows) ? 1 : 0;
+	}
+
+	// returns the number of bands decoded, 0 when the image was not split
+	int DecodeJpegBands(const unsigned char* pData, const JPEG_LAYOUT& layout, DECODED_IMAGE& image)
+	{
+		// a band can only start at an interval that starts an MCU row
+		int intervals = (int)layout.restarts.size() + 1;
+		int step = layout.mcusPerRow / GreatestCommonDivisor(layout.restartInterval, layout.mcusPerRow);
+		int stepRows = step * layout.restartInterval / layout.mcusPerRow * layout.mcuHeight;
+		int steps = (intervals + step - 1) / step;
+		int bandCount = (int)std::min(std::min(std::thread::hardware_concurrency(), g_MaxDecodeThreads), (unsigned int)steps);
+		if (bandCount < 2)
+			return 0;
+
+		std::vector<JPEG_BAND> bands(bandCount);
+		for (int b = 0; b < bandCount; b++)
+		{
+			int firstStep = steps * b / bandCount;
+			int endStep = steps * (b + 1) / bandCount;
+			int firstInterval = firstStep * step;
+			int endInterval = std::min(intervals, endStep * step);
+			size_t dataStart = (firstInterval == 0) ? layout.scanStart : layout.restarts[firstInterval - 1] + 2;
+			size_t dataEnd = (endInterval == intervals) ? layout.scanEnd : layout.restarts[endInterval - 1];
+
+			JPEG_BAND& band = bands[b];
+			band.rowStart = firstStep * stepRows;
+			band.rows = std::min(layout.height, endStep * stepRows) - band.rowStart;
+			band.bDecoded = 0;
+			band.jpeg.reserve(layout.scanStart + (dataEnd - dataStart) + 2);
+			band.jpeg.assign(pData, pData + layout.scanStart);
+			band.jpeg[layout.sofHeightOffset] = (unsigned char)(band.rows >> 8);
+			band.jpeg[layout.sofHeightOffset + 1] = (unsigned char)(band.rows & 0xFF);
+			band.jpeg.insert(band.jpeg.end(), pData + dataStart, pData + dataEnd);
+			// the decoder expects the markers of every band to count from RST0
+			for (int i = firstInterval; i + 1 < endInterval; i++)
+				band.jpeg[layout.scanStart + (layout.restarts[i] - dataStart) + 1] = (unsigned char)(0xD0 + ((i - firstInterval) & 7));
+			band.jpeg.push_back(0xFF);
+			band.jpeg.push_back(0xD9);
+		}
+
+		std::vector<std::thread> workers;
+		for (int b = 1; b < bandCount; b++)
+			workers.push_back(std::thread(DecodeJpegBand, &bands[b], &image));
+		DecodeJpegBand(&bands[0], &image);
+		for (size_t i = 0; i < workers.size(); i++)
+			workers[i].join();
+
+		for (int b = 0; b < bandCount; b++)
+		{
+			if (!bands[b].bDecoded)
+				return 0;
+		}
+		return bandCount;
+	}
+
+	bool DecodeTurboJpeg(const unsigned char* pData, size_t size, DECODED_IMAGE& image)
+	{
+		tjhandle handle = tj3Init(TJINIT_DECOMPRESS);
+		if (NULL == handle)
+			return false;
+		bool bHeader = tj3DecompressHeader(handle, pData, size) == 0;
+		int width = tj3Get(handle, TJPARAM_JPEGWIDTH);
+		int height = tj3Get(handle, TJPARAM_JPEGHEIGHT);
+		tj3Destroy(handle);
+		if (!bHeader || width <= 0 || height <= 0)
+			return false;
+
+		// grayscale is expanded to RGB like every other JPEG
+		image.pPixels = (unsigned char*)malloc((size_t)width * height * 3);
+		if (NULL == image.pPixels)
+			return false;
+		image.width = width;
+		image.height = height;
+		image.channels = 3;
+		image.decoder = IMAGE_DECODER_TURBOJPEG;
+
+		JPEG_LAYOUT layout;
+		image.threads = ((long long)width * height >= g_ParallelJpegPixels && ParseJpegLayout(pData, size, layout)) ?
+			DecodeJpegBands(pData, layout, image) : 0;
+		if (image.threads == 0)
+		{
+			image.threads = 1;
+			if (!DecompressJpeg(pData, size, image.pPixels, width, height))
+			{
+				free(image.pPixels);
+				image.pPixels = NULL;
+				return false;
+			}
+		}
+		return true;
+	}
+#endif
+
+#if defined(IMAGEDECODER_SPNG)
+	bool IsPng(const unsigned char* pData, size_t size)
+	{
+		static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		return size >= sizeof(signature) && memcmp(pData, signature, sizeof(signature)) == 0;
+	}
+
+	void FlipRows(unsigned char* pPixels, int width, int height, int channels)
+	{
+		size_t rowBytes = (size_t)width * channels;
+		std::vector<unsigned char> row(rowBytes);
+		for (int y = 0; y < height / 2; y++)
+		{
+			unsigned char* pTop = pPixels + (size_t)y * rowBytes;
+			unsigned char* pBottom = pPixels + (size_t)(height - 1 - y) * rowBytes;
+			memcpy(&row[0], pTop, rowBytes);
+			memcpy(pTop, pBottom, rowBytes);
+			memcpy(pBottom, &row[0], rowBytes);
+		}
+	}
+
+	bool DecodeSpng(const unsigned char* pData, size_t size, DECODED_IMAGE& image)
+	{
+		spng_ctx* pContext = spng_ctx_new(0);
+		if (NULL == pContext)
+			return false;
+
+		struct spng_ihdr header;
+		struct spng_trns transparency;
+		size_t imageSize = 0;
+		bool bDecoded = spng_set_png_buffer(pContext, pData, size) == 0 && spng_get_ihdr(pContext, &header) == 0;
+		if (bDecoded)
+		{
+			// alpha channels and transparency chunks decode to RGBA
+			bool bAlpha = header.color_type == SPNG_COLOR_TYPE_TRUECOLOR_ALPHA ||
+				header.color_type == SPNG_COLOR_TYPE_GRAYSCALE_ALPHA || spng_get_trns(pContext, &transparency) == 0;
+			int format = bAlpha ? SPNG_FMT_RGBA8 : SPNG_FMT_RGB8;
+			image.width = (int)header.width;
+			image.height = (int)header.height;
+			image.channels = bAlpha ? 4 : 3;
+			bDecoded = spng_decoded_image_size(pContext, format, &imageSize) == 0 &&
+				NULL != (image.pPixels = (unsigned char*)malloc(imageSize)) &&
+				spng_decode_image(pContext, image.pPixels, imageSize, format, SPNG_DECODE_TRNS) == 0;
+		}
+		spng_ctx_free(pContext);
+
+		if (!bDecoded)
+		{
+			free(image.pPixels);
+			image.pPixels = NULL;
+			return false;
+		}
+		FlipRows(image.pPixels, image.width, image.height, image.channels);
+		image.decoder = IMAGE_DECODER_SPNG;
+		image.threads = 1;
+		return true;
+	}
+#endif
+}
+
+/***********************************************************
+ *  Decode()
+ *
+ *  This method is used for reading an image file into
+ *  memory and decoding it.
+ ***********************************************************/
+bool ImageDecoder::Decode(const char* filename, DECODED_IMAGE& image)
+{
+	image.pPixels = NULL;
+
+	FILE* file = fopen(filename, "rb");
+	if (NULL == file)
+		return false;
+	std::vector<unsigned char> data;
+	if (fseek(file, 0, SEEK_END) == 0)
+	{
+		long size = ftell(file);
+		if (size > 0 && fseek(file, 0, SEEK_SET) == 0)
+		{
+			data.resize((size_t)size);
+			if (fread(&data[0], 1, data.size(), file) != data.size())
+				data.clear();
+		}
+	}
+	fclose(file);
+
+	return !data.empty() && DecodeMemory(&data[0], data.size(), image);
+}
+
+/***********************************************************
+ *  DecodeMemory()
+ *
+ *  This method is used for decoding an encoded image with
+ *  the fast decoder for its format, falling back to
+ *  stb_image when there is none or it fails.
+ ***********************************************************/
+bool ImageDecoder::DecodeMemory(const unsigned char* pData, size_t size, DECODED_IMAGE& image)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	memset(&image, 0, sizeof(image));
+
+	bool bDecoded = false;
+#if defined(IMAGEDECODER_TURBOJPEG)
+	if (!g_bStbOnly && IsJpeg(pData, size))
+		bDecoded = DecodeTurboJpeg(pData, size, image);
+#endif
+#if defined(IMAGEDECODER_SPNG)
+	if (!g_bStbOnly && !bDecoded && IsPng(pData, size))
+		bDecoded = DecodeSpng(pData, size, image);
+#endif
+	if (!bDecoded && !DecodeStb(pData, size, image))
+		return false;
+
+	DECODE_TIMES& times = g_DecodeTimes[image.decoder];
+	times.images++;
+	times.megapixels += (double)image.width * image.height / 1000000.0;
+	times.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+/***********************************************************
+ *  Free()
+ *
+ *  This method is used for releasing the pixels of an image,
+ *  with the allocator of the decoder that decoded it.
+ ***********************************************************/
+void ImageDecoder::Free(DECODED_IMAGE& image)
+{
+	if (image.decoder == IMAGE_DECODER_STB)
+		stbi_image_free(image.pPixels);
+	else
+		free(image.pPixels);
+	image.pPixels = NULL;
+}
+
+/***********************************************************
+ *  SetStbOnly()
+ *
+ *  This method is used for decoding every image with
+ *  stb_image, to compare it against the fast decoders.
+ ***********************************************************/
+void ImageDecoder::SetStbOnly(bool bStbOnly)
+{
+	g_bStbOnly = bStbOnly;
+}
+
+/***********************************************************
+ *  IsAvailable() / GetDecoderName()
+ *
+ *  These methods are used for telling which decoders the
+ *  build includes, and what they are called in reports.
+ ***********************************************************/
+bool ImageDecoder::IsAvailable(IMAGE_DECODER decoder)
+{
+	switch (decoder)
+	{
+	case IMAGE_DECODER_STB:
+		return true;
+#if defined(IMAGEDECODER_TURBOJPEG)
+	case IMAGE_DECODER_TURBOJPEG:
+		return true;
+#endif
+#if defined(IMAGEDECODER_SPNG)
+	case IMAGE_DECODER_SPNG:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* ImageDecoder::GetDecoderName(IMAGE_DECODER decoder)
+{
+	return (decoder < IMAGE_DECODER_COUNT) ? g_DecoderNames[decoder] : "unknown";
+}
+
+/***********************************************************
+ *  ReportDecodeTimes()
+ *
+ *  This method is used for printing the images and the
+ *  time every available decoder decoded so far.
+ ***********************************************************/
+void ImageDecoder::ReportDecodeTimes()
+{
+	for (int i = 0; i < IMAGE_DECODER_COUNT; i++)
+	{
+		const DECODE_TIMES& times = g_DecodeTimes[i];
+		if (!IsAvailable((IMAGE_DECODER)i))
+			continue;
+		std::cout << "[IMAGE] " << g_DecoderNames[i] << ": " << times.images << " images, " << times.megapixels
+			<< " MP in " << times.milliseconds << " ms";
+		if (times.milliseconds > 0.0)
+			std::cout << ", " << (times.megapixels * 1000.0 / times.milliseconds) << " MP/s";
+		std::cout << std::endl;
+	}
+}
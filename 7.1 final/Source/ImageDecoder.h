@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagedecoder.h
+// ============
+// decode texture image files with the fastest decoder available
+//
+//	JPEG files are decoded with libjpeg-turbo when the build defines
+//	IMAGEDECODER_TURBOJPEG and PNG files with libspng when it defines
+//	IMAGEDECODER_SPNG; both use SIMD where stb_image is scalar. A large
+//	baseline JPEG with restart markers is cut at the restart intervals
+//	into horizontal bands that are decoded on several threads. stb_image
+//	decodes every other format, and any file the fast decoders refuse,
+//	so a build without the libraries loads the same files as before.
+//	The decode time is summed per decoder for ReportDecodeTimes.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+
+enum IMAGE_DECODER
+{
+	IMAGE_DECODER_STB = 0,
+	IMAGE_DECODER_TURBOJPEG,
+	IMAGE_DECODER_SPNG,
+	IMAGE_DECODER_COUNT
+};
+
+// a decoded image, rows bottom first and tightly packed
+struct DECODED_IMAGE
+{
+	unsigned char* pPixels;
+	int            width;
+	int            height;
+	int            channels;
+	IMAGE_DECODER  decoder;
+	int            threads;         // bands decoded in parallel, else 1
+};
+
+class ImageDecoder
+{
+public:
+	// decode the passed in file, the image is released with Free()
+	static bool Decode(const char* filename, DECODED_IMAGE& image);
+	// decode an encoded image already in memory
+	static bool DecodeMemory(const unsigned char* pData, size_t size, DECODED_IMAGE& image);
+	static void Free(DECODED_IMAGE& image);
+
+	// decode everything with stb_image, for comparing the decoders
+	static void SetStbOnly(bool bStbOnly);
+	// whether the build includes the passed in decoder
+	static bool IsAvailable(IMAGE_DECODER decoder);
+	static const char* GetDecoderName(IMAGE_DECODER decoder);
+	// print the images and the decode time per decoder so far
+	static void ReportDecodeTimes();
+};
@@ -1,5 +1,7 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <chrono>           // time to first frame
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -9,7 +11,16 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "AllocationTracker.h"
+#include "ComputeProgram.h"
+#include "GLDebugOutput.h"
+#include "GLTrace.h"
+#include "ImageDecoder.h"
+#include "MetricsRegistry.h"
+#include "RenderFarm.h"
+#include "RenderServer.h"
 #include "SceneManager.h"
+#include "VertexPullingArena.h"
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
@@ -29,12 +40,74 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+
+	// fixed main pass resolution from the command line, 0 follows the window
+	int g_RenderWidth = 0;
+	int g_RenderHeight = 0;
+	// frame spike threshold from the command line, negative keeps the default
+	double g_SpikeMultiple = -1.0;
+	// GPU milliseconds per frame for periodic work, negative keeps the default
+	double g_GpuBudget = -1.0;
+	// GL command trace file and length from the command line
+	const char* g_GLTraceFile = NULL;
+	unsigned int g_GLTraceFrames = 0;
+	// create a debug context and collect driver warnings
+	bool g_bGLDebug = false;
+	// heap allocation tracking of the frame loop, and frames before
+	// allocations are treated as errors (negative disables the assertion)
+	bool g_bTrackAllocations = false;
+	int g_AllocationWarmupFrames = -1;
+	// compile every compute shader from GLSL instead of loading SPIR-V
+	bool g_bGlslShaders = false;
+	// decode every texture with stb_image instead of the SIMD decoders
+	bool g_bStbImages = false;
+	// bake the static scene lights into the main shader
+	bool g_bStaticLights = false;
+	// draw the meshes from one storage buffer through vertex pulling
+	bool g_bVertexPulling = false;
+	// warm start snapshot of the prepared scene, written when missing
+	const char* g_SnapshotFile = NULL;
+	// the first frame of a warm start should be on screen within this
+	const double g_FirstFrameTargetMilliseconds = 200.0;
+	// serve rendered views over this Unix socket instead of the window
+	const char* g_ServeSocket = NULL;
+	// render farm workers, their views and where the images go
+	int g_FarmWorkers = 0;
+	const char* g_FarmCameraFile = NULL;
+	int g_FarmFirstFrame = 0;
+	int g_FarmLastFrame = -1;
+	const char* g_FarmOutputDirectory = NULL;
+	// run the farm with 1, 2, 4, ... workers up to g_FarmWorkers
+	bool g_bFarmScaling = false;
+	// resolution of the farm when --resolution is not given
+	const int g_FarmDefaultWidth = 1280;
+	const int g_FarmDefaultHeight = 720;
+	// shared memory segment the live metrics are published to
+	const char* g_MetricsName = NULL;
+	const unsigned int g_MetricsIntervalMilliseconds = 500;
+	// IDs of the frame loop metrics, -1 while they are not published
+	int g_FramesMetric = -1;
+	int g_FpsMetric = -1;
+	int g_FrameTimeMetric = -1;
+	int g_DrawCallsMetric = -1;
+	int g_LoadingQueueMetric = -1;
+
+	// main shader program source files; the vertex pulling path, the
+	// static light switches and the render target outputs live in these
+	const char* g_VertexShaderFile = "shader.vert";
+	const char* g_FragmentShaderFile = "shader.frag";
+	// the vertex shader with the pulling path, written once at startup
+	const char* g_PulledShaderFile = NULL;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+bool ParseCommandLine(int argc, char* argv[]);
+bool RunRenderFarm();
+SceneManager* PrepareFarmWorker(const SceneSnapshot& snapshot);
+bool StartMetrics();
 
 
 /***********************************************************
@@ -45,6 +118,34 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	// if the command line is not understood, then terminate the application
+	if (ParseCommandLine(argc, argv) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// written before the farm starts, so every worker loads the same file
+	if (g_bVertexPulling)
+	{
+		g_PulledShaderFile = VertexPullingArena::WritePulledShader(g_VertexShaderFile);
+		if (NULL == g_PulledShaderFile)
+			std::cout << "[WARNING] --vertex-pulling ignored, meshes are drawn from vertex arrays" << std::endl;
+	}
+
+	// the farm renders in worker processes, without a window of its own
+	if (g_FarmWorkers > 0)
+	{
+		return(RunRenderFarm() ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// record from the first GL call so the trace holds the whole setup
+	if (NULL != g_GLTraceFile && GLTrace::Start(g_GLTraceFile, g_GLTraceFrames) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -66,18 +167,63 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
+	// load the shader code from its SPIR-V, or else the GLSL files; the
+	// scene lights are the full permutation of shader.frag
+	ComputeProgram::SetPreferSpirv(!g_bGlslShaders);
+	ComputeProgram::LoadMainProgram(g_ShaderManager, g_VertexShaderFile, g_FragmentShaderFile, true, 2, true);
 	g_ShaderManager->use();
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->SetRenderResolution(g_RenderWidth, g_RenderHeight);
+	if (g_SpikeMultiple >= 0.0)
+		g_SceneManager->GetSpikeDetector().m_spikeMultiple = g_SpikeMultiple;
+	if (g_GpuBudget >= 0.0)
+		g_SceneManager->GetGpuScheduler().m_budgetMilliseconds = g_GpuBudget;
+	// the pulling program is the VERTEX_PULLING path of shader.vert
+	if (NULL != g_PulledShaderFile && !g_SceneManager->EnableVertexPulling(g_PulledShaderFile, g_FragmentShaderFile))
+		std::cout << "[WARNING] --vertex-pulling ignored, meshes are drawn from vertex arrays" << std::endl;
+	ImageDecoder::SetStbOnly(g_bStbImages);
+	if (NULL != g_SnapshotFile)
+		g_SceneManager->UseSnapshot(g_SnapshotFile);
 	g_SceneManager->PrepareScene();
+	ComputeProgram::ReportLoadTimes();
+	ImageDecoder::ReportDecodeTimes();
+	// the baked program compiles in the background, on the vertex path
+	// PrepareScene settled on, from the STATIC_ switches of shader.frag
+	if (g_bStaticLights && !g_SceneManager->EnableStaticLights(g_VertexShaderFile, g_FragmentShaderFile))
+		std::cout << "[WARNING] --static-lights ignored, the lights are uploaded as uniforms" << std::endl;
+
+	// only the frame loop is tracked, loading is expected to allocate
+	if (g_bTrackAllocations)
+		AllocationTracker::Enable(true);
+	if (g_AllocationWarmupFrames >= 0)
+		AllocationTracker::AssertNoAllocations((unsigned int)g_AllocationWarmupFrames);
+
+	// monitoring is optional, the scene runs without it
+	if (NULL != g_MetricsName)
+		StartMetrics();
+
+	// in server mode the scene stays resident and renders the views
+	// clients request until the window is closed
+	if (NULL != g_ServeSocket)
+	{
+		RenderServer server(g_SceneManager);
+		bool bServing = server.Start(g_ServeSocket);
+		while (bServing && !glfwWindowShouldClose(g_Window))
+		{
+			bServing = server.Poll(50);
+			glfwPollEvents();
+		}
+		glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+	}
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
+	bool bFirstFrame = true;
+	std::chrono::steady_clock::time_point lastSwap = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point fpsStart = lastSwap;
+	unsigned int fpsFrames = 0;
 	while (!glfwWindowShouldClose(g_Window))
 	{
 		// Enable z-depth
@@ -88,6 +234,7 @@ int main(int argc, char* argv[])
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// convert from 3D object space to 2D view
+		g_ViewManager->SetShaderManager(g_SceneManager->GetShaderManager());
 		g_ViewManager->PrepareSceneView();
 
 		// refresh the 3D scene
@@ -96,6 +243,33 @@ int main(int argc, char* argv[])
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
+		if (bFirstFrame)
+		{
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+			std::cout << "[STARTUP] first frame after " << milliseconds << " ms ("
+				<< (g_SceneManager->IsWarmStart() ? "warm" : "cold") << " start, target " << g_FirstFrameTargetMilliseconds << " ms)" << std::endl;
+			bFirstFrame = false;
+		}
+
+		// relaxed atomic updates only, the publisher thread does the rest
+		std::chrono::steady_clock::time_point swap = std::chrono::steady_clock::now();
+		double fpsSeconds = std::chrono::duration<double>(swap - fpsStart).count();
+		fpsFrames++;
+		if (fpsSeconds >= 1.0)
+		{
+			MetricsRegistry::SetGauge(g_FpsMetric, fpsFrames / fpsSeconds);
+			fpsStart = swap;
+			fpsFrames = 0;
+		}
+		MetricsRegistry::Increment(g_FramesMetric, 1);
+		MetricsRegistry::Observe(g_FrameTimeMetric, std::chrono::duration<double, std::milli>(swap - lastSwap).count());
+		MetricsRegistry::SetGauge(g_DrawCallsMetric, g_SceneManager->GetFrameDrawCalls());
+		MetricsRegistry::SetGauge(g_LoadingQueueMetric, g_SceneManager->GetLoadingQueueDepth());
+		lastSwap = swap;
+
+		GLTrace::EndFrame();
+		GLDebugOutput::EndFrame();
+		AllocationTracker::EndFrame();
 
 		// query the latest GLFW events
 		glfwPollEvents();
@@ -118,10 +292,305 @@ int main(int argc, char* argv[])
 		g_ShaderManager = NULL;
 	}
 
+	AllocationTracker::Disable();
+	MetricsRegistry::StopPublishing();
+
+	// finish a trace that is still recording
+	GLTrace::Stop();
+	// list the driver warnings of the whole run
+	GLDebugOutput::Shutdown();
+
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
 }
 
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the optional command line
+ *  arguments:
+ *    --resolution WIDTHxHEIGHT   fixed main pass resolution
+ *    --spike-multiple X          dump a trace when a frame takes
+ *                                X times the median, 0 disables
+ *    --gpu-budget MS             GPU milliseconds per frame for
+ *                                periodic passes such as the
+ *                                volumetric update
+ *    --gl-trace FILE             record every GL call into FILE
+ *    --gl-trace-frames N         stop recording after N frames
+ *    --gl-debug                  report driver warnings from a
+ *                                debug context
+ *    --track-allocations         report the heap allocations of
+ *                                the frame loop
+ *    --assert-no-allocations N   abort if a frame allocates after
+ *                                N warm-up frames
+ *    --glsl-shaders              compile the main and compute
+ *                                shaders from GLSL instead of
+ *                                loading SPIR-V
+ *    --stb-images                decode the textures with
+ *                                stb_image only
+ *    --static-lights             compile the static lights into
+ *                                the main shader as constants
+ *    --vertex-pulling            fetch the vertices from a storage
+ *                                buffer instead of vertex arrays
+ *    --snapshot FILE             restore the prepared scene from
+ *                                FILE, or write it there when it
+ *                                is missing or out of date
+ *    --serve SOCKET              render the views clients request
+ *                                over the Unix socket SOCKET
+ *    --farm N                    render offline with N worker
+ *                                processes sharing --snapshot
+ *    --farm-cameras FILE         farm views from FILE, one
+ *                                "px py pz fx fy fz" per line
+ *    --farm-frames FIRST-LAST    farm views of an orbit around
+ *                                the scene, 360 frames per turn
+ *    --farm-output DIR           write the farm images into DIR
+ *                                as frame_NNNNN.ppm
+ *    --farm-scaling              run the farm with 1, 2, 4, ...
+ *                                up to N workers and compare
+ *    --metrics NAME              publish live metrics to the
+ *                                shared memory segment NAME for
+ *                                MetricsReader and exporters
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--resolution") == 0 && (i + 1) < argc)
+		{
+			char* separator = NULL;
+			g_RenderWidth = (int)strtol(argv[++i], &separator, 10);
+			g_RenderHeight = (*separator == 'x') ? (int)strtol(separator + 1, NULL, 10) : 0;
+			if (g_RenderWidth <= 0 || g_RenderHeight <= 0)
+			{
+				std::cerr << "Invalid resolution: " << argv[i] << " (expected WIDTHxHEIGHT)" << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--spike-multiple") == 0 && (i + 1) < argc)
+		{
+			char* end = NULL;
+			g_SpikeMultiple = strtod(argv[++i], &end);
+			if (end == argv[i] || g_SpikeMultiple < 0.0)
+			{
+				std::cerr << "Invalid spike multiple: " << argv[i] << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--gpu-budget") == 0 && (i + 1) < argc)
+		{
+			char* end = NULL;
+			g_GpuBudget = strtod(argv[++i], &end);
+			if (end == argv[i] || g_GpuBudget < 0.0)
+			{
+				std::cerr << "Invalid GPU budget: " << argv[i] << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--gl-trace") == 0 && (i + 1) < argc)
+		{
+			g_GLTraceFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--gl-trace-frames") == 0 && (i + 1) < argc)
+		{
+			char* end = NULL;
+			long frames = strtol(argv[++i], &end, 10);
+			if (end == argv[i] || frames < 0)
+			{
+				std::cerr << "Invalid trace frame count: " << argv[i] << std::endl;
+				return false;
+			}
+			g_GLTraceFrames = (unsigned int)frames;
+		}
+		else if (strcmp(argv[i], "--gl-debug") == 0)
+		{
+			g_bGLDebug = true;
+		}
+		else if (strcmp(argv[i], "--track-allocations") == 0)
+		{
+			g_bTrackAllocations = true;
+		}
+		else if (strcmp(argv[i], "--assert-no-allocations") == 0 && (i + 1) < argc)
+		{
+			char* end = NULL;
+			long frames = strtol(argv[++i], &end, 10);
+			if (end == argv[i] || frames < 0)
+			{
+				std::cerr << "Invalid warm-up frame count: " << argv[i] << std::endl;
+				return false;
+			}
+			g_AllocationWarmupFrames = (int)frames;
+			g_bTrackAllocations = true;
+		}
+		else if (strcmp(argv[i], "--glsl-shaders") == 0)
+		{
+			g_bGlslShaders = true;
+		}
+		else if (strcmp(argv[i], "--stb-images") == 0)
+		{
+			g_bStbImages = true;
+		}
+		else if (strcmp(argv[i], "--static-lights") == 0)
+		{
+			g_bStaticLights = true;
+		}
+		else if (strcmp(argv[i], "--vertex-pulling") == 0)
+		{
+			g_bVertexPulling = true;
+		}
+		else if (strcmp(argv[i], "--snapshot") == 0 && (i + 1) < argc)
+		{
+			g_SnapshotFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--serve") == 0 && (i + 1) < argc)
+		{
+			g_ServeSocket = argv[++i];
+		}
+		else if (strcmp(argv[i], "--farm") == 0 && (i + 1) < argc)
+		{
+			char* end = NULL;
+			long workers = strtol(argv[++i], &end, 10);
+			if (end == argv[i] || workers < 1 || workers > RenderFarm::MAX_WORKERS)
+			{
+				std::cerr << "Invalid farm worker count: " << argv[i] << " (1 to " << RenderFarm::MAX_WORKERS << ")" << std::endl;
+				return false;
+			}
+			g_FarmWorkers = (int)workers;
+		}
+		else if (strcmp(argv[i], "--farm-cameras") == 0 && (i + 1) < argc)
+		{
+			g_FarmCameraFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--farm-frames") == 0 && (i + 1) < argc)
+		{
+			char* separator = NULL;
+			g_FarmFirstFrame = (int)strtol(argv[++i], &separator, 10);
+			g_FarmLastFrame = (*separator == '-') ? (int)strtol(separator + 1, NULL, 10) : -1;
+			if (g_FarmFirstFrame < 0 || g_FarmLastFrame < g_FarmFirstFrame)
+			{
+				std::cerr << "Invalid farm frames: " << argv[i] << " (expected FIRST-LAST)" << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--farm-output") == 0 && (i + 1) < argc)
+		{
+			g_FarmOutputDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--farm-scaling") == 0)
+		{
+			g_bFarmScaling = true;
+		}
+		else if (strcmp(argv[i], "--metrics") == 0 && (i + 1) < argc)
+		{
+			g_MetricsName = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Unknown argument: " << argv[i] << std::endl;
+			return false;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	RunRenderFarm()
+ *
+ *  This function is used to render the farm views with
+ *  worker processes sharing the mapped snapshot, once or
+ *  with a doubling number of workers to measure scaling.
+ ***********************************************************/
+bool RunRenderFarm()
+{
+	if (NULL == g_SnapshotFile)
+	{
+		std::cerr << "The render farm needs the prepared scene, pass --snapshot FILE" << std::endl;
+		return false;
+	}
+
+	RenderFarm farm;
+	if (!farm.MapScene(g_SnapshotFile))
+		return false;
+	if (NULL != g_FarmCameraFile && !farm.LoadCameraList(g_FarmCameraFile))
+		return false;
+	if (g_FarmLastFrame >= g_FarmFirstFrame)
+		farm.AddOrbitFrames(g_FarmFirstFrame, g_FarmLastFrame);
+	if (farm.GetViewCount() == 0)
+	{
+		std::cerr << "The render farm has no views, pass --farm-cameras or --farm-frames" << std::endl;
+		return false;
+	}
+
+	int width = (g_RenderWidth > 0) ? g_RenderWidth : g_FarmDefaultWidth;
+	int height = (g_RenderHeight > 0) ? g_RenderHeight : g_FarmDefaultHeight;
+	int workers = g_bFarmScaling ? 1 : g_FarmWorkers;
+	while (true)
+	{
+		if (farm.Run(workers, width, height, g_FarmOutputDirectory, PrepareFarmWorker) <= 0.0)
+			return false;
+		if (workers == g_FarmWorkers)
+			break;
+		workers = (workers * 2 < g_FarmWorkers) ? workers * 2 : g_FarmWorkers;
+	}
+	farm.ReportScaling();
+	return true;
+}
+
+/***********************************************************
+ *	PrepareFarmWorker()
+ *
+ *  This function is used in every render farm worker to
+ *  create a hidden window for its context and prepare the
+ *  scene from the snapshot the coordinator mapped.
+ ***********************************************************/
+SceneManager* PrepareFarmWorker(const SceneSnapshot& snapshot)
+{
+	if (InitializeGLFW() == false)
+		return NULL;
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	g_Window = glfwCreateWindow(1, 1, WINDOW_TITLE, NULL, NULL);
+	if (NULL == g_Window)
+	{
+		std::cerr << "Failed to create the context of a render farm worker" << std::endl;
+		return NULL;
+	}
+	glfwMakeContextCurrent(g_Window);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	if (InitializeGLEW() == false)
+		return NULL;
+
+	g_ShaderManager = new ShaderManager();
+	ComputeProgram::SetPreferSpirv(!g_bGlslShaders);
+	ComputeProgram::LoadMainProgram(g_ShaderManager, g_VertexShaderFile, g_FragmentShaderFile, true, 2, true);
+	g_ShaderManager->use();
+
+	g_SceneManager = new SceneManager(g_ShaderManager);
+	if (NULL != g_PulledShaderFile && !g_SceneManager->EnableVertexPulling(g_PulledShaderFile, g_FragmentShaderFile))
+		std::cout << "[WARNING] --vertex-pulling ignored, meshes are drawn from vertex arrays" << std::endl;
+	ImageDecoder::SetStbOnly(g_bStbImages);
+	g_SceneManager->UseSnapshot(snapshot);
+	g_SceneManager->PrepareScene();
+	return g_SceneManager;
+}
+
+/***********************************************************
+ *	StartMetrics()
+ *
+ *  This function is used to register the metrics of the
+ *  frame loop and start publishing them. The frame time is
+ *  measured from one buffer swap to the next.
+ ***********************************************************/
+bool StartMetrics()
+{
+	g_FramesMetric = MetricsRegistry::Register("frames", MetricsFormat::METRIC_COUNTER, "frames");
+	g_FpsMetric = MetricsRegistry::Register("fps", MetricsFormat::METRIC_GAUGE, "1/s");
+	g_FrameTimeMetric = MetricsRegistry::Register("frame_time", MetricsFormat::METRIC_HISTOGRAM, "ms");
+	g_DrawCallsMetric = MetricsRegistry::Register("draw_calls", MetricsFormat::METRIC_GAUGE, "draws");
+	g_LoadingQueueMetric = MetricsRegistry::Register("loading_queue_depth", MetricsFormat::METRIC_GAUGE, "loads");
+	return MetricsRegistry::StartPublishing(g_MetricsName, g_MetricsIntervalMilliseconds);
+}
+
 /***********************************************************
  *	InitializeGLFW()
  * 
@@ -144,6 +613,8 @@ bool InitializeGLFW()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #endif
+	// drivers only report most performance warnings to debug contexts
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, g_bGLDebug ? GLFW_TRUE : GLFW_FALSE);
 	// GLFW: end -------------------------------
 
 	return(true);
@@ -173,5 +644,9 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Successfully Initialized\n";
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
+	// a missing debug output is not fatal, the scene renders without it
+	if (g_bGLDebug)
+		GLDebugOutput::Initialize();
+
 	return(true);
 }
\ No newline at end of file
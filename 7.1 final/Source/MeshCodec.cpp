@@ -0,0 +1,334 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcodec.cpp
+// ============
+// compact encoding of vertex and index streams with a fast SIMD decoder
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+// MESHCODEC_NO_SIMD builds the scalar decoder, e.g. to test it
+#if !defined(MESHCODEC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MESHCODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// "MSHC", the first field of every stream
+	const uint32_t g_StreamMagic = 0x4348534D;
+
+	// elements per block and bytes per group of a byte plane
+	const size_t g_BlockSize = 256;
+	const size_t g_GroupSize = 16;
+	const size_t g_MaxWords = MESH_CODEC_MAX_STRIDE / 4;
+
+	// encoded bytes of a group for each of the 2-bit group codes
+	const size_t g_GroupBytes[4] = { 0, 4, 8, 16 };
+
+	struct STREAM_HEADER
+	{
+		uint32_t magic;
+		uint32_t count;
+		uint32_t stride;
+		uint32_t encodedBytes;      // including this header
+	};
+
+	bool IsValidStride(size_t stride)
+	{
+		return stride > 0 && (stride % 4) == 0 && stride <= MESH_CODEC_MAX_STRIDE;
+	}
+
+	// the group codes of a plane, 2 bits each, come before its groups
+	void EncodePlane(const unsigned char* pPlane, size_t groups, std::vector<unsigned char>& encoded)
+	{
+		size_t codeStart = encoded.size();
+		encoded.resize(codeStart + (groups + 3) / 4, 0);
+		for (size_t g = 0; g < groups; g++)
+		{
+			const unsigned char* pGroup = pPlane + g * g_GroupSize;
+			unsigned char largest = *std::max_element(pGroup, pGroup + g_GroupSize);
+			int code = (largest == 0) ? 0 : (largest < 4) ? 1 : (largest < 16) ? 2 : 3;
+			encoded[codeStart + g / 4] |= (unsigned char)(code << ((g % 4) * 2));
+
+			if (code == 1)
+			{
+				for (size_t j = 0; j < 4; j++)
+					encoded.push_back((unsigned char)(pGroup[j * 4] | (pGroup[j * 4 + 1] << 2) | (pGroup[j * 4 + 2] << 4) | (pGroup[j * 4 + 3] << 6)));
+			}
+			else if (code == 2)
+			{
+				for (size_t j = 0; j < 8; j++)
+					encoded.push_back((unsigned char)(pGroup[j * 2] | (pGroup[j * 2 + 1] << 4)));
+			}
+			else if (code == 3)
+			{
+				encoded.insert(encoded.end(), pGroup, pGroup + g_GroupSize);
+			}
+		}
+	}
+
+	void DecodeGroup(int code, const unsigned char* pData, unsigned char* pGroup)
+	{
+#if defined(MESHCODEC_SSE2)
+		switch (code)
+		{
+		case 0:
+			_mm_store_si128((__m128i*)pGroup, _mm_setzero_si128());
+			break;
+		case 1:
+		{
+			int packed = 0;
+			memcpy(&packed, pData, sizeof(packed));
+			__m128i value = _mm_cvtsi32_si128(packed);
+			__m128i mask = _mm_set1_epi8(3);
+			__m128i bits0 = _mm_and_si128(value, mask);
+			__m128i bits2 = _mm_and_si128(_mm_srli_epi16(value, 2), mask);
+			__m128i bits4 = _mm_and_si128(_mm_srli_epi16(value, 4), mask);
+			__m128i bits6 = _mm_and_si128(_mm_srli_epi16(value, 6), mask);
+			_mm_store_si128((__m128i*)pGroup, _mm_unpacklo_epi16(_mm_unpacklo_epi8(bits0, bits2), _mm_unpacklo_epi8(bits4, bits6)));
+			break;
+		}
+		case 2:
+		{
+			__m128i value = _mm_loadl_epi64((const __m128i*)pData);
+			__m128i mask = _mm_set1_epi8(15);
+			__m128i low = _mm_and_si128(value, mask);
+			__m128i high = _mm_and_si128(_mm_srli_epi16(value, 4), mask);
+			_mm_store_si128((__m128i*)pGroup, _mm_unpacklo_epi8(low, high));
+			break;
+		}
+		default:
+			_mm_store_si128((__m128i*)pGroup, _mm_loadu_si128((const __m128i*)pData));
+			break;
+		}
+#else
+		for (size_t i = 0; i < g_GroupSize; i++)
+		{
+			if (code == 0)
+				pGroup[i] = 0;
+			else if (code == 1)
+				pGroup[i] = (pData[i / 4] >> ((i % 4) * 2)) & 3;
+			else if (code == 2)
+				pGroup[i] = (pData[i / 2] >> ((i % 2) * 4)) & 15;
+			else
+				pGroup[i] = pData[i];
+		}
+#endif
+	}
+
+	// returns where the next plane starts, NULL if the data is too short
+	const unsigned char* DecodePlane(const unsigned char* pRead, const unsigned char* pEnd, size_t groups, unsigned char* pPlane)
+	{
+		size_t codeBytes = (groups + 3) / 4;
+		if ((size_t)(pEnd - pRead) < codeBytes)
+			return NULL;
+
+		const unsigned char* pData = pRead + codeBytes;
+		for (size_t g = 0; g < groups; g++)
+		{
+			int code = (pRead[g / 4] >> ((g % 4) * 2)) & 3;
+			if ((size_t)(pEnd - pData) < g_GroupBytes[code])
+				return NULL;
+			DecodeGroup(code, pData, pPlane + g * g_GroupSize);
+			pData += g_GroupBytes[code];
+		}
+		return pData;
+	}
+
+	// join the byte planes of a word, undo the zigzag coding and sum
+	// the differences; returns the last word for the next block
+	uint32_t RebuildWords(const unsigned char (*pPlanes)[g_BlockSize], size_t elements, uint32_t previous, uint32_t* pWords)
+	{
+#if defined(MESHCODEC_SSE2)
+		__m128i carry = _mm_set1_epi32((int)previous);
+		__m128i one = _mm_set1_epi32(1);
+		for (size_t i = 0; i < elements; i += g_GroupSize)
+		{
+			__m128i plane0 = _mm_load_si128((const __m128i*)&pPlanes[0][i]);
+			__m128i plane1 = _mm_load_si128((const __m128i*)&pPlanes[1][i]);
+			__m128i plane2 = _mm_load_si128((const __m128i*)&pPlanes[2][i]);
+			__m128i plane3 = _mm_load_si128((const __m128i*)&pPlanes[3][i]);
+			__m128i low01 = _mm_unpacklo_epi8(plane0, plane1);
+			__m128i high01 = _mm_unpackhi_epi8(plane0, plane1);
+			__m128i low23 = _mm_unpacklo_epi8(plane2, plane3);
+			__m128i high23 = _mm_unpackhi_epi8(plane2, plane3);
+			__m128i zigzag[4] = { _mm_unpacklo_epi16(low01, low23), _mm_unpackhi_epi16(low01, low23),
+				_mm_unpacklo_epi16(high01, high23), _mm_unpackhi_epi16(high01, high23) };
+
+			for (int j = 0; j < 4; j++)
+			{
+				__m128i delta = _mm_xor_si128(_mm_srli_epi32(zigzag[j], 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(zigzag[j], one)));
+				delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+				delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+				__m128i words = _mm_add_epi32(delta, carry);
+				_mm_store_si128((__m128i*)(pWords + i + j * 4), words);
+				carry = _mm_shuffle_epi32(words, _MM_SHUFFLE(3, 3, 3, 3));
+			}
+		}
+		return (uint32_t)_mm_cvtsi128_si32(carry);
+#else
+		for (size_t i = 0; i < elements; i++)
+		{
+			uint32_t zigzag = pPlanes[0][i] | (pPlanes[1][i] << 8) | (pPlanes[2][i] << 16) | ((uint32_t)pPlanes[3][i] << 24);
+			previous += (zigzag >> 1) ^ (0u - (zigzag & 1));
+			pWords[i] = previous;
+		}
+		return previous;
+#endif
+	}
+
+	// interleave the words into whole elements, four at a time, so the
+	// destination is written in order
+	void WriteElements(const uint32_t (*pWords)[g_BlockSize], size_t wordCount, size_t elements, unsigned char* pOutput, size_t stride)
+	{
+#if defined(MESHCODEC_SSE2)
+		alignas(16) unsigned char staging[4 * MESH_CODEC_MAX_STRIDE];
+		for (size_t i = 0; i < elements; i += 4)
+		{
+			size_t k = 0;
+			for (; k + 4 <= wordCount; k += 4)
+			{
+				__m128i words0 = _mm_load_si128((const __m128i*)&pWords[k][i]);
+				__m128i words1 = _mm_load_si128((const __m128i*)&pWords[k + 1][i]);
+				__m128i words2 = _mm_load_si128((const __m128i*)&pWords[k + 2][i]);
+				__m128i words3 = _mm_load_si128((const __m128i*)&pWords[k + 3][i]);
+				__m128i low01 = _mm_unpacklo_epi32(words0, words1);
+				__m128i low23 = _mm_unpacklo_epi32(words2, words3);
+				__m128i high01 = _mm_unpackhi_epi32(words0, words1);
+				__m128i high23 = _mm_unpackhi_epi32(words2, words3);
+				_mm_storeu_si128((__m128i*)(staging + k * 4), _mm_unpacklo_epi64(low01, low23));
+				_mm_storeu_si128((__m128i*)(staging + stride + k * 4), _mm_unpackhi_epi64(low01, low23));
+				_mm_storeu_si128((__m128i*)(staging + 2 * stride + k * 4), _mm_unpacklo_epi64(high01, high23));
+				_mm_storeu_si128((__m128i*)(staging + 3 * stride + k * 4), _mm_unpackhi_epi64(high01, high23));
+			}
+			for (; k < wordCount; k++)
+			{
+				for (size_t e = 0; e < 4; e++)
+					memcpy(staging + e * stride + k * 4, &pWords[k][i + e], 4);
+			}
+			memcpy(pOutput + i * stride, staging, std::min<size_t>(4, elements - i) * stride);
+		}
+#else
+		for (size_t i = 0; i < elements; i++)
+		{
+			for (size_t k = 0; k < wordCount; k++)
+				memcpy(pOutput + i * stride + k * 4, &pWords[k][i], 4);
+		}
+#endif
+	}
+}
+
+/***********************************************************
+ *  EncodeStream()
+ *
+ *  This method is used for appending the encoded stream of
+ *  the passed in elements. The tail of the last group of a
+ *  block is padded with zero differences.
+ ***********************************************************/
+bool MeshCodec::EncodeStream(const void* pElements, size_t count, size_t stride, std::vector<unsigned char>& encoded)
+{
+	if (!IsValidStride(stride) || count > UINT32_MAX)
+		return false;
+
+	size_t start = encoded.size();
+	encoded.resize(start + sizeof(STREAM_HEADER));
+
+	const unsigned char* pInput = (const unsigned char*)pElements;
+	size_t wordCount = stride / 4;
+	uint32_t previous[g_MaxWords] = { 0 };
+	unsigned char planes[4][g_BlockSize];
+	for (size_t first = 0; first < count; first += g_BlockSize)
+	{
+		size_t elements = std::min(g_BlockSize, count - first);
+		size_t groups = (elements + g_GroupSize - 1) / g_GroupSize;
+		for (size_t k = 0; k < wordCount; k++)
+		{
+			memset(planes, 0, sizeof(planes));
+			for (size_t i = 0; i < elements; i++)
+			{
+				uint32_t word = 0;
+				memcpy(&word, pInput + (first + i) * stride + k * 4, 4);
+				uint32_t delta = word - previous[k];
+				uint32_t zigzag = (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+				previous[k] = word;
+				planes[0][i] = (unsigned char)zigzag;
+				planes[1][i] = (unsigned char)(zigzag >> 8);
+				planes[2][i] = (unsigned char)(zigzag >> 16);
+				planes[3][i] = (unsigned char)(zigzag >> 24);
+			}
+			for (int b = 0; b < 4; b++)
+				EncodePlane(planes[b], groups, encoded);
+		}
+	}
+
+	STREAM_HEADER header;
+	header.magic = g_StreamMagic;
+	header.count = (uint32_t)count;
+	header.stride = (uint32_t)stride;
+	header.encodedBytes = (uint32_t)(encoded.size() - start);
+	memcpy(&encoded[start], &header, sizeof(header));
+	return true;
+}
+
+/***********************************************************
+ *  DecodeStream()
+ *
+ *  This method is used for decoding a stream block by block
+ *  into the destination. Every read is checked against the
+ *  encoded size, so a damaged file fails instead of reading
+ *  past its end.
+ ***********************************************************/
+size_t MeshCodec::DecodeStream(const unsigned char* pEncoded, size_t size, void* pDestination, size_t count, size_t stride)
+{
+	STREAM_HEADER header;
+	if (size < sizeof(header))
+		return 0;
+	memcpy(&header, pEncoded, sizeof(header));
+	if (header.magic != g_StreamMagic || header.count != count || header.stride != stride ||
+		header.encodedBytes > size || header.encodedBytes < sizeof(header) || !IsValidStride(stride))
+	{
+		return 0;
+	}
+
+	const unsigned char* pRead = pEncoded + sizeof(header);
+	const unsigned char* pEnd = pEncoded + header.encodedBytes;
+	unsigned char* pOutput = (unsigned char*)pDestination;
+	size_t wordCount = stride / 4;
+	uint32_t previous[g_MaxWords] = { 0 };
+	alignas(16) unsigned char planes[4][g_BlockSize];
+	alignas(16) uint32_t words[g_MaxWords][g_BlockSize];
+	for (size_t first = 0; first < count; first += g_BlockSize)
+	{
+		size_t elements = std::min(g_BlockSize, count - first);
+		size_t groups = (elements + g_GroupSize - 1) / g_GroupSize;
+		for (size_t k = 0; k < wordCount; k++)
+		{
+			for (int b = 0; b < 4 && NULL != pRead; b++)
+				pRead = DecodePlane(pRead, pEnd, groups, planes[b]);
+			if (NULL == pRead)
+				return 0;
+			previous[k] = RebuildWords(planes, groups * g_GroupSize, previous[k], words[k]);
+		}
+		WriteElements(words, wordCount, elements, pOutput + first * stride, stride);
+	}
+	return (pRead == pEnd) ? header.encodedBytes : 0;
+}
+
+/***********************************************************
+ *  HasSimdDecoder()
+ *
+ *  This method is used for telling whether the decoder was
+ *  built with SSE2.
+ ***********************************************************/
+bool MeshCodec::HasSimdDecoder()
+{
+#if defined(MESHCODEC_SSE2)
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,37 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshcodec.h
+// ============
+// compact encoding of vertex and index streams with a fast SIMD decoder
+//
+//	A stream is a run of elements made of 32-bit words, e.g. vertices or
+//	indices. Each word is stored as the zigzag coded difference to the
+//	same word of the previous element, so smooth positions, normals and
+//	texture coordinates and ascending indices turn into small numbers.
+//	The differences of a block of up to 256 elements are split into byte
+//	planes, and each plane into groups of 16 bytes that are stored with
+//	0, 2, 4 or 8 bits per byte, whichever fits the largest of them. The
+//	decoder unpacks the groups and undoes the differences with SSE2 where
+//	the compiler targets it, writing whole elements in order, so it can
+//	decode straight into a mapped (write-combined) upload buffer.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// largest element the codec accepts, in bytes
+const size_t MESH_CODEC_MAX_STRIDE = 64;
+
+class MeshCodec
+{
+public:
+	// append the encoding of count elements of stride bytes, a multiple of 4
+	static bool EncodeStream(const void* pElements, size_t count, size_t stride, std::vector<unsigned char>& encoded);
+	// decode a stream of count elements of stride bytes; returns the
+	// encoded bytes read, 0 if the stream is invalid or does not match
+	static size_t DecodeStream(const unsigned char* pEncoded, size_t size, void* pDestination, size_t count, size_t stride);
+	// whether DecodeStream runs the SSE2 path
+	static bool HasSimdDecoder();
+};
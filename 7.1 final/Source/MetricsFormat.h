@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// metricsformat.h
+// ============
+// layout of the live metrics segment, shared by publisher and readers
+//
+//	The segment starts with SEGMENT_HEADER and holds one METRIC per
+//	registered counter, gauge or histogram. The publisher thread rewrites
+//	it under a sequence lock: the sequence is odd while a write is in
+//	progress, so a reader copies the payload between two reads of an even
+//	sequence and retries when they differ. Readers never write to the
+//	segment and the publisher never waits for them. Histograms count the
+//	samples in buckets that grow by a quarter octave, from which readers
+//	derive percentiles over any interval between two of their copies.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+namespace MetricsFormat
+{
+	// "METR" and the version of the segment layout
+	const uint32_t SEGMENT_MAGIC = 0x5254454d;
+	const uint32_t SEGMENT_VERSION = 1;
+
+	const int MAX_METRICS = 32;
+	const int NAME_LENGTH = 32;
+	const int UNIT_LENGTH = 8;
+
+	// bucket i counts the samples up to FIRST_BOUND * 2^(i / 4), the
+	// last one everything above
+	const int    HISTOGRAM_BUCKETS = 64;
+	const int    BUCKETS_PER_OCTAVE = 4;
+	const double FIRST_BOUND = 0.0625;
+
+	enum METRIC_TYPE
+	{
+		METRIC_COUNTER,         // count, only grows
+		METRIC_GAUGE,           // value, the latest sample
+		METRIC_HISTOGRAM        // count, value (sum) and buckets
+	};
+
+	struct METRIC
+	{
+		char     name[NAME_LENGTH];
+		char     unit[UNIT_LENGTH];
+		uint32_t type;          // METRIC_TYPE
+		uint32_t reserved;
+		uint64_t count;
+		double   value;
+		uint64_t buckets[HISTOGRAM_BUCKETS];
+	};
+
+	// everything the sequence lock protects
+	struct SEGMENT_DATA
+	{
+		uint64_t publishCount;
+		int64_t  publishTimeMs;     // since the Unix epoch
+		uint32_t processId;
+		uint32_t metricCount;
+		METRIC   metrics[MAX_METRICS];
+	};
+
+	struct SEGMENT_HEADER
+	{
+		uint32_t              magic;
+		uint32_t              version;
+		std::atomic<uint64_t> sequence;     // odd while the publisher writes
+		SEGMENT_DATA          data;
+	};
+
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the sequence is shared between processes and must be lock free");
+
+	// upper bound of a histogram bucket
+	inline double GetBucketBound(int bucket)
+	{
+		double bound = FIRST_BOUND;
+		for (int octave = 0; octave < bucket / BUCKETS_PER_OCTAVE; octave++)
+			bound *= 2.0;
+		static const double steps[BUCKETS_PER_OCTAVE] = { 1.0, 1.189207115, 1.414213562, 1.681792831 };
+		return bound * steps[bucket % BUCKETS_PER_OCTAVE];
+	}
+
+	// the bucket bound below which the passed in fraction of the samples
+	// fall, from bucket counts or differences of two copies
+	inline double GetPercentile(const uint64_t buckets[HISTOGRAM_BUCKETS], double fraction)
+	{
+		uint64_t total = 0;
+		for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+			total += buckets[i];
+		if (total == 0)
+			return 0.0;
+
+		uint64_t rank = (uint64_t)(fraction * (double)total + 0.5);
+		uint64_t seen = 0;
+		for (int i = 0; i < HISTOGRAM_BUCKETS - 1; i++)
+		{
+			seen += buckets[i];
+			if (seen >= rank && seen > 0)
+				return GetBucketBound(i);
+		}
+		return GetBucketBound(HISTOGRAM_BUCKETS - 1);
+	}
+
+	// copy a consistent payload out of a mapped segment; false when the
+	// segment is not a metrics segment or kept changing under the reader
+	inline bool ReadSegment(const SEGMENT_HEADER* pSegment, SEGMENT_DATA& data, int attempts)
+	{
+		if (pSegment->magic != SEGMENT_MAGIC || pSegment->version != SEGMENT_VERSION)
+			return false;
+
+		for (int attempt = 0; attempt < attempts; attempt++)
+		{
+			uint64_t before = pSegment->sequence.load(std::memory_order_acquire);
+			if (before & 1)
+				continue;
+			memcpy(&data, (const void*)&pSegment->data, sizeof(data));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (pSegment->sequence.load(std::memory_order_relaxed) == before)
+				return data.metricCount <= (uint32_t)MAX_METRICS;
+		}
+		return false;
+	}
+}
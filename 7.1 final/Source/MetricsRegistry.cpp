@@ -0,0 +1,340 @@
+///////////////////////////////////////////////////////////////////////////////
+// metricsregistry.cpp
+// ============
+// live counters, gauges and histograms for external monitoring
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MetricsRegistry.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MetricsFormat;
+
+// declaration of the global variables and defines
+namespace
+{
+	// the values of one metric as the render loop updates them, on cache
+	// lines of their own so the publisher reading one does not disturb
+	// the writer of the next
+	struct alignas(64) LIVE_METRIC
+	{
+		char                  name[NAME_LENGTH];
+		char                  unit[UNIT_LENGTH];
+		METRIC_TYPE           type;
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> valueBits;    // the double value
+		std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+	};
+
+	LIVE_METRIC g_metrics[MAX_METRICS];
+	std::atomic<int> g_metricCount(0);
+
+	// the segment and the thread that writes it
+	SEGMENT_HEADER* g_pSegment = NULL;
+	void* g_segmentHandle = NULL;
+	std::string g_segmentName;
+	std::thread g_publisher;
+	std::mutex g_publisherMutex;
+	std::condition_variable g_wakePublisher;
+	bool g_bStopPublisher = false;
+	unsigned int g_intervalMilliseconds = 0;
+	int g_memoryMetric = -1;
+
+	// the next payload, assembled before the sequence is made odd
+	SEGMENT_DATA g_staged;
+
+	uint64_t DoubleBits(double value)
+	{
+		uint64_t bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	double BitsDouble(uint64_t bits)
+	{
+		double value = 0.0;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// the first bucket whose bound holds the value
+	int BucketOf(double value)
+	{
+		if (!(value > FIRST_BOUND))
+			return 0;
+		double bucket = std::ceil(std::log2(value / FIRST_BOUND) * BUCKETS_PER_OCTAVE - 1e-9);
+		return (bucket >= HISTOGRAM_BUCKETS - 1) ? HISTOGRAM_BUCKETS - 1 : (int)bucket;
+	}
+
+	void CopyName(char* destination, size_t size, const char* source)
+	{
+		strncpy(destination, (NULL != source) ? source : "", size - 1);
+		destination[size - 1] = '\0';
+	}
+
+	// resident memory of the process, read by the publisher only
+	bool SampleProcessMemory(double& bytes)
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return false;
+		bytes = (double)counters.WorkingSetSize;
+		return true;
+#elif defined(__linux__)
+		FILE* file = fopen("/proc/self/statm", "r");
+		if (NULL == file)
+			return false;
+		unsigned long long totalPages = 0;
+		unsigned long long residentPages = 0;
+		bool bRead = (fscanf(file, "%llu %llu", &totalPages, &residentPages) == 2);
+		fclose(file);
+		bytes = (double)residentPages * (double)sysconf(_SC_PAGESIZE);
+		return bRead;
+#else
+		(void)bytes;
+		return false;
+#endif
+	}
+
+	void Publish()
+	{
+		double memoryBytes = 0.0;
+		if (g_memoryMetric >= 0 && SampleProcessMemory(memoryBytes))
+			MetricsRegistry::SetGauge(g_memoryMetric, memoryBytes);
+
+		int count = g_metricCount.load(std::memory_order_acquire);
+		g_staged.publishCount++;
+		g_staged.publishTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		g_staged.metricCount = (uint32_t)count;
+		for (int i = 0; i < count; i++)
+		{
+			const LIVE_METRIC& live = g_metrics[i];
+			METRIC& metric = g_staged.metrics[i];
+			memcpy(metric.name, live.name, sizeof(metric.name));
+			memcpy(metric.unit, live.unit, sizeof(metric.unit));
+			metric.type = live.type;
+			metric.count = live.count.load(std::memory_order_relaxed);
+			metric.value = BitsDouble(live.valueBits.load(std::memory_order_relaxed));
+			for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+				metric.buckets[bucket] = (live.type == METRIC_HISTOGRAM) ? live.buckets[bucket].load(std::memory_order_relaxed) : 0;
+		}
+
+		// odd while the payload changes, readers retry meanwhile
+		uint64_t sequence = g_pSegment->sequence.load(std::memory_order_relaxed);
+		g_pSegment->sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy((void*)&g_pSegment->data, &g_staged, sizeof(g_staged));
+		g_pSegment->sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	void PublishLoop()
+	{
+		std::unique_lock<std::mutex> lock(g_publisherMutex);
+		while (!g_bStopPublisher)
+		{
+			g_wakePublisher.wait_for(lock, std::chrono::milliseconds(g_intervalMilliseconds));
+			Publish();
+		}
+	}
+
+	unsigned int GetProcessID()
+	{
+#if defined(_WIN32)
+		return (unsigned int)GetCurrentProcessId();
+#else
+		return (unsigned int)getpid();
+#endif
+	}
+}
+
+/***********************************************************
+ *  Register()
+ *
+ *  This method is used for adding a counter, gauge or
+ *  histogram with the passed in name and unit. Registering
+ *  is meant for startup and must not race with itself.
+ ***********************************************************/
+int MetricsRegistry::Register(const char* name, METRIC_TYPE type, const char* unit)
+{
+	int id = g_metricCount.load(std::memory_order_relaxed);
+	if (id >= MAX_METRICS)
+	{
+		std::cout << "[WARNING] Metrics registry is full, " << name << " is not published" << std::endl;
+		return -1;
+	}
+
+	LIVE_METRIC& metric = g_metrics[id];
+	CopyName(metric.name, sizeof(metric.name), name);
+	CopyName(metric.unit, sizeof(metric.unit), unit);
+	metric.type = type;
+	metric.count.store(0, std::memory_order_relaxed);
+	metric.valueBits.store(DoubleBits(0.0), std::memory_order_relaxed);
+	for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+		metric.buckets[bucket].store(0, std::memory_order_relaxed);
+
+	// the publisher only sees the metric once it is filled in
+	g_metricCount.store(id + 1, std::memory_order_release);
+	return id;
+}
+
+/***********************************************************
+ *  Increment()
+ *  SetGauge()
+ *  Observe()
+ *
+ *  These methods are used for updating a metric. They only
+ *  make relaxed atomic operations on the metric's own cache
+ *  lines, so the render loop can call them every frame.
+ ***********************************************************/
+void MetricsRegistry::Increment(int id, uint64_t amount)
+{
+	if (id < 0)
+		return;
+	g_metrics[id].count.fetch_add(amount, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::SetGauge(int id, double value)
+{
+	if (id < 0)
+		return;
+	g_metrics[id].valueBits.store(DoubleBits(value), std::memory_order_relaxed);
+}
+
+void MetricsRegistry::Observe(int id, double value)
+{
+	if (id < 0)
+		return;
+	LIVE_METRIC& metric = g_metrics[id];
+	metric.buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+	metric.count.fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t bits = metric.valueBits.load(std::memory_order_relaxed);
+	while (!metric.valueBits.compare_exchange_weak(bits, DoubleBits(BitsDouble(bits) + value), std::memory_order_relaxed))
+	{
+	}
+}
+
+/***********************************************************
+ *  StartPublishing()
+ *
+ *  This method is used for creating the shared memory
+ *  segment with the passed in name, replacing one a crashed
+ *  run left behind, and starting the publisher thread.
+ ***********************************************************/
+bool MetricsRegistry::StartPublishing(const char* segmentName, unsigned int intervalMilliseconds)
+{
+	if (NULL != g_pSegment)
+		return true;
+
+	size_t size = sizeof(SEGMENT_HEADER);
+#if defined(_WIN32)
+	g_segmentName = std::string("Local\\") + segmentName;
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)size, g_segmentName.c_str());
+	void* pView = (NULL != mapping) ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : NULL;
+	if (NULL == pView)
+	{
+		if (NULL != mapping)
+			CloseHandle(mapping);
+		std::cout << "[ERROR] Could not create the metrics segment " << g_segmentName << std::endl;
+		return false;
+	}
+	g_segmentHandle = mapping;
+#else
+	g_segmentName = (segmentName[0] == '/') ? segmentName : std::string("/") + segmentName;
+	shm_unlink(g_segmentName.c_str());
+	int file = shm_open(g_segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	void* pView = MAP_FAILED;
+	if (file >= 0 && ftruncate(file, (off_t)size) == 0)
+		pView = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	if (file >= 0)
+		close(file);
+	if (pView == MAP_FAILED)
+	{
+		if (file >= 0)
+			shm_unlink(g_segmentName.c_str());
+		std::cout << "[ERROR] Could not create the metrics segment " << g_segmentName << std::endl;
+		return false;
+	}
+#endif
+
+	g_pSegment = new (pView) SEGMENT_HEADER();
+	memset((void*)&g_pSegment->data, 0, sizeof(g_pSegment->data));
+	memset(&g_staged, 0, sizeof(g_staged));
+	g_staged.processId = GetProcessID();
+	g_pSegment->sequence.store(0, std::memory_order_relaxed);
+	g_pSegment->version = SEGMENT_VERSION;
+	// readers check the magic last
+	std::atomic_thread_fence(std::memory_order_release);
+	g_pSegment->magic = SEGMENT_MAGIC;
+
+	if (g_memoryMetric < 0)
+		g_memoryMetric = Register("process_memory", METRIC_GAUGE, "bytes");
+	g_intervalMilliseconds = (intervalMilliseconds > 0) ? intervalMilliseconds : 1;
+	g_bStopPublisher = false;
+	Publish();
+	g_publisher = std::thread(PublishLoop);
+
+	std::cout << "[METRICS] publishing " << g_metricCount.load() << " metrics to " << g_segmentName
+		<< " every " << g_intervalMilliseconds << " ms" << std::endl;
+	return true;
+}
+
+/***********************************************************
+ *  StopPublishing()
+ *
+ *  This method is used for stopping the publisher thread
+ *  after a last update and removing the segment. Readers
+ *  that still have it mapped keep the last values.
+ ***********************************************************/
+void MetricsRegistry::StopPublishing()
+{
+	if (NULL == g_pSegment)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(g_publisherMutex);
+		g_bStopPublisher = true;
+	}
+	g_wakePublisher.notify_one();
+	if (g_publisher.joinable())
+		g_publisher.join();
+
+#if defined(_WIN32)
+	UnmapViewOfFile(g_pSegment);
+	CloseHandle((HANDLE)g_segmentHandle);
+#else
+	munmap(g_pSegment, sizeof(SEGMENT_HEADER));
+	shm_unlink(g_segmentName.c_str());
+#endif
+	g_pSegment = NULL;
+	g_segmentHandle = NULL;
+}
+
+bool MetricsRegistry::IsPublishing()
+{
+	return NULL != g_pSegment;
+}
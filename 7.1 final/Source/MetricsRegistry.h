@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////
+// metricsregistry.h
+// ============
+// live counters, gauges and histograms for external monitoring
+//
+//	Metrics are registered once at startup and then updated from the
+//	render loop with relaxed atomic operations only: the frame thread
+//	never takes a lock, allocates or touches the shared memory. A
+//	publisher thread copies the values into a named shared memory segment
+//	(see MetricsFormat.h) every interval under a sequence lock, where the
+//	MetricsReader tool or any exporter can map and read them while the
+//	application runs. The publisher also samples the resident memory of
+//	the process, so that read stays off the frame thread as well.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+#include "MetricsFormat.h"
+
+class MetricsRegistry
+{
+public:
+	// add a metric before publishing starts; returns its ID, -1 when the
+	// registry is full, and updates of ID -1 are ignored
+	static int Register(const char* name, MetricsFormat::METRIC_TYPE type, const char* unit);
+
+	// updates from any thread, lock free
+	static void Increment(int id, uint64_t amount);
+	static void SetGauge(int id, double value);
+	static void Observe(int id, double value);
+
+	// create the shared memory segment and publish every interval
+	static bool StartPublishing(const char* segmentName, unsigned int intervalMilliseconds);
+	// publish a last time and remove the segment
+	static void StopPublishing();
+	static bool IsPublishing();
+};
@@ -0,0 +1,501 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.cpp
+// ============
+// hardware occlusion queries of object bounds with conditional rendering
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCuller.h"
+#include "GLTrace.h"
+
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// declaration of the global variables and defines
+namespace
+{
+	// weight of a new sample in the main pass averages
+	const double g_AverageWeight = 0.1;
+
+	// main pass samples skipped after a mode change, so the GpuTimer
+	// results still in flight are not counted for the new mode
+	const unsigned int g_ModeSettleFrames = 6;
+
+	// growth of the bounds against the camera motion of one frame
+	const float g_BoundsMarginScale = 0.02f;
+	const float g_BoundsMargin = 0.01f;
+
+	// clip w below which a corner counts as at the camera
+	const float g_NearW = 0.1f;
+
+	// the bounds are the unit cube scaled and moved onto the object
+	const char* g_BoxVertexShaderSource =
+		"#version 330 core\n"
+		"layout(location = 0) in vec3 corner;\n"
+		"uniform mat4 boxTransform;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_Position = boxTransform * vec4(corner, 1.0);\n"
+		"}\n";
+
+	const char* g_BoxFragmentShaderSource =
+		"#version 330 core\n"
+		"void main()\n"
+		"{\n"
+		"}\n";
+
+	// the 12 triangles of the cube from 0 to 1
+	const GLfloat g_BoxVertices[36 * 3] = {
+		0,0,0, 1,1,0, 1,0,0,  0,0,0, 0,1,0, 1,1,0,
+		0,0,1, 1,0,1, 1,1,1,  0,0,1, 1,1,1, 0,1,1,
+		0,0,0, 0,0,1, 0,1,1,  0,0,0, 0,1,1, 0,1,0,
+		1,0,0, 1,1,1, 1,0,1,  1,0,0, 1,1,0, 1,1,1,
+		0,0,0, 1,0,0, 1,0,1,  0,0,0, 1,0,1, 0,0,1,
+		0,1,0, 1,1,1, 1,1,0,  0,1,0, 0,1,1, 1,1,1 };
+
+	GLuint CompileShader(GLenum type, const char* source, const char* name)
+	{
+		GLuint shaderID = glCreateShader(type);
+		glShaderSource(shaderID, 1, &source, NULL);
+		glCompileShader(shaderID);
+
+		GLint success = 0;
+		glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			char infoLog[1024];
+			glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+			std::cout << "[ERROR] Occlusion box " << name << " shader compile error:\n" << infoLog << std::endl;
+			glDeleteShader(shaderID);
+			return 0;
+		}
+		return shaderID;
+	}
+}
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller()
+	: m_queryTimer("Occlusion queries")
+{
+	m_minScreenFraction = 0.002f;
+	m_visibleFrames = 8;
+	m_program = 0;
+	m_transformLocation = -1;
+	m_boxVertexArray = 0;
+	m_boxBuffer = 0;
+	m_queryTarget = GL_ANY_SAMPLES_PASSED;
+	m_frame = 0;
+	m_bConditional = false;
+	m_viewProjection = glm::mat4(1.0f);
+	m_cameraPos = glm::vec3(0.0f);
+	m_stats = OCCLUSION_STATS();
+	m_mainPassSamples = 0;
+	m_withMilliseconds = 0.0;
+	m_withoutMilliseconds = 0.0;
+	m_withSamples = 0;
+	m_withoutSamples = 0;
+	m_bLastEnabled = true;
+	m_modeChangeFrame = 0;
+}
+
+/***********************************************************
+ *  ~OcclusionCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OcclusionCuller::~OcclusionCuller()
+{
+	for (size_t i = 0; i < m_objects.size(); i++)
+	{
+		if (m_objects[i].queries[0] != 0)
+			glDeleteQueries(QUERY_RING, m_objects[i].queries);
+	}
+	if (m_program != 0)
+		glDeleteProgram(m_program);
+	if (m_boxBuffer != 0)
+		glDeleteBuffers(1, &m_boxBuffer);
+	if (m_boxVertexArray != 0)
+		glDeleteVertexArrays(1, &m_boxVertexArray);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the program and the
+ *  unit cube the bounds are drawn with. Conditional rendering
+ *  and GL_ANY_SAMPLES_PASSED need OpenGL 3.3; with 4.3 the
+ *  cheaper conservative queries are used.
+ ***********************************************************/
+bool OcclusionCuller::Initialize()
+{
+	if (!GLEW_VERSION_3_3)
+	{
+		std::cout << "Occlusion culling disabled: OpenGL 3.3 is required" << std::endl;
+		return false;
+	}
+	// conditional rendering and the query readback are not part of GL traces
+	if (GLTrace::IsRecording())
+	{
+		std::cout << "[WARNING] Occlusion culling is not used while a GL trace is recording" << std::endl;
+		return false;
+	}
+
+	m_queryTarget = GLEW_VERSION_4_3 ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+	if (!CreateProgram())
+		return false;
+
+	glGenVertexArrays(1, &m_boxVertexArray);
+	glGenBuffers(1, &m_boxBuffer);
+	glBindVertexArray(m_boxVertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_boxBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(g_BoxVertices), g_BoxVertices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateProgram()
+ *
+ *  This method is used for building the program that only
+ *  rasterizes the bounds, without any color output.
+ ***********************************************************/
+bool OcclusionCuller::CreateProgram()
+{
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, g_BoxVertexShaderSource, "vertex");
+	GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, g_BoxFragmentShaderSource, "fragment");
+	if (vertexShader == 0 || fragmentShader == 0)
+	{
+		if (vertexShader != 0)
+			glDeleteShader(vertexShader);
+		if (fragmentShader != 0)
+			glDeleteShader(fragmentShader);
+		return false;
+	}
+
+	m_program = glCreateProgram();
+	glAttachShader(m_program, vertexShader);
+	glAttachShader(m_program, fragmentShader);
+	glLinkProgram(m_program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint success = 0;
+	glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		std::cout << "[ERROR] Occlusion box program did not link" << std::endl;
+		return false;
+	}
+	m_transformLocation = glGetUniformLocation(m_program, "boxTransform");
+	return true;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame: the states of
+ *  new object IDs are added and the query results that are
+ *  available are read back, without waiting for the others.
+ ***********************************************************/
+void OcclusionCuller::BeginFrame(int objectCount)
+{
+	m_frame++;
+	m_stats = OCCLUSION_STATS();
+
+	if (objectCount > (int)m_objects.size())
+	{
+		OBJECT_STATE state;
+		for (int slot = 0; slot < QUERY_RING; slot++)
+		{
+			state.queries[slot] = 0;
+			state.bPending[slot] = false;
+			state.issuedFrame[slot] = 0;
+		}
+		state.latest = -1;
+		state.latestFrame = 0;
+		state.lastVisibleFrame = 0;
+		state.resultFrame = 0;
+		state.bOccluded = false;
+		m_objects.resize(objectCount, state);
+	}
+
+	for (size_t i = 0; i < m_objects.size(); i++)
+	{
+		OBJECT_STATE& state = m_objects[i];
+		CollectResults(state);
+		if (state.bOccluded)
+			m_stats.objectsOccluded++;
+	}
+}
+
+/***********************************************************
+ *  CollectResults()
+ *
+ *  This method is used for reading the finished queries of
+ *  an object. Results can finish out of order, only a newer
+ *  one replaces the visibility of the object.
+ ***********************************************************/
+void OcclusionCuller::CollectResults(OBJECT_STATE& state)
+{
+	for (int slot = 0; slot < QUERY_RING; slot++)
+	{
+		if (!state.bPending[slot])
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(state.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+
+		GLuint anySamples = 0;
+		glGetQueryObjectuiv(state.queries[slot], GL_QUERY_RESULT, &anySamples);
+		state.bPending[slot] = false;
+
+		if (state.issuedFrame[slot] < state.resultFrame)
+			continue;
+		state.resultFrame = state.issuedFrame[slot];
+		state.bOccluded = (anySamples == 0);
+		if (!state.bOccluded)
+			state.lastVisibleFrame = state.issuedFrame[slot];
+	}
+}
+
+/***********************************************************
+ *  BeginObject() / EndObject()
+ *
+ *  These methods are used for drawing an object only when
+ *  the box query issued for it at the end of the last frame
+ *  passed. GL_QUERY_NO_WAIT draws it while the result is not
+ *  ready, so neither the CPU nor the GPU waits for it.
+ ***********************************************************/
+void OcclusionCuller::BeginObject(int id)
+{
+	m_bConditional = false;
+	if (id < 0 || id >= (int)m_objects.size())
+		return;
+
+	const OBJECT_STATE& state = m_objects[id];
+	if (state.latest < 0 || state.latestFrame + 1 != m_frame)
+		return;
+
+	glBeginConditionalRender(state.queries[state.latest], GL_QUERY_NO_WAIT);
+	m_bConditional = true;
+	m_stats.drawsConditional++;
+}
+
+void OcclusionCuller::EndObject()
+{
+	if (!m_bConditional)
+		return;
+
+	glEndConditionalRender();
+	m_bConditional = false;
+}
+
+/***********************************************************
+ *  BeginQueries()
+ *
+ *  This method is used for setting up the query pass: the
+ *  boxes are depth tested against the main pass but write
+ *  neither color nor depth.
+ ***********************************************************/
+void OcclusionCuller::BeginQueries(const glm::mat4& viewProjection, const glm::vec3& cameraPos)
+{
+	m_viewProjection = viewProjection;
+	m_cameraPos = cameraPos;
+
+	m_queryTimer.Begin();
+	glUseProgram(m_program);
+	glBindVertexArray(m_boxVertexArray);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	// the front faces of a box around a drawn object lie on its depth
+	glDepthFunc(GL_LEQUAL);
+}
+
+/***********************************************************
+ *  QueryObject()
+ *
+ *  This method is used for issuing the box query of an
+ *  object, unless it is too small on screen to be worth it,
+ *  reaches the camera, or was visible recently.
+ ***********************************************************/
+void OcclusionCuller::QueryObject(int id, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	if (id < 0 || id >= (int)m_objects.size())
+		return;
+
+	OBJECT_STATE& state = m_objects[id];
+	state.latest = -1;
+	m_stats.objectsTested++;
+
+	glm::vec3 margin = (boundsMax - boundsMin) * g_BoundsMarginScale + glm::vec3(g_BoundsMargin);
+	glm::vec3 queryMin = boundsMin - margin;
+	glm::vec3 queryMax = boundsMax + margin;
+
+	bool bNear = false;
+	if (IsSmallOrNear(queryMin, queryMax, bNear))
+	{
+		if (bNear)
+			m_stats.skippedNear++;
+		else
+			m_stats.skippedSmall++;
+		return;
+	}
+
+	// visible objects are drawn without a query for a while, and not
+	// queried again while the result of the last query is outstanding;
+	// the ID staggers the queries of objects that appeared together
+	bool bPending = false;
+	for (int slot = 0; slot < QUERY_RING; slot++)
+		bPending = bPending || state.bPending[slot];
+	bool bRecentlyVisible = state.lastVisibleFrame != 0 &&
+		m_frame - state.lastVisibleFrame < m_visibleFrames + (unsigned int)(id % 4);
+	if (!state.bOccluded && (bPending || bRecentlyVisible))
+	{
+		m_stats.skippedVisible++;
+		return;
+	}
+
+	// a free slot of the ring, the object is drawn without a query
+	// when every one is still in flight
+	int slot = 0;
+	while (slot < QUERY_RING && state.bPending[slot])
+		slot++;
+	if (slot == QUERY_RING)
+		return;
+	if (state.queries[0] == 0)
+		glGenQueries(QUERY_RING, state.queries);
+
+	glm::mat4 boxTransform = m_viewProjection;
+	boxTransform = glm::translate(boxTransform, queryMin);
+	boxTransform = glm::scale(boxTransform, queryMax - queryMin);
+	glUniformMatrix4fv(m_transformLocation, 1, GL_FALSE, glm::value_ptr(boxTransform));
+
+	glBeginQuery(m_queryTarget, state.queries[slot]);
+	glDrawArrays(GL_TRIANGLES, 0, 36);
+	glEndQuery(m_queryTarget);
+
+	state.bPending[slot] = true;
+	state.issuedFrame[slot] = m_frame;
+	state.latest = slot;
+	state.latestFrame = m_frame;
+	m_stats.queriesIssued++;
+}
+
+/***********************************************************
+ *  EndQueries()
+ *
+ *  This method is used for restoring the state the main
+ *  pass draws with.
+ ***********************************************************/
+void OcclusionCuller::EndQueries()
+{
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glBindVertexArray(0);
+	m_queryTimer.End();
+}
+
+/***********************************************************
+ *  IsSmallOrNear()
+ *
+ *  This method is used for testing the projected bounds. A
+ *  box with a corner at or behind the camera is clipped and
+ *  could hide its own front, so it is always drawn, as are
+ *  boxes covering less than the minimum screen fraction.
+ ***********************************************************/
+bool OcclusionCuller::IsSmallOrNear(const glm::vec3& boundsMin, const glm::vec3& boundsMax, bool& bNear) const
+{
+	bNear = false;
+	glm::vec2 screenMin(1.0f);
+	glm::vec2 screenMax(-1.0f);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 position((corner & 1) ? boundsMax.x : boundsMin.x,
+			(corner & 2) ? boundsMax.y : boundsMin.y,
+			(corner & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+		glm::vec4 clip = m_viewProjection * position;
+		if (clip.w < g_NearW)
+		{
+			bNear = true;
+			return true;
+		}
+		glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+		screenMin = glm::min(screenMin, ndc);
+		screenMax = glm::max(screenMax, ndc);
+	}
+
+	// the part of the [-1, 1] square the box covers
+	screenMin = glm::max(screenMin, glm::vec2(-1.0f));
+	screenMax = glm::min(screenMax, glm::vec2(1.0f));
+	glm::vec2 extent = glm::max(screenMax - screenMin, glm::vec2(0.0f));
+	return (extent.x * extent.y * 0.25f) < m_minScreenFraction;
+}
+
+/***********************************************************
+ *  RecordMainPassTime()
+ *
+ *  This method is used for averaging the main pass GPU time
+ *  separately for the frames drawn with and without the
+ *  conditional rendering, so the report can show the time
+ *  the culling saves net of its query pass.
+ ***********************************************************/
+void OcclusionCuller::RecordMainPassTime(const GpuTimer& mainPassTimer, bool bEnabled)
+{
+	if (bEnabled != m_bLastEnabled)
+	{
+		m_bLastEnabled = bEnabled;
+		m_modeChangeFrame = m_frame;
+	}
+	if (mainPassTimer.GetSampleCount() == m_mainPassSamples)
+		return;
+	m_mainPassSamples = mainPassTimer.GetSampleCount();
+	if (m_frame - m_modeChangeFrame < g_ModeSettleFrames)
+		return;
+
+	double milliseconds = mainPassTimer.GetLastMilliseconds();
+	double& average = bEnabled ? m_withMilliseconds : m_withoutMilliseconds;
+	unsigned int& samples = bEnabled ? m_withSamples : m_withoutSamples;
+	if (samples == 0)
+		average = milliseconds;
+	else
+		average += (milliseconds - average) * g_AverageWeight;
+	samples++;
+}
+
+/***********************************************************
+ *  Report()
+ *
+ *  This method is used for printing the query statistics of
+ *  the last frame and the main pass GPU time saved.
+ ***********************************************************/
+void OcclusionCuller::Report() const
+{
+	std::cout << "[OCCLUSION] queries " << m_stats.queriesIssued << "/" << m_stats.objectsTested
+		<< " (skipped " << m_stats.skippedSmall << " small, " << m_stats.skippedVisible << " visible, "
+		<< m_stats.skippedNear << " near), " << m_stats.objectsOccluded << " occluded, "
+		<< m_stats.drawsConditional << " conditional draws" << std::endl;
+
+	if (m_withSamples == 0 || m_withoutSamples == 0)
+	{
+		std::cout << "[OCCLUSION] main pass " << (m_withSamples == 0 ? m_withoutMilliseconds : m_withMilliseconds)
+			<< " ms, toggle culling with H and J to measure the time saved" << std::endl;
+		return;
+	}
+
+	double culledMilliseconds = m_withMilliseconds + m_queryTimer.GetAverageMilliseconds();
+	std::cout << "[OCCLUSION] main pass " << m_withMilliseconds << " ms + " << m_queryTimer.GetAverageMilliseconds()
+		<< " ms queries with culling vs " << m_withoutMilliseconds << " ms without: "
+		<< (m_withoutMilliseconds - culledMilliseconds) << " ms saved" << std::endl;
+}
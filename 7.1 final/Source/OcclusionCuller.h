@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.h
+// ============
+// hardware occlusion queries of object bounds with conditional rendering
+//
+//	After the main pass, the world bounds of the drawn objects are
+//	rasterized against the depth it left, with color and depth writes
+//	off, each inside an occlusion query. In the next frame every object
+//	with such a query is drawn inside glBeginConditionalRender with
+//	GL_QUERY_NO_WAIT: the GPU skips the draw when the box was hidden and
+//	draws it when the result is not ready yet, so the CPU never waits.
+//	Objects that are small on screen cost about as much to draw as to
+//	query and are always drawn; objects that were visible recently are
+//	only queried again every few frames. The results are also read back
+//	a few frames late, without blocking, for the visibility history and
+//	the statistics. The boxes are tested from the camera of the frame
+//	before, so they are inflated slightly against popping in motion.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GpuTimer.h"
+
+class OcclusionCuller
+{
+public:
+	// per frame statistics
+	struct OCCLUSION_STATS
+	{
+		int objectsTested;      // objects offered for a query
+		int skippedSmall;       // too small on screen to be worth a query
+		int skippedVisible;     // visible recently, not queried this frame
+		int skippedNear;        // bounds reach the camera, always drawn
+		int queriesIssued;
+		int drawsConditional;   // draws made under conditional rendering
+		int objectsOccluded;    // objects whose latest result was hidden
+	};
+
+	// constructor
+	OcclusionCuller();
+	// destructor
+	~OcclusionCuller();
+
+	// create the box program and geometry, needs OpenGL 3.3
+	bool Initialize();
+
+	// start a frame with the passed in number of object IDs, reading
+	// back the query results that are ready
+	void BeginFrame(int objectCount);
+
+	// bracket the draw of an object with the conditional rendering of
+	// the query issued for it in the last frame, if there is one
+	void BeginObject(int id);
+	void EndObject();
+
+	// query the bounds of the objects drawn this frame against the depth
+	// buffer of the main pass, which must still be bound
+	void BeginQueries(const glm::mat4& viewProjection, const glm::vec3& cameraPos);
+	void QueryObject(int id, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	void EndQueries();
+
+	// feed the main pass GPU time, labeled with whether culling was on
+	void RecordMainPassTime(const GpuTimer& mainPassTimer, bool bEnabled);
+	// print the statistics and the GPU time saved
+	void Report() const;
+
+	const OCCLUSION_STATS& GetStats() const { return m_stats; }
+	const GpuTimer& GetTimer() const { return m_queryTimer; }
+
+	// on screen fraction below which objects are not queried
+	float        m_minScreenFraction;
+	// frames an object visible in a result is drawn without queries
+	unsigned int m_visibleFrames;
+
+private:
+	// queries in flight per object before a result must be read
+	static const int QUERY_RING = 3;
+
+	struct OBJECT_STATE
+	{
+		GLuint       queries[QUERY_RING];
+		bool         bPending[QUERY_RING];
+		unsigned int issuedFrame[QUERY_RING];
+		int          latest;            // slot issued in latestFrame, -1 if none
+		unsigned int latestFrame;
+		unsigned int lastVisibleFrame;  // issue frame of the last visible result
+		unsigned int resultFrame;       // issue frame of the latest result read
+		bool         bOccluded;         // latest result read back
+	};
+
+	GLuint        m_program;
+	GLint         m_transformLocation;
+	GLuint        m_boxVertexArray;
+	GLuint        m_boxBuffer;
+	GLenum        m_queryTarget;
+
+	std::vector<OBJECT_STATE> m_objects;
+	unsigned int  m_frame;
+	bool          m_bConditional;
+	glm::mat4     m_viewProjection;
+	glm::vec3     m_cameraPos;
+	OCCLUSION_STATS m_stats;
+
+	// GPU time of the query pass and of the main pass with and without
+	// conditional rendering, averaged over the frames of each mode
+	GpuTimer      m_queryTimer;
+	unsigned int  m_mainPassSamples;
+	double        m_withMilliseconds;
+	double        m_withoutMilliseconds;
+	unsigned int  m_withSamples;
+	unsigned int  m_withoutSamples;
+	bool          m_bLastEnabled;
+	unsigned int  m_modeChangeFrame;
+
+	bool CreateProgram();
+	void CollectResults(OBJECT_STATE& state);
+	bool IsSmallOrNear(const glm::vec3& boundsMin, const glm::vec3& boundsMax, bool& bNear) const;
+};
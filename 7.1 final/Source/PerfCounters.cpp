@@ -0,0 +1,225 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfcounters.cpp
+// ============
+// read CPU hardware performance counters of the render thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PerfCounters.h"
+
+#include <iostream>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_CounterNames[PerfCounters::COUNTER_COUNT] = {
+		"cycles",
+		"instructions",
+		"L1D misses",
+		"LLC misses",
+		"branch misses" };
+
+	bool g_bInitialized = false;
+	// file descriptor of each counter, the first open one leads the group
+	int  g_counterFds[PerfCounters::COUNTER_COUNT] = { -1, -1, -1, -1, -1 };
+	// position of each counter in the group read, -1 if missing
+	int  g_groupSlots[PerfCounters::COUNTER_COUNT] = { -1, -1, -1, -1, -1 };
+	int  g_groupSize = 0;
+	int  g_leaderFd = -1;
+
+#if defined(__linux__)
+	void DescribeCounter(PerfCounters::COUNTER counter, perf_event_attr& attr)
+	{
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+
+		switch (counter)
+		{
+		case PerfCounters::CYCLES:
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case PerfCounters::INSTRUCTIONS:
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case PerfCounters::L1D_MISSES:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_L1D |
+				(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		case PerfCounters::LLC_MISSES:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_LL |
+				(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		default:
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		}
+
+		// user space of this thread only, which also works with
+		// the default perf_event_paranoid setting of 2
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+	}
+#endif
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for opening the counter group for the
+ *  calling thread. Counters the CPU or kernel do not support
+ *  are left out; only when none opens are the counters
+ *  reported as unavailable.
+ ***********************************************************/
+bool PerfCounters::Initialize()
+{
+	if (g_bInitialized)
+		return IsAvailable();
+	g_bInitialized = true;
+
+#if defined(__linux__)
+	int firstError = 0;
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		perf_event_attr attr;
+		DescribeCounter((COUNTER)i, attr);
+		attr.disabled = (g_leaderFd < 0) ? 1 : 0;
+
+		int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, g_leaderFd, 0);
+		if (fd < 0)
+		{
+			if (firstError == 0)
+				firstError = errno;
+			continue;
+		}
+
+		if (g_leaderFd < 0)
+			g_leaderFd = fd;
+		g_counterFds[i] = fd;
+		g_groupSlots[i] = g_groupSize++;
+	}
+
+	if (g_leaderFd < 0)
+	{
+		std::cout << "[WARNING] Hardware performance counters are not available (" << strerror(firstError) << ")";
+		if (firstError == EACCES || firstError == EPERM)
+			std::cout << ", check /proc/sys/kernel/perf_event_paranoid";
+		std::cout << std::endl;
+		return false;
+	}
+
+	ioctl(g_leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(g_leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		if (g_counterFds[i] < 0)
+			std::cout << "[WARNING] Hardware counter '" << g_CounterNames[i] << "' is not supported\n";
+	}
+	return true;
+#else
+	std::cout << "[WARNING] Hardware performance counters are only supported on Linux\n";
+	return false;
+#endif
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for closing the counter group.
+ ***********************************************************/
+void PerfCounters::Shutdown()
+{
+#if defined(__linux__)
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		if (g_counterFds[i] >= 0)
+			close(g_counterFds[i]);
+		g_counterFds[i] = -1;
+		g_groupSlots[i] = -1;
+	}
+#endif
+	g_leaderFd = -1;
+	g_groupSize = 0;
+	g_bInitialized = false;
+}
+
+/***********************************************************
+ *  IsAvailable()
+ *
+ *  This method is used for checking whether any counter is
+ *  being read.
+ ***********************************************************/
+bool PerfCounters::IsAvailable()
+{
+	return g_leaderFd >= 0;
+}
+
+/***********************************************************
+ *  IsCounterAvailable()
+ *
+ *  This method is used for checking whether the passed in
+ *  counter is being read.
+ ***********************************************************/
+bool PerfCounters::IsCounterAvailable(COUNTER counter)
+{
+	return counter >= 0 && counter < COUNTER_COUNT && g_groupSlots[counter] >= 0;
+}
+
+/***********************************************************
+ *  Read()
+ *
+ *  This method is used for reading the whole counter group
+ *  with a single system call.
+ ***********************************************************/
+bool PerfCounters::Read(uint64_t values[COUNTER_COUNT])
+{
+	for (int i = 0; i < COUNTER_COUNT; i++)
+		values[i] = 0;
+
+#if defined(__linux__)
+	if (g_leaderFd < 0)
+		return false;
+
+	// layout of PERF_FORMAT_GROUP: the counter count, then the values
+	uint64_t buffer[1 + COUNTER_COUNT];
+	ssize_t bytes = read(g_leaderFd, buffer, sizeof(uint64_t) * (1 + g_groupSize));
+	if (bytes < (ssize_t)sizeof(uint64_t) || buffer[0] != (uint64_t)g_groupSize)
+		return false;
+
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		if (g_groupSlots[i] >= 0)
+			values[i] = buffer[1 + g_groupSlots[i]];
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+/***********************************************************
+ *  GetCounterName()
+ *
+ *  This method is used for getting the report name of the
+ *  passed in counter.
+ ***********************************************************/
+const char* PerfCounters::GetCounterName(COUNTER counter)
+{
+	if (counter < 0 || counter >= COUNTER_COUNT)
+		return "unknown";
+	return g_CounterNames[counter];
+}
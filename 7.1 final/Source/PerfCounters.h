@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// perfcounters.h
+// ============
+// read CPU hardware performance counters of the render thread
+//
+//	Uses Linux perf_event_open to count cycles, instructions, cache and
+//	branch misses for the calling thread. The counters run continuously
+//	in one group and are sampled at the start and end of a scope. On other
+//	platforms, or when the kernel does not permit the counters (see
+//	/proc/sys/kernel/perf_event_paranoid), they are reported as missing
+//	and profiling falls back to wall clock time only.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+class PerfCounters
+{
+public:
+	// counters read for each profiled scope
+	enum COUNTER
+	{
+		CYCLES,
+		INSTRUCTIONS,
+		L1D_MISSES,
+		LLC_MISSES,
+		BRANCH_MISSES,
+		COUNTER_COUNT
+	};
+
+	// open the counter group once, returns false if no counter is available
+	static bool Initialize();
+	// close the counter group
+	static void Shutdown();
+
+	// whether at least one counter could be opened
+	static bool IsAvailable();
+	// whether the passed in counter could be opened
+	static bool IsCounterAvailable(COUNTER counter);
+	// current value of every counter, missing counters read as 0
+	static bool Read(uint64_t values[COUNTER_COUNT]);
+
+	// name used when reporting the counter
+	static const char* GetCounterName(COUNTER counter);
+};
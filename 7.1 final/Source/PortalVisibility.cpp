@@ -0,0 +1,334 @@
+///////////////////////////////////////////////////////////////////////////////
+// portalvisibility.cpp
+// ============
+// cell and portal visibility for scenes made of connected rooms
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PortalVisibility.h"
+
+#include <algorithm>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the whole viewport in normalized device coordinates
+	const PortalVisibility::SCREEN_RECT g_FullScreen = {
+		glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, 1.0f) };
+
+	// smallest clip space w treated as in front of the camera
+	const float g_MinClipW = 1e-5f;
+
+	bool Intersect(const PortalVisibility::SCREEN_RECT& a, const PortalVisibility::SCREEN_RECT& b,
+		PortalVisibility::SCREEN_RECT& result)
+	{
+		result.min = glm::max(a.min, b.min);
+		result.max = glm::min(a.max, b.max);
+		return (result.min.x < result.max.x) && (result.min.y < result.max.y);
+	}
+}
+
+/***********************************************************
+ *  PortalVisibility()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PortalVisibility::PortalVisibility()
+{
+	m_viewProjection = glm::mat4(1.0f);
+	m_stats = CULLING_STATS();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every cell and portal.
+ ***********************************************************/
+void PortalVisibility::Clear()
+{
+	m_cells.clear();
+	m_portals.clear();
+	m_cellRects.clear();
+	m_portalOnPath.clear();
+}
+
+/***********************************************************
+ *  AddCell()
+ *
+ *  This method is used for adding a convex region, given by
+ *  its axis aligned bounds, to the scene.
+ ***********************************************************/
+int PortalVisibility::AddCell(const std::string& tag, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	CELL cell;
+	cell.tag = tag;
+	cell.boundsMin = boundsMin;
+	cell.boundsMax = boundsMax;
+	m_cells.push_back(cell);
+
+	return (int)m_cells.size() - 1;
+}
+
+/***********************************************************
+ *  AddPortal()
+ *
+ *  This method is used for connecting two cells through a
+ *  quad opening. Portals are two way.
+ ***********************************************************/
+int PortalVisibility::AddPortal(int cellA, int cellB, const glm::vec3 corners[4])
+{
+	if (cellA < 0 || cellB < 0 || cellA >= (int)m_cells.size() || cellB >= (int)m_cells.size())
+		return -1;
+
+	PORTAL portal;
+	portal.cells[0] = cellA;
+	portal.cells[1] = cellB;
+	for (int i = 0; i < 4; i++)
+		portal.corners[i] = corners[i];
+	m_portals.push_back(portal);
+
+	int index = (int)m_portals.size() - 1;
+	m_cells[cellA].portals.push_back(index);
+	m_cells[cellB].portals.push_back(index);
+
+	return index;
+}
+
+/***********************************************************
+ *  FindCell()
+ *
+ *  These methods are used for looking up a cell either by
+ *  a point inside of it or by its tag.
+ ***********************************************************/
+int PortalVisibility::FindCell(const glm::vec3& point) const
+{
+	for (int i = 0; i < (int)m_cells.size(); i++)
+	{
+		const CELL& cell = m_cells[i];
+		if (point.x >= cell.boundsMin.x && point.x <= cell.boundsMax.x &&
+			point.y >= cell.boundsMin.y && point.y <= cell.boundsMax.y &&
+			point.z >= cell.boundsMin.z && point.z <= cell.boundsMax.z)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int PortalVisibility::FindCell(const std::string& tag) const
+{
+	for (int i = 0; i < (int)m_cells.size(); i++)
+	{
+		if (m_cells[i].tag == tag)
+			return i;
+	}
+
+	return -1;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for determining the reachable cells
+ *  for this frame. When the camera is outside of every cell
+ *  (e.g. looking in from outdoors) portal culling is skipped
+ *  and only the frustum test applies.
+ ***********************************************************/
+void PortalVisibility::Update(const glm::mat4& viewProjection, const glm::vec3& cameraPos)
+{
+	m_viewProjection = viewProjection;
+	m_stats = CULLING_STATS();
+	m_stats.cellsTotal = (int)m_cells.size();
+
+	m_cellRects.resize(m_cells.size());
+	for (size_t i = 0; i < m_cellRects.size(); i++)
+		m_cellRects[i].clear();
+	m_portalOnPath.assign(m_portals.size(), false);
+
+	int cameraCell = FindCell(cameraPos);
+	if (cameraCell < 0)
+	{
+		for (size_t i = 0; i < m_cellRects.size(); i++)
+			m_cellRects[i].push_back(g_FullScreen);
+		m_stats.cellsVisited = (int)m_cells.size();
+		return;
+	}
+
+	VisitCell(cameraCell, g_FullScreen, 0);
+}
+
+/***********************************************************
+ *  VisitCell()
+ *
+ *  This method is used for recording the screen rectangle a
+ *  cell is seen through and recursing into its neighbors
+ *  through every portal that is still visible within it.
+ ***********************************************************/
+void PortalVisibility::VisitCell(int cell, const SCREEN_RECT& rect, int depth)
+{
+	if (m_cellRects[cell].empty())
+		m_stats.cellsVisited++;
+	m_cellRects[cell].push_back(rect);
+
+	if (depth >= MAX_PORTAL_DEPTH)
+		return;
+
+	const std::vector<int>& portals = m_cells[cell].portals;
+	for (size_t i = 0; i < portals.size(); i++)
+	{
+		int portalIndex = portals[i];
+		if (m_portalOnPath[portalIndex])
+			continue;
+
+		m_stats.portalsTested++;
+
+		const PORTAL& portal = m_portals[portalIndex];
+		SCREEN_RECT portalRect;
+		SCREEN_RECT clippedRect;
+		if (!ProjectPortal(portal, portalRect) || !Intersect(rect, portalRect, clippedRect))
+			continue;
+
+		m_stats.portalsPassed++;
+
+		int neighbor = (portal.cells[0] == cell) ? portal.cells[1] : portal.cells[0];
+		m_portalOnPath[portalIndex] = true;
+		VisitCell(neighbor, clippedRect, depth + 1);
+		m_portalOnPath[portalIndex] = false;
+	}
+}
+
+/***********************************************************
+ *  ProjectPortal()
+ *
+ *  This method is used for finding the screen rectangle of a
+ *  portal. The quad is clipped against the near plane in clip
+ *  space first so openings the camera stands close to still
+ *  project correctly.
+ ***********************************************************/
+bool PortalVisibility::ProjectPortal(const PORTAL& portal, SCREEN_RECT& rect) const
+{
+	glm::vec4 input[4];
+	for (int i = 0; i < 4; i++)
+		input[i] = m_viewProjection * glm::vec4(portal.corners[i], 1.0f);
+
+	// Sutherland-Hodgman against the near plane, z + w >= 0
+	glm::vec4 clipped[8];
+	int count = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		const glm::vec4& current = input[i];
+		const glm::vec4& next = input[(i + 1) % 4];
+		float currentDistance = current.z + current.w;
+		float nextDistance = next.z + next.w;
+
+		if (currentDistance >= 0.0f)
+			clipped[count++] = current;
+		if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+		{
+			float t = currentDistance / (currentDistance - nextDistance);
+			clipped[count++] = current + (next - current) * t;
+		}
+	}
+
+	if (count < 3)
+		return false;
+
+	rect.min = glm::vec2(1e9f);
+	rect.max = glm::vec2(-1e9f);
+	for (int i = 0; i < count; i++)
+	{
+		float w = std::max(clipped[i].w, g_MinClipW);
+		glm::vec2 ndc(clipped[i].x / w, clipped[i].y / w);
+		rect.min = glm::min(rect.min, ndc);
+		rect.max = glm::max(rect.max, ndc);
+	}
+
+	return Intersect(rect, g_FullScreen, rect);
+}
+
+/***********************************************************
+ *  ProjectBounds()
+ *
+ *  This method is used for frustum testing an axis aligned
+ *  box and finding its screen rectangle. Boxes crossing the
+ *  near plane conservatively cover the whole screen.
+ ***********************************************************/
+bool PortalVisibility::ProjectBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax, SCREEN_RECT& rect) const
+{
+	// count of corners outside each of the six clip planes
+	int outside[6] = { 0, 0, 0, 0, 0, 0 };
+	bool bCrossesNear = false;
+
+	rect.min = glm::vec2(1e9f);
+	rect.max = glm::vec2(-1e9f);
+
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner(
+			(i & 1) ? boundsMax.x : boundsMin.x,
+			(i & 2) ? boundsMax.y : boundsMin.y,
+			(i & 4) ? boundsMax.z : boundsMin.z);
+		glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+
+		if (clip.x < -clip.w) outside[0]++;
+		if (clip.x > clip.w)  outside[1]++;
+		if (clip.y < -clip.w) outside[2]++;
+		if (clip.y > clip.w)  outside[3]++;
+		if (clip.z < -clip.w) outside[4]++;
+		if (clip.z > clip.w)  outside[5]++;
+
+		if (clip.w <= g_MinClipW)
+		{
+			bCrossesNear = true;
+			continue;
+		}
+
+		glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+		rect.min = glm::min(rect.min, ndc);
+		rect.max = glm::max(rect.max, ndc);
+	}
+
+	for (int plane = 0; plane < 6; plane++)
+	{
+		if (outside[plane] == 8)
+			return false;
+	}
+
+	if (bCrossesNear)
+		rect = g_FullScreen;
+
+	return true;
+}
+
+/***********************************************************
+ *  IsVisible()
+ *
+ *  This method is used for deciding whether an object of the
+ *  passed in cell is submitted for drawing this frame.
+ *  Objects without a cell (-1) are only frustum tested.
+ ***********************************************************/
+bool PortalVisibility::IsVisible(int cell, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	m_stats.objectsTested++;
+
+	SCREEN_RECT objectRect;
+	bool bVisible = ProjectBounds(boundsMin, boundsMax, objectRect);
+
+	if (bVisible && cell >= 0 && cell < (int)m_cellRects.size())
+	{
+		bVisible = false;
+		const std::vector<SCREEN_RECT>& rects = m_cellRects[cell];
+		for (size_t i = 0; i < rects.size() && !bVisible; i++)
+		{
+			SCREEN_RECT overlap;
+			bVisible = Intersect(rects[i], objectRect, overlap);
+		}
+	}
+
+	if (bVisible)
+		m_stats.objectsSubmitted++;
+	else
+		m_stats.objectsCulled++;
+
+	return bVisible;
+}
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// portalvisibility.h
+// ============
+// cell and portal visibility for scenes made of connected rooms
+//
+//	Each cell is a convex region (a room) and each portal a convex opening
+//	(a door) between two cells. Every frame the view frustum is clipped
+//	recursively through the portals reachable from the camera's cell; each
+//	visit narrows the frustum to the screen rectangle of the portal. Objects
+//	are only visible if they overlap a rectangle their own cell was reached
+//	through.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+class PortalVisibility
+{
+public:
+	// convex region of the scene
+	struct CELL
+	{
+		std::string      tag;
+		glm::vec3        boundsMin;
+		glm::vec3        boundsMax;
+		std::vector<int> portals;
+	};
+
+	// convex quad opening connecting two cells
+	struct PORTAL
+	{
+		int       cells[2];
+		glm::vec3 corners[4];
+	};
+
+	// screen space rectangle in normalized device coordinates
+	struct SCREEN_RECT
+	{
+		glm::vec2 min;
+		glm::vec2 max;
+	};
+
+	// per frame culling statistics
+	struct CULLING_STATS
+	{
+		int cellsTotal;
+		int cellsVisited;
+		int portalsTested;
+		int portalsPassed;
+		int objectsTested;
+		int objectsSubmitted;
+		int objectsCulled;
+	};
+
+	// constructor
+	PortalVisibility();
+
+	// remove all cells and portals
+	void Clear();
+	// add a cell, returns its index
+	int AddCell(const std::string& tag, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	// add a portal between two cells, corners in winding order
+	int AddPortal(int cellA, int cellB, const glm::vec3 corners[4]);
+	// index of the cell containing the point, -1 if none
+	int FindCell(const glm::vec3& point) const;
+	int FindCell(const std::string& tag) const;
+
+	// flood the visible cells from the camera for this frame
+	void Update(const glm::mat4& viewProjection, const glm::vec3& cameraPos);
+	// test an object's world bounds against the portal-clipped frustum of its cell
+	bool IsVisible(int cell, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+	const CULLING_STATS& GetStats() const { return m_stats; }
+	int GetCellCount() const { return (int)m_cells.size(); }
+
+private:
+	// maximum number of portals followed along one path
+	static const int MAX_PORTAL_DEPTH = 8;
+
+	std::vector<CELL>   m_cells;
+	std::vector<PORTAL> m_portals;
+	// screen rectangles each cell was reached through this frame
+	std::vector<std::vector<SCREEN_RECT> > m_cellRects;
+	std::vector<bool>   m_portalOnPath;
+	glm::mat4           m_viewProjection;
+	CULLING_STATS       m_stats;
+
+	void VisitCell(int cell, const SCREEN_RECT& rect, int depth);
+	bool ProjectPortal(const PORTAL& portal, SCREEN_RECT& rect) const;
+	bool ProjectBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax, SCREEN_RECT& rect) const;
+};
@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// recordpool.h
+// ============
+// fixed size pool for scene records with stable addresses
+//
+//	Records live in chunks of CHUNK_RECORDS slots that are allocated on
+//	a cache line boundary and never moved or released before the pool
+//	is, so a pointer or index to a record stays valid until it is freed.
+//	Freed slots are kept in a free list and reused before a new chunk is
+//	allocated, so adding and removing records during scene edits does
+//	not go back to the general heap. A free slot remembers its chunk, and
+//	Free finds the chunk of a record by a binary search over the chunk
+//	addresses. A bit mask per chunk marks the live slots; iteration
+//	visits them in index order and skips the free ones a whole chunk at
+//	a time.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+template <typename T, size_t CHUNK_RECORDS = 64>
+class RecordPool
+{
+	static_assert(CHUNK_RECORDS > 0 && CHUNK_RECORDS <= 64, "the live slots of a chunk are one 64-bit mask");
+
+public:
+	// chunks start on this boundary
+	static const size_t CACHE_LINE = 64;
+
+	// constructor
+	RecordPool() : m_pFreeList(NULL), m_count(0) {}
+	// destructor
+	~RecordPool() { Release(); }
+
+	// a default or copy constructed record, its address never changes
+	T* Allocate() { return new (TakeSlot()) T(); }
+	T* Allocate(const T& record) { return new (TakeSlot()) T(record); }
+	// destroy a record of this pool and put its slot on the free list
+	void Free(T* pRecord)
+	{
+		CHUNK* pChunk = NULL;
+		size_t slot = 0;
+		if (NULL == pRecord || !Locate(pRecord, pChunk, slot))
+			return;
+		pRecord->~T();
+		pChunk->liveMask &= ~((uint64_t)1 << slot);
+		SLOT* pSlot = &pChunk->slots[slot];
+		pSlot->freeSlot.pNextFree = m_pFreeList;
+		pSlot->freeSlot.pChunk = pChunk;
+		m_pFreeList = pSlot;
+		m_count--;
+	}
+	// destroy every record and release the chunks
+	void Clear() { Release(); }
+
+	size_t GetCount() const { return m_count; }
+	size_t GetCapacity() const { return m_chunks.size() * CHUNK_RECORDS; }
+	// stable index of a record, e.g. a texture unit
+	size_t GetIndex(const T* pRecord) const
+	{
+		CHUNK* pChunk = NULL;
+		size_t slot = 0;
+		return Locate(pRecord, pChunk, slot) ? pChunk->index * CHUNK_RECORDS + slot : (size_t)-1;
+	}
+	// the record at an index, NULL if the slot is free
+	T* GetRecord(size_t index) const
+	{
+		size_t chunk = index / CHUNK_RECORDS;
+		size_t slot = index % CHUNK_RECORDS;
+		if (chunk >= m_chunks.size() || (m_chunks[chunk]->liveMask & ((uint64_t)1 << slot)) == 0)
+			return NULL;
+		return (T*)m_chunks[chunk]->slots[slot].storage;
+	}
+
+private:
+	struct CHUNK;
+
+	union SLOT
+	{
+		struct
+		{
+			SLOT*  pNextFree;
+			CHUNK* pChunk;
+		} freeSlot;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	struct CHUNK
+	{
+		SLOT     slots[CHUNK_RECORDS];
+		uint64_t liveMask;
+		size_t   index;            // in m_chunks
+		void*    pAllocation;      // as returned by malloc
+	};
+
+public:
+	// visits the live records in index order
+	template <typename RECORD>
+	class ITERATOR
+	{
+	public:
+		ITERATOR(const std::vector<CHUNK*>& chunks, size_t chunk)
+			: m_pChunks(&chunks), m_chunk(chunk), m_mask(0), m_pSlots(NULL)
+		{
+			if (chunk < chunks.size())
+			{
+				m_mask = chunks[chunk]->liveMask;
+				m_pSlots = chunks[chunk]->slots;
+			}
+			SkipEmptyChunks();
+		}
+		RECORD& operator*() const { return *operator->(); }
+		RECORD* operator->() const { return (RECORD*)m_pSlots[LowestBit(m_mask)].storage; }
+		ITERATOR& operator++()
+		{
+			m_mask &= m_mask - 1;
+			SkipEmptyChunks();
+			return *this;
+		}
+		bool operator==(const ITERATOR& other) const { return m_chunk == other.m_chunk && m_mask == other.m_mask; }
+		bool operator!=(const ITERATOR& other) const { return !(*this == other); }
+
+	private:
+		const std::vector<CHUNK*>* m_pChunks;
+		size_t                     m_chunk;
+		uint64_t                   m_mask;      // live slots not visited yet
+		SLOT*                      m_pSlots;    // of the current chunk
+
+		void SkipEmptyChunks()
+		{
+			while (m_mask == 0 && m_chunk < m_pChunks->size())
+			{
+				m_chunk++;
+				if (m_chunk < m_pChunks->size())
+				{
+					m_mask = (*m_pChunks)[m_chunk]->liveMask;
+					m_pSlots = (*m_pChunks)[m_chunk]->slots;
+				}
+			}
+		}
+	};
+
+	typedef ITERATOR<T> iterator;
+	typedef ITERATOR<const T> const_iterator;
+
+	iterator begin() { return iterator(m_chunks, 0); }
+	iterator end() { return iterator(m_chunks, m_chunks.size()); }
+	const_iterator begin() const { return const_iterator(m_chunks, 0); }
+	const_iterator end() const { return const_iterator(m_chunks, m_chunks.size()); }
+
+private:
+	std::vector<CHUNK*> m_chunks;
+	std::vector<CHUNK*> m_chunksByAddress;
+	SLOT*               m_pFreeList;
+	size_t              m_count;
+
+	// records are not copied with their pool
+	RecordPool(const RecordPool&);
+	RecordPool& operator=(const RecordPool&);
+
+	static unsigned int LowestBit(uint64_t mask)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index = 0;
+		_BitScanForward64(&index, mask);
+		return (unsigned int)index;
+#elif defined(_MSC_VER)
+		unsigned long index = 0;
+		if (_BitScanForward(&index, (unsigned long)mask))
+			return (unsigned int)index;
+		_BitScanForward(&index, (unsigned long)(mask >> 32));
+		return (unsigned int)index + 32;
+#else
+		return (unsigned int)__builtin_ctzll(mask);
+#endif
+	}
+
+	void* TakeSlot()
+	{
+		if (NULL == m_pFreeList)
+			AddChunk();
+		SLOT* pSlot = m_pFreeList;
+		CHUNK* pChunk = pSlot->freeSlot.pChunk;
+		m_pFreeList = pSlot->freeSlot.pNextFree;
+		pChunk->liveMask |= (uint64_t)1 << (size_t)(pSlot - pChunk->slots);
+		m_count++;
+		return pSlot->storage;
+	}
+
+	// the free list hands out the lowest slots of a new chunk first
+	void AddChunk()
+	{
+		void* pAllocation = malloc(sizeof(CHUNK) + CACHE_LINE - 1);
+		if (NULL == pAllocation)
+			throw std::bad_alloc();
+		uintptr_t aligned = ((uintptr_t)pAllocation + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1);
+		CHUNK* pChunk = (CHUNK*)aligned;
+		pChunk->liveMask = 0;
+		pChunk->index = m_chunks.size();
+		pChunk->pAllocation = pAllocation;
+		for (size_t slot = CHUNK_RECORDS; slot > 0; slot--)
+		{
+			pChunk->slots[slot - 1].freeSlot.pNextFree = m_pFreeList;
+			pChunk->slots[slot - 1].freeSlot.pChunk = pChunk;
+			m_pFreeList = &pChunk->slots[slot - 1];
+		}
+		m_chunks.push_back(pChunk);
+		m_chunksByAddress.insert(std::upper_bound(m_chunksByAddress.begin(), m_chunksByAddress.end(),
+			(const unsigned char*)pChunk, StartsAfter), pChunk);
+	}
+
+	static bool StartsAfter(const unsigned char* pAddress, const CHUNK* pChunk)
+	{
+		return pAddress < (const unsigned char*)pChunk;
+	}
+
+	// the last chunk starting at or before the record holds it, if any
+	bool Locate(const T* pRecord, CHUNK*& pChunk, size_t& slot) const
+	{
+		const unsigned char* pAddress = (const unsigned char*)pRecord;
+		typename std::vector<CHUNK*>::const_iterator next =
+			std::upper_bound(m_chunksByAddress.begin(), m_chunksByAddress.end(), pAddress, StartsAfter);
+		if (next == m_chunksByAddress.begin())
+			return false;
+		pChunk = *(next - 1);
+		const unsigned char* pFirst = (const unsigned char*)pChunk->slots;
+		if (pAddress >= pFirst + sizeof(pChunk->slots))
+			return false;
+		slot = (size_t)(pAddress - pFirst) / sizeof(SLOT);
+		return true;
+	}
+
+	void Release()
+	{
+		for (iterator record = begin(); record != end(); ++record)
+			record->~T();
+		for (size_t i = 0; i < m_chunks.size(); i++)
+			free(m_chunks[i]->pAllocation);
+		m_chunks.clear();
+		m_chunksByAddress.clear();
+		m_pFreeList = NULL;
+		m_count = 0;
+	}
+};
@@ -0,0 +1,350 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderfarm.cpp
+// ============
+// offline batch rendering with one worker process per GL context
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderFarm.h"
+#include "SceneRenderTarget.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// the orbit of AddOrbitFrames, around the middle of the desk
+	const int g_OrbitFramesPerTurn = 360;
+	const float g_OrbitRadius = 12.0f;
+	const float g_OrbitHeight = 5.0f;
+	const glm::vec3 g_OrbitTarget(0.0f, 0.5f, 0.0f);
+
+	// what a worker did during a run
+	struct WORKER_STATS
+	{
+		uint32_t frames;
+		uint32_t failures;
+		double   busyMilliseconds;
+	};
+
+	// the shared memory work queue, followed by the views
+	struct FARM_QUEUE
+	{
+		std::atomic<uint32_t> nextView;
+		std::atomic<int32_t>  readyWorkers;
+		std::atomic<int32_t>  started;
+		uint32_t              viewCount;
+		WORKER_STATS          workers[RenderFarm::MAX_WORKERS];
+	};
+
+	// binary PPM, the rows read back bottom first are written top first
+	bool WriteImage(const std::string& filename, const std::vector<unsigned char>& pixels, int width, int height)
+	{
+		FILE* file = fopen(filename.c_str(), "wb");
+		if (NULL == file)
+			return false;
+
+		fprintf(file, "P6\n%d %d\n255\n", width, height);
+		std::vector<unsigned char> row((size_t)width * 3);
+		bool bWritten = true;
+		for (int y = height - 1; y >= 0 && bWritten; y--)
+		{
+			const unsigned char* pSource = &pixels[(size_t)y * width * 4];
+			for (int x = 0; x < width; x++)
+			{
+				row[x * 3 + 0] = pSource[x * 4 + 0];
+				row[x * 3 + 1] = pSource[x * 4 + 1];
+				row[x * 3 + 2] = pSource[x * 4 + 2];
+			}
+			bWritten = (fwrite(&row[0], 1, row.size(), file) == row.size());
+		}
+		return (fclose(file) == 0) && bWritten;
+	}
+
+#if !defined(_WIN32)
+	// the body of a worker process; returns its exit status
+	int RunWorker(FARM_QUEUE* pQueue, const RenderFarm::FARM_VIEW* pViews, int index, int width, int height,
+		const char* outputDirectory, const SceneSnapshot& snapshot, RenderFarm::PREPARE_WORKER prepareWorker, pid_t coordinator)
+	{
+		SceneManager* pSceneManager = prepareWorker(snapshot);
+		SceneRenderTarget target;
+		if (NULL == pSceneManager || !target.Resize(width, height))
+			return 1;
+		std::vector<unsigned char> pixels((size_t)width * height * 4);
+
+		// the run is timed from when every worker is ready
+		pQueue->readyWorkers.fetch_add(1);
+		while (pQueue->started.load() == 0)
+		{
+			if (getppid() != coordinator)
+				return 1;
+			usleep(1000);
+		}
+
+		WORKER_STATS& stats = pQueue->workers[index];
+		for (uint32_t view = pQueue->nextView.fetch_add(1); view < pQueue->viewCount; view = pQueue->nextView.fetch_add(1))
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			const RenderFarm::FARM_VIEW& farmView = pViews[view];
+			pSceneManager->RenderView(target, glm::vec3(farmView.cameraPos[0], farmView.cameraPos[1], farmView.cameraPos[2]),
+				glm::vec3(farmView.cameraFront[0], farmView.cameraFront[1], farmView.cameraFront[2]));
+			glReadBuffer(GL_COLOR_ATTACHMENT0 + SceneRenderTarget::COLOR_ATTACHMENT);
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+			stats.frames++;
+
+			if (NULL != outputDirectory)
+			{
+				char name[32];
+				snprintf(name, sizeof(name), "/frame_%05u.ppm", farmView.frame);
+				if (!WriteImage(std::string(outputDirectory) + name, pixels, width, height))
+					stats.failures++;
+			}
+			stats.busyMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return (stats.failures == 0) ? 0 : 1;
+	}
+#endif
+}
+
+/***********************************************************
+ *  RenderFarm()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderFarm::RenderFarm()
+{
+}
+
+/***********************************************************
+ *  ~RenderFarm()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderFarm::~RenderFarm()
+{
+	m_snapshot.Unmap();
+}
+
+/***********************************************************
+ *  MapScene()
+ *
+ *  This method is used for mapping the snapshot the workers
+ *  prepare the scene from. It is mapped once, before the
+ *  workers are forked, so they all share its pages.
+ ***********************************************************/
+bool RenderFarm::MapScene(const char* snapshotFile)
+{
+	if (!m_snapshot.Map(snapshotFile))
+	{
+		std::cout << "[ERROR] The render farm needs a scene snapshot, run once with --snapshot "
+			<< snapshotFile << " to write it" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  LoadCameraList()
+ *
+ *  This method is used for adding a view for every line of
+ *  the passed in file, numbered in the order of the lines.
+ *  Empty lines and lines starting with # are skipped.
+ ***********************************************************/
+bool RenderFarm::LoadCameraList(const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		std::cout << "[ERROR] Could not open camera list: " << filename << std::endl;
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		if (line.empty() || line[0] == '#' || line[0] == '\r')
+			continue;
+
+		FARM_VIEW view;
+		view.frame = (uint32_t)m_views.size();
+		std::istringstream stream(line);
+		if (!(stream >> view.cameraPos[0] >> view.cameraPos[1] >> view.cameraPos[2]
+			>> view.cameraFront[0] >> view.cameraFront[1] >> view.cameraFront[2]))
+		{
+			std::cout << "[ERROR] " << filename << "(" << lineNumber << "): expected px py pz fx fy fz" << std::endl;
+			return false;
+		}
+		m_views.push_back(view);
+	}
+	return true;
+}
+
+/***********************************************************
+ *  AddOrbitFrames()
+ *
+ *  This method is used for adding the frames of a camera
+ *  orbit around the scene, numbered by their frame, so a
+ *  long orbit can be split between render nodes.
+ ***********************************************************/
+void RenderFarm::AddOrbitFrames(int firstFrame, int lastFrame)
+{
+	for (int frame = firstFrame; frame <= lastFrame; frame++)
+	{
+		float angle = glm::radians(360.0f * (float)(frame % g_OrbitFramesPerTurn) / (float)g_OrbitFramesPerTurn);
+		glm::vec3 position(g_OrbitRadius * sinf(angle), g_OrbitHeight, g_OrbitRadius * cosf(angle));
+		glm::vec3 front = glm::normalize(g_OrbitTarget - position);
+
+		FARM_VIEW view;
+		view.frame = (uint32_t)frame;
+		memcpy(view.cameraPos, &position.x, sizeof(view.cameraPos));
+		memcpy(view.cameraFront, &front.x, sizeof(view.cameraFront));
+		m_views.push_back(view);
+	}
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for forking the workers, letting them
+ *  prepare their scenes, and timing how long they take to
+ *  render every view from the shared queue. Setting up the
+ *  contexts is not part of the measured time.
+ ***********************************************************/
+double RenderFarm::Run(int workerCount, int width, int height, const char* outputDirectory, PREPARE_WORKER prepareWorker)
+{
+#if defined(_WIN32)
+	std::cout << "[ERROR] The render farm forks its workers, which needs a POSIX system" << std::endl;
+	return 0.0;
+#else
+	if (workerCount < 1 || workerCount > MAX_WORKERS || m_views.empty() || !m_snapshot.IsMapped())
+	{
+		std::cout << "[ERROR] The render farm needs 1 to " << MAX_WORKERS << " workers, views and a mapped scene" << std::endl;
+		return 0.0;
+	}
+
+	size_t queueBytes = sizeof(FARM_QUEUE) + m_views.size() * sizeof(FARM_VIEW);
+	void* pMemory = mmap(NULL, queueBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (pMemory == MAP_FAILED)
+	{
+		std::cout << "[ERROR] Could not create the render farm queue" << std::endl;
+		return 0.0;
+	}
+	FARM_QUEUE* pQueue = new (pMemory) FARM_QUEUE();
+	pQueue->nextView.store(0);
+	pQueue->readyWorkers.store(0);
+	pQueue->started.store(0);
+	pQueue->viewCount = (uint32_t)m_views.size();
+	memset(pQueue->workers, 0, sizeof(pQueue->workers));
+	FARM_VIEW* pViews = (FARM_VIEW*)(pQueue + 1);
+	memcpy(pViews, &m_views[0], m_views.size() * sizeof(FARM_VIEW));
+
+	// buffered output would be written again by every child
+	std::cout.flush();
+	fflush(stdout);
+
+	pid_t coordinator = getpid();
+	std::vector<pid_t> workers;
+	for (int i = 0; i < workerCount; i++)
+	{
+		pid_t pid = fork();
+		if (pid == 0)
+			_exit(RunWorker(pQueue, pViews, i, width, height, outputDirectory, m_snapshot, prepareWorker, coordinator));
+		if (pid < 0)
+		{
+			std::cout << "[ERROR] Could not fork render farm worker " << i << std::endl;
+			break;
+		}
+		workers.push_back(pid);
+	}
+
+	// wait until every worker prepared its scene or gave up
+	std::vector<int> exitStatus(workers.size(), -1);
+	int exited = 0;
+	while (pQueue->readyWorkers.load() + exited < (int)workers.size())
+	{
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			if (exitStatus[i] == -1 && waitpid(workers[i], &exitStatus[i], WNOHANG) == workers[i])
+				exited++;
+		}
+		usleep(1000);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pQueue->started.store(1);
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		if (exitStatus[i] == -1)
+			waitpid(workers[i], &exitStatus[i], 0);
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	uint32_t rendered = 0;
+	int failedWorkers = 0;
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		const WORKER_STATS& stats = pQueue->workers[i];
+		bool bFailed = !WIFEXITED(exitStatus[i]) || WEXITSTATUS(exitStatus[i]) != 0;
+		failedWorkers += bFailed ? 1 : 0;
+		rendered += stats.frames;
+		std::cout << "[FARM] worker " << i << ": " << stats.frames << " views, " << stats.busyMilliseconds << " ms busy"
+			<< (bFailed ? ", failed" : "") << std::endl;
+	}
+	uint32_t viewCount = pQueue->viewCount;
+	pQueue->~FARM_QUEUE();
+	munmap(pMemory, queueBytes);
+
+	double viewsPerSecond = (milliseconds > 0.0) ? rendered * 1000.0 / milliseconds : 0.0;
+	std::cout << "[FARM] " << workers.size() << " workers rendered " << rendered << " of " << viewCount << " views in "
+		<< milliseconds << " ms, " << viewsPerSecond << " views/s" << std::endl;
+	if (rendered < viewCount || failedWorkers > 0)
+	{
+		std::cout << "[ERROR] " << failedWorkers << " render farm workers failed" << std::endl;
+		return 0.0;
+	}
+
+	RUN_RESULT result;
+	result.workers = (int)workers.size();
+	result.viewsPerSecond = viewsPerSecond;
+	m_runs.push_back(result);
+	return viewsPerSecond;
+#endif
+}
+
+/***********************************************************
+ *  ReportScaling()
+ *
+ *  This method is used for printing the throughput of every
+ *  run against the first run, scaled to one worker, as the
+ *  speedup and the parallel efficiency.
+ ***********************************************************/
+void RenderFarm::ReportScaling() const
+{
+	if (m_runs.empty())
+		return;
+
+	double singleWorker = m_runs[0].viewsPerSecond / m_runs[0].workers;
+	for (size_t i = 0; i < m_runs.size(); i++)
+	{
+		double speedup = m_runs[i].viewsPerSecond / singleWorker;
+		std::cout << "[FARM] scaling: " << m_runs[i].workers << " workers, " << m_runs[i].viewsPerSecond << " views/s, "
+			<< speedup << "x, " << (int)(100.0 * speedup / m_runs[i].workers + 0.5) << "% efficiency" << std::endl;
+	}
+}
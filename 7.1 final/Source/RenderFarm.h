@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderfarm.h
+// ============
+// offline batch rendering with one worker process per GL context
+//
+//	The coordinator maps the scene snapshot once and forks the workers
+//	before any GL context exists, so every worker shares the mapped pages
+//	and creates its own hidden context. The views to render, from a camera
+//	list or a range of orbit frames, sit in an anonymous shared memory
+//	queue that the workers take from one view at a time, so a slow worker
+//	never holds up the others. Each run records its throughput, and
+//	ReportScaling compares the runs with different worker counts.
+//	fork() makes this POSIX only.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "SceneManager.h"
+#include "SceneSnapshot.h"
+
+class RenderFarm
+{
+public:
+	// the most worker processes of one run
+	static const int MAX_WORKERS = 256;
+
+	// one view of the job list
+	struct FARM_VIEW
+	{
+		uint32_t frame;             // numbers the output image
+		float    cameraPos[3];
+		float    cameraFront[3];
+	};
+
+	// creates the context of a worker and prepares the scene from the
+	// shared snapshot, NULL on failure
+	typedef SceneManager* (*PREPARE_WORKER)(const SceneSnapshot& snapshot);
+
+	// constructor
+	RenderFarm();
+	// destructor
+	~RenderFarm();
+
+	// map the prepared scene for every worker to share
+	bool MapScene(const char* snapshotFile);
+	// add the views of a camera list, "px py pz fx fy fz" per line
+	bool LoadCameraList(const char* filename);
+	// add frames of an orbit around the scene, 360 frames per turn
+	void AddOrbitFrames(int firstFrame, int lastFrame);
+	size_t GetViewCount() const { return m_views.size(); }
+
+	// render every view with the passed in number of workers, writing
+	// PPM images when an output directory is given; returns views per
+	// second, 0 on failure
+	double Run(int workerCount, int width, int height, const char* outputDirectory, PREPARE_WORKER prepareWorker);
+	// print the throughput of the runs so far against one worker
+	void ReportScaling() const;
+
+private:
+	// throughput of one run
+	struct RUN_RESULT
+	{
+		int    workers;
+		double viewsPerSecond;
+	};
+
+	SceneSnapshot           m_snapshot;
+	std::vector<FARM_VIEW>  m_views;
+	std::vector<RUN_RESULT> m_runs;
+};
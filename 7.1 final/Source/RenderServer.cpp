@@ -0,0 +1,532 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderserver.cpp
+// ============
+// long-lived render service for tools, over a Unix domain socket
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderServer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+#if defined(_WIN32)
+	typedef SOCKET NATIVE_SOCKET;
+	const int g_SendFlags = 0;
+#else
+	typedef int NATIVE_SOCKET;
+#if defined(MSG_NOSIGNAL)
+	// a client that went away must not raise SIGPIPE in the server
+	const int g_SendFlags = MSG_NOSIGNAL;
+#else
+	const int g_SendFlags = 0;
+#endif
+#endif
+	const uintptr_t g_InvalidSocket = (uintptr_t)-1;
+
+	// the images of a client start on this boundary in its segment
+	const size_t g_ImageAlignment = 64;
+
+	// connected clients, one fd_set also holds the listening socket
+	const int g_MaxClients = (FD_SETSIZE - 1 < 64) ? FD_SETSIZE - 1 : 64;
+	// requests queued per client, the rest waits in its socket
+	const size_t g_MaxPendingRequests = 32;
+	// views and image bytes rendered in one batch
+	const size_t g_MaxBatchRequests = 256;
+	const uint64_t g_MaxBatchBytes = (uint64_t)1 << 30;
+	// bytes mapped by the shared segments of all clients together
+	const size_t g_MaxSharedBytes = (size_t)1 << 31;
+
+	void CloseSocket(uintptr_t socketHandle)
+	{
+#if defined(_WIN32)
+		closesocket((NATIVE_SOCKET)socketHandle);
+#else
+		close((NATIVE_SOCKET)socketHandle);
+#endif
+	}
+
+	bool SendAll(uintptr_t socketHandle, const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			int sent = send((NATIVE_SOCKET)socketHandle, data, (int)size, g_SendFlags);
+			if (sent <= 0)
+				return false;
+			data += sent;
+			size -= sent;
+		}
+		return true;
+	}
+
+	unsigned int GetProcessID()
+	{
+#if defined(_WIN32)
+		return (unsigned int)GetCurrentProcessId();
+#else
+		return (unsigned int)getpid();
+#endif
+	}
+}
+
+/***********************************************************
+ *  RenderServer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderServer::RenderServer(SceneManager* pSceneManager)
+{
+	m_pSceneManager = pSceneManager;
+	m_listenSocket = g_InvalidSocket;
+	m_nextClientId = 0;
+	m_sharedBytes = 0;
+	m_bSocketsStarted = false;
+}
+
+/***********************************************************
+ *  ~RenderServer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderServer::~RenderServer()
+{
+	Stop();
+	m_pSceneManager = NULL;
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for creating the listening socket at
+ *  the passed in path. A socket file left behind by a server
+ *  that did not shut down is removed first.
+ ***********************************************************/
+bool RenderServer::Start(const char* socketPath)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		std::cout << "[ERROR] Render server socket path is too long: " << socketPath << std::endl;
+		return false;
+	}
+	strcpy(address.sun_path, socketPath);
+
+#if defined(_WIN32)
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+	{
+		std::cout << "[ERROR] Could not initialize Winsock for the render server" << std::endl;
+		return false;
+	}
+	m_bSocketsStarted = true;
+#endif
+
+	remove(socketPath);
+	NATIVE_SOCKET listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	m_listenSocket = (uintptr_t)listenSocket;
+	if (m_listenSocket == g_InvalidSocket ||
+		bind(listenSocket, (const sockaddr*)&address, sizeof(address)) != 0 ||
+		listen(listenSocket, 16) != 0)
+	{
+		std::cout << "[ERROR] Render server could not listen on " << socketPath << std::endl;
+		Stop();
+		return false;
+	}
+	m_socketPath = socketPath;
+
+	std::cout << "[SERVE] render server listening on " << socketPath << std::endl;
+	return true;
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for disconnecting every client and
+ *  removing the socket.
+ ***********************************************************/
+void RenderServer::Stop()
+{
+	while (!m_clients.empty())
+		CloseClient(m_clients.size() - 1);
+
+	if (m_listenSocket != g_InvalidSocket)
+	{
+		CloseSocket(m_listenSocket);
+		m_listenSocket = g_InvalidSocket;
+	}
+	if (!m_socketPath.empty())
+	{
+		remove(m_socketPath.c_str());
+		m_socketPath.clear();
+	}
+#if defined(_WIN32)
+	if (m_bSocketsStarted)
+		WSACleanup();
+#endif
+	m_bSocketsStarted = false;
+}
+
+/***********************************************************
+ *  Poll()
+ *
+ *  This method is used for waiting up to the passed in time
+ *  for connections and requests, then rendering every
+ *  request received so far as one batch.
+ ***********************************************************/
+bool RenderServer::Poll(int timeoutMilliseconds)
+{
+	if (m_listenSocket == g_InvalidSocket)
+		return false;
+
+	fd_set readSet;
+	FD_ZERO(&readSet);
+	FD_SET((NATIVE_SOCKET)m_listenSocket, &readSet);
+	uintptr_t maxSocket = m_listenSocket;
+	for (size_t i = 0; i < m_clients.size(); i++)
+	{
+		// a client with a full queue is not read until the batch took it
+		if (m_clients[i]->pending.size() >= g_MaxPendingRequests)
+			continue;
+		FD_SET((NATIVE_SOCKET)m_clients[i]->socket, &readSet);
+		maxSocket = std::max(maxSocket, m_clients[i]->socket);
+	}
+
+	timeval timeout;
+	timeout.tv_sec = timeoutMilliseconds / 1000;
+	timeout.tv_usec = (timeoutMilliseconds % 1000) * 1000;
+	int ready = select((int)maxSocket + 1, &readSet, NULL, NULL, &timeout);
+	if (ready < 0)
+	{
+#if !defined(_WIN32)
+		if (errno == EINTR)
+			return true;
+#endif
+		std::cout << "[ERROR] Render server stopped, select failed" << std::endl;
+		return false;
+	}
+
+	for (size_t i = m_clients.size(); i > 0; i--)
+	{
+		if (FD_ISSET((NATIVE_SOCKET)m_clients[i - 1]->socket, &readSet) && !ReceiveRequests(*m_clients[i - 1]))
+			CloseClient(i - 1);
+	}
+
+	if (FD_ISSET((NATIVE_SOCKET)m_listenSocket, &readSet))
+	{
+		NATIVE_SOCKET clientSocket = accept((NATIVE_SOCKET)m_listenSocket, NULL, NULL);
+		if ((uintptr_t)clientSocket != g_InvalidSocket && m_clients.size() >= (size_t)g_MaxClients)
+		{
+			std::cout << "[WARNING] Render server is full, refusing a client" << std::endl;
+			CloseSocket((uintptr_t)clientSocket);
+		}
+#if !defined(_WIN32)
+		// FD_SET is undefined for descriptors past the end of the fd_set
+		else if ((uintptr_t)clientSocket != g_InvalidSocket && clientSocket >= FD_SETSIZE)
+		{
+			std::cout << "[WARNING] Render server is out of descriptors, refusing a client" << std::endl;
+			CloseSocket((uintptr_t)clientSocket);
+		}
+#endif
+		else if ((uintptr_t)clientSocket != g_InvalidSocket)
+		{
+			CLIENT* pClient = new CLIENT();
+			pClient->socket = (uintptr_t)clientSocket;
+			pClient->id = ++m_nextClientId;
+			pClient->generation = 0;
+			memset(&pClient->image, 0, sizeof(pClient->image));
+			m_clients.push_back(pClient);
+		}
+	}
+
+	RenderBatch();
+	return true;
+}
+
+/***********************************************************
+ *  ReceiveRequests()
+ *
+ *  This method is used for reading what the client sent and
+ *  queueing its complete requests. It returns false when the
+ *  client disconnected or is out of step with the protocol.
+ ***********************************************************/
+bool RenderServer::ReceiveRequests(CLIENT& client)
+{
+	char buffer[4096];
+	int received = recv((NATIVE_SOCKET)client.socket, buffer, sizeof(buffer), 0);
+	if (received <= 0)
+		return false;
+
+	client.received.insert(client.received.end(), buffer, buffer + received);
+	return QueueRequests(client);
+}
+
+/***********************************************************
+ *  QueueRequests()
+ *
+ *  This method is used for moving the complete requests the
+ *  client sent into its queue, up to the queue limit. The
+ *  rest stays in the receive buffer for the next batch.
+ ***********************************************************/
+bool RenderServer::QueueRequests(CLIENT& client)
+{
+	size_t count = client.received.size() / sizeof(RENDER_REQUEST);
+	if (client.pending.size() + count > g_MaxPendingRequests)
+		count = (client.pending.size() < g_MaxPendingRequests) ? g_MaxPendingRequests - client.pending.size() : 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		RENDER_REQUEST request;
+		memcpy(&request, &client.received[i * sizeof(RENDER_REQUEST)], sizeof(request));
+		if (request.magic != RENDER_PROTOCOL_MAGIC)
+		{
+			std::cout << "[WARNING] Render client " << client.id << " sent an invalid request, disconnecting" << std::endl;
+			return false;
+		}
+		client.pending.push_back(request);
+	}
+	client.received.erase(client.received.begin(), client.received.begin() + count * sizeof(RENDER_REQUEST));
+	return true;
+}
+
+/***********************************************************
+ *  RenderBatch()
+ *
+ *  This method is used for rendering the requests of every
+ *  client in resolution order and reading each image back
+ *  into its place in the client's shared memory segment.
+ *  The responses follow once the whole batch is done.
+ ***********************************************************/
+void RenderServer::RenderBatch()
+{
+	// one view of the batch and where its image goes
+	struct BATCH_ENTRY
+	{
+		CLIENT*  pClient;
+		size_t   client;
+		size_t   request;
+		uint64_t imageOffset;
+	};
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<BATCH_ENTRY> batch;
+	std::vector<std::vector<RENDER_RESPONSE> > responses(m_clients.size());
+	size_t clientCount = 0;
+	uint64_t batchBytes = 0;
+	for (size_t i = 0; i < m_clients.size(); i++)
+	{
+		CLIENT& client = *m_clients[i];
+		if (client.pending.empty())
+			continue;
+		clientCount++;
+
+		uint64_t offset = 0;
+		size_t firstEntry = batch.size();
+		responses[i].resize(client.pending.size());
+		for (size_t r = 0; r < client.pending.size(); r++)
+		{
+			const RENDER_REQUEST& request = client.pending[r];
+			RENDER_RESPONSE& response = responses[i][r];
+			memset(&response, 0, sizeof(response));
+			response.magic = RENDER_PROTOCOL_MAGIC;
+			response.requestId = request.requestId;
+			response.status = RENDER_INVALID_REQUEST;
+			if (request.width < 1 || request.height < 1 || request.width > RENDER_MAX_SIZE || request.height > RENDER_MAX_SIZE)
+				continue;
+
+			uint64_t imageBytes = ((uint64_t)request.width * request.height * 4 + g_ImageAlignment - 1) / g_ImageAlignment * g_ImageAlignment;
+			if (batch.size() >= g_MaxBatchRequests || batchBytes + offset + imageBytes > g_MaxBatchBytes)
+			{
+				response.status = RENDER_BUSY;
+				continue;
+			}
+
+			BATCH_ENTRY entry = { &client, i, r, offset };
+			batch.push_back(entry);
+			offset += imageBytes;
+		}
+
+		if (offset > 0 && !ResizeSharedImage(client, (size_t)offset))
+		{
+			for (size_t e = firstEntry; e < batch.size(); e++)
+				responses[i][batch[e].request].status = RENDER_OUT_OF_MEMORY;
+			batch.resize(firstEntry);
+			continue;
+		}
+		batchBytes += offset;
+	}
+	if (clientCount == 0)
+		return;
+
+	// the render target is resized once per resolution of the batch
+	std::stable_sort(batch.begin(), batch.end(), [](const BATCH_ENTRY& a, const BATCH_ENTRY& b)
+	{
+		const RENDER_REQUEST& first = a.pClient->pending[a.request];
+		const RENDER_REQUEST& second = b.pClient->pending[b.request];
+		return (first.width != second.width) ? first.width < second.width : first.height < second.height;
+	});
+
+	for (size_t e = 0; e < batch.size(); e++)
+	{
+		const RENDER_REQUEST& request = batch[e].pClient->pending[batch[e].request];
+		RENDER_RESPONSE& response = responses[batch[e].client][batch[e].request];
+		if (!m_target.Resize(request.width, request.height))
+		{
+			response.status = RENDER_OUT_OF_MEMORY;
+			continue;
+		}
+
+		glm::vec3 cameraPos(request.cameraPos[0], request.cameraPos[1], request.cameraPos[2]);
+		glm::vec3 cameraFront(request.cameraFront[0], request.cameraFront[1], request.cameraFront[2]);
+		m_pSceneManager->RenderView(m_target, cameraPos, cameraFront);
+
+		// straight into the mapped segment, the only copy of the image
+		glReadBuffer(GL_COLOR_ATTACHMENT0 + SceneRenderTarget::COLOR_ATTACHMENT);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, request.width, request.height, GL_RGBA, GL_UNSIGNED_BYTE,
+			batch[e].pClient->image.pData + batch[e].imageOffset);
+
+		response.status = RENDER_OK;
+		response.width = request.width;
+		response.height = request.height;
+		response.rowBytes = (uint32_t)request.width * 4;
+		response.imageOffset = batch[e].imageOffset;
+		response.imageBytes = (uint64_t)request.width * request.height * 4;
+		memcpy(response.imageName, batch[e].pClient->image.name, sizeof(response.imageName));
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	for (size_t i = m_clients.size(); i > 0; i--)
+	{
+		CLIENT& client = *m_clients[i - 1];
+		if (client.pending.empty())
+			continue;
+		client.pending.clear();
+		if (!SendAll(client.socket, (const char*)&responses[i - 1][0], responses[i - 1].size() * sizeof(RENDER_RESPONSE)) ||
+			!QueueRequests(client))
+			CloseClient(i - 1);
+	}
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "[SERVE] batch of " << batch.size() << " views for " << clientCount << " clients in "
+		<< milliseconds << " ms" << std::endl;
+}
+
+/***********************************************************
+ *  ResizeSharedImage()
+ *
+ *  This method is used for making sure the shared memory
+ *  segment of the client holds the passed in size. A larger
+ *  segment is created under a new name, since a client may
+ *  still have the old one mapped.
+ ***********************************************************/
+bool RenderServer::ResizeSharedImage(CLIENT& client, size_t size)
+{
+	if (NULL != client.image.pData && client.image.size >= size)
+		return true;
+	if (m_sharedBytes - client.image.size + size > g_MaxSharedBytes)
+	{
+		std::cout << "[WARNING] Render server is over its shared image budget, the batch of client " << client.id << " is refused" << std::endl;
+		return false;
+	}
+
+	ReleaseSharedImage(client.image);
+	SHARED_IMAGE& image = client.image;
+	client.generation++;
+
+#if defined(_WIN32)
+	snprintf(image.name, sizeof(image.name), "Local\\scene_render.%u.%u.%u", GetProcessID(), client.id, client.generation);
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+		(DWORD)((uint64_t)size >> 32), (DWORD)((uint64_t)size & 0xFFFFFFFF), image.name);
+	void* pView = (NULL != mapping) ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : NULL;
+	if (NULL == pView)
+	{
+		if (NULL != mapping)
+			CloseHandle(mapping);
+		std::cout << "[ERROR] Could not create shared image " << image.name << std::endl;
+		return false;
+	}
+	image.handle = mapping;
+#else
+	snprintf(image.name, sizeof(image.name), "/scene_render.%u.%u.%u", GetProcessID(), client.id, client.generation);
+	int file = shm_open(image.name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	void* pView = MAP_FAILED;
+	if (file >= 0 && ftruncate(file, (off_t)size) == 0)
+		pView = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	if (file >= 0)
+		close(file);
+	if (pView == MAP_FAILED)
+	{
+		if (file >= 0)
+			shm_unlink(image.name);
+		std::cout << "[ERROR] Could not create shared image " << image.name << std::endl;
+		return false;
+	}
+#endif
+	image.pData = (char*)pView;
+	image.size = size;
+	m_sharedBytes += size;
+	return true;
+}
+
+/***********************************************************
+ *  ReleaseSharedImage()
+ *
+ *  This method is used for unmapping and removing a shared
+ *  memory segment. Clients that mapped it keep their view.
+ ***********************************************************/
+void RenderServer::ReleaseSharedImage(SHARED_IMAGE& image)
+{
+	if (NULL == image.pData)
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(image.pData);
+	CloseHandle((HANDLE)image.handle);
+#else
+	munmap(image.pData, image.size);
+	shm_unlink(image.name);
+#endif
+	m_sharedBytes -= image.size;
+	image.pData = NULL;
+	image.size = 0;
+	image.handle = NULL;
+}
+
+/***********************************************************
+ *  CloseClient()
+ *
+ *  This method is used for disconnecting a client and
+ *  releasing its shared memory segment.
+ ***********************************************************/
+void RenderServer::CloseClient(size_t index)
+{
+	CLIENT* pClient = m_clients[index];
+	CloseSocket(pClient->socket);
+	ReleaseSharedImage(pClient->image);
+	delete pClient;
+	m_clients.erase(m_clients.begin() + index);
+}
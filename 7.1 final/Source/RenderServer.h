@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderserver.h
+// ============
+// long-lived render service for tools, over a Unix domain socket
+//
+//	The scene is prepared once and stays resident. Clients connect to the
+//	socket and send fixed size RENDER_REQUEST records with a camera and a
+//	resolution; every request that arrived while the last batch rendered
+//	is rendered in the next one, sorted by resolution so the render
+//	target is resized once per size. The pixels are read back straight
+//	into a shared memory segment of the client, and the RENDER_RESPONSE
+//	names the segment and the offset of the image within it, so the image
+//	is never copied through the socket. The images of a response stay
+//	valid until the client sends its next request.
+//
+//	A single client must not be able to make the server map gigabytes:
+//	the number of clients, the requests queued per client, the views per
+//	batch and the bytes per batch and of all segments are capped. A
+//	request over the batch limits is answered with RENDER_BUSY.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "SceneManager.h"
+#include "SceneRenderTarget.h"
+
+// "RNDR", the first field of every request and response
+const uint32_t RENDER_PROTOCOL_MAGIC = 0x52444E52;
+const int RENDER_IMAGE_NAME_LENGTH = 64;
+// largest width or height a client can request
+const int RENDER_MAX_SIZE = 8192;
+
+// one view to render, sent by the client
+struct RENDER_REQUEST
+{
+	uint32_t magic;
+	uint32_t requestId;         // returned in the response
+	int32_t  width;
+	int32_t  height;
+	float    cameraPos[3];
+	float    cameraFront[3];
+};
+
+enum RENDER_STATUS
+{
+	RENDER_OK = 0,
+	RENDER_INVALID_REQUEST,
+	RENDER_OUT_OF_MEMORY,
+	RENDER_BUSY                 // over the batch limits, send it again
+};
+
+// where the image of a request was written, sent back by the server
+struct RENDER_RESPONSE
+{
+	uint32_t magic;
+	uint32_t requestId;
+	int32_t  status;            // RENDER_STATUS
+	int32_t  width;
+	int32_t  height;
+	uint32_t rowBytes;          // RGBA8 rows, bottom row first
+	uint64_t imageOffset;       // within the shared memory segment
+	uint64_t imageBytes;
+	char     imageName[RENDER_IMAGE_NAME_LENGTH];  // segment to map
+};
+
+class RenderServer
+{
+public:
+	// constructor
+	RenderServer(SceneManager* pSceneManager);
+	// destructor
+	~RenderServer();
+
+	// listen on the passed in socket path, a stale socket file is replaced
+	bool Start(const char* socketPath);
+	void Stop();
+
+	// accept clients and read their requests for up to the passed in time,
+	// then render everything received as one batch; false on a fatal error
+	bool Poll(int timeoutMilliseconds);
+
+private:
+	// shared memory segment the images of one client are read back into
+	struct SHARED_IMAGE
+	{
+		char*       pData;
+		size_t      size;
+		void*       handle;
+		char        name[RENDER_IMAGE_NAME_LENGTH];
+	};
+
+	// a connected client, its partial request and its requests of the batch
+	struct CLIENT
+	{
+		uintptr_t                   socket;
+		unsigned int                id;
+		unsigned int                generation;
+		std::vector<char>           received;
+		std::vector<RENDER_REQUEST> pending;
+		SHARED_IMAGE                image;
+	};
+
+	SceneManager*           m_pSceneManager;
+	SceneRenderTarget       m_target;
+	uintptr_t               m_listenSocket;
+	std::string             m_socketPath;
+	std::vector<CLIENT*>    m_clients;
+	unsigned int            m_nextClientId;
+	size_t                  m_sharedBytes;
+	bool                    m_bSocketsStarted;
+
+	bool ReceiveRequests(CLIENT& client);
+	bool QueueRequests(CLIENT& client);
+	void RenderBatch();
+	bool ResizeSharedImage(CLIENT& client, size_t size);
+	void ReleaseSharedImage(SHARED_IMAGE& image);
+	void CloseClient(size_t index);
+};
@@ -8,15 +8,19 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
-
-#ifndef STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-#endif
+#include "AllocationTracker.h"
+#include "ComputeProgram.h"
+#include "GLDebugOutput.h"
+#include "GLTrace.h"
+#include "ImageDecoder.h"
 
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <GLFW/glfw3.h>  //  MOUSE/KEYBOARD/GLFW FUNCTIONS
 #include <iostream>      //  For debug output
+#include <algorithm>
+#include <cstring>
+#include <utility>
 
 // declaration of global variables
 namespace
@@ -26,6 +30,123 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_ObjectIDName = "objectID";
+	const char* g_ObjectTransformsName = "bObjectTransforms";
+	const char* g_ObjectIndexName = "objectIndex";
+
+	// background color of the scene
+	const glm::vec4 g_ClearColor(0.05f, 0.05f, 0.1f, 1.0f);
+
+	// texture units BindGLTextures fills, one per loaded texture; the
+	// volume of the volumetric lighting keeps the unit above them
+	const size_t g_MaxTextureUnits = VolumetricLighting::VOLUME_TEXTURE_UNIT;
+
+	// number of frames between GPU pass timing reports
+	const unsigned int g_TimingReportInterval = 300;
+
+	// uniform names of the point lights, in POINT_LIGHT member order
+	const char* const g_PointLightNames[2][7] = {
+		{ "pointLight.position", "pointLight.ambient", "pointLight.diffuse", "pointLight.specular",
+		  "pointLight.constant", "pointLight.linear", "pointLight.quadratic" },
+		{ "pointLight2.position", "pointLight2.ambient", "pointLight2.diffuse", "pointLight2.specular",
+		  "pointLight2.constant", "pointLight2.linear", "pointLight2.quadratic" } };
+
+	void SetPointLightUniforms(ShaderManager* pShaderManager, const char* const names[7], const StaticLightBaker::POINT_LIGHT& light)
+	{
+		pShaderManager->setVec3Value(names[0], light.position);
+		pShaderManager->setVec3Value(names[1], light.ambient);
+		pShaderManager->setVec3Value(names[2], light.diffuse);
+		pShaderManager->setVec3Value(names[3], light.specular);
+		pShaderManager->setFloatValue(names[4], light.constant);
+		pShaderManager->setFloatValue(names[5], light.linear);
+		pShaderManager->setFloatValue(names[6], light.quadratic);
+	}
+
+	// names of the scene description chunks in a warm start snapshot
+	const char* g_SnapshotMaterialsName = "materials";
+	const char* g_SnapshotObjectsName = "objects";
+
+	// copies a tag into a snapshot record, false when it does not fit
+	bool CopySnapshotTag(char (&destination)[SNAPSHOT_NAME_LENGTH], const std::string& tag)
+	{
+		if (tag.size() >= SNAPSHOT_NAME_LENGTH)
+			return false;
+		memset(destination, 0, SNAPSHOT_NAME_LENGTH);
+		memcpy(destination, tag.c_str(), tag.size());
+		return true;
+	}
+
+	// prints the hardware counters recorded for a CPU stage
+	void ReportHardwareCounters(const CpuTimer& timer)
+	{
+		if (!timer.HasHardwareCounters())
+			return;
+
+		std::cout << "[PERF] " << timer.GetName() << ":";
+		for (int i = 0; i < PerfCounters::COUNTER_COUNT; i++)
+		{
+			PerfCounters::COUNTER counter = (PerfCounters::COUNTER)i;
+			if (PerfCounters::IsCounterAvailable(counter))
+				std::cout << " " << PerfCounters::GetCounterName(counter) << " " << (uint64_t)timer.GetAverageCounter(counter);
+		}
+		double cycles = timer.GetAverageCounter(PerfCounters::CYCLES);
+		if (cycles > 0.0 && PerfCounters::IsCounterAvailable(PerfCounters::INSTRUCTIONS))
+			std::cout << " (IPC " << timer.GetAverageCounter(PerfCounters::INSTRUCTIONS) / cycles << ")";
+		std::cout << std::endl;
+	}
+
+	// conservative object space bounds of the basic meshes
+	const glm::vec3 g_MeshBoundsMin[] = {
+		glm::vec3(-1.0f, 0.0f, -1.0f),      // plane
+		glm::vec3(-1.0f, 0.0f, -1.0f),      // cylinder
+		glm::vec3(-1.5f, -1.5f, -0.5f) };   // torus
+	const glm::vec3 g_MeshBoundsMax[] = {
+		glm::vec3(1.0f, 0.0f, 1.0f),
+		glm::vec3(1.0f, 1.0f, 1.0f),
+		glm::vec3(1.5f, 1.5f, 0.5f) };
+
+	glm::mat4 BuildModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ)
+	{
+		glm::mat4 scale = glm::scale(scaleXYZ);
+		glm::mat4 rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::mat4 rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat4 translation = glm::translate(positionXYZ);
+
+		return translation * rotationX * rotationY * rotationZ * scale;
+	}
+
+	// the rotation of BuildModelMatrix as a quaternion
+	glm::quat BuildRotation(const glm::vec3& rotationDegrees)
+	{
+		return glm::angleAxis(glm::radians(rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f))
+			* glm::angleAxis(glm::radians(rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f))
+			* glm::angleAxis(glm::radians(rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+	}
+
+	// interleave the low 10 bits of v with two zero bits each
+	uint32_t SpreadBits(uint32_t v)
+	{
+		v &= 0x3ff;
+		v = (v | (v << 16)) & 0x030000ff;
+		v = (v | (v << 8)) & 0x0300f00f;
+		v = (v | (v << 4)) & 0x030c30c3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	}
+
+	// storage order of the scene objects, Morton code or authored order
+	bool ComesBefore(const SceneManager::SCENE_OBJECT& a, const SceneManager::SCENE_OBJECT& b, bool bSpatialOrder)
+	{
+		if (bSpatialOrder && a.mortonCode != b.mortonCode)
+			return a.mortonCode < b.mortonCode;
+		return a.id < b.id;
+	}
 }
 
 /***********************************************************
@@ -34,9 +155,68 @@ namespace
  *  The constructor for the class
  ***********************************************************/
 SceneManager::SceneManager(ShaderManager* pShaderManager)
+	: m_mainPassTimer("Main pass"),
+	  m_fullRateTimer("Main pass (full rate reference)"),
+	  m_cullTimer("Cull"),
+	  m_drawListTimer("Draw list submission"),
+	  m_frameTimer("RenderScene")
 {
 	m_pShaderManager = pShaderManager;
 	m_basicMeshes = new ShapeMeshes();
+	m_pVolumetricLighting = NULL;
+	m_bUseVolumetrics = true;
+	m_frameCount = 0;
+	m_volumetricTask = -1;
+	m_frameDrawCalls = 0;
+	m_pRenderTarget = NULL;
+	m_pReflections = NULL;
+	m_bUseReflections = false;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_pCheckerboard = NULL;
+	m_bUseCheckerboard = false;
+	m_bCompareCheckerboard = false;
+	m_previousViewProjection = glm::mat4(1.0f);
+	m_pOcclusionCuller = NULL;
+	m_bUseOcclusionCulling = true;
+	m_bOcclusionDraws = false;
+	m_bUseSpatialOrder = true;
+	m_bSpatialOrderDirty = false;
+	m_bSceneBoundsValid = false;
+	m_sceneBoundsMin = glm::vec3(0.0f);
+	m_sceneBoundsMax = glm::vec3(0.0f);
+	m_pLightBaker = NULL;
+	m_pDynamicShaderManager = pShaderManager;
+	m_pVertexArena = NULL;
+	m_pGpuTransforms = NULL;
+	m_bSnapshotComplete = false;
+
+	// Directional Light — soft overhead lighting
+	m_sceneLights.dirLight.bStatic = true;
+	m_sceneLights.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.1f);
+	m_sceneLights.dirLight.ambient = glm::vec3(0.4f);  // brighter ambient
+	m_sceneLights.dirLight.diffuse = glm::vec3(0.7f);
+	m_sceneLights.dirLight.specular = glm::vec3(0.7f);
+
+	// Front Fill Light — simulate camera-facing lighting
+	m_sceneLights.pointLight.bStatic = true;
+	m_sceneLights.pointLight.position = glm::vec3(0.0f, 4.0f, 6.0f);  // move forward slightly
+	m_sceneLights.pointLight.ambient = glm::vec3(0.25f);
+	m_sceneLights.pointLight.diffuse = glm::vec3(0.75f);
+	m_sceneLights.pointLight.specular = glm::vec3(1.0f);
+	m_sceneLights.pointLight.constant = 1.0f;
+	m_sceneLights.pointLight.linear = 0.09f;
+	m_sceneLights.pointLight.quadratic = 0.032f;
+
+	// Rim Light — subtle warm glow
+	m_sceneLights.pointLight2.bStatic = true;
+	m_sceneLights.pointLight2.position = glm::vec3(-4.0f, 3.0f, -2.0f);
+	m_sceneLights.pointLight2.ambient = glm::vec3(0.08f, 0.04f, 0.02f);
+	m_sceneLights.pointLight2.diffuse = glm::vec3(0.3f, 0.15f, 0.08f);
+	m_sceneLights.pointLight2.specular = glm::vec3(0.4f, 0.2f, 0.1f);
+	m_sceneLights.pointLight2.constant = 1.0f;
+	m_sceneLights.pointLight2.linear = 0.14f;
+	m_sceneLights.pointLight2.quadratic = 0.07f;
 }
 
 /***********************************************************
@@ -47,8 +227,50 @@ SceneManager::SceneManager(ShaderManager* pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
+	m_pDynamicShaderManager = NULL;
+	if (NULL != m_pLightBaker)
+	{
+		delete m_pLightBaker;
+		m_pLightBaker = NULL;
+	}
+	if (NULL != m_pVertexArena)
+	{
+		delete m_pVertexArena;
+		m_pVertexArena = NULL;
+	}
+	if (NULL != m_pGpuTransforms)
+	{
+		delete m_pGpuTransforms;
+		m_pGpuTransforms = NULL;
+	}
+	PerfCounters::Shutdown();
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	if (NULL != m_pVolumetricLighting)
+	{
+		delete m_pVolumetricLighting;
+		m_pVolumetricLighting = NULL;
+	}
+	if (NULL != m_pReflections)
+	{
+		delete m_pReflections;
+		m_pReflections = NULL;
+	}
+	if (NULL != m_pCheckerboard)
+	{
+		delete m_pCheckerboard;
+		m_pCheckerboard = NULL;
+	}
+	if (NULL != m_pOcclusionCuller)
+	{
+		delete m_pOcclusionCuller;
+		m_pOcclusionCuller = NULL;
+	}
+	if (NULL != m_pRenderTarget)
+	{
+		delete m_pRenderTarget;
+		m_pRenderTarget = NULL;
+	}
 }
 
 /***********************************************************
@@ -61,17 +283,36 @@ SceneManager::~SceneManager()
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
 	GLuint textureID = 0;
 
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char* image = stbi_load(filename, &width, &height, &colorChannels, 0);
+	GLDebugOutput::Scope debugScope("CreateGLTexture");
+	if (m_textureIDs.GetCount() >= g_MaxTextureUnits)
+	{
+		std::cout << "[ERROR] No texture unit left for " << filename << ", at most " << g_MaxTextureUnits
+			<< " textures can be loaded" << std::endl;
+		return false;
+	}
+	m_spikeDetector.BeginResourceLoad();
 
-	if (image)
+	// a warm start uploads the finished mip chain from the snapshot
+	if (m_snapshot.IsMapped())
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+		if (LoadSnapshotTexture(filename, tag))
+		{
+			m_spikeDetector.EndResourceLoad();
+			return true;
+		}
+		m_bSnapshotComplete = false;
+	}
+
+	DECODED_IMAGE image;
+	if (ImageDecoder::Decode(filename, image))
+	{
+		int width = image.width;
+		int height = image.height;
+		int colorChannels = image.channels;
+		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels
+			<< ", decoder:" << ImageDecoder::GetDecoderName(image.decoder) << std::endl;
 
 		glGenTextures(1, &textureID);
 		glBindTexture(GL_TEXTURE_2D, textureID);
@@ -82,29 +323,101 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.pPixels);
 		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pPixels);
 		else
 		{
 			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+			ImageDecoder::Free(image);
+			m_spikeDetector.EndResourceLoad();
 			return false;
 		}
+		m_spikeDetector.RecordTextureUpload(filename, (uint64_t)width * height * colorChannels);
 
 		glGenerateMipmap(GL_TEXTURE_2D);
-		stbi_image_free(image);
+		ImageDecoder::Free(image);
 		glBindTexture(GL_TEXTURE_2D, 0);
 
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+		TEXTURE_INFO* pTexture = m_textureIDs.Allocate();
+		pTexture->ID = textureID;
+		pTexture->tag = tag;
+		pTexture->file = filename;
 
+		m_spikeDetector.EndResourceLoad();
 		return true;
 	}
 
 	std::cout << "Could not load image:" << filename << std::endl;
+	m_spikeDetector.EndResourceLoad();
 	return false;
 }
+
+/***********************************************************
+ *  LoadSnapshotTexture()
+ *
+ *  This method is used for creating a texture from the mip
+ *  chain a warm start snapshot holds for the passed in tag,
+ *  as long as the image file has not changed since. The
+ *  levels are uploaded straight from the mapped file, with
+ *  no decoding and no mipmap generation.
+ ***********************************************************/
+bool SceneManager::LoadSnapshotTexture(const char* filename, const std::string& tag)
+{
+	size_t size = 0;
+	const char* pChunk = (const char*)m_snapshot.FindChunk(SNAPSHOT_TEXTURE, tag.c_str(), &size);
+	const SNAPSHOT_TEXTURE_HEADER* pHeader = (const SNAPSHOT_TEXTURE_HEADER*)pChunk;
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if (NULL == pHeader || size < sizeof(SNAPSHOT_TEXTURE_HEADER) ||
+		!SceneSnapshot::GetFileStamp(filename, sourceSize, sourceTime) ||
+		pHeader->sourceSize != sourceSize || pHeader->sourceTime != sourceTime ||
+		pHeader->levels < 1 || pHeader->levels > SNAPSHOT_TEXTURE_HEADER::MAX_LEVELS ||
+		(pHeader->format != GL_RGB && pHeader->format != GL_RGBA))
+	{
+		return false;
+	}
+
+	int channels = (pHeader->format == GL_RGBA) ? 4 : 3;
+	uint64_t totalBytes = 0;
+	for (int level = 0; level < pHeader->levels; level++)
+	{
+		uint64_t levelBytes = (uint64_t)std::max(pHeader->width >> level, 1) * std::max(pHeader->height >> level, 1) * channels;
+		if (pHeader->levelSizes[level] != levelBytes || pHeader->levelOffsets[level] > size ||
+			levelBytes > size - pHeader->levelOffsets[level])
+		{
+			return false;
+		}
+		totalBytes += levelBytes;
+	}
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pHeader->levels - 1);
+
+	// the levels are stored with tightly packed rows
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int level = 0; level < pHeader->levels; level++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, pHeader->internalFormat, std::max(pHeader->width >> level, 1),
+			std::max(pHeader->height >> level, 1), 0, pHeader->format, GL_UNSIGNED_BYTE, pChunk + pHeader->levelOffsets[level]);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	m_spikeDetector.RecordTextureUpload(filename, totalBytes);
+
+	TEXTURE_INFO* pTexture = m_textureIDs.Allocate();
+	pTexture->ID = textureID;
+	pTexture->tag = tag;
+	pTexture->file = filename;
+	return true;
+}
 /***********************************************************
  *  BindGLTextures()
  *
@@ -113,10 +426,10 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	for (const TEXTURE_INFO& texture : m_textureIDs)
 	{
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		glActiveTexture(GL_TEXTURE0 + (GLenum)m_textureIDs.GetIndex(&texture));
+		glBindTexture(GL_TEXTURE_2D, texture.ID);
 	}
 }
 
@@ -128,10 +441,11 @@ void SceneManager::BindGLTextures()
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	for (const TEXTURE_INFO& texture : m_textureIDs)
 	{
-		glDeleteTextures(1, &m_textureIDs[i].ID);
+		glDeleteTextures(1, &texture.ID);
 	}
+	m_textureIDs.Clear();
 }
 
 /***********************************************************
@@ -142,22 +456,13 @@ void SceneManager::DestroyGLTextures()
  ***********************************************************/
 int SceneManager::FindTextureID(std::string tag)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	for (const TEXTURE_INFO& texture : m_textureIDs)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
+		if (texture.tag.compare(tag) == 0)
+			return((int)texture.ID);
 	}
 
-	return(textureID);
+	return(-1);
 }
 
 /***********************************************************
@@ -168,22 +473,13 @@ int SceneManager::FindTextureID(std::string tag)
  ***********************************************************/
 int SceneManager::FindTextureSlot(std::string tag)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	for (const TEXTURE_INFO& texture : m_textureIDs)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		if (texture.tag.compare(tag) == 0)
+			return((int)m_textureIDs.GetIndex(&texture));
 	}
 
-	return(textureSlot);
+	return(-1);
 }
 /***********************************************************
  *  FindMaterial()
@@ -193,24 +489,15 @@ int SceneManager::FindTextureSlot(std::string tag)
  ***********************************************************/
 bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.empty())
-		return false;
-
-	int index = 0;
-	bool bFound = false;
-	while (index < m_objectMaterials.size() && !bFound)
+	for (const OBJECT_MATERIAL& candidate : m_objectMaterials)
 	{
-		if (m_objectMaterials[index].tag == tag)
-		{
-			bFound = true;
-			material = m_objectMaterials[index];
-		}
-		else
+		if (candidate.tag == tag)
 		{
-			index++;
+			material = candidate;
+			return true;
 		}
 	}
-	return bFound;
+	return false;
 }
 
 /***********************************************************
@@ -226,17 +513,12 @@ void SceneManager::SetTransformations(
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
 {
-	glm::mat4 modelView;
-	glm::mat4 scale = glm::scale(scaleXYZ);
-	glm::mat4 rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	glm::mat4 rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	glm::mat4 rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	glm::mat4 translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
+	glm::mat4 modelView = BuildModelMatrix(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
 
 	if (m_pShaderManager != NULL)
+	{
 		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+	}
 }
 
 /***********************************************************
@@ -268,6 +550,8 @@ void SceneManager::SetShaderColor(
  ***********************************************************/
 void SceneManager::SetShaderTexture(std::string textureTag)
 {
+	GLDebugOutput::Scope debugScope("SetShaderTexture");
+	AllocationTracker::Scope allocationScope("SetShaderTexture");
 	if (m_pShaderManager != NULL)
 	{
 		m_pShaderManager->setIntValue(g_UseTextureName, true);
@@ -296,7 +580,9 @@ void SceneManager::SetTextureUVScale(float u, float v)
  ***********************************************************/
 void SceneManager::SetShaderMaterial(std::string materialTag)
 {
-	if (!m_objectMaterials.empty())
+	GLDebugOutput::Scope debugScope("SetShaderMaterial");
+	AllocationTracker::Scope allocationScope("SetShaderMaterial");
+	if (m_objectMaterials.GetCount() > 0)
 	{
 		OBJECT_MATERIAL material;
 		if (FindMaterial(materialTag, material))
@@ -333,41 +619,760 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
  ***********************************************************/
 void SceneManager::SetupSceneLights(const glm::vec3& cameraPos, const glm::vec3& cameraFront)
 {
-	// Directional Light — soft overhead lighting
-	m_pShaderManager->setVec3Value("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.1f));
-	m_pShaderManager->setVec3Value("dirLight.ambient", glm::vec3(0.4f));  // brighter ambient
-	m_pShaderManager->setVec3Value("dirLight.diffuse", glm::vec3(0.7f));
-	m_pShaderManager->setVec3Value("dirLight.specular", glm::vec3(0.7f));
-
-	// Front Fill Light — simulate camera-facing lighting
-	m_pShaderManager->setVec3Value("pointLight.position", glm::vec3(0.0f, 4.0f, 6.0f));  // move forward slightly
-	m_pShaderManager->setVec3Value("pointLight.ambient", glm::vec3(0.25f));
-	m_pShaderManager->setVec3Value("pointLight.diffuse", glm::vec3(0.75f));
-	m_pShaderManager->setVec3Value("pointLight.specular", glm::vec3(1.0f));
-	m_pShaderManager->setFloatValue("pointLight.constant", 1.0f);
-	m_pShaderManager->setFloatValue("pointLight.linear", 0.09f);
-	m_pShaderManager->setFloatValue("pointLight.quadratic", 0.032f);
+	// static lights are constants of a baked program, the program
+	// loaded by the application reads every light from uniforms
+	bool bBaked = (m_pShaderManager != m_pDynamicShaderManager);
 
-	// Rim Light — subtle warm glow
-	m_pShaderManager->setVec3Value("pointLight2.position", glm::vec3(-4.0f, 3.0f, -2.0f));
-	m_pShaderManager->setVec3Value("pointLight2.ambient", glm::vec3(0.08f, 0.04f, 0.02f));
-	m_pShaderManager->setVec3Value("pointLight2.diffuse", glm::vec3(0.3f, 0.15f, 0.08f));
-	m_pShaderManager->setVec3Value("pointLight2.specular", glm::vec3(0.4f, 0.2f, 0.1f));
-	m_pShaderManager->setFloatValue("pointLight2.constant", 1.0f);
-	m_pShaderManager->setFloatValue("pointLight2.linear", 0.14f);
-	m_pShaderManager->setFloatValue("pointLight2.quadratic", 0.07f);
-
-	// Spotlight (Camera torch effect)
-	m_pShaderManager->setVec3Value("spotLight.position", cameraPos);
-	m_pShaderManager->setVec3Value("spotLight.direction", cameraFront);
-	m_pShaderManager->setFloatValue("spotLight.cutOff", glm::cos(glm::radians(10.0f)));
-	m_pShaderManager->setFloatValue("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+	const StaticLightBaker::DIRECTIONAL_LIGHT& dirLight = m_sceneLights.dirLight;
+	if (!bBaked || !dirLight.bStatic)
+	{
+		m_pShaderManager->setVec3Value("dirLight.direction", dirLight.direction);
+		m_pShaderManager->setVec3Value("dirLight.ambient", dirLight.ambient);
+		m_pShaderManager->setVec3Value("dirLight.diffuse", dirLight.diffuse);
+		m_pShaderManager->setVec3Value("dirLight.specular", dirLight.specular);
+	}
+	if (!bBaked || !m_sceneLights.pointLight.bStatic)
+		SetPointLightUniforms(m_pShaderManager, g_PointLightNames[0], m_sceneLights.pointLight);
+	if (!bBaked || !m_sceneLights.pointLight2.bStatic)
+		SetPointLightUniforms(m_pShaderManager, g_PointLightNames[1], m_sceneLights.pointLight2);
+
+	// Spotlight (Camera torch effect) - also drives the volumetric light shafts
+	m_spotLight.position = cameraPos;
+	m_spotLight.direction = cameraFront;
+	m_spotLight.cutOff = glm::cos(glm::radians(10.0f));
+	m_spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+	m_spotLight.diffuse = glm::vec3(0.8f);
+	m_spotLight.constant = 1.0f;
+	m_spotLight.linear = 0.09f;
+	m_spotLight.quadratic = 0.032f;
+
+	m_pShaderManager->setVec3Value("spotLight.position", m_spotLight.position);
+	m_pShaderManager->setVec3Value("spotLight.direction", m_spotLight.direction);
+	m_pShaderManager->setFloatValue("spotLight.cutOff", m_spotLight.cutOff);
+	m_pShaderManager->setFloatValue("spotLight.outerCutOff", m_spotLight.outerCutOff);
 	m_pShaderManager->setVec3Value("spotLight.ambient", glm::vec3(0.15f));
-	m_pShaderManager->setVec3Value("spotLight.diffuse", glm::vec3(0.8f));
+	m_pShaderManager->setVec3Value("spotLight.diffuse", m_spotLight.diffuse);
 	m_pShaderManager->setVec3Value("spotLight.specular", glm::vec3(1.0f));
-	m_pShaderManager->setFloatValue("spotLight.constant", 1.0f);
-	m_pShaderManager->setFloatValue("spotLight.linear", 0.09f);
-	m_pShaderManager->setFloatValue("spotLight.quadratic", 0.032f);
+	m_pShaderManager->setFloatValue("spotLight.constant", m_spotLight.constant);
+	m_pShaderManager->setFloatValue("spotLight.linear", m_spotLight.linear);
+	m_pShaderManager->setFloatValue("spotLight.quadratic", m_spotLight.quadratic);
+}
+
+/***********************************************************
+ *  EnableVertexPulling()
+ *
+ *  This method is used for loading the vertex pulling
+ *  program from the passed in shader files. The meshes are
+ *  moved into the arena, and the scene switches to the
+ *  program, once PrepareScene has loaded them.
+ ***********************************************************/
+bool SceneManager::EnableVertexPulling(const char* pulledShaderFile, const char* fragmentShaderFile)
+{
+	if (NULL != m_pVertexArena)
+		return true;
+
+	m_pVertexArena = new VertexPullingArena();
+	if (!m_pVertexArena->Initialize(pulledShaderFile, fragmentShaderFile))
+	{
+		delete m_pVertexArena;
+		m_pVertexArena = NULL;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  UseSnapshot()
+ *
+ *  These methods are used for mapping the warm start snapshot
+ *  PrepareScene restores the scene from. When the file is
+ *  missing or out of date the scene is prepared as usual
+ *  and written to it afterwards; a snapshot mapped by the
+ *  caller is only read.
+ ***********************************************************/
+bool SceneManager::UseSnapshot(const char* filename)
+{
+	// a warm start skips the calls a trace should replay
+	if (GLTrace::IsRecording())
+	{
+		std::cout << "[WARNING] The scene snapshot is not used while a GL trace is recording" << std::endl;
+		return false;
+	}
+
+	m_snapshotFile = filename;
+	m_bSnapshotComplete = m_snapshot.Map(filename);
+	if (m_bSnapshotComplete)
+		ComputeProgram::SetSnapshot(&m_snapshot);
+	if (m_bSnapshotComplete && !m_snapshot.IsFromThisBuild())
+		std::cout << "[STARTUP] scene snapshot is from another build, the scene is defined again" << std::endl;
+	return m_bSnapshotComplete;
+}
+
+bool SceneManager::UseSnapshot(const SceneSnapshot& snapshot)
+{
+	if (GLTrace::IsRecording())
+	{
+		std::cout << "[WARNING] The scene snapshot is not used while a GL trace is recording" << std::endl;
+		return false;
+	}
+
+	m_snapshot.Share(snapshot);
+	m_bSnapshotComplete = m_snapshot.IsMapped();
+	if (m_bSnapshotComplete)
+		ComputeProgram::SetSnapshot(&m_snapshot);
+	return m_bSnapshotComplete;
+}
+
+/***********************************************************
+ *  RestoreMaterials() / RestoreSceneObjects()
+ *
+ *  These methods are used for restoring the material table
+ *  and the scene objects from the snapshot. They return
+ *  false on a cold start, when PrepareScene defines them,
+ *  and when another build wrote the snapshot.
+ ***********************************************************/
+bool SceneManager::RestoreMaterials()
+{
+	size_t size = 0;
+	const SNAPSHOT_MATERIAL* pMaterials =
+		(const SNAPSHOT_MATERIAL*)m_snapshot.FindChunk(SNAPSHOT_MATERIALS, g_SnapshotMaterialsName, &size);
+	if (NULL == pMaterials || size % sizeof(SNAPSHOT_MATERIAL) != 0 || !m_snapshot.IsFromThisBuild())
+	{
+		m_bSnapshotComplete = false;
+		return false;
+	}
+
+	for (size_t i = 0; i < size / sizeof(SNAPSHOT_MATERIAL); i++)
+	{
+		const SNAPSHOT_MATERIAL& record = pMaterials[i];
+		OBJECT_MATERIAL material;
+		material.tag = std::string(record.tag, strnlen(record.tag, SNAPSHOT_NAME_LENGTH));
+		material.ambientStrength = record.ambientStrength;
+		material.ambientColor = glm::vec3(record.ambientColor[0], record.ambientColor[1], record.ambientColor[2]);
+		material.diffuseColor = glm::vec3(record.diffuseColor[0], record.diffuseColor[1], record.diffuseColor[2]);
+		material.specularColor = glm::vec3(record.specularColor[0], record.specularColor[1], record.specularColor[2]);
+		material.shininess = record.shininess;
+		m_objectMaterials.Allocate(material);
+	}
+	return true;
+}
+
+bool SceneManager::RestoreSceneObjects()
+{
+	size_t size = 0;
+	const SNAPSHOT_OBJECT* pObjects =
+		(const SNAPSHOT_OBJECT*)m_snapshot.FindChunk(SNAPSHOT_OBJECTS, g_SnapshotObjectsName, &size);
+	bool bValid = (NULL != pObjects && size % sizeof(SNAPSHOT_OBJECT) == 0 && m_snapshot.IsFromThisBuild());
+	for (size_t i = 0; bValid && i < size / sizeof(SNAPSHOT_OBJECT); i++)
+		bValid = (pObjects[i].mesh >= MESH_PLANE && pObjects[i].mesh <= MESH_TORUS);
+	if (!bValid)
+	{
+		m_bSnapshotComplete = false;
+		return false;
+	}
+
+	// in ID order, so the objects keep their IDs
+	for (size_t i = 0; i < size / sizeof(SNAPSHOT_OBJECT); i++)
+	{
+		const SNAPSHOT_OBJECT& record = pObjects[i];
+		AddSceneObject(std::string(record.tag, strnlen(record.tag, SNAPSHOT_NAME_LENGTH)), (MESH_TYPE)record.mesh,
+			glm::vec3(record.scaleXYZ[0], record.scaleXYZ[1], record.scaleXYZ[2]),
+			glm::vec3(record.rotationDegrees[0], record.rotationDegrees[1], record.rotationDegrees[2]),
+			glm::vec3(record.positionXYZ[0], record.positionXYZ[1], record.positionXYZ[2]),
+			glm::vec4(record.color[0], record.color[1], record.color[2], record.color[3]),
+			std::string(record.textureTag, strnlen(record.textureTag, SNAPSHOT_NAME_LENGTH)),
+			glm::vec2(record.uvScale[0], record.uvScale[1]),
+			std::string(record.materialTag, strnlen(record.materialTag, SNAPSHOT_NAME_LENGTH)));
+	}
+	return true;
+}
+
+/***********************************************************
+ *  FinishSnapshot()
+ *
+ *  This method is used for releasing the mapped snapshot at
+ *  the end of PrepareScene, or, after a cold start or when
+ *  any part of it was out of date, writing a new one with
+ *  the textures read back from the GPU, the material table,
+ *  the scene objects, the compute program binaries and the
+ *  vertex pulling arena.
+ ***********************************************************/
+void SceneManager::FinishSnapshot()
+{
+	if (m_snapshotFile.empty() && !m_snapshot.IsMapped())
+		return;
+
+	m_bSnapshotComplete = m_snapshot.IsMapped() && m_bSnapshotComplete && ComputeProgram::GetSnapshotMisses() == 0;
+	ComputeProgram::SetSnapshot(NULL);
+	m_snapshot.Unmap();
+	if (m_bSnapshotComplete || m_snapshotFile.empty())
+		return;
+
+	SceneSnapshot snapshot;
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	for (const TEXTURE_INFO& texture : m_textureIDs)
+	{
+		SNAPSHOT_TEXTURE_HEADER header;
+		memset(&header, 0, sizeof(header));
+		if (texture.tag.size() >= SNAPSHOT_NAME_LENGTH ||
+			!SceneSnapshot::GetFileStamp(texture.file.c_str(), header.sourceSize, header.sourceTime))
+		{
+			continue;
+		}
+
+		GLint internalFormat = 0;
+		glBindTexture(GL_TEXTURE_2D, texture.ID);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &header.width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &header.height);
+		header.internalFormat = internalFormat;
+		header.format = (internalFormat == GL_RGBA8) ? GL_RGBA : GL_RGB;
+		int channels = (header.format == GL_RGBA) ? 4 : 3;
+
+		// the complete chain glGenerateMipmap built, down to 1x1
+		uint64_t offset = (sizeof(header) + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+		for (int size = std::max(header.width, header.height); size > 0 && header.levels < SNAPSHOT_TEXTURE_HEADER::MAX_LEVELS; size >>= 1)
+		{
+			int level = header.levels++;
+			header.levelOffsets[level] = offset;
+			header.levelSizes[level] = (uint64_t)std::max(header.width >> level, 1) * std::max(header.height >> level, 1) * channels;
+			offset = (offset + header.levelSizes[level] + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+		}
+
+		std::vector<char> chunk((size_t)offset);
+		memcpy(&chunk[0], &header, sizeof(header));
+		for (int level = 0; level < header.levels; level++)
+			glGetTexImage(GL_TEXTURE_2D, level, header.format, GL_UNSIGNED_BYTE, &chunk[(size_t)header.levelOffsets[level]]);
+		snapshot.AddChunk(SNAPSHOT_TEXTURE, texture.tag.c_str(), &chunk[0], chunk.size());
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	bool bTagsFit = true;
+	std::vector<SNAPSHOT_MATERIAL> materials(m_objectMaterials.GetCount());
+	size_t materialIndex = 0;
+	for (const OBJECT_MATERIAL& material : m_objectMaterials)
+	{
+		SNAPSHOT_MATERIAL& record = materials[materialIndex++];
+		bTagsFit = CopySnapshotTag(record.tag, material.tag) && bTagsFit;
+		record.ambientStrength = material.ambientStrength;
+		memcpy(record.ambientColor, glm::value_ptr(material.ambientColor), sizeof(record.ambientColor));
+		memcpy(record.diffuseColor, glm::value_ptr(material.diffuseColor), sizeof(record.diffuseColor));
+		memcpy(record.specularColor, glm::value_ptr(material.specularColor), sizeof(record.specularColor));
+		record.shininess = material.shininess;
+	}
+
+	// in ID order, the storage may already be spatially sorted
+	std::vector<SNAPSHOT_OBJECT> objects(m_objectSlots.size());
+	for (size_t id = 0; id < m_objectSlots.size(); id++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[m_objectSlots[id]];
+		SNAPSHOT_OBJECT& record = objects[id];
+		record.mesh = object.mesh;
+		memcpy(record.scaleXYZ, glm::value_ptr(object.scaleXYZ), sizeof(record.scaleXYZ));
+		memcpy(record.rotationDegrees, glm::value_ptr(object.rotationDegrees), sizeof(record.rotationDegrees));
+		memcpy(record.positionXYZ, glm::value_ptr(object.positionXYZ), sizeof(record.positionXYZ));
+		memcpy(record.color, glm::value_ptr(object.color), sizeof(record.color));
+		memcpy(record.uvScale, glm::value_ptr(object.uvScale), sizeof(record.uvScale));
+		bTagsFit = CopySnapshotTag(record.tag, object.tag) && bTagsFit;
+		bTagsFit = CopySnapshotTag(record.textureTag, object.textureTag) && bTagsFit;
+		bTagsFit = CopySnapshotTag(record.materialTag, object.materialTag) && bTagsFit;
+	}
+
+	// a truncated tag would restore a different scene, so it is prepared as usual
+	if (bTagsFit && !materials.empty() && !objects.empty())
+	{
+		snapshot.AddChunk(SNAPSHOT_MATERIALS, g_SnapshotMaterialsName, &materials[0], materials.size() * sizeof(SNAPSHOT_MATERIAL));
+		snapshot.AddChunk(SNAPSHOT_OBJECTS, g_SnapshotObjectsName, &objects[0], objects.size() * sizeof(SNAPSHOT_OBJECT));
+	}
+	else
+	{
+		std::cout << "[WARNING] The scene description does not fit the snapshot, it is defined on every start" << std::endl;
+	}
+
+	ComputeProgram::AddBinariesToSnapshot(snapshot);
+	if (NULL != m_pVertexArena)
+		m_pVertexArena->AddToSnapshot(snapshot);
+
+	if (snapshot.Write(m_snapshotFile.c_str()))
+		std::cout << "[STARTUP] scene snapshot written to " << m_snapshotFile << " for the next start" << std::endl;
+}
+
+/***********************************************************
+ *  CaptureMeshesForPulling()
+ *
+ *  This method is used for capturing every basic mesh into
+ *  the vertex pulling arena, in MESH_TYPE order, and making
+ *  the pulling program the one the scene renders with. The
+ *  vertex array path stays in use if any mesh fails. On a
+ *  warm start the arena comes from the snapshot instead.
+ ***********************************************************/
+void SceneManager::CaptureMeshesForPulling()
+{
+	if (NULL == m_pVertexArena)
+		return;
+
+	bool bRestored = m_snapshot.IsMapped() && m_pVertexArena->LoadFromSnapshot(m_snapshot);
+	if (m_snapshot.IsMapped() && !bRestored)
+		m_bSnapshotComplete = false;
+
+	bool bCaptured = true;
+	for (int mesh = MESH_PLANE; mesh <= MESH_TORUS && bCaptured && !bRestored; mesh++)
+	{
+		m_pVertexArena->BeginCapture();
+		DrawBasicMesh((MESH_TYPE)mesh);
+		bCaptured = (m_pVertexArena->EndCapture() == mesh);
+	}
+
+	if (!bCaptured || (!bRestored && !m_pVertexArena->Upload()))
+	{
+		std::cout << "[WARNING] Vertex pulling is not available, meshes are drawn from vertex arrays\n";
+		delete m_pVertexArena;
+		m_pVertexArena = NULL;
+		m_pShaderManager->use();
+		return;
+	}
+
+	m_pDynamicShaderManager = m_pVertexArena->GetProgram();
+	m_pShaderManager = m_pDynamicShaderManager;
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  EnableStaticLights()
+ *
+ *  This method is used for starting the background baking
+ *  of the static lights into the passed in shader files.
+ *  The scene renders with the application's program until
+ *  the baked one is compiled.
+ ***********************************************************/
+bool SceneManager::EnableStaticLights(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	if (NULL != m_pLightBaker)
+		return true;
+
+	// the baked program keeps the vertex path the scene draws with
+	if (NULL != m_pVertexArena)
+		vertexShaderFile = m_pVertexArena->GetVertexShaderFile();
+
+	m_pLightBaker = new StaticLightBaker();
+	if (!m_pLightBaker->Initialize(vertexShaderFile, fragmentShaderFile))
+	{
+		delete m_pLightBaker;
+		m_pLightBaker = NULL;
+		return false;
+	}
+
+	m_pLightBaker->Bake(m_sceneLights);
+	return true;
+}
+
+/***********************************************************
+ *  SetSceneLights()
+ *
+ *  This method is used for editing the directional and
+ *  point lights. The baked program goes stale with the edit,
+ *  so the lights are uploaded as uniforms from the next
+ *  frame until the worker has compiled the new values in.
+ ***********************************************************/
+void SceneManager::SetSceneLights(const StaticLightBaker::SCENE_LIGHTS& lights)
+{
+	m_sceneLights = lights;
+	if (NULL != m_pLightBaker)
+		m_pLightBaker->Bake(m_sceneLights);
+}
+
+/***********************************************************
+ *  UpdateLightProgram()
+ *
+ *  This method is used for switching the scene to the baked
+ *  light program once it is ready, and back to the uniform
+ *  one while it is stale.
+ ***********************************************************/
+void SceneManager::UpdateLightProgram()
+{
+	if (NULL == m_pLightBaker)
+		return;
+
+	ShaderManager* pBaked = m_pLightBaker->GetBakedProgram();
+	ShaderManager* pActive = (NULL != pBaked) ? pBaked : m_pDynamicShaderManager;
+	if (pActive != m_pShaderManager)
+	{
+		m_pShaderManager = pActive;
+		m_pShaderManager->use();
+	}
+}
+
+/***********************************************************
+ *  GetLoadingQueueDepth()
+ *
+ *  This method is used for counting the resource loads in
+ *  flight and a light bake that is still compiling.
+ ***********************************************************/
+int SceneManager::GetLoadingQueueDepth() const
+{
+	int depth = m_spikeDetector.GetLoadsInFlight();
+	if (NULL != m_pLightBaker && m_pLightBaker->IsBakePending())
+		depth++;
+	return depth;
+}
+
+/***********************************************************
+ *  ReportPassTimings()
+ *
+ *  Periodically prints the GPU time of the optional render
+ *  passes, which are tracked separately from the main pass.
+ ***********************************************************/
+void SceneManager::ReportPassTimings()
+{
+	m_frameCount++;
+	if ((m_frameCount % g_TimingReportInterval) != 0)
+		return;
+
+	AllocationTracker::Scope allocationScope("ReportPassTimings");
+
+	std::cout << "[GPU] " << m_mainPassTimer.GetName() << (m_bUseCheckerboard ? " (checkerboard" : " (full rate")
+		<< (NULL != m_pVertexArena ? ", vertex pulling)" : ")")
+		<< ": " << m_mainPassTimer.GetAverageMilliseconds() << " ms" << std::endl;
+
+	if (NULL != m_pCheckerboard && m_bUseCheckerboard)
+	{
+		const GpuTimer& timer = m_pCheckerboard->GetTimer();
+		std::cout << "[GPU] " << timer.GetName() << ": " << timer.GetAverageMilliseconds() << " ms" << std::endl;
+	}
+	if (NULL != m_pVolumetricLighting && m_bUseVolumetrics)
+	{
+		const GpuTimer& timer = m_pVolumetricLighting->GetTimer();
+		std::cout << "[GPU] " << timer.GetName() << ": " << timer.GetAverageMilliseconds() << " ms" << std::endl;
+	}
+	if (NULL != m_pReflections && m_bUseReflections && !m_bUseCheckerboard)
+	{
+		const GpuTimer& timer = m_pReflections->GetTimer();
+		std::cout << "[GPU] " << timer.GetName() << " (" << m_pRenderTarget->GetWidth() << "x" << m_pRenderTarget->GetHeight()
+			<< ", traced at " << m_pReflections->GetTraceWidth() << "x" << m_pReflections->GetTraceHeight() << "): "
+			<< timer.GetAverageMilliseconds() << " ms" << std::endl;
+	}
+
+	std::cout << "[CPU] " << m_cullTimer.GetName() << ": " << m_cullTimer.GetAverageMilliseconds() << " ms, "
+		<< m_drawListTimer.GetName() << ": " << m_drawListTimer.GetAverageMilliseconds() << " ms ("
+		<< (m_bUseSpatialOrder ? "Morton order" : "authored order") << ")" << std::endl;
+	ReportHardwareCounters(m_frameTimer);
+	ReportHardwareCounters(m_cullTimer);
+	ReportHardwareCounters(m_drawListTimer);
+	m_gpuScheduler.Report();
+
+	const PortalVisibility::CULLING_STATS& stats = m_portalVisibility.GetStats();
+	std::cout << "[CULL] cells " << stats.cellsVisited << "/" << stats.cellsTotal
+		<< ", portals " << stats.portalsPassed << "/" << stats.portalsTested
+		<< ", objects submitted " << stats.objectsSubmitted << "/" << stats.objectsTested
+		<< " (" << stats.objectsCulled << " culled)" << std::endl;
+
+	if (NULL != m_pOcclusionCuller && m_bUseOcclusionCulling)
+		m_pOcclusionCuller->Report();
+
+	if (NULL != m_pGpuTransforms)
+	{
+		const GpuTimer& timer = m_pGpuTransforms->GetTimer();
+		const GpuTransforms::UPDATE_STATS& transformStats = m_pGpuTransforms->GetStats();
+		std::cout << "[GPU] " << timer.GetName() << " (" << m_pGpuTransforms->GetNodeCount() << " objects): "
+			<< timer.GetAverageMilliseconds() << " ms, last update " << transformStats.valuesChanged << " values in "
+			<< transformStats.uploadRuns << " uploads (" << transformStats.uploadBytes << " bytes), "
+			<< transformStats.levelsDispatched << " levels" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  RecordGpuTimings()
+ *
+ *  Passes the latest results of the active GPU timers on to
+ *  the frame spike detector.
+ ***********************************************************/
+void SceneManager::RecordGpuTimings()
+{
+	m_spikeDetector.RecordGpuTime(m_mainPassTimer.GetName(), m_mainPassTimer.GetLastMilliseconds());
+
+	// a deferred frame would count the reading of the last run again
+	if (NULL != m_pVolumetricLighting && m_bUseVolumetrics && m_gpuScheduler.HasRunThisFrame(m_volumetricTask))
+	{
+		const GpuTimer& timer = m_pVolumetricLighting->GetTimer();
+		m_spikeDetector.RecordGpuTime(timer.GetName(), timer.GetLastMilliseconds());
+	}
+	if (NULL != m_pReflections && m_bUseReflections && !m_bUseCheckerboard)
+	{
+		const GpuTimer& timer = m_pReflections->GetTimer();
+		m_spikeDetector.RecordGpuTime(timer.GetName(), timer.GetLastMilliseconds());
+	}
+	if (NULL != m_pCheckerboard && m_bUseCheckerboard)
+	{
+		const GpuTimer& timer = m_pCheckerboard->GetTimer();
+		m_spikeDetector.RecordGpuTime(timer.GetName(), timer.GetLastMilliseconds());
+	}
+	// checkerboard frames issue no occlusion queries and would skew the
+	// comparison of the main pass with and without culling
+	if (NULL != m_pOcclusionCuller && !m_bUseCheckerboard)
+	{
+		m_pOcclusionCuller->RecordMainPassTime(m_mainPassTimer, m_bUseOcclusionCulling);
+		if (m_bUseOcclusionCulling)
+		{
+			const GpuTimer& timer = m_pOcclusionCuller->GetTimer();
+			m_spikeDetector.RecordGpuTime(timer.GetName(), timer.GetLastMilliseconds());
+		}
+	}
+	// the update only runs on frames with changed transforms
+	if (NULL != m_pGpuTransforms && m_pGpuTransforms->GetStats().levelsDispatched > 0)
+	{
+		const GpuTimer& timer = m_pGpuTransforms->GetTimer();
+		m_spikeDetector.RecordGpuTime(timer.GetName(), timer.GetLastMilliseconds());
+	}
+}
+
+/***********************************************************
+ *  SetRenderResolution()
+ *
+ *  Sets a fixed resolution for the offscreen main pass so
+ *  pass costs can be compared at e.g. 1080p and 4K. The
+ *  result is scaled to the window when it is displayed.
+ ***********************************************************/
+void SceneManager::SetRenderResolution(int width, int height)
+{
+	m_renderWidth = width;
+	m_renderHeight = height;
+}
+
+/***********************************************************
+ *  BeginMainPass()
+ *
+ *  Directs the main pass into the offscreen render target
+ *  when a screen space effect needs its buffers. Returns
+ *  false when rendering straight into the window instead.
+ ***********************************************************/
+bool SceneManager::BeginMainPass(int windowWidth, int windowHeight)
+{
+	if (NULL == m_pRenderTarget || !(m_bUseReflections || m_bUseCheckerboard))
+		return false;
+
+	int width = (m_renderWidth > 0) ? m_renderWidth : windowWidth;
+	int height = (m_renderHeight > 0) ? m_renderHeight : windowHeight;
+	if (!m_pRenderTarget->Resize(width, height))
+		return false;
+
+	m_pRenderTarget->Bind();
+	m_pRenderTarget->Clear(g_ClearColor);
+
+	return true;
+}
+
+/***********************************************************
+ *  EndMainPass()
+ *
+ *  Runs the screen space passes on the offscreen main pass
+ *  and presents the result in the window.
+ ***********************************************************/
+void SceneManager::EndMainPass(int windowWidth, int windowHeight, const glm::mat4& view, const glm::mat4& projection)
+{
+	// reflections need full resolution depth and surfaces, which the
+	// checkerboard pass only produces for half of the pixels
+	if (NULL != m_pReflections && m_bUseReflections && !m_bUseCheckerboard)
+		m_pReflections->Render(*m_pRenderTarget, view, projection);
+
+	m_pRenderTarget->BlitToDefault(windowWidth, windowHeight);
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  Adds an object to the scene description. Objects keep the
+ *  ID of the order they were added in, while their storage
+ *  is reordered spatially by UpdateSpatialOrder().
+ ***********************************************************/
+void SceneManager::AddSceneObject(
+	const std::string& tag,
+	MESH_TYPE mesh,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegrees,
+	glm::vec3 positionXYZ,
+	glm::vec4 color,
+	const std::string& textureTag,
+	glm::vec2 uvScale,
+	const std::string& materialTag)
+{
+	SCENE_OBJECT object;
+	object.id = (int)m_sceneObjects.size();
+	object.tag = tag;
+	object.mesh = mesh;
+	object.scaleXYZ = scaleXYZ;
+	object.rotationDegrees = rotationDegrees;
+	object.positionXYZ = positionXYZ;
+	object.color = color;
+	object.textureTag = textureTag;
+	object.uvScale = uvScale;
+	object.materialTag = materialTag;
+	object.mortonCode = 0;
+	UpdateObjectBounds(object);
+
+	m_objectSlots.push_back((int)m_sceneObjects.size());
+	m_sceneObjects.push_back(object);
+
+	// the scene bounds the Morton codes are relative to have changed
+	m_bSceneBoundsValid = false;
+}
+
+/***********************************************************
+ *  MoveSceneObject()
+ *
+ *  Moves the object with the passed in ID. Only its own
+ *  Morton code is recomputed; the storage order is repaired
+ *  incrementally before the next draw list is built.
+ ***********************************************************/
+void SceneManager::MoveSceneObject(int id, const glm::vec3& positionXYZ)
+{
+	if (id < 0 || id >= (int)m_objectSlots.size())
+		return;
+
+	SCENE_OBJECT& object = m_sceneObjects[m_objectSlots[id]];
+	object.positionXYZ = positionXYZ;
+	UpdateObjectBounds(object);
+	if (NULL != m_pGpuTransforms)
+		m_pGpuTransforms->SetTranslation(id, positionXYZ);
+
+	if (m_bSceneBoundsValid)
+	{
+		uint32_t mortonCode = ComputeMortonCode(object);
+		if (mortonCode != object.mortonCode)
+		{
+			object.mortonCode = mortonCode;
+			m_bSpatialOrderDirty = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateObjectBounds()
+ *
+ *  Computes the world bounds of an object from its mesh and
+ *  transformations, and places it in the cell that contains
+ *  the center of those bounds.
+ ***********************************************************/
+void SceneManager::UpdateObjectBounds(SCENE_OBJECT& object)
+{
+	glm::mat4 model = BuildModelMatrix(object.scaleXYZ, object.rotationDegrees.x,
+		object.rotationDegrees.y, object.rotationDegrees.z, object.positionXYZ);
+	const glm::vec3& localMin = g_MeshBoundsMin[object.mesh];
+	const glm::vec3& localMax = g_MeshBoundsMax[object.mesh];
+	object.boundsMin = glm::vec3(1e9f);
+	object.boundsMax = glm::vec3(-1e9f);
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner(
+			(i & 1) ? localMax.x : localMin.x,
+			(i & 2) ? localMax.y : localMin.y,
+			(i & 4) ? localMax.z : localMin.z);
+		glm::vec3 world = glm::vec3(model * glm::vec4(corner, 1.0f));
+		object.boundsMin = glm::min(object.boundsMin, world);
+		object.boundsMax = glm::max(object.boundsMax, world);
+	}
+	object.cell = m_portalVisibility.FindCell((object.boundsMin + object.boundsMax) * 0.5f);
+}
+
+/***********************************************************
+ *  ComputeMortonCode()
+ *
+ *  Quantizes the center of an object to 10 bits per axis
+ *  within the scene bounds and interleaves the bits. Objects
+ *  that moved outside of the bounds are clamped to the edge.
+ ***********************************************************/
+uint32_t SceneManager::ComputeMortonCode(const SCENE_OBJECT& object) const
+{
+	glm::vec3 center = (object.boundsMin + object.boundsMax) * 0.5f;
+	glm::vec3 extent = glm::max(m_sceneBoundsMax - m_sceneBoundsMin, glm::vec3(1e-6f));
+	glm::vec3 normalized = glm::clamp((center - m_sceneBoundsMin) / extent, glm::vec3(0.0f), glm::vec3(1.0f));
+
+	uint32_t x = (uint32_t)(normalized.x * 1023.0f);
+	uint32_t y = (uint32_t)(normalized.y * 1023.0f);
+	uint32_t z = (uint32_t)(normalized.z * 1023.0f);
+
+	return (SpreadBits(x) << 2) | (SpreadBits(y) << 1) | SpreadBits(z);
+}
+
+/***********************************************************
+ *  UpdateSpatialOrder()
+ *
+ *  Keeps the object storage sorted by Morton code so that
+ *  culling and draw submission walk neighboring objects, and
+ *  their state, one after another. The array is nearly
+ *  sorted between frames, so an insertion sort repairs it in
+ *  close to linear time after a few objects have moved.
+ ***********************************************************/
+void SceneManager::UpdateSpatialOrder()
+{
+	if (!m_bSceneBoundsValid)
+	{
+		m_sceneBoundsMin = glm::vec3(1e9f);
+		m_sceneBoundsMax = glm::vec3(-1e9f);
+		for (size_t i = 0; i < m_sceneObjects.size(); i++)
+		{
+			m_sceneBoundsMin = glm::min(m_sceneBoundsMin, m_sceneObjects[i].boundsMin);
+			m_sceneBoundsMax = glm::max(m_sceneBoundsMax, m_sceneObjects[i].boundsMax);
+		}
+		for (size_t i = 0; i < m_sceneObjects.size(); i++)
+			m_sceneObjects[i].mortonCode = ComputeMortonCode(m_sceneObjects[i]);
+
+		m_bSceneBoundsValid = true;
+		m_bSpatialOrderDirty = true;
+	}
+
+	if (!m_bSpatialOrderDirty)
+		return;
+
+	for (size_t i = 1; i < m_sceneObjects.size(); i++)
+	{
+		if (!ComesBefore(m_sceneObjects[i], m_sceneObjects[i - 1], m_bUseSpatialOrder))
+			continue;
+
+		// moved, so the strings of the shifted objects are not copied
+		SCENE_OBJECT object = std::move(m_sceneObjects[i]);
+		size_t j = i;
+		while (j > 0 && ComesBefore(object, m_sceneObjects[j - 1], m_bUseSpatialOrder))
+		{
+			m_sceneObjects[j] = std::move(m_sceneObjects[j - 1]);
+			j--;
+		}
+		m_sceneObjects[j] = std::move(object);
+	}
+
+	// the object matrices the GPU composes follow the storage order
+	m_objectSlots.resize(m_sceneObjects.size());
+	for (size_t i = 0; i < m_sceneObjects.size(); i++)
+	{
+		m_objectSlots[m_sceneObjects[i].id] = (int)i;
+		if (NULL != m_pGpuTransforms)
+			m_pGpuTransforms->SetNodeRank(m_sceneObjects[i].id, (int)i);
+	}
+
+	m_bSpatialOrderDirty = false;
+}
+
+/***********************************************************
+ *  BuildDrawList()
+ *
+ *  Clips the view frustum through the portals reachable from
+ *  the camera and collects the objects that remain visible.
+ ***********************************************************/
+void SceneManager::BuildDrawList(const glm::mat4& viewProjection, const glm::vec3& cameraPos)
+{
+	UpdateSpatialOrder();
+
+	CpuTimer::Scope scope(m_cullTimer);
+	m_portalVisibility.Update(viewProjection, cameraPos);
+
+	m_drawList.clear();
+	for (int i = 0; i < (int)m_sceneObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		if (m_portalVisibility.IsVisible(object.cell, object.boundsMin, object.boundsMax))
+			m_drawList.push_back(i);
+	}
 }
 
 
@@ -378,6 +1383,8 @@ void SceneManager::SetupSceneLights(const glm::vec3& cameraPos, const glm::vec3&
  *  PrepareScene()
  *
  *  Loads and sets up meshes, textures, materials, lights.
+ *  With a current snapshot mapped by UseSnapshot() they are
+ *  restored from it instead.
  ***********************************************************/
 void SceneManager::PrepareScene()
 {
@@ -385,6 +1392,7 @@ void SceneManager::PrepareScene()
 	m_basicMeshes->LoadPlaneMesh();
 	m_basicMeshes->LoadCylinderMesh();
 	m_basicMeshes->LoadTorusMesh();
+	CaptureMeshesForPulling();
 
 	// Load wood texture
 	if (!CreateGLTexture("Debug/wood.jpg", "wood"))
@@ -396,25 +1404,177 @@ void SceneManager::PrepareScene()
 	SetTextureUVScale(8.0f, 4.0f);
 	BindGLTextures();
 
-	// Define material for wood surface (floor/table)
-	OBJECT_MATERIAL woodMaterial;
-	woodMaterial.tag = "woodMaterial";
-	woodMaterial.ambientColor = glm::vec3(0.15f, 0.08f, 0.03f);   // deeper tone
-	woodMaterial.ambientStrength = 0.25f;
-	woodMaterial.diffuseColor = glm::vec3(0.5f, 0.3f, 0.1f);      // richer wood
-	woodMaterial.specularColor = glm::vec3(0.5f);                  // stronger reflection
-	woodMaterial.shininess = 48.0f;                            // semi-gloss
-	m_objectMaterials.push_back(woodMaterial);
+	// Materials come from the snapshot on a warm start
+	if (!m_snapshot.IsMapped() || !RestoreMaterials())
+	{
+		// Define material for wood surface (floor/table)
+		OBJECT_MATERIAL woodMaterial;
+		woodMaterial.tag = "woodMaterial";
+		woodMaterial.ambientColor = glm::vec3(0.15f, 0.08f, 0.03f);   // deeper tone
+		woodMaterial.ambientStrength = 0.25f;
+		woodMaterial.diffuseColor = glm::vec3(0.5f, 0.3f, 0.1f);      // richer wood
+		woodMaterial.specularColor = glm::vec3(0.5f);                  // stronger reflection
+		woodMaterial.shininess = 48.0f;                            // semi-gloss
+		m_objectMaterials.Allocate(woodMaterial);
+
+		// Define material for white ceramic mug
+		OBJECT_MATERIAL whiteMaterial;
+		whiteMaterial.tag = "whiteMaterial";
+		whiteMaterial.ambientColor = glm::vec3(0.4f);                  // warmer ambient
+		whiteMaterial.ambientStrength = 0.5f;
+		whiteMaterial.diffuseColor = glm::vec3(1.0f);
+		whiteMaterial.specularColor = glm::vec3(1.2f);                  // polished ceramic
+		whiteMaterial.shininess = 96.0f;                            // glossy
+		m_objectMaterials.Allocate(whiteMaterial);
+	}
+
+	// Froxel volumetric lighting for the camera torch
+	m_pVolumetricLighting = new VolumetricLighting();
+	if (!m_pVolumetricLighting->Initialize())
+	{
+		std::cout << "[WARNING] Volumetric lighting is not available\n";
+		m_bUseVolumetrics = false;
+	}
+	else
+	{
+		// reprojection carries the volume over the frames it is deferred
+		m_volumetricTask = m_gpuScheduler.AddTask(m_pVolumetricLighting->GetTimer().GetName(), UpdateVolumetrics,
+			this, 4, 1.0, 1, &m_pVolumetricLighting->GetTimer());
+	}
+
+	// The render target passes read outputs of the program the scene
+	// draws with, which CaptureMeshesForPulling has settled on
+	m_pShaderManager->use();
+	GLint sceneProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &sceneProgram);
+
+	// Screen space reflections for the glossy wood and ceramic, traced
+	// from the surface data of the main pass
+	m_pReflections = new ScreenSpaceReflections();
+	if (!m_pReflections->Initialize())
+	{
+		std::cout << "[WARNING] Screen space reflections are not available\n";
+		delete m_pReflections;
+		m_pReflections = NULL;
+	}
+	else if (!SceneRenderTarget::ProgramWritesAttachment((GLuint)sceneProgram, SceneRenderTarget::SURFACE_ATTACHMENT))
+	{
+		std::cout << "[WARNING] Screen space reflections disabled: the scene program writes no SurfaceData\n";
+		delete m_pReflections;
+		m_pReflections = NULL;
+	}
+	m_bUseReflections = (NULL != m_pReflections);
+
+	// Checkerboard rendering, off until enabled with the B key; the
+	// missing pixels are rebuilt from the velocity and object IDs
+	m_pCheckerboard = new CheckerboardRenderer();
+	if (!m_pCheckerboard->Initialize())
+	{
+		std::cout << "[WARNING] Checkerboard rendering is not available\n";
+		delete m_pCheckerboard;
+		m_pCheckerboard = NULL;
+	}
+	else if (!SceneRenderTarget::ProgramWritesAttachment((GLuint)sceneProgram, SceneRenderTarget::VELOCITY_ATTACHMENT)
+		|| !SceneRenderTarget::ProgramWritesAttachment((GLuint)sceneProgram, SceneRenderTarget::OBJECT_ID_ATTACHMENT))
+	{
+		std::cout << "[WARNING] Checkerboard rendering disabled: the scene program writes no Velocity or ObjectID\n";
+		delete m_pCheckerboard;
+		m_pCheckerboard = NULL;
+	}
+
+	// Occlusion culling of the desk items hidden behind the laptop and mug
+	m_pOcclusionCuller = new OcclusionCuller();
+	if (!m_pOcclusionCuller->Initialize())
+	{
+		std::cout << "[WARNING] Occlusion culling is not available\n";
+		delete m_pOcclusionCuller;
+		m_pOcclusionCuller = NULL;
+	}
+
+	if (m_bUseReflections || NULL != m_pCheckerboard)
+		m_pRenderTarget = new SceneRenderTarget();
+
+	// CPU hardware counters for the profiled stages, when permitted
+	if (m_frameTimer.EnableHardwareCounters())
+	{
+		m_cullTimer.EnableHardwareCounters();
+		m_drawListTimer.EnableHardwareCounters();
+	}
+
+	// The office is a single cell; further rooms are added with
+	// AddCell() and joined to it through door quads with AddPortal()
+	m_portalVisibility.Clear();
+	m_portalVisibility.AddCell("office", glm::vec3(-12.0f, -1.0f, -12.0f), glm::vec3(12.0f, 10.0f, 12.0f));
 
-	// Define material for white ceramic mug
-	OBJECT_MATERIAL whiteMaterial;
-	whiteMaterial.tag = "whiteMaterial";
-	whiteMaterial.ambientColor = glm::vec3(0.4f);                  // warmer ambient
-	whiteMaterial.ambientStrength = 0.5f;
-	whiteMaterial.diffuseColor = glm::vec3(1.0f);
-	whiteMaterial.specularColor = glm::vec3(1.2f);                  // polished ceramic
-	whiteMaterial.shininess = 96.0f;                            // glossy
-	m_objectMaterials.push_back(whiteMaterial);
+	// Scene objects come from the snapshot on a warm start
+	if (!m_snapshot.IsMapped() || !RestoreSceneObjects())
+	{
+		// Floor (Wood Table)
+		AddSceneObject("table", MESH_PLANE,
+			glm::vec3(20.0f, 1.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+			glm::vec4(1.0f), "wood", glm::vec2(4.0f, 2.0f), "woodMaterial");
+
+		// Mug Body – smaller and properly lowered
+		AddSceneObject("mugBody", MESH_CYLINDER,
+			glm::vec3(0.75f, 1.125f, 0.75f), glm::vec3(0.0f), glm::vec3(8.0f, 0.5625f, 0.0f),
+			glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), "", glm::vec2(1.0f), "whiteMaterial");
+
+		// Mug Rim
+		AddSceneObject("mugRim", MESH_TORUS,
+			glm::vec3(0.375f, 0.375f, 0.0375f), glm::vec3(90.0f, 0.0f, 0.0f), glm::vec3(8.0f, 1.125f, 0.0f),
+			glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), "", glm::vec2(1.0f), "whiteMaterial");
+
+		// Mug Handle
+		AddSceneObject("mugHandle", MESH_TORUS,
+			glm::vec3(0.3f, 0.3f, 0.075f), glm::vec3(0.0f, 0.0f, 90.0f), glm::vec3(8.75f, 0.85f, 0.0f),
+			glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), "", glm::vec2(1.0f), "whiteMaterial");
+
+		// Notebook (Dark Blue)
+		AddSceneObject("notebook", MESH_PLANE,
+			glm::vec3(3.0f, 0.2f, 2.0f), glm::vec3(0.0f, 15.0f, 0.0f), glm::vec3(-3.0f, 0.2f, 1.0f),
+			glm::vec4(0.1f, 0.1f, 0.4f, 1.0f), "", glm::vec2(1.0f), "whiteMaterial");
+
+		// Pen (Bright Red, on top of the notebook)
+		AddSceneObject("pen", MESH_CYLINDER,
+			glm::vec3(0.1f, 2.0f, 0.1f), glm::vec3(90.0f, 15.0f, 0.0f), glm::vec3(-2.8f, 0.5f, 1.7f),
+			glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), "", glm::vec2(1.0f), "whiteMaterial");
+
+		// Laptop Base – slightly raised and flatter
+		AddSceneObject("laptopBase", MESH_PLANE,
+			glm::vec3(3.0f, 0.05f, 2.0f), glm::vec3(0.0f, -10.0f, 0.0f), glm::vec3(3.0f, 0.075f, -2.0f),
+			glm::vec4(0.75f, 0.75f, 0.75f, 1.0f), "", glm::vec2(1.0f), "whiteMaterial");
+
+		// Laptop Screen – slightly back, better aligned to base
+		AddSceneObject("laptopScreen", MESH_PLANE,
+			glm::vec3(3.0f, 2.0f, 1.0f), glm::vec3(-100.0f, 0.0f, 0.0f), glm::vec3(3.0f, 1.15f, -2.95f),
+			glm::vec4(0.2f, 0.2f, 0.2f, 1.0f), "", glm::vec2(1.0f), "whiteMaterial");
+	}
+
+	// The arena's vertex shader reads the object matrices from the compute
+	// pass; the desk items have no parents, so each is a root node
+	if (NULL != m_pVertexArena)
+	{
+		m_pGpuTransforms = new GpuTransforms();
+		if (!m_pGpuTransforms->Initialize())
+		{
+			std::cout << "[WARNING] GPU transform update is not available\n";
+			delete m_pGpuTransforms;
+			m_pGpuTransforms = NULL;
+		}
+		else
+		{
+			// the node of an object is its ID, its slot follows the storage
+			// order like the rest of the per object data
+			for (size_t id = 0; id < m_objectSlots.size(); id++)
+			{
+				const SCENE_OBJECT& object = m_sceneObjects[m_objectSlots[id]];
+				int node = m_pGpuTransforms->AddNode(-1, object.positionXYZ, BuildRotation(object.rotationDegrees), object.scaleXYZ);
+				m_pGpuTransforms->SetNodeRank(node, m_objectSlots[id]);
+			}
+		}
+	}
+
+	FinishSnapshot();
 }
 
 
@@ -448,12 +1608,19 @@ void SceneManager::RenderScene()
 	GLFWwindow* window = glfwGetCurrentContext();
 	if (!window) return;
 
+	m_spikeDetector.BeginFrame();
+	CpuTimer::Scope frameScope(m_frameTimer);
+	m_frameDrawCalls = 0;
+
 	glClearColor(0.05f, 0.05f, 0.1f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	glfwSetWindowUserPointer(window, &cameraPos);
 	glfwSetScrollCallback(window, scroll_callback);
 
+	// every uniform of the frame goes to the program picked here
+	UpdateLightProgram();
+
 	m_pShaderManager->setVec3Value("viewPos", cameraPos);
 	m_pShaderManager->setIntValue("bUseLighting", true);
 
@@ -513,77 +1680,283 @@ void SceneManager::RenderScene()
 	if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS)
 		perspectiveMode = false;
 
+	// Volumetric light shafts toggle
+	if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS)
+		m_bUseVolumetrics = true;
+	if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS)
+		m_bUseVolumetrics = false;
+
+	// Screen space reflections toggle
+	if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS && NULL != m_pReflections)
+		m_bUseReflections = true;
+	if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
+		m_bUseReflections = false;
+
+	// Checkerboard rendering toggle and quality comparison
+	static bool comparePressed = false;
+	if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && NULL != m_pCheckerboard)
+		m_bUseCheckerboard = true;
+	if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS)
+		m_bUseCheckerboard = false;
+	bool compareKey = (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS);
+	if (compareKey && !comparePressed)
+		m_bCompareCheckerboard = true;
+	comparePressed = compareKey;
+
+	// Morton ordered object storage toggle, to compare against authored order
+	bool bSpatialOrder = m_bUseSpatialOrder;
+	if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS)
+		bSpatialOrder = true;
+	if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
+		bSpatialOrder = false;
+	if (bSpatialOrder != m_bUseSpatialOrder)
+	{
+		m_bUseSpatialOrder = bSpatialOrder;
+		m_bSpatialOrderDirty = true;
+	}
+
+	// Occlusion culling toggle, to measure the GPU time it saves
+	if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS && NULL != m_pOcclusionCuller)
+		m_bUseOcclusionCulling = true;
+	if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS)
+		m_bUseOcclusionCulling = false;
+
 	glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
 	glm::mat4 projection = perspectiveMode ?
 		glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f) :
 		glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 100.0f);
 
+	int windowWidth = 0;
+	int windowHeight = 0;
+	glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+	bool bOffscreen = BeginMainPass(windowWidth, windowHeight);
+
+	// Periodic GPU work runs before the main pass, as far as the budget
+	// allows; the main pass samples the latest volumetric result
+	m_volumetricCamera.position = cameraPos;
+	m_volumetricCamera.front = cameraFront;
+	m_volumetricCamera.view = view;
+	m_volumetricCamera.projection = projection;
+	m_gpuScheduler.SetTaskEnabled(m_volumetricTask, m_bUseVolumetrics);
+	m_gpuScheduler.RunFrame();
+	if (m_gpuScheduler.GetStats().tasksRun > 0)
+		m_pShaderManager->use();
+	if (NULL != m_pVolumetricLighting)
+		m_pVolumetricLighting->BindForMainPass(m_pShaderManager, m_bUseVolumetrics);
+
 	m_pShaderManager->setMat4Value("view", view);
 	m_pShaderManager->setMat4Value("projection", projection);
 
-	glm::vec3 scaleXYZ, positionXYZ;
-
-	// Floor (Wood Table)
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetTextureUVScale(4.0f, 2.0f);
-	SetShaderTexture("wood");
-	SetShaderMaterial("woodMaterial");
-	m_basicMeshes->DrawPlaneMesh();
-
-	m_pShaderManager->setIntValue("bUseTexture", false);
-
-	// Mug Body – smaller and properly lowered
-	scaleXYZ = glm::vec3(0.75f, 1.125f, 0.75f);       // 75% of original
-	positionXYZ = glm::vec3(8.0f, 0.5625f, 0.0f);      // Y = half of height
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderMaterial("whiteMaterial");
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	m_basicMeshes->DrawCylinderMesh();
-
-	// Mug Rim
-	scaleXYZ = glm::vec3(0.375f, 0.375f, 0.0375f);
-	positionXYZ = glm::vec3(8.0f, 1.125f, 0.0f);       // top of mug
-	SetTransformations(scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	m_basicMeshes->DrawTorusMesh();
-
-	// Corrected Mug Handle Position
-	scaleXYZ = glm::vec3(0.3f, 0.3f, 0.075f);
-	positionXYZ = glm::vec3(8.75f, 0.85f, 0.0f); // closer to mug and raised slightly
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 90.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	m_basicMeshes->DrawTorusMesh();
-
-	// Notebook (Dark Blue)
-	scaleXYZ = glm::vec3(3.0f, 0.2f, 2.0f);
-	positionXYZ = glm::vec3(-3.0f, 0.2f, 1.0f);
-	SetTransformations(scaleXYZ, 0.0f, 15.0f, 0.0f, positionXYZ);
-	SetShaderColor(0.1f, 0.1f, 0.4f, 1.0f);
-	m_basicMeshes->DrawPlaneMesh();
-
-	// Pen (Bright Red, fixed position and clearly visible)
-	scaleXYZ = glm::vec3(0.1f, 2.0f, 0.1f);  // Thin cylinder for pen body
-	positionXYZ = glm::vec3(-2.8f, 0.5f, 1.7f);  // On top of notebook
-	SetTransformations(scaleXYZ, 90.0f, 15.0f, 0.0f, positionXYZ);
-	SetShaderColor(1.0f, 0.0f, 0.0f, 1.0f);  // Bright red color
-	m_basicMeshes->DrawCylinderMesh();
-
-	// Laptop Base – slightly raised and flatter
-	scaleXYZ = glm::vec3(3.0f, 0.05f, 2.0f);
-	positionXYZ = glm::vec3(3.0f, 0.075f, -2.0f); // slight lift above table
-	SetTransformations(scaleXYZ, 0.0f, -10.0f, 0.0f, positionXYZ);
-	SetShaderColor(0.75f, 0.75f, 0.75f, 1.0f);
-	m_basicMeshes->DrawPlaneMesh();
-
-	// Laptop Screen – slightly back, better aligned to base
-	scaleXYZ = glm::vec3(3.0f, 2.0f, 1.0f);
-	positionXYZ = glm::vec3(3.0f, 1.15f, -2.95f); // lowered and moved forward
-	SetTransformations(scaleXYZ, -100.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);
-	m_basicMeshes->DrawPlaneMesh();
+	m_pShaderManager->setMat4Value("previousViewProjection", m_previousViewProjection);
+
+	// Only objects in cells reachable through visible portals are drawn
+	BuildDrawList(projection * view, cameraPos);
+	UpdateGpuTransforms();
+	if (NULL != m_pOcclusionCuller)
+		m_pOcclusionCuller->BeginFrame((int)m_sceneObjects.size());
 
+	// Checkerboard mode shades half of the pixels and reconstructs the rest
+	bool bCheckerboard = bOffscreen && m_bUseCheckerboard;
+	if (bCheckerboard && m_bCompareCheckerboard)
+	{
+		// full rate reference of the same frame for the quality comparison
+		m_fullRateTimer.Begin();
+		RenderSceneObjects();
+		m_fullRateTimer.End();
+		m_pCheckerboard->CaptureReference(*m_pRenderTarget);
+		m_pRenderTarget->Clear(g_ClearColor);
+	}
+	if (bCheckerboard)
+		m_pCheckerboard->BeginShading(*m_pRenderTarget);
+
+	m_mainPassTimer.Begin();
+	m_drawListTimer.Begin();
+	m_bOcclusionDraws = (NULL != m_pOcclusionCuller && m_bUseOcclusionCulling);
+	RenderSceneObjects();
+	m_bOcclusionDraws = false;
+	m_drawListTimer.End();
+	m_mainPassTimer.End();
+
+	// The bounds of the drawn objects are tested against this depth, and
+	// the results decide the next frame's draws without waiting for them;
+	// the checkerboard depth only covers half of the pixels
+	if (NULL != m_pOcclusionCuller && m_bUseOcclusionCulling && !bCheckerboard)
+	{
+		m_pOcclusionCuller->BeginQueries(projection * view, cameraPos);
+		for (int index : m_drawList)
+		{
+			const SCENE_OBJECT& object = m_sceneObjects[index];
+			m_pOcclusionCuller->QueryObject(object.id, object.boundsMin, object.boundsMax);
+		}
+		m_pOcclusionCuller->EndQueries();
+		m_pShaderManager->use();
+	}
+
+	if (bCheckerboard)
+	{
+		m_pCheckerboard->EndShading();
+		m_pCheckerboard->Resolve(*m_pRenderTarget);
+		m_pShaderManager->use();
+
+		if (m_bCompareCheckerboard)
+		{
+			double psnr = m_pCheckerboard->CompareWithReference();
+			m_pShaderManager->use();
+			std::cout << "[CHECKERBOARD] PSNR against full rate: " << psnr << " dB, main pass "
+				<< m_mainPassTimer.GetAverageMilliseconds() << " ms (checkerboard) vs "
+				<< m_fullRateTimer.GetAverageMilliseconds() << " ms (full rate)" << std::endl;
+		}
+	}
+	m_bCompareCheckerboard = false;
+
+	if (bOffscreen)
+		EndMainPass(windowWidth, windowHeight, view, projection);
+
+	m_previousViewProjection = projection * view;
+	RecordGpuTimings();
+	ReportPassTimings();
+}
+
+/***********************************************************
+ *  UpdateVolumetrics()
+ *
+ *  Runs the volumetric passes for the camera of this frame,
+ *  when the GPU task scheduler picks them.
+ ***********************************************************/
+void SceneManager::UpdateVolumetrics(void* pScene)
+{
+	SceneManager* pSceneManager = (SceneManager*)pScene;
+	pSceneManager->m_pVolumetricLighting->Update(pSceneManager->m_volumetricCamera, pSceneManager->m_spotLight);
+}
+
+/***********************************************************
+ *  RenderView()
+ *
+ *  Renders the prepared scene from the passed in camera into
+ *  the render target, at its size. Volumetric lighting and
+ *  screen space reflections accumulate over frames of one
+ *  moving camera, so views of unrelated cameras leave them
+ *  out; the interactive frame loop is not disturbed.
+ ***********************************************************/
+void SceneManager::RenderView(SceneRenderTarget& target, const glm::vec3& cameraPos, const glm::vec3& cameraFront)
+{
+	// the frame loop enables it every frame, which may never have run
+	glEnable(GL_DEPTH_TEST);
+	target.Bind();
+	target.Clear(g_ClearColor);
+
+	UpdateLightProgram();
+
+	m_pShaderManager->setVec3Value("viewPos", cameraPos);
+	m_pShaderManager->setVec3Value("viewPosition", cameraPos);
+	m_pShaderManager->setIntValue("bUseLighting", true);
+
+	SetupSceneLights(cameraPos, cameraFront);
+
+	glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f),
+		(float)target.GetWidth() / (float)target.GetHeight(), 0.1f, 100.0f);
+
+	if (NULL != m_pVolumetricLighting)
+		m_pVolumetricLighting->BindForMainPass(m_pShaderManager, false);
+
+	m_pShaderManager->setMat4Value("view", view);
+	m_pShaderManager->setMat4Value("projection", projection);
+	// a still camera, so the velocity buffer stays zero
+	m_pShaderManager->setMat4Value("previousViewProjection", projection * view);
+
+	BuildDrawList(projection * view, cameraPos);
+	UpdateGpuTransforms();
+	RenderSceneObjects();
+}
+
+/***********************************************************
+ *  UpdateGpuTransforms()
+ *
+ *  Recomposes the object matrices changed since the last
+ *  frame. It runs ahead of the draws, as its timer cannot
+ *  nest in the main pass timer.
+ ***********************************************************/
+void SceneManager::UpdateGpuTransforms()
+{
+	if (NULL != m_pGpuTransforms && m_pGpuTransforms->Update())
+		m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  RenderSceneObjects()
+ *
+ *  Draws every object of this frame's draw list with its
+ *  transformations, material, color and texture.
+ ***********************************************************/
+void SceneManager::RenderSceneObjects()
+{
+	// vertex pulling binds its arena once for the whole draw list
+	if (NULL != m_pVertexArena)
+		m_pVertexArena->Bind();
+	// the object matrices are indexed by slot instead of set per draw
+	bool bGpuTransforms = (NULL != m_pGpuTransforms);
+	if (bGpuTransforms)
+		m_pGpuTransforms->Bind();
+	m_pShaderManager->setIntValue(g_ObjectTransformsName, bGpuTransforms);
+	m_frameDrawCalls += (unsigned int)m_drawList.size();
+
+	for (size_t i = 0; i < m_drawList.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[m_drawList[i]];
+		// driver warnings raised while drawing are attributed to the object
+		GLDebugOutput::Scope debugScope(object.tag.c_str());
+
+		if (bGpuTransforms)
+			m_pShaderManager->setIntValue(g_ObjectIndexName, m_pGpuTransforms->GetSlot(object.id));
+		else
+			SetTransformations(object.scaleXYZ, object.rotationDegrees.x, object.rotationDegrees.y,
+				object.rotationDegrees.z, object.positionXYZ);
+		// stable per object ID for motion reconstruction, 0 is background
+		m_pShaderManager->setIntValue(g_ObjectIDName, object.id + 1);
+
+		if (!object.textureTag.empty())
+		{
+			SetTextureUVScale(object.uvScale.x, object.uvScale.y);
+			SetShaderTexture(object.textureTag);
+		}
+		else
+		{
+			SetShaderColor(object.color.r, object.color.g, object.color.b, object.color.a);
+		}
+		SetShaderMaterial(object.materialTag);
+
+		// skipped by the GPU when the object's box was hidden last frame
+		if (m_bOcclusionDraws)
+			m_pOcclusionCuller->BeginObject(object.id);
+		if (NULL != m_pVertexArena)
+			m_pVertexArena->Draw(m_pShaderManager, object.mesh);
+		else
+			DrawBasicMesh(object.mesh);
+		if (m_bOcclusionDraws)
+			m_pOcclusionCuller->EndObject();
+	}
+}
+
+/***********************************************************
+ *  DrawBasicMesh()
+ *
+ *  Draws a basic mesh through the vertex arrays of ShapeMeshes.
+ ***********************************************************/
+void SceneManager::DrawBasicMesh(MESH_TYPE mesh)
+{
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case MESH_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	}
 }
 
 
@@ -15,6 +15,21 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "VolumetricLighting.h"
+#include "SceneRenderTarget.h"
+#include "ScreenSpaceReflections.h"
+#include "CheckerboardRenderer.h"
+#include "GpuTimer.h"
+#include "CpuTimer.h"
+#include "FrameSpikeDetector.h"
+#include "PortalVisibility.h"
+#include "StaticLightBaker.h"
+#include "VertexPullingArena.h"
+#include "SceneSnapshot.h"
+#include "RecordPool.h"
+#include "OcclusionCuller.h"
+#include "GpuTaskScheduler.h"
+#include "GpuTransforms.h"
 
 /***********************************************************
  *  SceneManager
@@ -35,6 +50,7 @@ public:
     {
         std::string tag;
         uint32_t    ID;
+        std::string file;           // image the texture was loaded from
     };
 
     // Phong material properties
@@ -48,12 +64,116 @@ public:
         std::string tag;
     };
 
+    // basic meshes a scene object can be drawn with
+    enum MESH_TYPE
+    {
+        MESH_PLANE,
+        MESH_CYLINDER,
+        MESH_TORUS
+    };
+
+    // one drawable object of the scene description
+    struct SCENE_OBJECT
+    {
+        int         id;             // stable, in the order objects were added
+        std::string tag;
+        MESH_TYPE   mesh;
+        glm::vec3   scaleXYZ;
+        glm::vec3   rotationDegrees;
+        glm::vec3   positionXYZ;
+        glm::vec4   color;
+        std::string textureTag;     // empty draws with color
+        glm::vec2   uvScale;
+        std::string materialTag;
+        int         cell;           // -1 when outside of every cell
+        glm::vec3   boundsMin;      // world space bounds
+        glm::vec3   boundsMax;
+        uint32_t    mortonCode;     // of the bounds center within the scene bounds
+    };
+
 private:
+    // the CPU microbenchmarks in Tools/Benchmarks drive the private helpers
+    friend class SceneManagerBenchmarkAccess;
+
     ShaderManager* m_pShaderManager;
     ShapeMeshes* m_basicMeshes;
-    int                         m_loadedTextures;
-    TEXTURE_INFO                m_textureIDs[16];
-    std::vector<OBJECT_MATERIAL> m_objectMaterials;
+    // pooled records keep their address; a texture's pool index is its unit
+    RecordPool<TEXTURE_INFO>    m_textureIDs;
+    RecordPool<OBJECT_MATERIAL> m_objectMaterials;
+
+    // froxel volumetric lighting for the camera spotlight
+    VolumetricLighting*          m_pVolumetricLighting;
+    VolumetricLighting::SPOT_LIGHT m_spotLight;
+    bool                        m_bUseVolumetrics;
+    unsigned int                m_frameCount;
+
+    // periodic GPU work spread over frames within a time budget; the
+    // volumetric update samples the camera of the frame it runs in
+    GpuTaskScheduler            m_gpuScheduler;
+    int                         m_volumetricTask;
+    VolumetricLighting::CAMERA_STATE m_volumetricCamera;
+    // meshes drawn by the last RenderScene, for the live metrics
+    unsigned int                m_frameDrawCalls;
+
+    // directional and point lights, the static ones can be baked into
+    // the shader; m_pShaderManager is the baked program while one is
+    // ready and m_pDynamicShaderManager, with uniform lights, otherwise
+    StaticLightBaker::SCENE_LIGHTS m_sceneLights;
+    StaticLightBaker*           m_pLightBaker;
+    ShaderManager*              m_pDynamicShaderManager;
+
+    // the basic meshes in one storage buffer for vertex pulling, NULL
+    // while they are drawn through the vertex arrays of ShapeMeshes
+    VertexPullingArena*         m_pVertexArena;
+    // world and normal matrices of the objects composed by a compute
+    // pass, one root node per object ID slotted in storage order; only
+    // with vertex pulling
+    GpuTransforms*              m_pGpuTransforms;
+
+    // warm start snapshot of the prepared scene; mapped during
+    // PrepareScene when the file is current, written after it otherwise
+    std::string                 m_snapshotFile;
+    SceneSnapshot               m_snapshot;
+    bool                        m_bSnapshotComplete;
+
+    // offscreen main pass and half resolution screen space reflections
+    SceneRenderTarget*          m_pRenderTarget;
+    ScreenSpaceReflections*     m_pReflections;
+    bool                        m_bUseReflections;
+    int                         m_renderWidth;
+    int                         m_renderHeight;
+
+    // checkerboard rendering and its comparison against full rate
+    CheckerboardRenderer*       m_pCheckerboard;
+    bool                        m_bUseCheckerboard;
+    bool                        m_bCompareCheckerboard;
+    GpuTimer                    m_mainPassTimer;
+    GpuTimer                    m_fullRateTimer;
+    glm::mat4                   m_previousViewProjection;
+
+    // box queries against the main pass depth, which decide through
+    // conditional rendering whether objects are drawn the next frame
+    OcclusionCuller*            m_pOcclusionCuller;
+    bool                        m_bUseOcclusionCulling;
+    bool                        m_bOcclusionDraws;  // while the main pass draws
+
+    // scene description split into cells connected by portals
+    std::vector<SCENE_OBJECT>   m_sceneObjects;
+    std::vector<int>            m_drawList;
+    PortalVisibility            m_portalVisibility;
+
+    // object storage kept in Morton order of the object centers
+    std::vector<int>            m_objectSlots;      // index of each object id
+    bool                        m_bUseSpatialOrder;
+    bool                        m_bSpatialOrderDirty;
+    bool                        m_bSceneBoundsValid;
+    glm::vec3                   m_sceneBoundsMin;
+    glm::vec3                   m_sceneBoundsMax;
+    CpuTimer                    m_cullTimer;
+    CpuTimer                    m_drawListTimer;
+    CpuTimer                    m_frameTimer;
+    // rolling trace of recent frames, dumped when a frame spikes
+    FrameSpikeDetector          m_spikeDetector;
 
     bool CreateGLTexture(const char* filename, std::string tag);
     void BindGLTextures();
@@ -62,6 +182,8 @@ private:
     int  FindTextureSlot(std::string tag);
     bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
 
+    void UpdateGpuTransforms();
+
     void SetTransformations(
         glm::vec3 scaleXYZ,
         float      XrotationDegrees,
@@ -84,10 +206,73 @@ private:
     void SetShaderMaterial(
         std::string materialTag);
 
+    void AddSceneObject(
+        const std::string& tag,
+        MESH_TYPE  mesh,
+        glm::vec3  scaleXYZ,
+        glm::vec3  rotationDegrees,
+        glm::vec3  positionXYZ,
+        glm::vec4  color,
+        const std::string& textureTag,
+        glm::vec2  uvScale,
+        const std::string& materialTag);
+    void UpdateObjectBounds(SCENE_OBJECT& object);
+    uint32_t ComputeMortonCode(const SCENE_OBJECT& object) const;
+    void UpdateSpatialOrder();
+    void BuildDrawList(const glm::mat4& viewProjection, const glm::vec3& cameraPos);
+
+    void UpdateLightProgram();
+    void DrawBasicMesh(MESH_TYPE mesh);
+    void CaptureMeshesForPulling();
+    bool LoadSnapshotTexture(const char* filename, const std::string& tag);
+    bool RestoreMaterials();
+    bool RestoreSceneObjects();
+    void FinishSnapshot();
+    void ReportPassTimings();
+    void RecordGpuTimings();
+    static void UpdateVolumetrics(void* pScene);
+    bool BeginMainPass(int windowWidth, int windowHeight);
+    void EndMainPass(int windowWidth, int windowHeight, const glm::mat4& view, const glm::mat4& projection);
+
 public:
     // the student‐customizable methods
     void PrepareScene();
     void RenderScene();
+    void RenderSceneObjects();
+    // render one camera view into the passed in target, without the
+    // temporal passes, for the render server
+    void RenderView(SceneRenderTarget& target, const glm::vec3& cameraPos, const glm::vec3& cameraFront);
     void SetupSceneLights(const glm::vec3& cameraPos, const glm::vec3& cameraFront);
+    // render the main pass at a fixed resolution, 0 follows the window
+    void SetRenderResolution(int width, int height);
+    // portal culling results of the last rendered frame
+    const PortalVisibility::CULLING_STATS& GetCullingStats() const { return m_portalVisibility.GetStats(); }
+    // move a scene object, its storage order is updated before the next frame
+    void MoveSceneObject(int id, const glm::vec3& positionXYZ);
+    // frame spike detection settings and results
+    FrameSpikeDetector& GetSpikeDetector() { return m_spikeDetector; }
+    // budget and tasks of the periodic GPU work
+    GpuTaskScheduler& GetGpuScheduler() { return m_gpuScheduler; }
+    // mesh draws of the last RenderScene, and resource loads and shader
+    // bakes still in flight, for the live metrics
+    unsigned int GetFrameDrawCalls() const { return m_frameDrawCalls; }
+    int GetLoadingQueueDepth() const;
+    // warm start PrepareScene from a snapshot file, or write it after a
+    // cold start; call before PrepareScene, returns true on a warm start
+    bool UseSnapshot(const char* filename);
+    // warm start from a snapshot mapped by the caller, nothing is written
+    bool UseSnapshot(const SceneSnapshot& snapshot);
+    // true when PrepareScene restored everything from the snapshot
+    bool IsWarmStart() const { return m_bSnapshotComplete; }
+    // draw the meshes through vertex pulling, call before PrepareScene;
+    // the vertex shader is the one VertexPullingArena::WritePulledShader wrote
+    bool EnableVertexPulling(const char* pulledShaderFile, const char* fragmentShaderFile);
+    // compile the static lights into the shader files in the background
+    bool EnableStaticLights(const char* vertexShaderFile, const char* fragmentShaderFile);
+    // edit the lights, static ones are baked again before they show
+    void SetSceneLights(const StaticLightBaker::SCENE_LIGHTS& lights);
+    const StaticLightBaker::SCENE_LIGHTS& GetSceneLights() const { return m_sceneLights; }
+    // the program the scene renders with, baked or the application's
+    ShaderManager* GetShaderManager() const { return m_pShaderManager; }
 
 };
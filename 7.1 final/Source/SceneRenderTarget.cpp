@@ -0,0 +1,199 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenerendertarget.cpp
+// ============
+// offscreen framebuffer for the main pass
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneRenderTarget.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// internal formats of the color attachments
+	const GLenum g_AttachmentFormats[SceneRenderTarget::ATTACHMENT_COUNT] = {
+		GL_RGBA16F,
+		GL_RGBA16F,
+		GL_RG16F,
+		GL_R32UI };
+}
+
+/***********************************************************
+ *  SceneRenderTarget()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneRenderTarget::SceneRenderTarget()
+{
+	m_framebuffer = 0;
+	m_depthTexture = 0;
+	m_width = 0;
+	m_height = 0;
+	for (int i = 0; i < ATTACHMENT_COUNT; i++)
+		m_textures[i] = 0;
+}
+
+/***********************************************************
+ *  ~SceneRenderTarget()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneRenderTarget::~SceneRenderTarget()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the framebuffer and all
+ *  of its attachments.
+ ***********************************************************/
+void SceneRenderTarget::Destroy()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteTextures(ATTACHMENT_COUNT, m_textures);
+		glDeleteTextures(1, &m_depthTexture);
+	}
+
+	m_framebuffer = 0;
+	m_depthTexture = 0;
+	for (int i = 0; i < ATTACHMENT_COUNT; i++)
+		m_textures[i] = 0;
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for creating the framebuffer at the
+ *  passed in size. Nothing happens if the size is unchanged.
+ ***********************************************************/
+bool SceneRenderTarget::Resize(int width, int height)
+{
+	if (m_framebuffer != 0 && width == m_width && height == m_height)
+		return true;
+
+	Destroy();
+	m_width = width;
+	m_height = height;
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+	glGenTextures(ATTACHMENT_COUNT, m_textures);
+	GLenum drawBuffers[ATTACHMENT_COUNT];
+	for (int i = 0; i < ATTACHMENT_COUNT; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, g_AttachmentFormats[i], width, height);
+		// integer textures cannot be filtered
+		GLint filter = (g_AttachmentFormats[i] == GL_R32UI) ? GL_NEAREST : GL_LINEAR;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, m_textures[i], 0);
+		drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+	glDrawBuffers(ATTACHMENT_COUNT, drawBuffers);
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Scene render target is incomplete, status:" << status << std::endl;
+		Destroy();
+		return false;
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for directing the following draws
+ *  into the offscreen framebuffer.
+ ***********************************************************/
+void SceneRenderTarget::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for clearing the bound framebuffer
+ *  before the main pass. The stencil buffer is not cleared
+ *  since it can hold a persistent pattern (checkerboard).
+ ***********************************************************/
+void SceneRenderTarget::Clear(const glm::vec4& clearColor)
+{
+	const GLuint clearObjectID[4] = { 0, 0, 0, 0 };
+
+	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// glClear leaves integer color buffers undefined
+	glClearBufferuiv(GL_COLOR, OBJECT_ID_ATTACHMENT, clearObjectID);
+}
+
+/***********************************************************
+ *  BlitToDefault()
+ *
+ *  This method is used for copying the lit color into the
+ *  window, scaling it when the render resolution differs.
+ ***********************************************************/
+void SceneRenderTarget::BlitToDefault(int windowWidth, int windowHeight)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glReadBuffer(GL_COLOR_ATTACHMENT0 + COLOR_ATTACHMENT);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, m_width, m_height,
+		0, 0, windowWidth, windowHeight,
+		GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, windowWidth, windowHeight);
+}
+
+/***********************************************************
+ *  ProgramWritesAttachment()
+ *
+ *  This method is used for checking that a program renders
+ *  into the passed in attachment, so passes reading it do
+ *  not work on undefined data. The active outputs are
+ *  listed through the program interface query.
+ ***********************************************************/
+bool SceneRenderTarget::ProgramWritesAttachment(GLuint program, ATTACHMENT attachment)
+{
+	if (!GLEW_VERSION_4_3 || program == 0)
+		return false;
+
+	GLint outputCount = 0;
+	glGetProgramInterfaceiv(program, GL_PROGRAM_OUTPUT, GL_ACTIVE_RESOURCES, &outputCount);
+	const GLenum locationProperty = GL_LOCATION;
+	for (GLint i = 0; i < outputCount; i++)
+	{
+		GLint location = -1;
+		glGetProgramResourceiv(program, GL_PROGRAM_OUTPUT, (GLuint)i, 1, &locationProperty, 1, NULL, &location);
+		if (location == (GLint)attachment)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenerendertarget.h
+// ============
+// offscreen framebuffer that the main pass renders into when screen space
+// effects need its color, surface and depth buffers
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+class SceneRenderTarget
+{
+public:
+	// color attachment indices, matching the fragment shader outputs
+	enum ATTACHMENT
+	{
+		COLOR_ATTACHMENT = 0,    // lit color (RGBA16F)
+		SURFACE_ATTACHMENT = 1,  // octahedral normal, roughness, reflectivity (RGBA16F)
+		VELOCITY_ATTACHMENT = 2, // screen space motion since the last frame (RG16F)
+		OBJECT_ID_ATTACHMENT = 3,// per draw object identifier (R32UI)
+		ATTACHMENT_COUNT = 4
+	};
+
+	// constructor
+	SceneRenderTarget();
+	// destructor
+	~SceneRenderTarget();
+
+	// (re)create the attachments if the requested size changed
+	bool Resize(int width, int height);
+	// bind the framebuffer for rendering and set the viewport
+	void Bind();
+	// clear color, depth and the object IDs, leaving the stencil intact
+	void Clear(const glm::vec4& clearColor);
+	// copy the lit color to the default framebuffer at the window size
+	void BlitToDefault(int windowWidth, int windowHeight);
+
+	// whether the linked program has a fragment output at the location of
+	// the attachment, needs OpenGL 4.3
+	static bool ProgramWritesAttachment(GLuint program, ATTACHMENT attachment);
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	GLuint GetFramebuffer() const { return m_framebuffer; }
+	GLuint GetColorTexture() const { return m_textures[COLOR_ATTACHMENT]; }
+	GLuint GetSurfaceTexture() const { return m_textures[SURFACE_ATTACHMENT]; }
+	GLuint GetVelocityTexture() const { return m_textures[VELOCITY_ATTACHMENT]; }
+	GLuint GetObjectIDTexture() const { return m_textures[OBJECT_ID_ATTACHMENT]; }
+	// combined depth (24 bit) and stencil (8 bit) texture
+	GLuint GetDepthTexture() const { return m_depthTexture; }
+
+private:
+	GLuint m_framebuffer;
+	GLuint m_textures[ATTACHMENT_COUNT];
+	GLuint m_depthTexture;
+	int    m_width;
+	int    m_height;
+
+	void Destroy();
+};
@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenesnapshot.cpp
+// ============
+// one aligned file holding the prepared scene for a warm start
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneSnapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	const char g_SnapshotMagic[8] = { 'S', 'C', 'N', 'S', 'N', 'A', 'P', '\0' };
+
+	uint64_t AlignOffset(uint64_t offset)
+	{
+		return (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+	}
+}
+
+/***********************************************************
+ *  SceneSnapshot()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneSnapshot::SceneSnapshot()
+{
+	m_pMapping = NULL;
+	m_mappingSize = 0;
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+	m_bShared = false;
+}
+
+/***********************************************************
+ *  ~SceneSnapshot()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneSnapshot::~SceneSnapshot()
+{
+	Unmap();
+}
+
+/***********************************************************
+ *  AddChunk()
+ *
+ *  This method is used for collecting a chunk to be written.
+ ***********************************************************/
+void SceneSnapshot::AddChunk(SNAPSHOT_CHUNK type, const char* name, const void* data, size_t size)
+{
+	PENDING_CHUNK chunk;
+	chunk.type = type;
+	chunk.name = name;
+	chunk.data.assign((const char*)data, (const char*)data + size);
+	m_pendingChunks.push_back(chunk);
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for writing the header, the chunk
+ *  table and the aligned chunk data into the passed in file.
+ *  The file is written under a temporary name and renamed,
+ *  so a crash never leaves a partial snapshot behind.
+ ***********************************************************/
+bool SceneSnapshot::Write(const char* filename) const
+{
+	SNAPSHOT_FILE_HEADER header;
+	memcpy(header.magic, g_SnapshotMagic, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.chunkCount = (uint32_t)m_pendingChunks.size();
+	if (!GetBuildStamp(header.buildSize, header.buildTime))
+	{
+		header.buildSize = 0;
+		header.buildTime = 0;
+	}
+
+	std::vector<SNAPSHOT_CHUNK_ENTRY> table(m_pendingChunks.size());
+	uint64_t offset = AlignOffset(sizeof(header) + table.size() * sizeof(SNAPSHOT_CHUNK_ENTRY));
+	for (size_t i = 0; i < m_pendingChunks.size(); i++)
+	{
+		memset(&table[i], 0, sizeof(SNAPSHOT_CHUNK_ENTRY));
+		table[i].type = (uint32_t)m_pendingChunks[i].type;
+		table[i].offset = offset;
+		table[i].size = m_pendingChunks[i].data.size();
+		strncpy(table[i].name, m_pendingChunks[i].name.c_str(), SNAPSHOT_NAME_LENGTH - 1);
+		offset = AlignOffset(offset + table[i].size);
+	}
+	header.fileSize = offset;
+
+	std::string temporaryFile = std::string(filename) + ".tmp";
+	FILE* file = fopen(temporaryFile.c_str(), "wb");
+	if (NULL == file)
+	{
+		std::cout << "[ERROR] Could not create snapshot " << temporaryFile << std::endl;
+		return false;
+	}
+
+	bool bWritten = (fwrite(&header, sizeof(header), 1, file) == 1);
+	if (!table.empty())
+		bWritten = bWritten && (fwrite(&table[0], sizeof(SNAPSHOT_CHUNK_ENTRY), table.size(), file) == table.size());
+
+	static const char padding[SNAPSHOT_ALIGNMENT] = { 0 };
+	uint64_t position = sizeof(header) + table.size() * sizeof(SNAPSHOT_CHUNK_ENTRY);
+	for (size_t i = 0; i < m_pendingChunks.size() && bWritten; i++)
+	{
+		bWritten = (fwrite(padding, 1, (size_t)(table[i].offset - position), file) == table[i].offset - position);
+		const std::vector<char>& data = m_pendingChunks[i].data;
+		if (!data.empty())
+			bWritten = bWritten && (fwrite(&data[0], 1, data.size(), file) == data.size());
+		position = table[i].offset + table[i].size;
+	}
+	bWritten = bWritten && (fwrite(padding, 1, (size_t)(header.fileSize - position), file) == header.fileSize - position);
+	bWritten = (fclose(file) == 0) && bWritten;
+
+	remove(filename);
+	if (!bWritten || rename(temporaryFile.c_str(), filename) != 0)
+	{
+		std::cout << "[ERROR] Could not write snapshot " << filename << std::endl;
+		remove(temporaryFile.c_str());
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  Map()
+ *
+ *  This method is used for mapping a snapshot file read
+ *  only and validating its header and chunk table against
+ *  the file size. A snapshot of another version is refused.
+ ***********************************************************/
+bool SceneSnapshot::Map(const char* filename)
+{
+	Unmap();
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = NULL;
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const void* pView = (NULL != mapping) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (NULL == pView)
+	{
+		if (NULL != mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_mappingSize = (size_t)fileSize.QuadPart;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+		return false;
+	struct stat fileStat;
+	void* pView = MAP_FAILED;
+	if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+		pView = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (pView == MAP_FAILED)
+		return false;
+	m_mappingSize = (size_t)fileStat.st_size;
+#endif
+	m_pMapping = (const char*)pView;
+
+	const SNAPSHOT_FILE_HEADER* pHeader = (const SNAPSHOT_FILE_HEADER*)m_pMapping;
+	bool bValid = m_mappingSize >= sizeof(SNAPSHOT_FILE_HEADER) &&
+		memcmp(pHeader->magic, g_SnapshotMagic, sizeof(g_SnapshotMagic)) == 0 &&
+		pHeader->version == SNAPSHOT_VERSION &&
+		pHeader->fileSize == m_mappingSize &&
+		sizeof(SNAPSHOT_FILE_HEADER) + (uint64_t)pHeader->chunkCount * sizeof(SNAPSHOT_CHUNK_ENTRY) <= m_mappingSize;
+
+	const SNAPSHOT_CHUNK_ENTRY* pTable = GetChunkTable();
+	for (uint32_t i = 0; bValid && i < pHeader->chunkCount; i++)
+	{
+		bValid = (pTable[i].offset % SNAPSHOT_ALIGNMENT) == 0 && pTable[i].offset <= m_mappingSize &&
+			pTable[i].size <= m_mappingSize - pTable[i].offset && pTable[i].name[SNAPSHOT_NAME_LENGTH - 1] == '\0';
+	}
+	if (!bValid)
+	{
+		std::cout << "[WARNING] Snapshot " << filename << " is invalid or from another version" << std::endl;
+		Unmap();
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  Share()
+ *
+ *  This method is used for reading the chunks of a snapshot
+ *  another object mapped, e.g. one mapped before fork().
+ ***********************************************************/
+void SceneSnapshot::Share(const SceneSnapshot& snapshot)
+{
+	Unmap();
+	m_pMapping = snapshot.m_pMapping;
+	m_mappingSize = snapshot.m_mappingSize;
+	m_bShared = (NULL != m_pMapping);
+}
+
+/***********************************************************
+ *  Unmap()
+ *
+ *  This method is used for releasing the mapped file.
+ ***********************************************************/
+void SceneSnapshot::Unmap()
+{
+	if (NULL == m_pMapping)
+		return;
+
+	if (!m_bShared)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(m_pMapping);
+		CloseHandle((HANDLE)m_mappingHandle);
+		CloseHandle((HANDLE)m_fileHandle);
+#else
+		munmap((void*)m_pMapping, m_mappingSize);
+#endif
+	}
+	m_bShared = false;
+	m_pMapping = NULL;
+	m_mappingSize = 0;
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+}
+
+/***********************************************************
+ *  FindChunk()
+ *
+ *  This method is used for looking up a mapped chunk by
+ *  its type and name.
+ ***********************************************************/
+const void* SceneSnapshot::FindChunk(SNAPSHOT_CHUNK type, const char* name, size_t* pSize) const
+{
+	if (NULL == m_pMapping)
+		return NULL;
+
+	const SNAPSHOT_FILE_HEADER* pHeader = (const SNAPSHOT_FILE_HEADER*)m_pMapping;
+	const SNAPSHOT_CHUNK_ENTRY* pTable = GetChunkTable();
+	for (uint32_t i = 0; i < pHeader->chunkCount; i++)
+	{
+		if (pTable[i].type == (uint32_t)type && strcmp(pTable[i].name, name) == 0)
+		{
+			if (NULL != pSize)
+				*pSize = (size_t)pTable[i].size;
+			return m_pMapping + pTable[i].offset;
+		}
+	}
+	return NULL;
+}
+
+/***********************************************************
+ *  IsFromThisBuild()
+ *
+ *  This method is used for comparing the executable stamp
+ *  in the mapped header with the running executable. The
+ *  scene description chunks are stale after any rebuild,
+ *  since an edit of the code defining them leaves no other
+ *  trace in the snapshot.
+ ***********************************************************/
+bool SceneSnapshot::IsFromThisBuild() const
+{
+	if (NULL == m_pMapping)
+		return false;
+
+	uint64_t size = 0;
+	int64_t time = 0;
+	if (!GetBuildStamp(size, time))
+		return false;
+
+	const SNAPSHOT_FILE_HEADER* pHeader = (const SNAPSHOT_FILE_HEADER*)m_pMapping;
+	return pHeader->buildSize == size && pHeader->buildTime == time;
+}
+
+const SNAPSHOT_CHUNK_ENTRY* SceneSnapshot::GetChunkTable() const
+{
+	return (const SNAPSHOT_CHUNK_ENTRY*)(m_pMapping + sizeof(SNAPSHOT_FILE_HEADER));
+}
+
+/***********************************************************
+ *  GetFileStamp()
+ *
+ *  This method is used for reading the size and the last
+ *  modification time of a file, which decide whether data
+ *  derived from it in a snapshot is still current.
+ ***********************************************************/
+bool SceneSnapshot::GetFileStamp(const char* filename, uint64_t& size, int64_t& time)
+{
+#if defined(_WIN32)
+	struct _stat64 fileStat;
+	if (_stat64(filename, &fileStat) != 0)
+		return false;
+#else
+	struct stat fileStat;
+	if (stat(filename, &fileStat) != 0)
+		return false;
+#endif
+	size = (uint64_t)fileStat.st_size;
+	time = (int64_t)fileStat.st_mtime;
+	return true;
+}
+
+/***********************************************************
+ *  GetBuildStamp()
+ *
+ *  This method is used for reading the file stamp of the
+ *  running executable, which changes with every build.
+ ***********************************************************/
+bool SceneSnapshot::GetBuildStamp(uint64_t& size, int64_t& time)
+{
+	char path[4096];
+#if defined(_WIN32)
+	DWORD length = GetModuleFileNameA(NULL, path, sizeof(path));
+	if (length == 0 || length >= sizeof(path))
+		return false;
+#else
+	ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+	if (length <= 0)
+		return false;
+	path[length] = '\0';
+#endif
+	return GetFileStamp(path, size, time);
+}
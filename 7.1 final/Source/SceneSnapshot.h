@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenesnapshot.h
+// ============
+// one aligned file holding the prepared scene for a warm start
+//
+//	A snapshot is a header, a table of chunks and the chunk data, each
+//	chunk starting on a SNAPSHOT_ALIGNMENT boundary. It is written once
+//	after PrepareScene and memory mapped on the next launch, so texture
+//	mip chains, program binaries and mesh data are uploaded straight from
+//	the mapping without decoding or copying. The chunk payloads below are
+//	plain records, so they are only valid for the build that wrote them;
+//	the version is bumped whenever one of them changes. Textures and
+//	programs carry the stamp of their source file, while the materials,
+//	objects and meshes are defined in code and checked against the stamp
+//	of the executable in the file header.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// chunk data offsets are multiples of this, enough for any upload path
+const uint32_t SNAPSHOT_ALIGNMENT = 64;
+const uint32_t SNAPSHOT_VERSION = 3;
+const int SNAPSHOT_NAME_LENGTH = 48;
+
+// what a chunk holds
+enum SNAPSHOT_CHUNK
+{
+	SNAPSHOT_TEXTURE = 1,       // SNAPSHOT_TEXTURE_HEADER and the mip levels
+	SNAPSHOT_MATERIALS,         // SNAPSHOT_MATERIAL records
+	SNAPSHOT_OBJECTS,           // SNAPSHOT_OBJECT records
+	SNAPSHOT_PROGRAM,           // binary format, shader file stamp and binary
+	SNAPSHOT_MESHES             // see VertexPullingArena
+};
+
+struct SNAPSHOT_FILE_HEADER
+{
+	char     magic[8];          // "SCNSNAP\0"
+	uint32_t version;
+	uint32_t chunkCount;
+	uint64_t fileSize;
+	uint64_t buildSize;         // executable that wrote the snapshot
+	int64_t  buildTime;
+};
+
+struct SNAPSHOT_CHUNK_ENTRY
+{
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t size;
+	char     name[SNAPSHOT_NAME_LENGTH];
+};
+
+// a texture and its complete mip chain, tightly packed rows
+struct SNAPSHOT_TEXTURE_HEADER
+{
+	static const int MAX_LEVELS = 16;
+
+	uint64_t sourceSize;        // image file the texture was decoded from
+	int64_t  sourceTime;
+	int32_t  width;
+	int32_t  height;
+	int32_t  levels;
+	uint32_t internalFormat;
+	uint32_t format;
+	uint32_t reserved;
+	uint64_t levelOffsets[MAX_LEVELS];  // from the start of the chunk
+	uint64_t levelSizes[MAX_LEVELS];
+};
+
+struct SNAPSHOT_MATERIAL
+{
+	float ambientStrength;
+	float ambientColor[3];
+	float diffuseColor[3];
+	float specularColor[3];
+	float shininess;
+	char  tag[SNAPSHOT_NAME_LENGTH];
+};
+
+struct SNAPSHOT_OBJECT
+{
+	int32_t mesh;
+	float   scaleXYZ[3];
+	float   rotationDegrees[3];
+	float   positionXYZ[3];
+	float   color[4];
+	float   uvScale[2];
+	char    tag[SNAPSHOT_NAME_LENGTH];
+	char    textureTag[SNAPSHOT_NAME_LENGTH];
+	char    materialTag[SNAPSHOT_NAME_LENGTH];
+};
+
+class SceneSnapshot
+{
+public:
+	// constructor
+	SceneSnapshot();
+	// destructor
+	~SceneSnapshot();
+
+	// collect a chunk for Write, the data is copied
+	void AddChunk(SNAPSHOT_CHUNK type, const char* name, const void* data, size_t size);
+	// write the collected chunks into the passed in file
+	bool Write(const char* filename) const;
+
+	// map a snapshot file, checking its header and chunk table
+	bool Map(const char* filename);
+	// use the mapping of another snapshot, which must stay mapped
+	void Share(const SceneSnapshot& snapshot);
+	void Unmap();
+	bool IsMapped() const { return m_pMapping != NULL; }
+
+	// a mapped chunk by type and name, NULL when there is none
+	const void* FindChunk(SNAPSHOT_CHUNK type, const char* name, size_t* pSize) const;
+	// whether the running executable wrote the mapped snapshot, which the
+	// chunks defined in code need
+	bool IsFromThisBuild() const;
+
+	// the modification time and size of a source file, false if missing
+	static bool GetFileStamp(const char* filename, uint64_t& size, int64_t& time);
+	// the same for the running executable
+	static bool GetBuildStamp(uint64_t& size, int64_t& time);
+
+private:
+	// chunks collected for writing
+	struct PENDING_CHUNK
+	{
+		SNAPSHOT_CHUNK    type;
+		std::string       name;
+		std::vector<char> data;
+	};
+	std::vector<PENDING_CHUNK> m_pendingChunks;
+
+	// the mapped file
+	const char*         m_pMapping;
+	size_t              m_mappingSize;
+	void*               m_fileHandle;
+	void*               m_mappingHandle;
+	bool                m_bShared;
+
+	const SNAPSHOT_CHUNK_ENTRY* GetChunkTable() const;
+};
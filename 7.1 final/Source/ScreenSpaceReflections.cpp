@@ -0,0 +1,275 @@
+///////////////////////////////////////////////////////////////////////////////
+// screenspacereflections.cpp
+// ============
+// half resolution, hierarchical-Z traced screen space reflections
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ScreenSpaceReflections.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_HiZShaderFile = "ssr_hiz.comp";
+	const char* g_TraceShaderFile = "ssr_trace.comp";
+	const char* g_ResolveShaderFile = "ssr_resolve.comp";
+	const char* g_CompositeShaderFile = "ssr_composite.comp";
+
+	// compute work group size used by every pass
+	const int g_GroupSize = 8;
+
+	// the passes sample from units above the ones the scene textures
+	// stay bound to (see SceneManager::BindGLTextures)
+	const int g_TextureUnitBase = 16;
+
+	void BindTexture(int unit, GLenum target, GLuint textureID)
+	{
+		glActiveTexture(GL_TEXTURE0 + g_TextureUnitBase + unit);
+		glBindTexture(target, textureID);
+	}
+
+	GLuint GroupCount(int size)
+	{
+		return (GLuint)((size + g_GroupSize - 1) / g_GroupSize);
+	}
+
+	GLuint CreateTexture2D(GLenum format, int width, int height, int levels)
+	{
+		GLuint textureID = 0;
+
+		glGenTextures(1, &textureID);
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		glTexStorage2D(GL_TEXTURE_2D, levels, format, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, levels > 1 ? GL_NEAREST : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		return textureID;
+	}
+}
+
+/***********************************************************
+ *  ScreenSpaceReflections()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ScreenSpaceReflections::ScreenSpaceReflections()
+	: m_timer("Screen space reflections")
+{
+	m_maxDistance = 15.0f;
+	m_thickness = 0.002f;
+	m_maxIterations = 64;
+	m_fallbackColor = glm::vec3(0.05f, 0.05f, 0.1f);
+
+	m_hizTexture = 0;
+	m_hizLevels = 0;
+	m_traceTexture = 0;
+	m_historyTextures[0] = 0;
+	m_historyTextures[1] = 0;
+	m_historyIndex = 0;
+	m_bHistoryValid = false;
+	m_width = 0;
+	m_height = 0;
+	m_traceWidth = 0;
+	m_traceHeight = 0;
+	m_environmentProbe = 0;
+}
+
+/***********************************************************
+ *  ~ScreenSpaceReflections()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ScreenSpaceReflections::~ScreenSpaceReflections()
+{
+	DestroyTextures();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the compute passes.
+ ***********************************************************/
+bool ScreenSpaceReflections::Initialize()
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "Screen space reflections disabled: OpenGL 4.3 is required" << std::endl;
+		return false;
+	}
+
+	return m_hizProgram.Load(g_HiZShaderFile) &&
+		m_traceProgram.Load(g_TraceShaderFile) &&
+		m_resolveProgram.Load(g_ResolveShaderFile) &&
+		m_compositeProgram.Load(g_CompositeShaderFile);
+}
+
+/***********************************************************
+ *  DestroyTextures()
+ *
+ *  This method is used for freeing the intermediate textures.
+ ***********************************************************/
+void ScreenSpaceReflections::DestroyTextures()
+{
+	if (m_hizTexture != 0)
+	{
+		glDeleteTextures(1, &m_hizTexture);
+		glDeleteTextures(1, &m_traceTexture);
+		glDeleteTextures(2, m_historyTextures);
+	}
+
+	m_hizTexture = 0;
+	m_traceTexture = 0;
+	m_historyTextures[0] = 0;
+	m_historyTextures[1] = 0;
+}
+
+/***********************************************************
+ *  ResizeTextures()
+ *
+ *  This method is used for matching the intermediate textures
+ *  to the main pass resolution.
+ ***********************************************************/
+void ScreenSpaceReflections::ResizeTextures(int width, int height)
+{
+	if (m_hizTexture != 0 && width == m_width && height == m_height)
+		return;
+
+	DestroyTextures();
+
+	m_width = width;
+	m_height = height;
+	m_traceWidth = std::max(1, width / 2);
+	m_traceHeight = std::max(1, height / 2);
+
+	m_hizLevels = 1;
+	while ((std::max(width, height) >> m_hizLevels) > 0)
+		m_hizLevels++;
+
+	m_hizTexture = CreateTexture2D(GL_R32F, width, height, m_hizLevels);
+	m_traceTexture = CreateTexture2D(GL_RGBA16F, m_traceWidth, m_traceHeight, 1);
+	m_historyTextures[0] = CreateTexture2D(GL_RGBA16F, m_traceWidth, m_traceHeight, 1);
+	m_historyTextures[1] = CreateTexture2D(GL_RGBA16F, m_traceWidth, m_traceHeight, 1);
+	m_bHistoryValid = false;
+}
+
+/***********************************************************
+ *  BuildHiZ()
+ *
+ *  This method is used for reducing the depth buffer into
+ *  the min-depth mip chain, one dispatch per level.
+ ***********************************************************/
+void ScreenSpaceReflections::BuildHiZ(SceneRenderTarget& target)
+{
+	m_hizProgram.use();
+	m_hizProgram.setIntValue("uDepth", g_TextureUnitBase + 0);
+	m_hizProgram.setIntValue("uHiZ", g_TextureUnitBase + 1);
+
+	BindTexture(0, GL_TEXTURE_2D, target.GetDepthTexture());
+	BindTexture(1, GL_TEXTURE_2D, m_hizTexture);
+
+	for (int level = 0; level < m_hizLevels; level++)
+	{
+		int levelWidth = std::max(1, m_width >> level);
+		int levelHeight = std::max(1, m_height >> level);
+
+		m_hizProgram.setIntValue("uLevel", level);
+		glBindImageTexture(0, m_hizTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		m_hizProgram.Dispatch(GroupCount(levelWidth), GroupCount(levelHeight), 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method is used for running every reflection pass on
+ *  the main pass output held by the passed in render target.
+ ***********************************************************/
+void ScreenSpaceReflections::Render(SceneRenderTarget& target, const glm::mat4& view, const glm::mat4& projection)
+{
+	if (!m_compositeProgram.IsLoaded() || target.GetFramebuffer() == 0)
+		return;
+
+	ResizeTextures(target.GetWidth(), target.GetHeight());
+
+	glm::mat4 viewProjection = projection * view;
+	int writeIndex = 1 - m_historyIndex;
+
+	m_timer.Begin();
+
+	BuildHiZ(target);
+
+	// half resolution Hi-Z ray march
+	m_traceProgram.use();
+	m_traceProgram.setMat4Value("uView", view);
+	m_traceProgram.setMat4Value("uProjection", projection);
+	m_traceProgram.setMat4Value("uInvProjection", glm::inverse(projection));
+	m_traceProgram.setMat4Value("uInvView", glm::inverse(view));
+	m_traceProgram.setIntValue("uHiZLevels", m_hizLevels);
+	m_traceProgram.setIntValue("uMaxIterations", m_maxIterations);
+	m_traceProgram.setFloatValue("uMaxDistance", m_maxDistance);
+	m_traceProgram.setFloatValue("uThickness", m_thickness);
+	m_traceProgram.setVec3Value("uFallbackColor", m_fallbackColor);
+	m_traceProgram.setIntValue("uUseEnvironmentProbe", m_environmentProbe != 0);
+	m_traceProgram.setIntValue("uHiZ", g_TextureUnitBase + 0);
+	m_traceProgram.setIntValue("uColor", g_TextureUnitBase + 1);
+	m_traceProgram.setIntValue("uSurface", g_TextureUnitBase + 2);
+	m_traceProgram.setIntValue("uEnvironmentProbe", g_TextureUnitBase + 3);
+
+	BindTexture(0, GL_TEXTURE_2D, m_hizTexture);
+	BindTexture(1, GL_TEXTURE_2D, target.GetColorTexture());
+	BindTexture(2, GL_TEXTURE_2D, target.GetSurfaceTexture());
+	BindTexture(3, GL_TEXTURE_CUBE_MAP, m_environmentProbe);
+	glBindImageTexture(0, m_traceTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	m_traceProgram.Dispatch(GroupCount(m_traceWidth), GroupCount(m_traceHeight), 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	// roughness aware temporal accumulation
+	m_resolveProgram.use();
+	m_resolveProgram.setMat4Value("uInvViewProjection", glm::inverse(viewProjection));
+	m_resolveProgram.setMat4Value("uPrevViewProjection", m_previousViewProjection);
+	m_resolveProgram.setIntValue("uHistoryValid", m_bHistoryValid);
+	m_resolveProgram.setIntValue("uTrace", g_TextureUnitBase + 0);
+	m_resolveProgram.setIntValue("uHistory", g_TextureUnitBase + 1);
+	m_resolveProgram.setIntValue("uSurface", g_TextureUnitBase + 2);
+	m_resolveProgram.setIntValue("uDepth", g_TextureUnitBase + 3);
+
+	BindTexture(0, GL_TEXTURE_2D, m_traceTexture);
+	BindTexture(1, GL_TEXTURE_2D, m_historyTextures[m_historyIndex]);
+	BindTexture(3, GL_TEXTURE_CUBE_MAP, 0);
+	BindTexture(3, GL_TEXTURE_2D, target.GetDepthTexture());
+	glBindImageTexture(0, m_historyTextures[writeIndex], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	m_resolveProgram.Dispatch(GroupCount(m_traceWidth), GroupCount(m_traceHeight), 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	// composite into the full resolution lit color
+	m_compositeProgram.use();
+	m_compositeProgram.setMat4Value("uInvViewProjection", glm::inverse(viewProjection));
+	m_compositeProgram.setMat4Value("uInvView", glm::inverse(view));
+	m_compositeProgram.setIntValue("uReflection", g_TextureUnitBase + 0);
+	m_compositeProgram.setIntValue("uSurface", g_TextureUnitBase + 2);
+	m_compositeProgram.setIntValue("uDepth", g_TextureUnitBase + 3);
+
+	BindTexture(0, GL_TEXTURE_2D, m_historyTextures[writeIndex]);
+	glBindImageTexture(0, target.GetColorTexture(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+
+	m_compositeProgram.Dispatch(GroupCount(m_width), GroupCount(m_height), 1);
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	for (int unit = 0; unit < 4; unit++)
+		BindTexture(unit, GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_timer.End();
+
+	m_historyIndex = writeIndex;
+	m_bHistoryValid = true;
+	m_previousViewProjection = viewProjection;
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// screenspacereflections.h
+// ============
+// half resolution, hierarchical-Z traced screen space reflections
+//
+//	The depth buffer of the main pass is reduced into a min-depth mip
+//	chain (Hi-Z), reflection rays are traced through it at half resolution,
+//	accumulated over time with a roughness dependent blend, and composited
+//	back into the lit color. Rays that leave the screen or pass behind
+//	geometry fall back to the environment probe.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "ComputeProgram.h"
+#include "GpuTimer.h"
+#include "SceneRenderTarget.h"
+
+class ScreenSpaceReflections
+{
+public:
+	// constructor
+	ScreenSpaceReflections();
+	// destructor
+	~ScreenSpaceReflections();
+
+	// compile the Hi-Z, trace, resolve and composite passes
+	bool Initialize();
+	// trace reflections for the main pass and composite them into its color
+	void Render(SceneRenderTarget& target, const glm::mat4& view, const glm::mat4& projection);
+
+	// cube map sampled when a ray misses, 0 uses m_fallbackColor
+	void SetEnvironmentProbe(GLuint cubeMapTexture) { m_environmentProbe = cubeMapTexture; }
+
+	// GPU cost of all reflection passes
+	const GpuTimer& GetTimer() const { return m_timer; }
+	int GetTraceWidth() const { return m_traceWidth; }
+	int GetTraceHeight() const { return m_traceHeight; }
+
+	// trace settings
+	float     m_maxDistance;
+	float     m_thickness;
+	int       m_maxIterations;
+	glm::vec3 m_fallbackColor;
+
+private:
+	ComputeProgram m_hizProgram;
+	ComputeProgram m_traceProgram;
+	ComputeProgram m_resolveProgram;
+	ComputeProgram m_compositeProgram;
+
+	// min-depth mip chain of the main pass depth buffer
+	GLuint m_hizTexture;
+	int    m_hizLevels;
+	// half resolution raw trace result and temporal history
+	GLuint m_traceTexture;
+	GLuint m_historyTextures[2];
+	int    m_historyIndex;
+	bool   m_bHistoryValid;
+
+	int m_width;
+	int m_height;
+	int m_traceWidth;
+	int m_traceHeight;
+
+	glm::mat4 m_previousViewProjection;
+	GLuint    m_environmentProbe;
+	GpuTimer  m_timer;
+
+	void ResizeTextures(int width, int height);
+	void DestroyTextures();
+	void BuildHiZ(SceneRenderTarget& target);
+};
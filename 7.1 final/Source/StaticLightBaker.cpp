@@ -0,0 +1,270 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticlightbaker.cpp
+// ============
+// compile the main shader with the static scene lights as constants
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticLightBaker.h"
+#include "GLTrace.h"
+
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the worker writes the baked source here for the ShaderManager to load
+	const char* g_BakedShaderFile = "static_lights.frag";
+
+	// GLSL float literal that survives a round trip
+	std::string FormatFloat(float value)
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "%.9g", value);
+		std::string literal = text;
+		if (literal.find_first_of(".eE") == std::string::npos)
+			literal += ".0";
+		return literal;
+	}
+
+	std::string FormatVec3(const glm::vec3& value)
+	{
+		return "vec3(" + FormatFloat(value.x) + ", " + FormatFloat(value.y) + ", " + FormatFloat(value.z) + ")";
+	}
+
+	std::string FormatPointLight(const StaticLightBaker::POINT_LIGHT& light)
+	{
+		return "PointLight(" + FormatVec3(light.position) + ", " + FormatVec3(light.ambient) + ", "
+			+ FormatVec3(light.diffuse) + ", " + FormatVec3(light.specular) + ", " + FormatFloat(light.constant) + ", "
+			+ FormatFloat(light.linear) + ", " + FormatFloat(light.quadratic) + ")";
+	}
+}
+
+/***********************************************************
+ *  StaticLightBaker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticLightBaker::StaticLightBaker()
+{
+	m_pContext = NULL;
+	m_bStop = false;
+	m_injectPosition = 0;
+	m_requested = 0;
+	m_started = 0;
+	m_pCompiled = NULL;
+	m_compiled = 0;
+	m_compileMilliseconds = 0.0;
+	m_pBaked = NULL;
+	m_baked = 0;
+}
+
+/***********************************************************
+ *  ~StaticLightBaker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StaticLightBaker::~StaticLightBaker()
+{
+	if (m_worker.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_bStop = true;
+		}
+		m_wake.notify_one();
+		m_worker.join();
+	}
+	if (NULL != m_pContext)
+	{
+		glfwDestroyWindow(m_pContext);
+		m_pContext = NULL;
+	}
+
+	delete m_pCompiled;
+	m_pCompiled = NULL;
+	delete m_pBaked;
+	m_pBaked = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for reading the fragment shader the
+ *  lights are injected into and creating the worker thread
+ *  with an invisible window whose context shares objects
+ *  with the current one.
+ ***********************************************************/
+bool StaticLightBaker::Initialize(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	// the trace recorder only follows the render thread
+	if (GLTrace::IsRecording())
+	{
+		std::cout << "[WARNING] Static lights are not baked while a GL trace is recording" << std::endl;
+		return false;
+	}
+
+	std::ifstream file(fragmentShaderFile);
+	if (!file.is_open())
+	{
+		std::cout << "[ERROR] Could not open fragment shader: " << fragmentShaderFile << std::endl;
+		return false;
+	}
+	std::stringstream sourceStream;
+	sourceStream << file.rdbuf();
+	m_fragmentSource = sourceStream.str();
+
+	// the defines go right after the #version line
+	size_t version = m_fragmentSource.find("#version");
+	if (version == std::string::npos || m_fragmentSource.find("STATIC_DIR_LIGHT") == std::string::npos)
+	{
+		std::cout << "[WARNING] " << fragmentShaderFile << " has no STATIC_ light switches, lights stay uniforms" << std::endl;
+		return false;
+	}
+	m_injectPosition = m_fragmentSource.find('\n', version);
+	m_injectPosition = (m_injectPosition == std::string::npos) ? m_fragmentSource.size() : m_injectPosition + 1;
+	m_vertexShaderFile = vertexShaderFile;
+
+	GLFWwindow* pMainContext = glfwGetCurrentContext();
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_pContext = glfwCreateWindow(1, 1, "static lights", NULL, pMainContext);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (NULL == m_pContext)
+	{
+		std::cout << "[ERROR] Could not create the shared context for baking static lights" << std::endl;
+		return false;
+	}
+
+	m_worker = std::thread(&StaticLightBaker::WorkerLoop, this);
+	return true;
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for requesting a program with the
+ *  static lights of the passed in set as constants. Until
+ *  it is compiled GetBakedProgram returns NULL, so the
+ *  caller goes on uploading the edited lights as uniforms.
+ ***********************************************************/
+bool StaticLightBaker::Bake(const SCENE_LIGHTS& lights)
+{
+	std::string defines;
+	if (lights.dirLight.bStatic)
+	{
+		defines += "#define STATIC_DIR_LIGHT DirLight(" + FormatVec3(lights.dirLight.direction) + ", "
+			+ FormatVec3(lights.dirLight.ambient) + ", " + FormatVec3(lights.dirLight.diffuse) + ", "
+			+ FormatVec3(lights.dirLight.specular) + ")\n";
+	}
+	if (lights.pointLight.bStatic)
+		defines += "#define STATIC_POINT_LIGHT " + FormatPointLight(lights.pointLight) + "\n";
+	if (lights.pointLight2.bStatic)
+		defines += "#define STATIC_POINT_LIGHT2 " + FormatPointLight(lights.pointLight2) + "\n";
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (defines == m_requestedDefines && m_requested != 0)
+			return !defines.empty();
+
+		m_requestedDefines = defines;
+		m_requested++;
+	}
+	if (!defines.empty() && m_worker.joinable())
+		m_wake.notify_one();
+
+	return !defines.empty();
+}
+
+/***********************************************************
+ *  GetBakedProgram()
+ *
+ *  This method is used for picking up the program of the
+ *  latest Bake request once the worker finished it. Older
+ *  programs are released when a newer one takes over.
+ ***********************************************************/
+ShaderManager* StaticLightBaker::GetBakedProgram()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (NULL != m_pCompiled && m_compiled == m_requested)
+	{
+		delete m_pBaked;
+		m_pBaked = m_pCompiled;
+		m_baked = m_compiled;
+		m_pCompiled = NULL;
+		std::cout << "[SHADER] static lights baked in " << m_compileMilliseconds << " ms on the worker thread" << std::endl;
+	}
+
+	return (m_baked == m_requested && !m_requestedDefines.empty()) ? m_pBaked : NULL;
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for compiling the requested programs
+ *  in the shared context of the worker thread. Only the
+ *  latest request is compiled, so a run of edits costs one
+ *  compile once they settle.
+ ***********************************************************/
+void StaticLightBaker::WorkerLoop()
+{
+	glfwMakeContextCurrent(m_pContext);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [this] { return m_bStop || (m_started != m_requested && !m_requestedDefines.empty()); });
+		if (m_bStop)
+			break;
+
+		unsigned int generation = m_requested;
+		std::string source = m_fragmentSource;
+		source.insert(m_injectPosition, m_requestedDefines);
+		m_started = generation;
+		lock.unlock();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		bool bWritten = false;
+		{
+			std::ofstream file(g_BakedShaderFile, std::ios::trunc);
+			file << source;
+			bWritten = file.good();
+		}
+
+		ShaderManager* pProgram = NULL;
+		if (bWritten)
+		{
+			pProgram = new ShaderManager();
+			GLuint programID = pProgram->LoadShaders(m_vertexShaderFile.c_str(), g_BakedShaderFile);
+
+			// the render thread may only use the program once it is complete
+			GLint linked = 0;
+			if (programID != 0)
+				glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+			glFinish();
+			if (!linked)
+			{
+				delete pProgram;
+				pProgram = NULL;
+			}
+		}
+		if (NULL == pProgram)
+			std::cout << "[ERROR] Baking the static lights failed, they stay uniforms" << std::endl;
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		lock.lock();
+		delete m_pCompiled;
+		m_pCompiled = pProgram;
+		m_compiled = generation;
+		m_compileMilliseconds = milliseconds;
+	}
+	lock.unlock();
+
+	glfwMakeContextCurrent(NULL);
+}
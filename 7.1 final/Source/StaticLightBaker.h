@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticlightbaker.h
+// ============
+// compile the main shader with the static scene lights as constants
+//
+//	Lights marked static are written into the fragment shader source as
+//	STATIC_DIR_LIGHT / STATIC_POINT_LIGHT / STATIC_POINT_LIGHT2 defines,
+//	which shader.frag turns into constants instead of uniforms, so the
+//	compiler can fold their attenuation and lighting terms. The program
+//	is compiled on a worker thread with its own shared GL context, so an
+//	edit never stalls the frame; until the new program is ready the scene
+//	keeps rendering with the lights uploaded as uniforms.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <glm/glm.hpp>
+
+#include "ShaderManager.h"
+
+struct GLFWwindow;
+
+class StaticLightBaker
+{
+public:
+	// directional light, in the member order of DirLight in shader.frag
+	struct DIRECTIONAL_LIGHT
+	{
+		bool      bStatic;
+		glm::vec3 direction;
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+	};
+
+	// point light, in the member order of PointLight in shader.frag
+	struct POINT_LIGHT
+	{
+		bool      bStatic;
+		glm::vec3 position;
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		float     constant;
+		float     linear;
+		float     quadratic;
+	};
+
+	// the lights of the scene that can be baked, the spotlight follows
+	// the camera and always stays a uniform
+	struct SCENE_LIGHTS
+	{
+		DIRECTIONAL_LIGHT dirLight;
+		POINT_LIGHT       pointLight;
+		POINT_LIGHT       pointLight2;
+	};
+
+	// constructor
+	StaticLightBaker();
+	// destructor
+	~StaticLightBaker();
+
+	// read the shader sources and start the worker, on the render thread
+	bool Initialize(const char* vertexShaderFile, const char* fragmentShaderFile);
+
+	// compile a program with the static lights baked in, in the background;
+	// returns false when none of the lights is static
+	bool Bake(const SCENE_LIGHTS& lights);
+	// the program of the last Bake once it finished compiling, else NULL
+	ShaderManager* GetBakedProgram();
+	// whether the last Bake has not been picked up yet, render thread only
+	bool IsBakePending() const { return m_baked != m_requested && !m_requestedDefines.empty(); }
+
+private:
+	// shared context of the worker, an invisible window
+	GLFWwindow*             m_pContext;
+	std::thread             m_worker;
+	std::mutex              m_mutex;
+	std::condition_variable m_wake;
+	bool                    m_bStop;
+
+	std::string             m_vertexShaderFile;
+	std::string             m_fragmentSource;
+	size_t                  m_injectPosition;
+
+	// the defines of the last request and its generation, guarded by m_mutex
+	std::string             m_requestedDefines;
+	unsigned int            m_requested;
+	unsigned int            m_started;
+	// the worker's latest program and the generation it was compiled for
+	ShaderManager*          m_pCompiled;
+	unsigned int            m_compiled;
+	double                  m_compileMilliseconds;
+	// the program handed out by GetBakedProgram and its generation,
+	// render thread only
+	ShaderManager*          m_pBaked;
+	unsigned int            m_baked;
+
+	void WorkerLoop();
+};
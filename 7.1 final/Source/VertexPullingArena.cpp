@@ -0,0 +1,494 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexpullingarena.cpp
+// ============
+// draw every mesh from one storage buffer arena through vertex pulling
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VertexPullingArena.h"
+#include "GLTrace.h"
+#include "MeshCodec.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the vertex shader with the pulling path enabled, for the ShaderManager
+	const char* g_PulledShaderFile = "vertex_pulling.vert";
+
+	// transform feedback space for the triangles of one mesh
+	const GLsizeiptr g_CaptureBufferBytes = 4 * 1024 * 1024;
+
+	// name of the arena chunk in a warm start snapshot
+	const char* g_SnapshotChunkName = "arena";
+
+	// passes the attributes of ShapeMeshes through in the arena layout
+	const char* g_CaptureShaderSource =
+		"#version 330 core\n"
+		"layout(location = 0) in vec3 aPos;\n"
+		"layout(location = 1) in vec3 aNormal;\n"
+		"layout(location = 2) in vec2 aTexCoord;\n"
+		"out vec4 capturedPositionU;\n"
+		"out vec4 capturedNormalV;\n"
+		"void main()\n"
+		"{\n"
+		"    capturedPositionU = vec4(aPos, aTexCoord.x);\n"
+		"    capturedNormalV = vec4(aNormal, aTexCoord.y);\n"
+		"    gl_Position = vec4(0.0);\n"
+		"}\n";
+}
+
+/***********************************************************
+ *  VertexPullingArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VertexPullingArena::VertexPullingArena()
+{
+	m_pProgram = NULL;
+	m_captureProgram = 0;
+	m_captureBuffer = 0;
+	m_captureQueries[0] = 0;
+	m_captureQueries[1] = 0;
+	m_emptyVertexArray = 0;
+	m_arenaBuffer = 0;
+	m_vertexBytes = 0;
+	m_indexOffset = 0;
+	m_indexBytes = 0;
+}
+
+/***********************************************************
+ *  ~VertexPullingArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VertexPullingArena::~VertexPullingArena()
+{
+	if (NULL != m_pProgram)
+	{
+		delete m_pProgram;
+		m_pProgram = NULL;
+	}
+	if (m_captureProgram != 0)
+		glDeleteProgram(m_captureProgram);
+	if (m_captureBuffer != 0)
+		glDeleteBuffers(1, &m_captureBuffer);
+	if (m_captureQueries[0] != 0)
+		glDeleteQueries(2, m_captureQueries);
+	if (m_emptyVertexArray != 0)
+		glDeleteVertexArrays(1, &m_emptyVertexArray);
+	if (m_arenaBuffer != 0)
+		glDeleteBuffers(1, &m_arenaBuffer);
+}
+
+/***********************************************************
+ *  WritePulledShader()
+ *
+ *  This method is used for writing the vertex shader with
+ *  the VERTEX_PULLING path enabled. It is written once, by
+ *  the process that starts the render farm workers, so no
+ *  worker reads the file while another one rewrites it.
+ ***********************************************************/
+const char* VertexPullingArena::WritePulledShader(const char* vertexShaderFile)
+{
+	std::ifstream file(vertexShaderFile);
+	if (!file.is_open())
+	{
+		std::cout << "[ERROR] Could not open vertex shader: " << vertexShaderFile << std::endl;
+		return NULL;
+	}
+	std::stringstream sourceStream;
+	sourceStream << file.rdbuf();
+	std::string source = sourceStream.str();
+
+	// storage buffers need GLSL 4.30, the rest of the shader is unchanged
+	size_t version = source.find("#version");
+	if (version == std::string::npos || source.find("VERTEX_PULLING") == std::string::npos)
+	{
+		std::cout << "[WARNING] " << vertexShaderFile << " has no VERTEX_PULLING path" << std::endl;
+		return NULL;
+	}
+	size_t lineEnd = source.find('\n', version);
+	source.replace(version, (lineEnd == std::string::npos) ? std::string::npos : lineEnd - version,
+		"#version 430 core\n#define VERTEX_PULLING 1");
+
+	std::ofstream pulledFile(g_PulledShaderFile, std::ios::trunc);
+	pulledFile << source;
+	if (!pulledFile.good())
+	{
+		std::cout << "[ERROR] Could not write " << g_PulledShaderFile << std::endl;
+		return NULL;
+	}
+	return g_PulledShaderFile;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for loading the main shader program
+ *  from the vertex shader WritePulledShader wrote, which
+ *  needs storage buffers and so OpenGL 4.3, and creating the
+ *  transform feedback capture of the meshes.
+ ***********************************************************/
+bool VertexPullingArena::Initialize(const char* pulledShaderFile, const char* fragmentShaderFile)
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "Vertex pulling disabled: OpenGL 4.3 is required" << std::endl;
+		return false;
+	}
+	// the storage buffer bindings are not part of GL traces
+	if (GLTrace::IsRecording())
+	{
+		std::cout << "[WARNING] Vertex pulling is not used while a GL trace is recording" << std::endl;
+		return false;
+	}
+
+	m_vertexShaderFile = pulledShaderFile;
+	m_pProgram = new ShaderManager();
+	GLuint programID = m_pProgram->LoadShaders(pulledShaderFile, fragmentShaderFile);
+	GLint linked = 0;
+	if (programID != 0)
+		glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+	if (!linked)
+	{
+		std::cout << "[ERROR] The vertex pulling program did not link" << std::endl;
+		return false;
+	}
+
+	if (!CreateCaptureProgram())
+		return false;
+
+	glGenBuffers(1, &m_captureBuffer);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, m_captureBuffer);
+	glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, g_CaptureBufferBytes, NULL, GL_STREAM_READ);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+	glGenQueries(2, m_captureQueries);
+	glGenVertexArrays(1, &m_emptyVertexArray);
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateCaptureProgram()
+ *
+ *  This method is used for building the pass through program
+ *  whose outputs transform feedback writes in the layout of
+ *  the arena.
+ ***********************************************************/
+bool VertexPullingArena::CreateCaptureProgram()
+{
+	GLuint shaderID = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(shaderID, 1, &g_CaptureShaderSource, NULL);
+	glCompileShader(shaderID);
+
+	GLint success = 0;
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		char infoLog[1024];
+		glGetShaderInfoLog(shaderID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "[ERROR] Mesh capture shader compile error:\n" << infoLog << std::endl;
+		glDeleteShader(shaderID);
+		return false;
+	}
+
+	m_captureProgram = glCreateProgram();
+	glAttachShader(m_captureProgram, shaderID);
+	const char* varyings[] = { "capturedPositionU", "capturedNormalV" };
+	glTransformFeedbackVaryings(m_captureProgram, 2, varyings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(m_captureProgram);
+	glDeleteShader(shaderID);
+
+	glGetProgramiv(m_captureProgram, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		std::cout << "[ERROR] Mesh capture program did not link" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  BeginCapture() / EndCapture()
+ *
+ *  These methods are used for recording the triangles of
+ *  the draws made in between, with rasterization off, and
+ *  appending them to the arena as one indexed mesh. Strips
+ *  and fans come out as separate triangles.
+ ***********************************************************/
+void VertexPullingArena::BeginCapture()
+{
+	glUseProgram(m_captureProgram);
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_captureBuffer);
+	glBeginQuery(GL_PRIMITIVES_GENERATED, m_captureQueries[0]);
+	glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, m_captureQueries[1]);
+	glBeginTransformFeedback(GL_TRIANGLES);
+}
+
+int VertexPullingArena::EndCapture()
+{
+	glEndTransformFeedback();
+	glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+	glEndQuery(GL_PRIMITIVES_GENERATED);
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+
+	GLuint generated = 0;
+	GLuint written = 0;
+	glGetQueryObjectuiv(m_captureQueries[0], GL_QUERY_RESULT, &generated);
+	glGetQueryObjectuiv(m_captureQueries[1], GL_QUERY_RESULT, &written);
+	if (written == 0 || written < generated)
+	{
+		std::cout << "[ERROR] Mesh capture wrote " << written << " of " << generated << " triangles" << std::endl;
+		return -1;
+	}
+
+	std::vector<PULLED_VERTEX> triangles(written * 3);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, m_captureBuffer);
+	glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, triangles.size() * sizeof(PULLED_VERTEX), &triangles[0]);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+
+	MESH_RANGE range;
+	range.baseVertex = (GLint)m_vertices.size();
+	range.firstIndex = (GLint)m_indices.size();
+	range.indexCount = (GLsizei)triangles.size();
+
+	// captured triangles repeat the shared vertices, identical ones are merged
+	std::unordered_map<std::string, GLuint> uniqueVertices;
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		std::string key((const char*)&triangles[i], sizeof(PULLED_VERTEX));
+		std::unordered_map<std::string, GLuint>::iterator it = uniqueVertices.find(key);
+		if (it == uniqueVertices.end())
+		{
+			GLuint index = (GLuint)(m_vertices.size() - range.baseVertex);
+			it = uniqueVertices.insert(std::make_pair(key, index)).first;
+			m_vertices.push_back(triangles[i]);
+		}
+		m_indices.push_back(it->second);
+	}
+
+	m_meshes.push_back(range);
+	return (int)m_meshes.size() - 1;
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for writing the captured vertices and
+ *  indices into the arena buffer, the indices after the
+ *  vertices at the storage buffer offset alignment.
+ ***********************************************************/
+bool VertexPullingArena::Upload()
+{
+	if (m_meshes.empty())
+		return false;
+
+	CreateArenaBuffer(m_vertices.size(), m_indices.size());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_arenaBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_vertexBytes, &m_vertices[0]);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, m_indexOffset, m_indexBytes, &m_indices[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// the capture is only needed once
+	std::vector<PULLED_VERTEX>().swap(m_vertices);
+	std::vector<GLuint>().swap(m_indices);
+	ReleaseCapture();
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateArenaBuffer()
+ *
+ *  This method is used for creating the arena buffer with
+ *  room for the passed in number of vertices and indices.
+ ***********************************************************/
+void VertexPullingArena::CreateArenaBuffer(size_t vertexCount, size_t indexCount)
+{
+	GLint alignment = 1;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment < 1)
+		alignment = 1;
+
+	m_vertexBytes = (GLsizeiptr)(vertexCount * sizeof(PULLED_VERTEX));
+	m_indexOffset = ((m_vertexBytes + alignment - 1) / alignment) * alignment;
+	m_indexBytes = (GLsizeiptr)(indexCount * sizeof(GLuint));
+
+	glGenBuffers(1, &m_arenaBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_arenaBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_indexOffset + m_indexBytes, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	std::cout << "[PULL] " << m_meshes.size() << " meshes, " << vertexCount << " vertices and "
+		<< indexCount << " indices in one " << (m_indexOffset + m_indexBytes) / 1024 << " KB arena" << std::endl;
+}
+
+/***********************************************************
+ *  ReleaseCapture()
+ *
+ *  This method is used for deleting the transform feedback
+ *  objects once the arena is filled.
+ ***********************************************************/
+void VertexPullingArena::ReleaseCapture()
+{
+	glDeleteProgram(m_captureProgram);
+	m_captureProgram = 0;
+	glDeleteBuffers(1, &m_captureBuffer);
+	m_captureBuffer = 0;
+}
+
+/***********************************************************
+ *  LoadFromSnapshot()
+ *
+ *  This method is used for filling the arena from the mapped
+ *  snapshot chunk, so no mesh is drawn, captured or merged
+ *  on a warm start. The streams are decoded straight into
+ *  the write-only mapping of the new arena buffer. The
+ *  meshes are captured again when another build wrote it,
+ *  as ShapeMeshes may have changed.
+ ***********************************************************/
+bool VertexPullingArena::LoadFromSnapshot(const SceneSnapshot& snapshot)
+{
+	size_t size = 0;
+	const ARENA_SNAPSHOT_HEADER* pHeader =
+		(const ARENA_SNAPSHOT_HEADER*)snapshot.FindChunk(SNAPSHOT_MESHES, g_SnapshotChunkName, &size);
+	if (NULL == pHeader || !snapshot.IsFromThisBuild() || size < sizeof(ARENA_SNAPSHOT_HEADER) || pHeader->meshCount == 0 ||
+		size != sizeof(ARENA_SNAPSHOT_HEADER) + pHeader->meshCount * sizeof(MESH_RANGE) +
+			(size_t)pHeader->vertexStreamBytes + (size_t)pHeader->indexStreamBytes)
+	{
+		return false;
+	}
+
+	const MESH_RANGE* pRanges = (const MESH_RANGE*)(pHeader + 1);
+	const unsigned char* pVertexStream = (const unsigned char*)(pRanges + pHeader->meshCount);
+	const unsigned char* pIndexStream = pVertexStream + pHeader->vertexStreamBytes;
+
+	m_meshes.assign(pRanges, pRanges + pHeader->meshCount);
+	CreateArenaBuffer(pHeader->vertexCount, pHeader->indexCount);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_arenaBuffer);
+	char* pArena = (char*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_indexOffset + m_indexBytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	bool bDecoded = NULL != pArena &&
+		MeshCodec::DecodeStream(pVertexStream, pHeader->vertexStreamBytes, pArena, pHeader->vertexCount, sizeof(PULLED_VERTEX)) != 0 &&
+		MeshCodec::DecodeStream(pIndexStream, pHeader->indexStreamBytes, pArena + m_indexOffset, pHeader->indexCount, sizeof(GLuint)) != 0;
+	// the driver may lose the mapping, e.g. on a mode switch
+	if (NULL != pArena)
+		bDecoded = (glUnmapBuffer(GL_SHADER_STORAGE_BUFFER) == GL_TRUE) && bDecoded;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (!bDecoded)
+	{
+		std::cout << "[WARNING] The meshes of the snapshot could not be decoded, they are captured again" << std::endl;
+		glDeleteBuffers(1, &m_arenaBuffer);
+		m_arenaBuffer = 0;
+		m_meshes.clear();
+		return false;
+	}
+
+	double decodedBytes = (double)(m_vertexBytes + m_indexBytes);
+	std::cout << "[PULL] decoded " << (m_vertexBytes + m_indexBytes) / 1024 << " KB of meshes from "
+		<< (pHeader->vertexStreamBytes + pHeader->indexStreamBytes) / 1024 << " KB in " << milliseconds << " ms, "
+		<< ((milliseconds > 0.0) ? decodedBytes / (milliseconds * 1000000.0) : 0.0) << " GB/s"
+		<< (MeshCodec::HasSimdDecoder() ? " (SSE2)" : "") << std::endl;
+	ReleaseCapture();
+
+	return true;
+}
+
+/***********************************************************
+ *  AddToSnapshot()
+ *
+ *  This method is used for reading the arena back from the
+ *  GPU and encoding it into a snapshot chunk.
+ ***********************************************************/
+void VertexPullingArena::AddToSnapshot(SceneSnapshot& snapshot) const
+{
+	if (m_arenaBuffer == 0)
+		return;
+
+	ARENA_SNAPSHOT_HEADER header;
+	header.meshCount = (uint32_t)m_meshes.size();
+	header.vertexCount = (uint32_t)(m_vertexBytes / sizeof(PULLED_VERTEX));
+	header.indexCount = (uint32_t)(m_indexBytes / sizeof(GLuint));
+	header.reserved = 0;
+
+	std::vector<PULLED_VERTEX> vertices(header.vertexCount);
+	std::vector<GLuint> indices(header.indexCount);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_arenaBuffer);
+	if (!vertices.empty())
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_vertexBytes, &vertices[0]);
+	if (!indices.empty())
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, m_indexOffset, m_indexBytes, &indices[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	size_t rangeBytes = m_meshes.size() * sizeof(MESH_RANGE);
+	std::vector<unsigned char> chunk(sizeof(header) + rangeBytes);
+	MeshCodec::EncodeStream(vertices.empty() ? NULL : &vertices[0], vertices.size(), sizeof(PULLED_VERTEX), chunk);
+	header.vertexStreamBytes = (uint32_t)(chunk.size() - sizeof(header) - rangeBytes);
+	MeshCodec::EncodeStream(indices.empty() ? NULL : &indices[0], indices.size(), sizeof(GLuint), chunk);
+	header.indexStreamBytes = (uint32_t)(chunk.size() - sizeof(header) - rangeBytes - header.vertexStreamBytes);
+	memcpy(&chunk[0], &header, sizeof(header));
+	memcpy(&chunk[sizeof(header)], &m_meshes[0], rangeBytes);
+
+	uint64_t rawBytes = (uint64_t)m_vertexBytes + m_indexBytes;
+	uint64_t encodedBytes = (uint64_t)header.vertexStreamBytes + header.indexStreamBytes;
+	std::cout << "[PULL] meshes encoded from " << rawBytes / 1024 << " KB to " << encodedBytes / 1024 << " KB, ratio "
+		<< ((encodedBytes > 0) ? (double)rawBytes / encodedBytes : 0.0) << std::endl;
+
+	snapshot.AddChunk(SNAPSHOT_MESHES, g_SnapshotChunkName, &chunk[0], chunk.size());
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the vertex and index
+ *  ranges of the arena to the storage buffer bindings of
+ *  shader.vert, with the attribute-less vertex array.
+ ***********************************************************/
+void VertexPullingArena::Bind() const
+{
+	glBindVertexArray(m_emptyVertexArray);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_arenaBuffer, 0, m_vertexBytes);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, m_arenaBuffer, m_indexOffset, m_indexBytes);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing one captured mesh, only
+ *  its offsets into the arena change between draws.
+ ***********************************************************/
+void VertexPullingArena::Draw(ShaderManager* pShaderManager, int mesh) const
+{
+	if (mesh < 0 || mesh >= (int)m_meshes.size())
+		return;
+
+	const MESH_RANGE& range = m_meshes[mesh];
+	pShaderManager->setIntValue("firstIndex", range.firstIndex);
+	pShaderManager->setIntValue("baseVertex", range.baseVertex);
+	glDrawArrays(GL_TRIANGLES, 0, range.indexCount);
+}
+
+/***********************************************************
+ *  GetVertexShaderFile()
+ *
+ *  This method is used for naming the vertex shader with the
+ *  pulling path, so other programs of the main pass can be
+ *  built on it.
+ ***********************************************************/
+const char* VertexPullingArena::GetVertexShaderFile() const
+{
+	return m_vertexShaderFile.c_str();
+}
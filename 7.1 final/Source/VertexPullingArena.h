@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexpullingarena.h
+// ============
+// draw every mesh from one storage buffer arena through vertex pulling
+//
+//	The vertices and indices of all meshes are packed into a single
+//	shader storage buffer. The VERTEX_PULLING path of shader.vert fetches
+//	and decodes them from gl_VertexID and the firstIndex / baseVertex
+//	offsets of the draw, so one empty vertex array serves every mesh and
+//	no vertex format changes between draws. The meshes are captured from
+//	the draws of ShapeMeshes with transform feedback, so they match the
+//	fixed function path exactly. With a warm start snapshot the captured
+//	arena is decoded from it instead, with MeshCodec, straight into the
+//	mapped arena buffer.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ShaderManager.h"
+#include "SceneSnapshot.h"
+
+class VertexPullingArena
+{
+public:
+	// constructor
+	VertexPullingArena();
+	// destructor
+	~VertexPullingArena();
+
+	// write the vertex shader with the pulling path enabled; called once,
+	// before any farm worker starts, returns the file or NULL
+	static const char* WritePulledShader(const char* vertexShaderFile);
+	// load the main shader from the written file as is, needs OpenGL 4.3
+	bool Initialize(const char* pulledShaderFile, const char* fragmentShaderFile);
+
+	// record the triangles drawn between the two calls as the next mesh,
+	// EndCapture returns its index or -1 on failure
+	void BeginCapture();
+	int EndCapture();
+	// move the captured meshes into the storage buffer
+	bool Upload();
+
+	// fill the arena from a snapshot instead of capturing, false if it has none
+	bool LoadFromSnapshot(const SceneSnapshot& snapshot);
+	// add the uploaded arena to a snapshot
+	void AddToSnapshot(SceneSnapshot& snapshot) const;
+
+	// bind the arena and the empty vertex array before drawing
+	void Bind() const;
+	// draw a captured mesh, the pulling program must be in use
+	void Draw(ShaderManager* pShaderManager, int mesh) const;
+
+	// the program and vertex shader file of the pulling path
+	ShaderManager* GetProgram() const { return m_pProgram; }
+	const char* GetVertexShaderFile() const;
+
+private:
+	// one captured mesh within the arena
+	struct MESH_RANGE
+	{
+		GLint  baseVertex;
+		GLint  firstIndex;
+		GLsizei indexCount;
+	};
+
+	// vertex layout of the arena, PulledVertex in shader.vert
+	struct PULLED_VERTEX
+	{
+		float positionU[4];
+		float normalV[4];
+	};
+
+	ShaderManager*              m_pProgram;
+	std::string                 m_vertexShaderFile;
+	GLuint                      m_captureProgram;
+	GLuint                      m_captureBuffer;
+	GLuint                      m_captureQueries[2];
+	GLuint                      m_emptyVertexArray;
+	GLuint                      m_arenaBuffer;
+	GLsizeiptr                  m_vertexBytes;
+	GLintptr                    m_indexOffset;
+	GLsizeiptr                  m_indexBytes;
+
+	std::vector<MESH_RANGE>     m_meshes;
+	// captured geometry until Upload moves it to the GPU
+	std::vector<PULLED_VERTEX>  m_vertices;
+	std::vector<GLuint>         m_indices;
+
+	// SNAPSHOT_MESHES chunk, followed by the mesh ranges and the
+	// MeshCodec streams of the vertices and the indices
+	struct ARENA_SNAPSHOT_HEADER
+	{
+		uint32_t meshCount;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t vertexStreamBytes;
+		uint32_t indexStreamBytes;
+		uint32_t reserved;
+	};
+
+	bool CreateCaptureProgram();
+	void CreateArenaBuffer(size_t vertexCount, size_t indexCount);
+	void ReleaseCapture();
+};
@@ -42,4 +42,7 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// follow the scene when it switches to another shader program
+	void SetShaderManager(ShaderManager* pShaderManager) { m_pShaderManager = pShaderManager; }
 };
\ No newline at end of file
@@ -0,0 +1,218 @@
+///////////////////////////////////////////////////////////////////////////////
+// volumetriclighting.cpp
+// ============
+// froxel based volumetric lighting for the camera spotlight
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VolumetricLighting.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_InjectShaderFile = "volumetric_inject.comp";
+	const char* g_IntegrateShaderFile = "volumetric_integrate.comp";
+
+	// compute work group size used by both passes
+	const int g_GroupSize = 8;
+
+	// sub-slice jitter sequence, decorrelated by temporal reprojection
+	const float g_DepthJitter[8] = {
+		0.5f, 0.25f, 0.75f, 0.125f, 0.625f, 0.375f, 0.875f, 0.0625f };
+}
+
+/***********************************************************
+ *  VolumetricLighting()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VolumetricLighting::VolumetricLighting()
+	: m_timer("Volumetric lighting")
+{
+	m_nearPlane = 0.1f;
+	m_farPlane = 30.0f;
+	m_density = 0.04f;
+	m_anisotropy = 0.6f;
+	m_historyWeight = 0.9f;
+
+	m_scatterVolumes[0] = 0;
+	m_scatterVolumes[1] = 0;
+	m_integratedVolume = 0;
+	m_historyIndex = 0;
+	m_bHistoryValid = false;
+	m_frameIndex = 0;
+}
+
+/***********************************************************
+ *  ~VolumetricLighting()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VolumetricLighting::~VolumetricLighting()
+{
+	if (m_scatterVolumes[0] != 0)
+		glDeleteTextures(2, m_scatterVolumes);
+	if (m_integratedVolume != 0)
+		glDeleteTextures(1, &m_integratedVolume);
+}
+
+/***********************************************************
+ *  CreateVolumeTexture()
+ *
+ *  This method is used for allocating one froxel volume.
+ ***********************************************************/
+GLuint VolumetricLighting::CreateVolumeTexture()
+{
+	GLuint textureID = 0;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_3D, textureID);
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_RGBA16F, FROXEL_WIDTH, FROXEL_HEIGHT, FROXEL_DEPTH);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	return textureID;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the froxel volumes and
+ *  loading the injection and integration compute shaders.
+ *  Compute shaders need OpenGL 4.3, so this fails cleanly
+ *  on older contexts and the main pass runs without fog.
+ ***********************************************************/
+bool VolumetricLighting::Initialize()
+{
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "Volumetric lighting disabled: OpenGL 4.3 is required" << std::endl;
+		return false;
+	}
+
+	if (!m_injectProgram.Load(g_InjectShaderFile) ||
+		!m_integrateProgram.Load(g_IntegrateShaderFile))
+	{
+		return false;
+	}
+
+	m_scatterVolumes[0] = CreateVolumeTexture();
+	m_scatterVolumes[1] = CreateVolumeTexture();
+	m_integratedVolume = CreateVolumeTexture();
+
+	return true;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for running the volumetric passes:
+ *  the spotlight is injected into the froxel grid and blended
+ *  with the reprojected result of the last frame, then the
+ *  grid is integrated front to back along each view ray.
+ ***********************************************************/
+void VolumetricLighting::Update(const CAMERA_STATE& camera, const SPOT_LIGHT& spotLight)
+{
+	if (!m_injectProgram.IsLoaded() || !m_integrateProgram.IsLoaded())
+		return;
+
+	int writeIndex = 1 - m_historyIndex;
+	glm::mat4 viewProjection = camera.projection * camera.view;
+	glm::mat4 previousViewProjection = m_previousCamera.projection * m_previousCamera.view;
+
+	m_timer.Begin();
+
+	// light injection with temporal reprojection
+	m_injectProgram.use();
+	m_injectProgram.setMat4Value("uInvViewProjection", glm::inverse(viewProjection));
+	m_injectProgram.setMat4Value("uPrevViewProjection", previousViewProjection);
+	m_injectProgram.setVec3Value("uCameraPos", camera.position);
+	m_injectProgram.setVec3Value("uCameraFront", camera.front);
+	m_injectProgram.setVec3Value("uPrevCameraPos", m_previousCamera.position);
+	m_injectProgram.setVec3Value("uPrevCameraFront", m_previousCamera.front);
+	m_injectProgram.setFloatValue("uNear", m_nearPlane);
+	m_injectProgram.setFloatValue("uFar", m_farPlane);
+	m_injectProgram.setFloatValue("uDensity", m_density);
+	m_injectProgram.setFloatValue("uAnisotropy", m_anisotropy);
+	m_injectProgram.setFloatValue("uHistoryWeight", m_bHistoryValid ? m_historyWeight : 0.0f);
+	m_injectProgram.setFloatValue("uDepthJitter", g_DepthJitter[m_frameIndex % 8]);
+	m_injectProgram.setVec3Value("spotLight.position", spotLight.position);
+	m_injectProgram.setVec3Value("spotLight.direction", spotLight.direction);
+	m_injectProgram.setFloatValue("spotLight.cutOff", spotLight.cutOff);
+	m_injectProgram.setFloatValue("spotLight.outerCutOff", spotLight.outerCutOff);
+	m_injectProgram.setVec3Value("spotLight.diffuse", spotLight.diffuse);
+	m_injectProgram.setFloatValue("spotLight.constant", spotLight.constant);
+	m_injectProgram.setFloatValue("spotLight.linear", spotLight.linear);
+	m_injectProgram.setFloatValue("spotLight.quadratic", spotLight.quadratic);
+	m_injectProgram.setIntValue("uScatterHistory", 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, m_scatterVolumes[m_historyIndex]);
+	glBindImageTexture(0, m_scatterVolumes[writeIndex], 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	m_injectProgram.Dispatch(
+		(FROXEL_WIDTH + g_GroupSize - 1) / g_GroupSize,
+		(FROXEL_HEIGHT + g_GroupSize - 1) / g_GroupSize,
+		FROXEL_DEPTH);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	// front-to-back integration along each froxel column
+	m_integrateProgram.use();
+	m_integrateProgram.setFloatValue("uNear", m_nearPlane);
+	m_integrateProgram.setFloatValue("uFar", m_farPlane);
+	m_integrateProgram.setIntValue("uScatter", 0);
+
+	glBindTexture(GL_TEXTURE_3D, m_scatterVolumes[writeIndex]);
+	glBindImageTexture(0, m_integratedVolume, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	m_integrateProgram.Dispatch(
+		(FROXEL_WIDTH + g_GroupSize - 1) / g_GroupSize,
+		(FROXEL_HEIGHT + g_GroupSize - 1) / g_GroupSize,
+		1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	m_timer.End();
+
+	m_historyIndex = writeIndex;
+	m_bHistoryValid = true;
+	m_previousCamera = camera;
+	m_frameIndex++;
+}
+
+/***********************************************************
+ *  BindForMainPass()
+ *
+ *  This method is used for binding the integrated volume to
+ *  its texture unit and passing the froxel mapping into the
+ *  main fragment shader.
+ ***********************************************************/
+void VolumetricLighting::BindForMainPass(ShaderManager* pShaderManager, bool bEnabled)
+{
+	if (pShaderManager == NULL)
+		return;
+
+	bool bActive = bEnabled && (m_integratedVolume != 0);
+
+	pShaderManager->setIntValue("bUseVolumetrics", bActive);
+	if (!bActive)
+		return;
+
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glActiveTexture(GL_TEXTURE0 + VOLUME_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_3D, m_integratedVolume);
+	glActiveTexture(GL_TEXTURE0);
+
+	pShaderManager->setIntValue("volumetricTex", VOLUME_TEXTURE_UNIT);
+	pShaderManager->setFloatValue("volumetricNear", m_nearPlane);
+	pShaderManager->setFloatValue("volumetricFar", m_farPlane);
+	pShaderManager->setVec2Value("screenSize", glm::vec2((float)viewport[2], (float)viewport[3]));
+}
@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// volumetriclighting.h
+// ============
+// froxel based volumetric lighting for the camera spotlight
+//
+//	Light is injected into a low resolution 3D texture aligned with the
+//	view frustum (froxels), integrated front to back, and sampled by the
+//	main fragment shader as in-scattered light plus transmittance.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "ShaderManager.h"
+#include "ComputeProgram.h"
+#include "GpuTimer.h"
+
+class VolumetricLighting
+{
+public:
+	// froxel grid resolution
+	static const int FROXEL_WIDTH = 160;
+	static const int FROXEL_HEIGHT = 90;
+	static const int FROXEL_DEPTH = 64;
+	// texture unit the integrated volume is bound to for the main pass
+	static const int VOLUME_TEXTURE_UNIT = 15;
+
+	// spotlight parameters used for light injection
+	struct SPOT_LIGHT
+	{
+		glm::vec3 position;
+		glm::vec3 direction;
+		float     cutOff;
+		float     outerCutOff;
+		glm::vec3 diffuse;
+		float     constant;
+		float     linear;
+		float     quadratic;
+	};
+
+	// camera state for the current frame
+	struct CAMERA_STATE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::mat4 view;
+		glm::mat4 projection;
+	};
+
+	// constructor
+	VolumetricLighting();
+	// destructor
+	~VolumetricLighting();
+
+	// create the froxel volumes and compile the compute passes
+	bool Initialize();
+	// inject, reproject and integrate the volume for this frame
+	void Update(const CAMERA_STATE& camera, const SPOT_LIGHT& spotLight);
+	// bind the integrated volume and its uniforms for the main pass
+	void BindForMainPass(ShaderManager* pShaderManager, bool bEnabled);
+
+	// GPU cost of the volumetric passes, tracked separately
+	const GpuTimer& GetTimer() const { return m_timer; }
+
+	// froxel depth range in view space
+	float m_nearPlane;
+	float m_farPlane;
+	// participating media settings
+	float m_density;
+	float m_anisotropy;
+	float m_historyWeight;
+
+private:
+	ComputeProgram m_injectProgram;
+	ComputeProgram m_integrateProgram;
+	// ping-pong scattering volumes for temporal reprojection
+	GLuint m_scatterVolumes[2];
+	// front-to-back integrated in-scattering and transmittance
+	GLuint m_integratedVolume;
+	int    m_historyIndex;
+	bool   m_bHistoryValid;
+	unsigned int m_frameIndex;
+	CAMERA_STATE m_previousCamera;
+	GpuTimer m_timer;
+
+	GLuint CreateVolumeTexture();
+};
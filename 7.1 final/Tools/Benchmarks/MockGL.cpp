@@ -0,0 +1,477 @@
+///////////////////////////////////////////////////////////////////////////////
+// mockgl.cpp
+// ============
+// driverless stand-in for the GL entry points used by the renderer
+//
+//	The benchmark target force-includes GLTrace.h like the application,
+//	so every traced GL call lands in a GLTrace_ function. Here those are
+//	implemented without a driver: object names are handed out in order,
+//	uniform locations are hashed from the name and uniform values are
+//	written to a sink, so the benchmarks measure the CPU work of the
+//	renderer itself plus the cost of a call.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MockGL.h"
+
+#include "GLTrace.h"
+
+// declaration of the global variables and defines
+namespace
+{
+	// number of distinct uniform locations handed out
+	const int UNIFORM_SLOTS = 1024;
+
+	uint64_t g_callCount = 0;
+	GLuint g_nextName = 0;
+	volatile float g_uniformSink[UNIFORM_SLOTS];
+
+	void GenerateNames(GLsizei n, GLuint* names)
+	{
+		for (GLsizei i = 0; i < n; i++)
+			names[i] = ++g_nextName;
+	}
+
+	GLint UniformLocation(const GLchar* name)
+	{
+		// FNV-1a, like a driver looking the name up in a hash table
+		uint32_t hash = 2166136261u;
+		for (const GLchar* c = name; *c != 0; c++)
+			hash = (hash ^ (unsigned char)*c) * 16777619u;
+		return (GLint)(hash % UNIFORM_SLOTS);
+	}
+
+	void Store(GLint location, float value)
+	{
+		if (location >= 0)
+			g_uniformSink[location % UNIFORM_SLOTS] = value;
+	}
+}
+
+/***********************************************************
+ *  GetCallCount() / Reset()
+ *
+ *  These functions are used for reading the number of GL
+ *  calls made, and for resetting the mock between runs.
+ ***********************************************************/
+uint64_t MockGL::GetCallCount()
+{
+	return g_callCount;
+}
+
+void MockGL::Reset()
+{
+	g_callCount = 0;
+	g_nextName = 0;
+}
+
+/***********************************************************
+ *  GLTrace
+ *
+ *  Recording is not available without a driver.
+ ***********************************************************/
+bool GLTrace::Start(const char*, unsigned int)
+{
+	return false;
+}
+
+void GLTrace::Stop()
+{
+}
+
+void GLTrace::EndFrame()
+{
+}
+
+bool GLTrace::IsRecording()
+{
+	return false;
+}
+
+/***********************************************************
+ *  GLTrace_ entry points
+ *
+ *  Every call is counted; calls that return something or
+ *  pass values on do the minimum to stay observable.
+ ***********************************************************/
+
+void GLTrace_GenTextures(GLsizei n, GLuint* textures)
+{
+	g_callCount++;
+	GenerateNames(n, textures);
+}
+
+void GLTrace_GenBuffers(GLsizei n, GLuint* buffers)
+{
+	g_callCount++;
+	GenerateNames(n, buffers);
+}
+
+void GLTrace_GenVertexArrays(GLsizei n, GLuint* arrays)
+{
+	g_callCount++;
+	GenerateNames(n, arrays);
+}
+
+void GLTrace_GenFramebuffers(GLsizei n, GLuint* framebuffers)
+{
+	g_callCount++;
+	GenerateNames(n, framebuffers);
+}
+
+void GLTrace_GenQueries(GLsizei n, GLuint* ids)
+{
+	g_callCount++;
+	GenerateNames(n, ids);
+}
+
+GLuint GLTrace_CreateShader(GLenum type)
+{
+	g_callCount++;
+	return ++g_nextName;
+}
+
+GLuint GLTrace_CreateProgram(void)
+{
+	g_callCount++;
+	return ++g_nextName;
+}
+
+void GLTrace_DeleteTextures(GLsizei, const GLuint*)
+{
+	g_callCount++;
+}
+
+void GLTrace_DeleteBuffers(GLsizei, const GLuint*)
+{
+	g_callCount++;
+}
+
+void GLTrace_DeleteVertexArrays(GLsizei, const GLuint*)
+{
+	g_callCount++;
+}
+
+void GLTrace_DeleteFramebuffers(GLsizei, const GLuint*)
+{
+	g_callCount++;
+}
+
+void GLTrace_DeleteQueries(GLsizei, const GLuint*)
+{
+	g_callCount++;
+}
+
+void GLTrace_DeleteShader(GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_DeleteProgram(GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_ActiveTexture(GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_BindTexture(GLenum, GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_BindBuffer(GLenum, GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_BindBufferBase(GLenum, GLuint, GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_BindVertexArray(GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_BindFramebuffer(GLenum, GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_UseProgram(GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_BindImageTexture(GLuint, GLuint, GLint, GLboolean, GLint, GLenum, GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_TexImage2D(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*)
+{
+	g_callCount++;
+}
+
+void GLTrace_TexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*)
+{
+	g_callCount++;
+}
+
+void GLTrace_TexStorage2D(GLenum, GLsizei, GLenum, GLsizei, GLsizei)
+{
+	g_callCount++;
+}
+
+void GLTrace_TexStorage3D(GLenum, GLsizei, GLenum, GLsizei, GLsizei, GLsizei)
+{
+	g_callCount++;
+}
+
+void GLTrace_TexParameteri(GLenum, GLenum, GLint)
+{
+	g_callCount++;
+}
+
+void GLTrace_GenerateMipmap(GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_BufferData(GLenum, GLsizeiptr, const void*, GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_BufferSubData(GLenum, GLintptr, GLsizeiptr, const void*)
+{
+	g_callCount++;
+}
+
+void GLTrace_CopyImageSubData(GLuint, GLenum, GLint, GLint, GLint, GLint, GLuint, GLenum, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei)
+{
+	g_callCount++;
+}
+
+void GLTrace_FramebufferTexture2D(GLenum, GLenum, GLenum, GLuint, GLint)
+{
+	g_callCount++;
+}
+
+void GLTrace_DrawBuffers(GLsizei, const GLenum*)
+{
+	g_callCount++;
+}
+
+void GLTrace_ReadBuffer(GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_VertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*)
+{
+	g_callCount++;
+}
+
+void GLTrace_EnableVertexAttribArray(GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_DisableVertexAttribArray(GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_ShaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*)
+{
+	g_callCount++;
+}
+
+void GLTrace_CompileShader(GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_AttachShader(GLuint, GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_LinkProgram(GLuint)
+{
+	g_callCount++;
+}
+
+GLint GLTrace_GetUniformLocation(GLuint program, const GLchar* name)
+{
+	g_callCount++;
+	return UniformLocation(name);
+}
+
+void GLTrace_Uniform1i(GLint location, GLint v0)
+{
+	g_callCount++;
+	Store(location, (float)v0);
+}
+
+void GLTrace_Uniform1f(GLint location, GLfloat v0)
+{
+	g_callCount++;
+	Store(location, v0);
+}
+
+void GLTrace_Uniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+	g_callCount++;
+	Store(location, v0 + v1);
+}
+
+void GLTrace_Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+	g_callCount++;
+	Store(location, v0 + v1 + v2);
+}
+
+void GLTrace_Uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+	g_callCount++;
+	Store(location, v0 + v1 + v2 + v3);
+}
+
+void GLTrace_Uniform2fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	g_callCount++;
+	Store(location, value[0]);
+}
+
+void GLTrace_Uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	g_callCount++;
+	Store(location, value[0]);
+}
+
+void GLTrace_Uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	g_callCount++;
+	Store(location, value[0]);
+}
+
+void GLTrace_UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+	g_callCount++;
+	Store(location, value[0]);
+}
+
+void GLTrace_Enable(GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_Disable(GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_Viewport(GLint, GLint, GLsizei, GLsizei)
+{
+	g_callCount++;
+}
+
+void GLTrace_ClearColor(GLfloat, GLfloat, GLfloat, GLfloat)
+{
+	g_callCount++;
+}
+
+void GLTrace_Clear(GLbitfield)
+{
+	g_callCount++;
+}
+
+void GLTrace_ClearBufferuiv(GLenum, GLint, const GLuint*)
+{
+	g_callCount++;
+}
+
+void GLTrace_ClearBufferfv(GLenum, GLint, const GLfloat*)
+{
+	g_callCount++;
+}
+
+void GLTrace_BlendFunc(GLenum, GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_DepthFunc(GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_DepthMask(GLboolean)
+{
+	g_callCount++;
+}
+
+void GLTrace_CullFace(GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_StencilFunc(GLenum, GLint, GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_StencilOp(GLenum, GLenum, GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_StencilMask(GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_PolygonMode(GLenum, GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_MemoryBarrier(GLbitfield)
+{
+	g_callCount++;
+}
+
+void GLTrace_DrawArrays(GLenum, GLint, GLsizei)
+{
+	g_callCount++;
+}
+
+void GLTrace_DrawElements(GLenum, GLsizei, GLenum, const void*)
+{
+	g_callCount++;
+}
+
+void GLTrace_DispatchCompute(GLuint, GLuint, GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_BlitFramebuffer(GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLbitfield, GLenum)
+{
+	g_callCount++;
+}
+
+void GLTrace_BeginQuery(GLenum, GLuint)
+{
+	g_callCount++;
+}
+
+void GLTrace_EndQuery(GLenum)
+{
+	g_callCount++;
+}
@@ -0,0 +1,18 @@
+///////////////////////////////////////////////////////////////////////////////
+// mockgl.h
+// ============
+// driverless stand-in for the GL entry points used by the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+
+class MockGL
+{
+public:
+	// GL calls made since the last reset
+	static uint64_t GetCallCount();
+	// restart call counting and object naming
+	static void Reset();
+};
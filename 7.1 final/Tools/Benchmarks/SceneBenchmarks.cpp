@@ -0,0 +1,613 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebenchmarks.cpp
+// ============
+// CPU microbenchmarks of the SceneManager and ShaderManager hot paths
+//
+//	Usage: SceneBenchmarks [--texture_corpus=DIR] [Google Benchmark options]
+//
+//	GL runs against MockGL, so the timings only contain the CPU work of
+//	the renderer and none of the driver or GPU. Results are written to
+//	scene_benchmarks.json unless --benchmark_out is passed, so runs
+//	before and after a change can be compared with the compare.py tool
+//	of Google Benchmark. Each benchmark reports the GL calls it makes
+//	per iteration as the gl_calls counter. The image decode benchmarks read
+//	the scene textures from ../../Debug/ unless --texture_corpus names the
+//	directory that holds them.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "ImageDecoder.h"
+#include "MeshCodec.h"
+#include "MockGL.h"
+#include "RecordPool.h"
+#include "SceneManager.h"
+#include "ShaderManager.h"
+
+/***********************************************************
+ *  SceneManagerBenchmarkAccess
+ *
+ *  This class gives the benchmarks access to the private
+ *  helpers of SceneManager and fills in synthetic textures,
+ *  materials and objects without loading any files.
+ ***********************************************************/
+class SceneManagerBenchmarkAccess
+{
+public:
+	static void AddTextures(SceneManager& scene, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			SceneManager::TEXTURE_INFO* pTexture = scene.m_textureIDs.Allocate();
+			pTexture->tag = "texture" + std::to_string(i);
+			pTexture->ID = i + 1;
+		}
+	}
+
+	static void AddMaterials(SceneManager& scene, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			SceneManager::OBJECT_MATERIAL material;
+			material.tag = "material" + std::to_string(i);
+			material.ambientColor = glm::vec3(0.1f * (i % 10));
+			material.ambientStrength = 0.5f;
+			material.diffuseColor = glm::vec3(0.8f);
+			material.specularColor = glm::vec3(0.5f);
+			material.shininess = 32.0f;
+			scene.m_objectMaterials.Allocate(material);
+		}
+	}
+
+	// every other object is textured, all of them are drawn
+	static void AddObjects(SceneManager& scene, int count, int materials, int textures)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			std::string textureTag = (textures > 0 && (i % 2) == 0) ? "texture" + std::to_string(i % textures) : "";
+			scene.AddSceneObject("object" + std::to_string(i), (SceneManager::MESH_TYPE)(i % 3),
+				glm::vec3(1.0f), glm::vec3(0.0f, 15.0f * i, 0.0f), glm::vec3((float)(i % 16), 0.0f, (float)(i / 16)),
+				glm::vec4(1.0f), textureTag, glm::vec2(1.0f), "material" + std::to_string(i % materials));
+		}
+
+		scene.m_drawList.clear();
+		for (int i = 0; i < count; i++)
+			scene.m_drawList.push_back(i);
+	}
+
+	static int FindTextureID(SceneManager& scene, const std::string& tag) { return scene.FindTextureID(tag); }
+	static int FindTextureSlot(SceneManager& scene, const std::string& tag) { return scene.FindTextureSlot(tag); }
+	static bool FindMaterial(SceneManager& scene, const std::string& tag, SceneManager::OBJECT_MATERIAL& material)
+	{
+		return scene.FindMaterial(tag, material);
+	}
+	static void SetShaderMaterial(SceneManager& scene, const std::string& tag) { scene.SetShaderMaterial(tag); }
+	static void SetTransformations(SceneManager& scene, const glm::vec3& scale, const glm::vec3& rotation, const glm::vec3& position)
+	{
+		scene.SetTransformations(scale, rotation.x, rotation.y, rotation.z, position);
+	}
+};
+
+// declaration of the global variables and defines
+namespace
+{
+	typedef SceneManagerBenchmarkAccess ACCESS;
+
+	// a scene manager over a shader manager, both backed by MockGL
+	struct BENCH_SCENE
+	{
+		ShaderManager shaderManager;
+		SceneManager  scene;
+
+		BENCH_SCENE() : scene(&shaderManager) { MockGL::Reset(); }
+	};
+
+	std::vector<std::string> MakeTags(const char* prefix, int count)
+	{
+		std::vector<std::string> tags;
+		for (int i = 0; i < count; i++)
+			tags.push_back(prefix + std::to_string(i));
+		return tags;
+	}
+
+	// directory of the textures PrepareScene loads
+	std::string g_TextureCorpusDirectory = "../../Debug/";
+
+	std::vector<unsigned char> ReadFile(const std::string& filename)
+	{
+		std::vector<unsigned char> data;
+		FILE* file = fopen(filename.c_str(), "rb");
+		if (NULL == file)
+			return data;
+		if (fseek(file, 0, SEEK_END) == 0)
+		{
+			long size = ftell(file);
+			if (size > 0 && fseek(file, 0, SEEK_SET) == 0)
+			{
+				data.resize((size_t)size);
+				if (fread(&data[0], 1, data.size(), file) != data.size())
+					data.clear();
+			}
+		}
+		fclose(file);
+		return data;
+	}
+
+	void ReportGLCalls(benchmark::State& state)
+	{
+		state.counters["gl_calls"] = benchmark::Counter((double)MockGL::GetCallCount(), benchmark::Counter::kAvgIterations);
+	}
+
+	SceneManager::OBJECT_MATERIAL MakeMaterial(int i)
+	{
+		SceneManager::OBJECT_MATERIAL material;
+		material.tag = "material";
+		material.ambientColor = glm::vec3(0.1f * (i % 10));
+		material.ambientStrength = 0.5f;
+		material.diffuseColor = glm::vec3(0.8f);
+		material.specularColor = glm::vec3(0.5f);
+		material.shininess = (float)i;
+		return material;
+	}
+}
+
+/***********************************************************
+ *  BM_FindTextureID() / BM_FindTextureSlot()
+ *
+ *  Look up every loaded texture by tag in turn, with the
+ *  number of loaded textures as the argument.
+ ***********************************************************/
+static void BM_FindTextureID(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	int textures = (int)state.range(0);
+	ACCESS::AddTextures(bench.scene, textures);
+	std::vector<std::string> tags = MakeTags("texture", textures);
+
+	size_t next = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(ACCESS::FindTextureID(bench.scene, tags[next]));
+		next = (next + 1) % tags.size();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindTextureID)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_FindTextureSlot(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	int textures = (int)state.range(0);
+	ACCESS::AddTextures(bench.scene, textures);
+	std::vector<std::string> tags = MakeTags("texture", textures);
+
+	size_t next = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(ACCESS::FindTextureSlot(bench.scene, tags[next]));
+		next = (next + 1) % tags.size();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindTextureSlot)->Arg(1)->Arg(4)->Arg(16);
+
+/***********************************************************
+ *  BM_FindMaterial()
+ *
+ *  Look up every material by tag in turn, with the number
+ *  of defined materials as the argument.
+ ***********************************************************/
+static void BM_FindMaterial(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	int materials = (int)state.range(0);
+	ACCESS::AddMaterials(bench.scene, materials);
+	std::vector<std::string> tags = MakeTags("material", materials);
+
+	SceneManager::OBJECT_MATERIAL material;
+	size_t next = 0;
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(ACCESS::FindMaterial(bench.scene, tags[next], material));
+		next = (next + 1) % tags.size();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindMaterial)->RangeMultiplier(4)->Range(2, 128);
+
+/***********************************************************
+ *  BM_SetShaderMaterial()
+ *
+ *  Look up a material and upload it to the shader, with the
+ *  number of defined materials as the argument.
+ ***********************************************************/
+static void BM_SetShaderMaterial(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	int materials = (int)state.range(0);
+	ACCESS::AddMaterials(bench.scene, materials);
+	std::vector<std::string> tags = MakeTags("material", materials);
+
+	size_t next = 0;
+	for (auto _ : state)
+	{
+		ACCESS::SetShaderMaterial(bench.scene, tags[next]);
+		next = (next + 1) % tags.size();
+	}
+	state.SetItemsProcessed(state.iterations());
+	ReportGLCalls(state);
+}
+BENCHMARK(BM_SetShaderMaterial)->RangeMultiplier(4)->Range(2, 128);
+
+/***********************************************************
+ *  BM_SetTransformations()
+ *
+ *  Build and upload the model matrix of one object.
+ ***********************************************************/
+static void BM_SetTransformations(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	glm::vec3 rotation(10.0f, 20.0f, 30.0f);
+
+	for (auto _ : state)
+	{
+		ACCESS::SetTransformations(bench.scene, glm::vec3(1.0f, 2.0f, 3.0f), rotation, glm::vec3(4.0f, 5.0f, 6.0f));
+		rotation.y += 1.0f;
+	}
+	state.SetItemsProcessed(state.iterations());
+	ReportGLCalls(state);
+}
+BENCHMARK(BM_SetTransformations);
+
+/***********************************************************
+ *  BM_SetupSceneLights()
+ *
+ *  Upload the parameters of every light of the scene.
+ ***********************************************************/
+static void BM_SetupSceneLights(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	glm::vec3 cameraPos(0.0f, 5.0f, 12.0f);
+	glm::vec3 cameraFront(0.0f, -0.3f, -1.0f);
+
+	for (auto _ : state)
+	{
+		bench.scene.SetupSceneLights(cameraPos, cameraFront);
+	}
+	state.SetItemsProcessed(state.iterations());
+	ReportGLCalls(state);
+}
+BENCHMARK(BM_SetupSceneLights);
+
+/***********************************************************
+ *  BM_UniformInt() / BM_UniformVec3() / BM_UniformMat4()
+ *
+ *  Upload one uniform through the ShaderManager, which looks
+ *  the location up by name on every call.
+ ***********************************************************/
+static void BM_UniformInt(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	int value = 0;
+	for (auto _ : state)
+	{
+		bench.shaderManager.setIntValue("objectID", value++);
+	}
+	ReportGLCalls(state);
+}
+BENCHMARK(BM_UniformInt);
+
+static void BM_UniformVec3(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	glm::vec3 value(0.0f);
+	for (auto _ : state)
+	{
+		bench.shaderManager.setVec3Value("material.diffuseColor", value);
+		value.x += 1.0f;
+	}
+	ReportGLCalls(state);
+}
+BENCHMARK(BM_UniformVec3);
+
+static void BM_UniformMat4(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	glm::mat4 value(1.0f);
+	for (auto _ : state)
+	{
+		bench.shaderManager.setMat4Value("model", value);
+		value[3][0] += 1.0f;
+	}
+	ReportGLCalls(state);
+}
+BENCHMARK(BM_UniformMat4);
+
+/***********************************************************
+ *  BM_RenderSceneObjects()
+ *
+ *  Submit a whole draw list, with the object count as the
+ *  first and the material count as the second argument.
+ *  Sixteen textures are shared by half of the objects.
+ ***********************************************************/
+static void BM_RenderSceneObjects(benchmark::State& state)
+{
+	BENCH_SCENE bench;
+	int objects = (int)state.range(0);
+	int materials = (int)state.range(1);
+	ACCESS::AddTextures(bench.scene, 16);
+	ACCESS::AddMaterials(bench.scene, materials);
+	ACCESS::AddObjects(bench.scene, objects, materials, 16);
+	MockGL::Reset();
+
+	for (auto _ : state)
+	{
+		bench.scene.RenderSceneObjects();
+	}
+	state.SetItemsProcessed(state.iterations() * objects);
+	ReportGLCalls(state);
+}
+BENCHMARK(BM_RenderSceneObjects)->ArgsProduct({ { 8, 64, 512 }, { 2, 32 } });
+
+/***********************************************************
+ *  BM_DecodeImage()
+ *
+ *  Decode a texture of the corpus from memory, with the
+ *  fastest decoder the build has (argument 0) or with
+ *  stb_image only (argument 1). The label names the
+ *  decoder and the threads it used.
+ ***********************************************************/
+static void BM_DecodeImage(benchmark::State& state, const char* filename)
+{
+	std::vector<unsigned char> data = ReadFile(g_TextureCorpusDirectory + filename);
+	if (data.empty())
+	{
+		state.SkipWithError("texture not found, pass --texture_corpus=DIR");
+		return;
+	}
+
+	ImageDecoder::SetStbOnly(state.range(0) != 0);
+	DECODED_IMAGE image;
+	int64_t pixelBytes = 0;
+	for (auto _ : state)
+	{
+		if (!ImageDecoder::DecodeMemory(&data[0], data.size(), image))
+		{
+			state.SkipWithError("decode failed");
+			break;
+		}
+		pixelBytes += (int64_t)image.width * image.height * image.channels;
+		ImageDecoder::Free(image);
+	}
+	ImageDecoder::SetStbOnly(false);
+
+	state.SetBytesProcessed(pixelBytes);
+	state.SetLabel(std::string(ImageDecoder::GetDecoderName(image.decoder)) + ", " + std::to_string(image.threads) + " threads");
+}
+BENCHMARK_CAPTURE(BM_DecodeImage, wood, "wood.jpg")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+/***********************************************************
+ *  BM_DecodeMeshStream()
+ *
+ *  Decode the vertices of a torus in the vertex pulling
+ *  arena layout, with the vertex count as the argument.
+ *  The ratio counter is the raw over the encoded size.
+ ***********************************************************/
+static void BM_DecodeMeshStream(benchmark::State& state)
+{
+	const int rings = 64;
+	size_t vertexCount = (size_t)state.range(0);
+	std::vector<float> vertices(vertexCount * 8);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		float u = 6.2831853f * (float)(i % rings) / rings;
+		float v = 6.2831853f * (float)(i / rings) / rings;
+		float* pVertex = &vertices[i * 8];
+		pVertex[0] = (1.0f + 0.25f * cosf(u)) * cosf(v);
+		pVertex[1] = 0.25f * sinf(u);
+		pVertex[2] = (1.0f + 0.25f * cosf(u)) * sinf(v);
+		pVertex[3] = (float)(i % rings) / rings;
+		pVertex[4] = cosf(u) * cosf(v);
+		pVertex[5] = sinf(u);
+		pVertex[6] = cosf(u) * sinf(v);
+		pVertex[7] = (float)(i / rings) / rings;
+	}
+
+	std::vector<unsigned char> encoded;
+	MeshCodec::EncodeStream(&vertices[0], vertexCount, 8 * sizeof(float), encoded);
+	std::vector<float> decoded(vertices.size());
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(MeshCodec::DecodeStream(&encoded[0], encoded.size(), &decoded[0], vertexCount, 8 * sizeof(float)));
+		benchmark::ClobberMemory();
+	}
+	state.SetBytesProcessed(state.iterations() * (int64_t)(vertices.size() * sizeof(float)));
+	state.counters["ratio"] = (double)(vertices.size() * sizeof(float)) / encoded.size();
+}
+BENCHMARK(BM_DecodeMeshStream)->RangeMultiplier(16)->Range(4096, 1 << 20);
+
+/***********************************************************
+ *  BM_PoolAllocate() / BM_NewAllocate() / BM_VectorAllocate()
+ *
+ *  Add the argument's number of material records and remove
+ *  them again, as a scene edit does, from a RecordPool, with
+ *  new and delete, and with a std::vector that is cleared.
+ *  Only the first two keep the records at a stable address.
+ ***********************************************************/
+static void BM_PoolAllocate(benchmark::State& state)
+{
+	const int count = (int)state.range(0);
+	SceneManager::OBJECT_MATERIAL material = MakeMaterial(0);
+	RecordPool<SceneManager::OBJECT_MATERIAL> pool;
+	std::vector<SceneManager::OBJECT_MATERIAL*> records(count);
+	for (auto _ : state)
+	{
+		for (int i = 0; i < count; i++)
+			records[i] = pool.Allocate(material);
+		benchmark::DoNotOptimize(records.data());
+		for (int i = 0; i < count; i++)
+			pool.Free(records[i]);
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_PoolAllocate)->RangeMultiplier(16)->Range(16, 4096);
+
+static void BM_NewAllocate(benchmark::State& state)
+{
+	const int count = (int)state.range(0);
+	SceneManager::OBJECT_MATERIAL material = MakeMaterial(0);
+	std::vector<SceneManager::OBJECT_MATERIAL*> records(count);
+	for (auto _ : state)
+	{
+		for (int i = 0; i < count; i++)
+			records[i] = new SceneManager::OBJECT_MATERIAL(material);
+		benchmark::DoNotOptimize(records.data());
+		for (int i = 0; i < count; i++)
+			delete records[i];
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_NewAllocate)->RangeMultiplier(16)->Range(16, 4096);
+
+static void BM_VectorAllocate(benchmark::State& state)
+{
+	const int count = (int)state.range(0);
+	SceneManager::OBJECT_MATERIAL material = MakeMaterial(0);
+	std::vector<SceneManager::OBJECT_MATERIAL> records;
+	for (auto _ : state)
+	{
+		for (int i = 0; i < count; i++)
+			records.push_back(material);
+		benchmark::DoNotOptimize(records.data());
+		records.clear();
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_VectorAllocate)->RangeMultiplier(16)->Range(16, 4096);
+
+/***********************************************************
+ *  BM_PoolIterate() / BM_NewIterate() / BM_VectorIterate()
+ *
+ *  Sum the shininess of the argument's number of material
+ *  records, after every fourth one was removed again. The
+ *  heap records are allocated interleaved with strings of
+ *  their own, as the scene setup does, so they are spread
+ *  over the heap the way separately allocated records are.
+ ***********************************************************/
+static void BM_PoolIterate(benchmark::State& state)
+{
+	const int count = (int)state.range(0);
+	RecordPool<SceneManager::OBJECT_MATERIAL> pool;
+	std::vector<SceneManager::OBJECT_MATERIAL*> records;
+	for (int i = 0; i < count; i++)
+		records.push_back(pool.Allocate(MakeMaterial(i)));
+	for (int i = 0; i < count; i += 4)
+		pool.Free(records[i]);
+	for (auto _ : state)
+	{
+		float sum = 0.0f;
+		for (const SceneManager::OBJECT_MATERIAL& material : pool)
+			sum += material.shininess;
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * (int64_t)pool.GetCount());
+}
+BENCHMARK(BM_PoolIterate)->RangeMultiplier(16)->Range(16, 4096);
+
+static void BM_NewIterate(benchmark::State& state)
+{
+	const int count = (int)state.range(0);
+	std::vector<SceneManager::OBJECT_MATERIAL*> records;
+	std::vector<std::string*> strings;
+	for (int i = 0; i < count; i++)
+	{
+		records.push_back(new SceneManager::OBJECT_MATERIAL(MakeMaterial(i)));
+		strings.push_back(new std::string(64, 'x'));
+	}
+	for (int i = 0; i < count; i += 4)
+	{
+		delete records[i];
+		records[i] = NULL;
+	}
+	records.erase(std::remove(records.begin(), records.end(), (SceneManager::OBJECT_MATERIAL*)NULL), records.end());
+	for (auto _ : state)
+	{
+		float sum = 0.0f;
+		for (size_t i = 0; i < records.size(); i++)
+			sum += records[i]->shininess;
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * (int64_t)records.size());
+	for (size_t i = 0; i < records.size(); i++)
+		delete records[i];
+	for (size_t i = 0; i < strings.size(); i++)
+		delete strings[i];
+}
+BENCHMARK(BM_NewIterate)->RangeMultiplier(16)->Range(16, 4096);
+
+static void BM_VectorIterate(benchmark::State& state)
+{
+	const int count = (int)state.range(0);
+	std::vector<SceneManager::OBJECT_MATERIAL> records;
+	for (int i = 0; i < count; i++)
+	{
+		if ((i % 4) != 0)
+			records.push_back(MakeMaterial(i));
+	}
+	for (auto _ : state)
+	{
+		float sum = 0.0f;
+		for (size_t i = 0; i < records.size(); i++)
+			sum += records[i].shininess;
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * (int64_t)records.size());
+}
+BENCHMARK(BM_VectorIterate)->RangeMultiplier(16)->Range(16, 4096);
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  Runs the benchmarks, writing the results as JSON unless
+ *  the command line already names an output file.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	static char outArgument[] = "--benchmark_out=scene_benchmarks.json";
+	static char formatArgument[] = "--benchmark_out_format=json";
+
+	std::vector<char*> arguments(1, argv[0]);
+	bool bHasOutput = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--texture_corpus=", 17) == 0)
+		{
+			g_TextureCorpusDirectory = std::string(argv[i] + 17) + "/";
+			continue;
+		}
+		bHasOutput = bHasOutput || (strncmp(argv[i], "--benchmark_out=", 16) == 0);
+		arguments.push_back(argv[i]);
+	}
+	if (!bHasOutput)
+	{
+		arguments.push_back(outArgument);
+		arguments.push_back(formatArgument);
+	}
+
+	int count = (int)arguments.size();
+	benchmark::Initialize(&count, &arguments[0]);
+	if (benchmark::ReportUnrecognizedArguments(count, &arguments[0]))
+		return EXIT_FAILURE;
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,328 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenetests.cpp
+// ============
+// correctness checks of the code the scene benchmarks time
+//
+//	Usage: SceneTests
+//
+//	Runs every check and prints the ones that failed; the exit code is
+//	the number of failed checks, so a build step can run it. The Debug
+//	build compiles the MeshCodec without SSE2 (MESHCODEC_NO_SIMD) and
+//	the Release build with it, so running both covers both decoders.
+//	The RecordPool checks run with full and with small chunks, so the
+//	free list and the iteration cross many chunk boundaries.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "MeshCodec.h"
+#include "RecordPool.h"
+
+// declaration of the global variables and defines
+namespace
+{
+	int g_ChecksRun = 0;
+	int g_ChecksFailed = 0;
+
+	// bytes after a decoded stream that the decoder must leave alone
+	const size_t g_GuardBytes = 64;
+	const unsigned char g_GuardValue = 0xCD;
+
+	// what the checks are run on, printed with a failure
+	char g_Case[64] = "";
+
+	void Check(bool bPassed, const char* check)
+	{
+		g_ChecksRun++;
+		if (bPassed)
+			return;
+		g_ChecksFailed++;
+		std::cout << "[ERROR] " << check << " (" << g_Case << ")" << std::endl;
+	}
+
+	// deterministic pseudo random words, so a failure can be repeated
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	enum STREAM_KIND
+	{
+		STREAM_RANDOM = 0,
+		STREAM_RAMP,
+		STREAM_ZERO,
+		STREAM_KIND_COUNT
+	};
+
+	std::vector<unsigned char> MakeStream(STREAM_KIND kind, size_t count, size_t stride)
+	{
+		std::vector<unsigned char> elements(count * stride);
+		size_t wordCount = stride / 4;
+		uint32_t state = 0x9E3779B9u ^ (uint32_t)(count * 131 + stride);
+		for (size_t i = 0; i < count; i++)
+		{
+			for (size_t k = 0; k < wordCount; k++)
+			{
+				uint32_t word = 0;
+				if (kind == STREAM_RANDOM)
+				{
+					word = NextRandom(state);
+				}
+				else if (kind == STREAM_RAMP)
+				{
+					float value = (float)k - 0.01f * (float)i;
+					memcpy(&word, &value, sizeof(word));
+				}
+				memcpy(&elements[i * stride + k * 4], &word, sizeof(word));
+			}
+		}
+		return elements;
+	}
+
+	// encode the elements, decode them again and compare
+	void CheckRoundTrip(const std::vector<unsigned char>& elements, size_t count, size_t stride)
+	{
+		snprintf(g_Case, sizeof(g_Case), "count %u, stride %u", (unsigned int)count, (unsigned int)stride);
+		std::vector<unsigned char> encoded;
+		bool bEncoded = MeshCodec::EncodeStream(elements.empty() ? NULL : &elements[0], count, stride, encoded);
+		Check(bEncoded, "EncodeStream failed");
+		if (!bEncoded)
+			return;
+
+		std::vector<unsigned char> decoded(count * stride + g_GuardBytes, g_GuardValue);
+		size_t read = MeshCodec::DecodeStream(&encoded[0], encoded.size(), &decoded[0], count, stride);
+		Check(read == encoded.size(), "DecodeStream did not read the whole stream");
+		Check(count == 0 || memcmp(&decoded[0], &elements[0], count * stride) == 0, "decoded elements differ");
+
+		bool bGuardIntact = true;
+		for (size_t i = count * stride; i < decoded.size(); i++)
+			bGuardIntact = bGuardIntact && decoded[i] == g_GuardValue;
+		Check(bGuardIntact, "DecodeStream wrote past the last element");
+
+		Check(MeshCodec::DecodeStream(&encoded[0], encoded.size(), &decoded[0], count + 1, stride) == 0,
+			"DecodeStream accepted the wrong element count");
+	}
+
+	// every cut of the stream must be refused, both with the size passed
+	// short and with the header claiming the short size
+	void CheckTruncation(const std::vector<unsigned char>& elements, size_t count, size_t stride)
+	{
+		snprintf(g_Case, sizeof(g_Case), "count %u, stride %u", (unsigned int)count, (unsigned int)stride);
+		std::vector<unsigned char> encoded;
+		MeshCodec::EncodeStream(elements.empty() ? NULL : &elements[0], count, stride, encoded);
+		std::vector<unsigned char> decoded(count * stride + g_GuardBytes);
+
+		// the header holds the stream size as its last 32-bit field
+		const size_t encodedBytesOffset = 12;
+		size_t step = (encoded.size() > 4096) ? 7 : 1;
+		bool bShortRefused = true;
+		bool bCutRefused = true;
+		for (size_t size = 0; size < encoded.size(); size += step)
+		{
+			bShortRefused = bShortRefused && MeshCodec::DecodeStream(&encoded[0], size, &decoded[0], count, stride) == 0;
+			if (size < encodedBytesOffset + 4)
+				continue;
+
+			std::vector<unsigned char> cut(encoded.begin(), encoded.begin() + size);
+			uint32_t cutBytes = (uint32_t)size;
+			memcpy(&cut[encodedBytesOffset], &cutBytes, sizeof(cutBytes));
+			bCutRefused = bCutRefused && MeshCodec::DecodeStream(&cut[0], cut.size(), &decoded[0], count, stride) == 0;
+		}
+		Check(bShortRefused, "DecodeStream accepted a stream passed short");
+		Check(bCutRefused, "DecodeStream accepted a truncated stream");
+
+		std::vector<unsigned char> damaged(encoded);
+		damaged[0] ^= 0xFF;
+		Check(MeshCodec::DecodeStream(&damaged[0], damaged.size(), &decoded[0], count, stride) == 0,
+			"DecodeStream accepted a stream without the magic");
+	}
+
+	// a record that counts its live instances, so leaks and double
+	// destruction show up
+	int g_LiveRecords = 0;
+
+	struct TEST_RECORD
+	{
+		size_t value;
+		double padding[3];
+
+		TEST_RECORD() : value((size_t)-1) { g_LiveRecords++; }
+		TEST_RECORD(const TEST_RECORD& other) : value(other.value) { g_LiveRecords++; }
+		~TEST_RECORD() { g_LiveRecords--; }
+	};
+
+	// the values iteration visits, in order
+	template <typename POOL>
+	std::vector<size_t> CollectValues(const POOL& pool)
+	{
+		std::vector<size_t> values;
+		for (const TEST_RECORD& record : pool)
+			values.push_back(record.value);
+		return values;
+	}
+
+	template <size_t CHUNK_RECORDS>
+	void CheckRecordPool(size_t count)
+	{
+		snprintf(g_Case, sizeof(g_Case), "count %u, chunk %u", (unsigned int)count, (unsigned int)CHUNK_RECORDS);
+		typedef RecordPool<TEST_RECORD, CHUNK_RECORDS> POOL;
+		{
+			POOL pool;
+			Check(pool.begin() == pool.end(), "an empty pool has records");
+
+			// a new pool hands out the slots in index order
+			std::vector<TEST_RECORD*> records;
+			TEST_RECORD record;
+			bool bInOrder = true;
+			for (size_t i = 0; i < count; i++)
+			{
+				record.value = i;
+				records.push_back(pool.Allocate(record));
+				bInOrder = bInOrder && pool.GetIndex(records[i]) == i && pool.GetRecord(i) == records[i];
+				bInOrder = bInOrder && ((size_t)records[i] % alignof(TEST_RECORD)) == 0;
+			}
+			Check(bInOrder, "new records are not in index order");
+			Check(pool.GetCount() == count, "the count is wrong after Allocate");
+			Check(pool.GetCapacity() == (count + CHUNK_RECORDS - 1) / CHUNK_RECORDS * CHUNK_RECORDS, "the capacity is not whole chunks");
+			Check(g_LiveRecords == (int)count + 1, "Allocate did not construct one record");
+			Check(pool.GetRecord(pool.GetCapacity()) == NULL, "a record past the capacity");
+
+			// free every third record and a whole chunk, if there is a second one
+			std::vector<bool> live(count, true);
+			for (size_t i = 0; i < count; i += 3)
+				live[i] = false;
+			for (size_t i = CHUNK_RECORDS; i < count && i < 2 * CHUNK_RECORDS; i++)
+				live[i] = false;
+			std::vector<size_t> expected;
+			std::vector<size_t> freed;
+			for (size_t i = 0; i < count; i++)
+			{
+				if (live[i])
+				{
+					expected.push_back(i);
+					continue;
+				}
+				pool.Free(records[i]);
+				freed.push_back(i);
+			}
+			Check(pool.GetCount() == expected.size(), "the count is wrong after Free");
+			Check(g_LiveRecords == (int)expected.size() + 1, "Free did not destroy the record");
+			Check(CollectValues(pool) == expected, "iteration does not visit the live records in index order");
+
+			bool bFreeSlotsEmpty = true;
+			for (size_t i = 0; i < freed.size(); i++)
+				bFreeSlotsEmpty = bFreeSlotsEmpty && pool.GetRecord(freed[i]) == NULL;
+			Check(bFreeSlotsEmpty, "GetRecord returned a freed record");
+
+			// foreign pointers are ignored
+			POOL other;
+			TEST_RECORD* pForeign = other.Allocate();
+			pool.Free(NULL);
+			pool.Free(pForeign);
+			pool.Free(&record);
+			Check(pool.GetCount() == expected.size() && other.GetCount() == 1, "Free changed the pool for a foreign record");
+			Check(pool.GetIndex(pForeign) == (size_t)-1, "GetIndex found a foreign record");
+
+			// the free slots are reused, the last freed first, before the pool grows
+			size_t capacity = pool.GetCapacity();
+			bool bReused = true;
+			for (size_t i = freed.size(); i > 0; i--)
+			{
+				record.value = freed[i - 1];
+				TEST_RECORD* pRecord = pool.Allocate(record);
+				bReused = bReused && pRecord == records[freed[i - 1]] && pool.GetIndex(pRecord) == freed[i - 1];
+			}
+			Check(bReused, "the free slots are not reused last freed first");
+			Check(pool.GetCapacity() == capacity, "the pool grew with free slots left");
+
+			std::vector<size_t> all(count);
+			for (size_t i = 0; i < count; i++)
+				all[i] = i;
+			Check(CollectValues(pool) == all, "iteration misses reused records");
+
+			// records keep their address while the pool grows
+			TEST_RECORD* pGrown = pool.Allocate();
+			bool bStable = pool.GetIndex(pGrown) == count && pool.GetCapacity() >= count + 1;
+			for (size_t i = 0; i < count; i++)
+				bStable = bStable && pool.GetRecord(i) == records[i] && records[i]->value == i;
+			Check(bStable, "records moved when the pool grew");
+
+			pool.Clear();
+			Check(pool.GetCount() == 0 && pool.GetCapacity() == 0 && pool.begin() == pool.end(), "Clear left records");
+			Check(g_LiveRecords == 2, "Clear did not destroy every record");
+
+			for (size_t i = 0; i < count; i++)
+				pool.Allocate();
+		}
+		Check(g_LiveRecords == 0, "the destructor did not destroy every record");
+		g_LiveRecords = 0;
+	}
+}
+
+/***********************************************************
+ *  TestMeshCodec()
+ *
+ *  Round trip random, ramp and zero streams of every stride
+ *  over counts around the group and block boundaries, and
+ *  make sure truncated and damaged streams are refused.
+ ***********************************************************/
+static void TestMeshCodec()
+{
+	const size_t counts[] = { 0, 1, 3, 15, 16, 17, 255, 256, 257, 511, 1000, 1500 };
+	for (size_t stride = 4; stride <= MESH_CODEC_MAX_STRIDE; stride += 4)
+	{
+		for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+		{
+			for (int kind = 0; kind < STREAM_KIND_COUNT; kind++)
+				CheckRoundTrip(MakeStream((STREAM_KIND)kind, counts[c], stride), counts[c], stride);
+			if (counts[c] <= 300)
+				CheckTruncation(MakeStream(STREAM_RANDOM, counts[c], stride), counts[c], stride);
+		}
+	}
+
+	snprintf(g_Case, sizeof(g_Case), "invalid strides");
+	std::vector<unsigned char> encoded;
+	unsigned char element[MESH_CODEC_MAX_STRIDE + 4] = { 0 };
+	Check(!MeshCodec::EncodeStream(element, 1, 6, encoded), "EncodeStream accepted a stride of 6");
+	Check(!MeshCodec::EncodeStream(element, 1, MESH_CODEC_MAX_STRIDE + 4, encoded), "EncodeStream accepted a stride past the maximum");
+}
+
+/***********************************************************
+ *  TestRecordPool()
+ *
+ *  Allocate, free and reuse records around the chunk
+ *  boundaries and check the indices, the free list order,
+ *  the iteration and that every record is destroyed once.
+ ***********************************************************/
+static void TestRecordPool()
+{
+	const size_t counts[] = { 0, 1, 3, 4, 5, 63, 64, 65, 200, 1000 };
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		CheckRecordPool<64>(counts[c]);
+		CheckRecordPool<4>(counts[c]);
+		CheckRecordPool<1>(counts[c]);
+	}
+}
+
+/***********************************************************
+ *  main()
+ *
+ *  Run the checks and report the result.
+ ***********************************************************/
+int main()
+{
+	std::cout << "[TEST] MeshCodec, " << (MeshCodec::HasSimdDecoder() ? "SSE2" : "scalar") << " decoder" << std::endl;
+	TestMeshCodec();
+	std::cout << "[TEST] RecordPool" << std::endl;
+	TestRecordPool();
+
+	std::cout << "[TEST] " << (g_ChecksRun - g_ChecksFailed) << " of " << g_ChecksRun << " checks passed" << std::endl;
+	return g_ChecksFailed;
+}
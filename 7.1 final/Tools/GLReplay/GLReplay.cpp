@@ -0,0 +1,906 @@
+///////////////////////////////////////////////////////////////////////////////
+// glreplay.cpp
+// ============
+// replay GL command traces recorded with GLTrace, as fast as possible
+//
+//	Usage: GLReplay trace.gltrace [--loop N] [--profile] [--strip] [--size WxH]
+//
+//	The first frame of the trace, which also holds the scene setup, is
+//	replayed once. The remaining frames are then looped N times without
+//	vsync, timing the CPU cost of issuing them and the time to finish
+//	them on the GPU. --profile reports the cost of every GL function,
+//	--strip also replays the loop without calls that set state to the
+//	value it already has, to estimate what removing them would save.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include "GLTraceFormat.h"
+
+using namespace GLTraceFormat;
+
+// declaration of the global variables and defines
+namespace
+{
+	typedef std::chrono::steady_clock CLOCK;
+
+	// one decoded call of the trace
+	struct CALL
+	{
+		uint8_t  op;
+		uint32_t words[MAX_WORDS];
+		uint32_t blobOffset;
+		uint32_t blobSize;
+	};
+
+	// accumulated cost of one GL function
+	struct CALL_COST
+	{
+		uint64_t calls;
+		double   nanoseconds;
+	};
+
+	// command line options
+	const char* g_TraceFile = NULL;
+	int  g_LoopCount = 100;
+	bool g_bProfile = false;
+	bool g_bStrip = false;
+	int  g_WindowWidth = 1280;
+	int  g_WindowHeight = 720;
+
+	float AsFloat(uint32_t word)
+	{
+		float value;
+		memcpy(&value, &word, sizeof(value));
+		return value;
+	}
+
+	double Milliseconds(CLOCK::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+}
+
+/***********************************************************
+ *  TraceReplayer
+ *
+ *  This class re-issues decoded calls, translating the
+ *  object names and uniform locations of the recording to
+ *  the ones of the replaying context.
+ ***********************************************************/
+class TraceReplayer
+{
+public:
+	TraceReplayer(const std::vector<unsigned char>& data) : m_data(data), m_currentProgram(0) {}
+
+	void Execute(const CALL& call);
+
+private:
+	const std::vector<unsigned char>& m_data;
+
+	std::vector<GLuint> m_textures;
+	std::vector<GLuint> m_buffers;
+	std::vector<GLuint> m_vertexArrays;
+	std::vector<GLuint> m_framebuffers;
+	std::vector<GLuint> m_queries;
+	std::vector<GLuint> m_shaders;
+	std::vector<GLuint> m_programs;
+	// uniform locations by recorded program and recorded location
+	std::vector<std::vector<GLint> > m_locations;
+	uint32_t m_currentProgram;
+
+	const void* Blob(const CALL& call) const
+	{
+		return (call.blobSize > 0) ? &m_data[call.blobOffset] : NULL;
+	}
+
+	static GLuint Map(const std::vector<GLuint>& table, uint32_t name)
+	{
+		return (name < table.size()) ? table[name] : name;
+	}
+
+	static void SetMapping(std::vector<GLuint>& table, uint32_t name, GLuint actual)
+	{
+		if (name >= table.size())
+			table.resize(name + 1, 0);
+		table[name] = actual;
+	}
+
+	GLint Location(uint32_t location) const
+	{
+		GLint recorded = (GLint)location;
+		if (recorded < 0 || m_currentProgram >= m_locations.size())
+			return recorded;
+		const std::vector<GLint>& locations = m_locations[m_currentProgram];
+		return ((size_t)recorded < locations.size()) ? locations[recorded] : recorded;
+	}
+
+	// glGen* style creation of n objects into a name table
+	template <typename GEN>
+	void Generate(const CALL& call, std::vector<GLuint>& table, GEN generate)
+	{
+		GLsizei count = (GLsizei)(call.blobSize / sizeof(GLuint));
+		const GLuint* recorded = (const GLuint*)Blob(call);
+		std::vector<GLuint> names(count, 0);
+		if (count > 0)
+			generate(count, &names[0]);
+		for (GLsizei i = 0; i < count; i++)
+			SetMapping(table, recorded[i], names[i]);
+	}
+
+	// glDelete* style deletion of n objects of a name table
+	template <typename DEL>
+	void Delete(const CALL& call, std::vector<GLuint>& table, DEL remove)
+	{
+		GLsizei count = (GLsizei)(call.blobSize / sizeof(GLuint));
+		const GLuint* recorded = (const GLuint*)Blob(call);
+		std::vector<GLuint> names(count, 0);
+		for (GLsizei i = 0; i < count; i++)
+		{
+			names[i] = Map(table, recorded[i]);
+			SetMapping(table, recorded[i], 0);
+		}
+		if (count > 0)
+			remove(count, &names[0]);
+	}
+
+	void CheckShader(GLuint shader);
+	void CheckProgram(GLuint program);
+};
+
+/***********************************************************
+ *  CheckShader() / CheckProgram()
+ *
+ *  These methods are used for reporting shaders that do not
+ *  compile or link on the replaying driver.
+ ***********************************************************/
+void TraceReplayer::CheckShader(GLuint shader)
+{
+	GLint status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status == GL_TRUE)
+		return;
+
+	char log[1024];
+	glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+	std::cout << "[WARNING] Shader " << shader << " did not compile:\n" << log << std::endl;
+}
+
+void TraceReplayer::CheckProgram(GLuint program)
+{
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status == GL_TRUE)
+		return;
+
+	char log[1024];
+	glGetProgramInfoLog(program, sizeof(log), NULL, log);
+	std::cout << "[WARNING] Program " << program << " did not link:\n" << log << std::endl;
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method is used for issuing one recorded call.
+ ***********************************************************/
+void TraceReplayer::Execute(const CALL& call)
+{
+	const uint32_t* w = call.words;
+
+	switch (call.op)
+	{
+	case OP_FRAME_END:
+		break;
+
+	case OP_GEN_TEXTURES:
+		Generate(call, m_textures, [](GLsizei n, GLuint* names) { glGenTextures(n, names); });
+		break;
+	case OP_GEN_BUFFERS:
+		Generate(call, m_buffers, [](GLsizei n, GLuint* names) { glGenBuffers(n, names); });
+		break;
+	case OP_GEN_VERTEX_ARRAYS:
+		Generate(call, m_vertexArrays, [](GLsizei n, GLuint* names) { glGenVertexArrays(n, names); });
+		break;
+	case OP_GEN_FRAMEBUFFERS:
+		Generate(call, m_framebuffers, [](GLsizei n, GLuint* names) { glGenFramebuffers(n, names); });
+		break;
+	case OP_GEN_QUERIES:
+		Generate(call, m_queries, [](GLsizei n, GLuint* names) { glGenQueries(n, names); });
+		break;
+	case OP_CREATE_SHADER:
+		SetMapping(m_shaders, w[1], glCreateShader(w[0]));
+		break;
+	case OP_CREATE_PROGRAM:
+		SetMapping(m_programs, w[0], glCreateProgram());
+		break;
+
+	case OP_DELETE_TEXTURES:
+		Delete(call, m_textures, [](GLsizei n, const GLuint* names) { glDeleteTextures(n, names); });
+		break;
+	case OP_DELETE_BUFFERS:
+		Delete(call, m_buffers, [](GLsizei n, const GLuint* names) { glDeleteBuffers(n, names); });
+		break;
+	case OP_DELETE_VERTEX_ARRAYS:
+		Delete(call, m_vertexArrays, [](GLsizei n, const GLuint* names) { glDeleteVertexArrays(n, names); });
+		break;
+	case OP_DELETE_FRAMEBUFFERS:
+		Delete(call, m_framebuffers, [](GLsizei n, const GLuint* names) { glDeleteFramebuffers(n, names); });
+		break;
+	case OP_DELETE_QUERIES:
+		Delete(call, m_queries, [](GLsizei n, const GLuint* names) { glDeleteQueries(n, names); });
+		break;
+	case OP_DELETE_SHADER:
+		glDeleteShader(Map(m_shaders, w[0]));
+		break;
+	case OP_DELETE_PROGRAM:
+		glDeleteProgram(Map(m_programs, w[0]));
+		break;
+
+	case OP_ACTIVE_TEXTURE:
+		glActiveTexture(w[0]);
+		break;
+	case OP_BIND_TEXTURE:
+		glBindTexture(w[0], Map(m_textures, w[1]));
+		break;
+	case OP_BIND_BUFFER:
+		glBindBuffer(w[0], Map(m_buffers, w[1]));
+		break;
+	case OP_BIND_BUFFER_BASE:
+		glBindBufferBase(w[0], w[1], Map(m_buffers, w[2]));
+		break;
+	case OP_BIND_VERTEX_ARRAY:
+		glBindVertexArray(Map(m_vertexArrays, w[0]));
+		break;
+	case OP_BIND_FRAMEBUFFER:
+		glBindFramebuffer(w[0], Map(m_framebuffers, w[1]));
+		break;
+	case OP_USE_PROGRAM:
+		m_currentProgram = w[0];
+		glUseProgram(Map(m_programs, w[0]));
+		break;
+	case OP_BIND_IMAGE_TEXTURE:
+		glBindImageTexture(w[0], Map(m_textures, w[1]), (GLint)w[2], (GLboolean)w[3], (GLint)w[4], w[5], w[6]);
+		break;
+
+	case OP_TEX_IMAGE_2D:
+		glTexImage2D(w[0], (GLint)w[1], (GLint)w[2], (GLsizei)w[3], (GLsizei)w[4], (GLint)w[5], w[6], w[7], Blob(call));
+		break;
+	case OP_TEX_SUB_IMAGE_2D:
+		glTexSubImage2D(w[0], (GLint)w[1], (GLint)w[2], (GLint)w[3], (GLsizei)w[4], (GLsizei)w[5], w[6], w[7], Blob(call));
+		break;
+	case OP_TEX_STORAGE_2D:
+		glTexStorage2D(w[0], (GLsizei)w[1], w[2], (GLsizei)w[3], (GLsizei)w[4]);
+		break;
+	case OP_TEX_STORAGE_3D:
+		glTexStorage3D(w[0], (GLsizei)w[1], w[2], (GLsizei)w[3], (GLsizei)w[4], (GLsizei)w[5]);
+		break;
+	case OP_TEX_PARAMETER_I:
+		glTexParameteri(w[0], w[1], (GLint)w[2]);
+		break;
+	case OP_GENERATE_MIPMAP:
+		glGenerateMipmap(w[0]);
+		break;
+	case OP_BUFFER_DATA:
+		glBufferData(w[0], (GLsizeiptr)w[1], Blob(call), w[2]);
+		break;
+	case OP_BUFFER_SUB_DATA:
+		glBufferSubData(w[0], (GLintptr)w[1], (GLsizeiptr)call.blobSize, Blob(call));
+		break;
+	case OP_COPY_IMAGE_SUB_DATA:
+		glCopyImageSubData(Map(m_textures, w[0]), w[1], (GLint)w[2], (GLint)w[3], (GLint)w[4], (GLint)w[5],
+			Map(m_textures, w[6]), w[7], (GLint)w[8], (GLint)w[9], (GLint)w[10], (GLint)w[11],
+			(GLsizei)w[12], (GLsizei)w[13], (GLsizei)w[14]);
+		break;
+	case OP_FRAMEBUFFER_TEXTURE_2D:
+		glFramebufferTexture2D(w[0], w[1], w[2], Map(m_textures, w[3]), (GLint)w[4]);
+		break;
+	case OP_DRAW_BUFFERS:
+		glDrawBuffers((GLsizei)(call.blobSize / sizeof(GLenum)), (const GLenum*)Blob(call));
+		break;
+	case OP_READ_BUFFER:
+		glReadBuffer(w[0]);
+		break;
+
+	case OP_VERTEX_ATTRIB_POINTER:
+		glVertexAttribPointer(w[0], (GLint)w[1], w[2], (GLboolean)w[3], (GLsizei)w[4], (const void*)(size_t)w[5]);
+		break;
+	case OP_ENABLE_VERTEX_ATTRIB_ARRAY:
+		glEnableVertexAttribArray(w[0]);
+		break;
+	case OP_DISABLE_VERTEX_ATTRIB_ARRAY:
+		glDisableVertexAttribArray(w[0]);
+		break;
+
+	case OP_SHADER_SOURCE:
+	{
+		const GLchar* source = (const GLchar*)Blob(call);
+		GLint length = (GLint)call.blobSize;
+		glShaderSource(Map(m_shaders, w[0]), 1, &source, &length);
+		break;
+	}
+	case OP_COMPILE_SHADER:
+		glCompileShader(Map(m_shaders, w[0]));
+		CheckShader(Map(m_shaders, w[0]));
+		break;
+	case OP_ATTACH_SHADER:
+		glAttachShader(Map(m_programs, w[0]), Map(m_shaders, w[1]));
+		break;
+	case OP_LINK_PROGRAM:
+		glLinkProgram(Map(m_programs, w[0]));
+		CheckProgram(Map(m_programs, w[0]));
+		break;
+	case OP_GET_UNIFORM_LOCATION:
+	{
+		GLint recorded = (GLint)w[1];
+		GLint actual = glGetUniformLocation(Map(m_programs, w[0]), (const GLchar*)Blob(call));
+		if (recorded >= 0)
+		{
+			if (w[0] >= m_locations.size())
+				m_locations.resize(w[0] + 1);
+			std::vector<GLint>& locations = m_locations[w[0]];
+			if ((size_t)recorded >= locations.size())
+				locations.resize(recorded + 1, -1);
+			locations[recorded] = actual;
+		}
+		break;
+	}
+
+	case OP_UNIFORM_1I:
+		glUniform1i(Location(w[0]), (GLint)w[1]);
+		break;
+	case OP_UNIFORM_1F:
+		glUniform1f(Location(w[0]), AsFloat(w[1]));
+		break;
+	case OP_UNIFORM_2F:
+		glUniform2f(Location(w[0]), AsFloat(w[1]), AsFloat(w[2]));
+		break;
+	case OP_UNIFORM_3F:
+		glUniform3f(Location(w[0]), AsFloat(w[1]), AsFloat(w[2]), AsFloat(w[3]));
+		break;
+	case OP_UNIFORM_4F:
+		glUniform4f(Location(w[0]), AsFloat(w[1]), AsFloat(w[2]), AsFloat(w[3]), AsFloat(w[4]));
+		break;
+	case OP_UNIFORM_2FV:
+		glUniform2fv(Location(w[0]), (GLsizei)(call.blobSize / (2 * sizeof(GLfloat))), (const GLfloat*)Blob(call));
+		break;
+	case OP_UNIFORM_3FV:
+		glUniform3fv(Location(w[0]), (GLsizei)(call.blobSize / (3 * sizeof(GLfloat))), (const GLfloat*)Blob(call));
+		break;
+	case OP_UNIFORM_4FV:
+		glUniform4fv(Location(w[0]), (GLsizei)(call.blobSize / (4 * sizeof(GLfloat))), (const GLfloat*)Blob(call));
+		break;
+	case OP_UNIFORM_MATRIX_4FV:
+		glUniformMatrix4fv(Location(w[0]), (GLsizei)(call.blobSize / (16 * sizeof(GLfloat))), (GLboolean)w[1], (const GLfloat*)Blob(call));
+		break;
+
+	case OP_ENABLE:
+		glEnable(w[0]);
+		break;
+	case OP_DISABLE:
+		glDisable(w[0]);
+		break;
+	case OP_VIEWPORT:
+		glViewport((GLint)w[0], (GLint)w[1], (GLsizei)w[2], (GLsizei)w[3]);
+		break;
+	case OP_CLEAR_COLOR:
+		glClearColor(AsFloat(w[0]), AsFloat(w[1]), AsFloat(w[2]), AsFloat(w[3]));
+		break;
+	case OP_CLEAR:
+		glClear(w[0]);
+		break;
+	case OP_CLEAR_BUFFER_UIV:
+		glClearBufferuiv(w[0], (GLint)w[1], (const GLuint*)Blob(call));
+		break;
+	case OP_CLEAR_BUFFER_FV:
+		glClearBufferfv(w[0], (GLint)w[1], (const GLfloat*)Blob(call));
+		break;
+	case OP_BLEND_FUNC:
+		glBlendFunc(w[0], w[1]);
+		break;
+	case OP_DEPTH_FUNC:
+		glDepthFunc(w[0]);
+		break;
+	case OP_DEPTH_MASK:
+		glDepthMask((GLboolean)w[0]);
+		break;
+	case OP_CULL_FACE:
+		glCullFace(w[0]);
+		break;
+	case OP_STENCIL_FUNC:
+		glStencilFunc(w[0], (GLint)w[1], w[2]);
+		break;
+	case OP_STENCIL_OP:
+		glStencilOp(w[0], w[1], w[2]);
+		break;
+	case OP_STENCIL_MASK:
+		glStencilMask(w[0]);
+		break;
+	case OP_POLYGON_MODE:
+		glPolygonMode(w[0], w[1]);
+		break;
+	case OP_MEMORY_BARRIER:
+		glMemoryBarrier(w[0]);
+		break;
+
+	case OP_DRAW_ARRAYS:
+		glDrawArrays(w[0], (GLint)w[1], (GLsizei)w[2]);
+		break;
+	case OP_DRAW_ELEMENTS:
+		glDrawElements(w[0], (GLsizei)w[1], w[2], (const void*)(size_t)w[3]);
+		break;
+	case OP_DISPATCH_COMPUTE:
+		glDispatchCompute(w[0], w[1], w[2]);
+		break;
+	case OP_BLIT_FRAMEBUFFER:
+		glBlitFramebuffer((GLint)w[0], (GLint)w[1], (GLint)w[2], (GLint)w[3],
+			(GLint)w[4], (GLint)w[5], (GLint)w[6], (GLint)w[7], w[8], w[9]);
+		break;
+	case OP_BEGIN_QUERY:
+		glBeginQuery(w[0], Map(m_queries, w[1]));
+		break;
+	case OP_END_QUERY:
+		glEndQuery(w[0]);
+		break;
+	}
+}
+
+/***********************************************************
+ *  RedundancyTracker
+ *
+ *  This class follows the GL state through the recorded
+ *  calls and flags calls that set state to the value it
+ *  already has. Only state that is fully described by the
+ *  trace is tracked; anything else is never flagged.
+ ***********************************************************/
+class RedundancyTracker
+{
+public:
+	RedundancyTracker(const std::vector<unsigned char>& data) : m_data(data), m_program(0), m_activeTexture(GL_TEXTURE0) {}
+
+	bool IsRedundant(const CALL& call);
+
+private:
+	typedef std::vector<uint32_t> VALUE;
+
+	const std::vector<unsigned char>& m_data;
+	uint32_t m_program;
+	uint32_t m_activeTexture;
+	// last value of each piece of state, keyed by opcode and target
+	std::map<uint64_t, VALUE> m_state;
+	// last value of each uniform, keyed by program and location
+	std::map<uint64_t, VALUE> m_uniforms;
+
+	VALUE ValueOf(const CALL& call, int firstWord) const
+	{
+		VALUE value(call.words + firstWord, call.words + OPCODES[call.op].words);
+		const uint32_t* blob = (const uint32_t*)&m_data[call.blobOffset];
+		value.insert(value.end(), blob, blob + call.blobSize / sizeof(uint32_t));
+		return value;
+	}
+
+	bool Update(std::map<uint64_t, VALUE>& table, uint64_t key, const VALUE& value)
+	{
+		std::map<uint64_t, VALUE>::iterator it = table.find(key);
+		if (it != table.end() && it->second == value)
+			return true;
+		table[key] = value;
+		return false;
+	}
+
+	void Forget(uint8_t op)
+	{
+		std::map<uint64_t, VALUE>::iterator it = m_state.lower_bound((uint64_t)op << 40);
+		while (it != m_state.end() && (it->first >> 40) == op)
+			it = m_state.erase(it);
+	}
+};
+
+/***********************************************************
+ *  IsRedundant()
+ *
+ *  This method is used for checking one call against the
+ *  tracked state and updating the state with it.
+ ***********************************************************/
+bool RedundancyTracker::IsRedundant(const CALL& call)
+{
+	uint64_t op = (uint64_t)call.op << 40;
+	const uint32_t* w = call.words;
+
+	switch (call.op)
+	{
+	case OP_USE_PROGRAM:
+		if (m_program == w[0])
+			return true;
+		m_program = w[0];
+		return false;
+	case OP_ACTIVE_TEXTURE:
+		if (m_activeTexture == w[0])
+			return true;
+		m_activeTexture = w[0];
+		return false;
+	case OP_BIND_TEXTURE:
+		return Update(m_state, op | ((uint64_t)m_activeTexture << 20) | (w[0] & 0xfffff), ValueOf(call, 1));
+	case OP_BIND_BUFFER:
+		// the element array binding belongs to the vertex array object
+		if (w[0] == GL_ELEMENT_ARRAY_BUFFER)
+			return false;
+		return Update(m_state, op | w[0], ValueOf(call, 1));
+	case OP_BIND_FRAMEBUFFER:
+		if (w[0] == GL_FRAMEBUFFER)
+		{
+			bool bDraw = Update(m_state, op | GL_DRAW_FRAMEBUFFER, ValueOf(call, 1));
+			bool bRead = Update(m_state, op | GL_READ_FRAMEBUFFER, ValueOf(call, 1));
+			return bDraw && bRead;
+		}
+		return Update(m_state, op | w[0], ValueOf(call, 1));
+	case OP_BIND_VERTEX_ARRAY:
+	case OP_CLEAR_COLOR:
+	case OP_VIEWPORT:
+	case OP_BLEND_FUNC:
+	case OP_DEPTH_FUNC:
+	case OP_DEPTH_MASK:
+	case OP_CULL_FACE:
+	case OP_STENCIL_FUNC:
+	case OP_STENCIL_OP:
+	case OP_STENCIL_MASK:
+		return Update(m_state, op, ValueOf(call, 0));
+	case OP_ENABLE:
+	case OP_DISABLE:
+	{
+		VALUE value(1, call.op == OP_ENABLE ? 1 : 0);
+		return Update(m_state, ((uint64_t)OP_ENABLE << 40) | w[0], value);
+	}
+
+	case OP_UNIFORM_1I:
+	case OP_UNIFORM_1F:
+	case OP_UNIFORM_2F:
+	case OP_UNIFORM_3F:
+	case OP_UNIFORM_4F:
+	case OP_UNIFORM_2FV:
+	case OP_UNIFORM_3FV:
+	case OP_UNIFORM_4FV:
+	case OP_UNIFORM_MATRIX_4FV:
+	{
+		VALUE value = ValueOf(call, 1);
+		value.push_back(call.op);
+		return Update(m_uniforms, ((uint64_t)m_program << 32) | w[0], value);
+	}
+
+	case OP_LINK_PROGRAM:
+	{
+		// linking resets every uniform of the program
+		std::map<uint64_t, VALUE>::iterator it = m_uniforms.lower_bound((uint64_t)w[0] << 32);
+		while (it != m_uniforms.end() && (it->first >> 32) == w[0])
+			it = m_uniforms.erase(it);
+		return false;
+	}
+	case OP_DELETE_TEXTURES:
+		Forget(OP_BIND_TEXTURE);
+		return false;
+	case OP_DELETE_BUFFERS:
+		Forget(OP_BIND_BUFFER);
+		return false;
+	case OP_DELETE_VERTEX_ARRAYS:
+		Forget(OP_BIND_VERTEX_ARRAY);
+		return false;
+	case OP_DELETE_FRAMEBUFFERS:
+		Forget(OP_BIND_FRAMEBUFFER);
+		return false;
+	case OP_DELETE_PROGRAM:
+		if (m_program == w[0])
+			m_program = 0;
+		return false;
+	}
+
+	return false;
+}
+
+/***********************************************************
+ *  LoadTrace()
+ *
+ *  Reads a trace file and decodes it into calls, returning
+ *  the index of the FRAME_END call of every frame.
+ ***********************************************************/
+bool LoadTrace(const char* filename, std::vector<unsigned char>& data, std::vector<CALL>& calls, std::vector<size_t>& frameEnds)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Could not open trace " << filename << std::endl;
+		return false;
+	}
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	TRACE_HEADER header;
+	if (data.size() < sizeof(header))
+	{
+		std::cerr << "Trace " << filename << " is empty" << std::endl;
+		return false;
+	}
+	memcpy(&header, &data[0], sizeof(header));
+	if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION)
+	{
+		std::cerr << "Trace " << filename << " is not a GL trace of version " << TRACE_VERSION << std::endl;
+		return false;
+	}
+
+	size_t offset = sizeof(header);
+	while (offset < data.size())
+	{
+		CALL call;
+		call.op = data[offset++];
+		if (call.op >= OPCODE_COUNT)
+		{
+			std::cerr << "Unknown opcode " << (int)call.op << " at offset " << offset - 1 << std::endl;
+			return false;
+		}
+
+		const OPCODE_INFO& info = OPCODES[call.op];
+		size_t needed = info.words * sizeof(uint32_t) + (info.bBlob ? sizeof(uint32_t) : 0);
+		if (offset + needed > data.size())
+			break;
+
+		memcpy(call.words, &data[offset], info.words * sizeof(uint32_t));
+		offset += info.words * sizeof(uint32_t);
+
+		call.blobOffset = 0;
+		call.blobSize = 0;
+		if (info.bBlob)
+		{
+			memcpy(&call.blobSize, &data[offset], sizeof(uint32_t));
+			offset += sizeof(uint32_t);
+			call.blobOffset = (uint32_t)offset;
+			if (offset + call.blobSize > data.size())
+				break;
+			offset += call.blobSize;
+		}
+
+		if (call.op == OP_FRAME_END)
+			frameEnds.push_back(calls.size());
+		calls.push_back(call);
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  ParseCommandLine()
+ *
+ *  Reads the trace file name and the replay options.
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--loop") == 0 && (i + 1) < argc)
+			g_LoopCount = std::max(1, (int)strtol(argv[++i], NULL, 10));
+		else if (strcmp(argv[i], "--profile") == 0)
+			g_bProfile = true;
+		else if (strcmp(argv[i], "--strip") == 0)
+			g_bStrip = true;
+		else if (strcmp(argv[i], "--size") == 0 && (i + 1) < argc)
+		{
+			char* separator = NULL;
+			g_WindowWidth = (int)strtol(argv[++i], &separator, 10);
+			g_WindowHeight = (*separator == 'x') ? (int)strtol(separator + 1, NULL, 10) : 0;
+			if (g_WindowWidth <= 0 || g_WindowHeight <= 0)
+			{
+				std::cerr << "Invalid size: " << argv[i] << " (expected WIDTHxHEIGHT)" << std::endl;
+				return false;
+			}
+		}
+		else if (argv[i][0] != '-' && NULL == g_TraceFile)
+			g_TraceFile = argv[i];
+		else
+		{
+			std::cerr << "Unknown argument: " << argv[i] << std::endl;
+			return false;
+		}
+	}
+
+	if (NULL == g_TraceFile)
+	{
+		std::cerr << "Usage: GLReplay trace.gltrace [--loop N] [--profile] [--strip] [--size WxH]" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  ReplayLoop()
+ *
+ *  Replays the looped frames, skipping the flagged calls,
+ *  and returns the time until the GPU finished them.
+ ***********************************************************/
+double ReplayLoop(GLFWwindow* window, TraceReplayer& replayer, const std::vector<CALL>& calls,
+	size_t begin, size_t end, const std::vector<bool>* pSkip, std::vector<CALL_COST>* pCosts, double& submitMs)
+{
+	CLOCK::time_point start = CLOCK::now();
+	CLOCK::duration submit = CLOCK::duration::zero();
+
+	for (int loop = 0; loop < g_LoopCount; loop++)
+	{
+		CLOCK::time_point submitStart = CLOCK::now();
+		for (size_t i = begin; i < end; i++)
+		{
+			if (NULL != pSkip && (*pSkip)[i - begin])
+				continue;
+
+			const CALL& call = calls[i];
+			if (call.op == OP_FRAME_END)
+			{
+				submit += CLOCK::now() - submitStart;
+				glfwSwapBuffers(window);
+				glfwPollEvents();
+				submitStart = CLOCK::now();
+				continue;
+			}
+
+			if (NULL != pCosts)
+			{
+				CLOCK::time_point callStart = CLOCK::now();
+				replayer.Execute(call);
+				CALL_COST& cost = (*pCosts)[call.op];
+				cost.calls++;
+				cost.nanoseconds += std::chrono::duration<double, std::nano>(CLOCK::now() - callStart).count();
+			}
+			else
+			{
+				replayer.Execute(call);
+			}
+		}
+		submit += CLOCK::now() - submitStart;
+	}
+	glFinish();
+
+	submitMs = Milliseconds(submit);
+	return Milliseconds(CLOCK::now() - start);
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	if (!ParseCommandLine(argc, argv))
+		return EXIT_FAILURE;
+
+	std::vector<unsigned char> data;
+	std::vector<CALL> calls;
+	std::vector<size_t> frameEnds;
+	if (!LoadTrace(g_TraceFile, data, calls, frameEnds))
+		return EXIT_FAILURE;
+	if (frameEnds.empty())
+	{
+		std::cerr << "Trace " << g_TraceFile << " does not contain a whole frame" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	GLFWwindow* window = glfwCreateWindow(g_WindowWidth, g_WindowHeight, "GLReplay", NULL, NULL);
+	if (NULL == window)
+	{
+		std::cerr << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+	// replay as fast as possible
+	glfwSwapInterval(0);
+
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK)
+	{
+		std::cerr << "Failed to initialize GLEW" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	TraceReplayer replayer(data);
+
+	// the first frame creates the scene and is only replayed once
+	size_t setupEnd = frameEnds[0] + 1;
+	for (size_t i = 0; i < setupEnd; i++)
+		replayer.Execute(calls[i]);
+	glfwSwapBuffers(window);
+	glFinish();
+
+	size_t loopBegin = setupEnd;
+	size_t loopEnd = frameEnds.back() + 1;
+	size_t loopFrames = frameEnds.size() - 1;
+	if (loopFrames == 0)
+	{
+		std::cout << "Trace has a single frame, record at least two frames to loop them" << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	std::cout << "Replaying " << loopFrames << " frames (" << loopEnd - loopBegin << " calls) "
+		<< g_LoopCount << " times" << std::endl;
+
+	std::vector<CALL_COST> costs(OPCODE_COUNT);
+	for (size_t i = 0; i < costs.size(); i++)
+	{
+		costs[i].calls = 0;
+		costs[i].nanoseconds = 0.0;
+	}
+
+	double submitMs = 0.0;
+	double totalMs = ReplayLoop(window, replayer, calls, loopBegin, loopEnd, NULL, g_bProfile ? &costs : NULL, submitMs);
+	double frames = (double)(loopFrames * g_LoopCount);
+	std::cout << "Full trace:     " << totalMs / frames << " ms/frame, CPU submit " << submitMs / frames << " ms/frame" << std::endl;
+
+	if (g_bProfile)
+	{
+		std::vector<int> order;
+		for (int op = 0; op < OPCODE_COUNT; op++)
+		{
+			if (costs[op].calls > 0)
+				order.push_back(op);
+		}
+		std::sort(order.begin(), order.end(), [&costs](int a, int b) { return costs[a].nanoseconds > costs[b].nanoseconds; });
+
+		double totalNs = 0.0;
+		for (size_t i = 0; i < order.size(); i++)
+			totalNs += costs[order[i]].nanoseconds;
+
+		std::cout << "\nPer call CPU cost (calls/frame, ns/call, share of submit time):" << std::endl;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			const CALL_COST& cost = costs[order[i]];
+			std::cout << "  " << OPCODES[order[i]].name << ": " << cost.calls / frames << ", "
+				<< cost.nanoseconds / cost.calls << " ns, " << 100.0 * cost.nanoseconds / totalNs << "%" << std::endl;
+		}
+	}
+
+	if (g_bStrip)
+	{
+		// follow the state through the setup and one pass of the loop,
+		// then flag the loop as it runs from then on
+		RedundancyTracker tracker(data);
+		for (size_t i = 0; i < loopEnd; i++)
+			tracker.IsRedundant(calls[i]);
+
+		std::vector<bool> skip(loopEnd - loopBegin, false);
+		std::vector<uint64_t> stripped(OPCODE_COUNT, 0);
+		size_t strippedCount = 0;
+		for (size_t i = loopBegin; i < loopEnd; i++)
+		{
+			if (tracker.IsRedundant(calls[i]))
+			{
+				skip[i - loopBegin] = true;
+				stripped[calls[i].op]++;
+				strippedCount++;
+			}
+		}
+
+		double strippedSubmitMs = 0.0;
+		double strippedMs = ReplayLoop(window, replayer, calls, loopBegin, loopEnd, &skip, NULL, strippedSubmitMs);
+
+		std::cout << "\nRedundant calls: " << strippedCount << " of " << loopEnd - loopBegin << " per loop" << std::endl;
+		for (int op = 0; op < OPCODE_COUNT; op++)
+		{
+			if (stripped[op] > 0)
+				std::cout << "  " << OPCODES[op].name << ": " << stripped[op] / (double)loopFrames << " per frame" << std::endl;
+		}
+		std::cout << "Stripped trace: " << strippedMs / frames << " ms/frame, CPU submit " << strippedSubmitMs / frames
+			<< " ms/frame (saves " << (submitMs - strippedSubmitMs) / frames << " ms/frame of submission)" << std::endl;
+	}
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
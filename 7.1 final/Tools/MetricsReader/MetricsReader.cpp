@@ -0,0 +1,297 @@
+///////////////////////////////////////////////////////////////////////////////
+// metricsreader.cpp
+// ============
+// read the live metrics a running scene publishes, without attaching to it
+//
+//	Usage: MetricsReader [--interval MS] [--count N] [--prometheus] NAME
+//
+//	Maps the shared memory segment the application creates for --metrics
+//	NAME read-only and prints the metrics every interval: counters with
+//	their rate, gauges with their value and histograms with the 50th, 90th
+//	and 99th percentile of the samples since the previous report. With
+//	--prometheus the metrics are printed once in the Prometheus text
+//	format, for a scrape wrapper or the textfile collector of an exporter.
+//	The reader never writes to the segment, so any number of readers can
+//	watch one application without changing its frame times.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "MetricsFormat.h"
+
+using namespace MetricsFormat;
+
+// declaration of the global variables and defines
+namespace
+{
+	// command line options
+	const char* g_SegmentName = NULL;
+	unsigned int g_IntervalMilliseconds = 1000;
+	int g_ReportCount = 0;          // 0 reports until interrupted
+	bool g_bPrometheus = false;
+
+	// copies of the segment that changed under the reader before giving up
+	const int g_ReadAttempts = 1000;
+
+	// the previous copy, for rates and interval percentiles
+	SEGMENT_DATA g_previous;
+	bool g_bHasPrevious = false;
+
+	const METRIC* FindPrevious(const METRIC& metric)
+	{
+		if (!g_bHasPrevious)
+			return NULL;
+		for (uint32_t i = 0; i < g_previous.metricCount; i++)
+		{
+			if (strncmp(g_previous.metrics[i].name, metric.name, NAME_LENGTH) == 0)
+				return &g_previous.metrics[i];
+		}
+		return NULL;
+	}
+
+	std::string GetName(const METRIC& metric)
+	{
+		return std::string(metric.name, strnlen(metric.name, NAME_LENGTH));
+	}
+
+	std::string GetUnit(const METRIC& metric)
+	{
+		return std::string(metric.unit, strnlen(metric.unit, UNIT_LENGTH));
+	}
+}
+
+/***********************************************************
+ *  ParseCommandLine()
+ *
+ *  Reads the options and the segment name.
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--interval") == 0 && (i + 1) < argc)
+		{
+			long interval = strtol(argv[++i], NULL, 10);
+			if (interval <= 0)
+			{
+				std::cerr << "Invalid interval: " << argv[i] << std::endl;
+				return false;
+			}
+			g_IntervalMilliseconds = (unsigned int)interval;
+		}
+		else if (strcmp(argv[i], "--count") == 0 && (i + 1) < argc)
+		{
+			g_ReportCount = (int)strtol(argv[++i], NULL, 10);
+			if (g_ReportCount <= 0)
+			{
+				std::cerr << "Invalid report count: " << argv[i] << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--prometheus") == 0)
+			g_bPrometheus = true;
+		else if (argv[i][0] != '-' && NULL == g_SegmentName)
+			g_SegmentName = argv[i];
+		else
+		{
+			std::cerr << "Unknown argument: " << argv[i] << std::endl;
+			return false;
+		}
+	}
+
+	if (NULL == g_SegmentName)
+	{
+		std::cerr << "Usage: MetricsReader [--interval MS] [--count N] [--prometheus] NAME" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  MapSegment()
+ *
+ *  Opens the segment the application published under the
+ *  passed in name, read-only.
+ ***********************************************************/
+const SEGMENT_HEADER* MapSegment(const char* name)
+{
+	size_t size = sizeof(SEGMENT_HEADER);
+#if defined(_WIN32)
+	std::string segmentName = std::string("Local\\") + name;
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, segmentName.c_str());
+	void* pView = (NULL != mapping) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size) : NULL;
+	if (NULL != mapping)
+		CloseHandle(mapping);
+	if (NULL == pView)
+	{
+		std::cerr << "No metrics segment " << segmentName << ", is the scene running with --metrics " << name << "?" << std::endl;
+		return NULL;
+	}
+#else
+	std::string segmentName = (name[0] == '/') ? name : std::string("/") + name;
+	int file = shm_open(segmentName.c_str(), O_RDONLY, 0);
+	void* pView = MAP_FAILED;
+	if (file >= 0)
+	{
+		pView = mmap(NULL, size, PROT_READ, MAP_SHARED, file, 0);
+		close(file);
+	}
+	if (pView == MAP_FAILED)
+	{
+		std::cerr << "No metrics segment " << segmentName << ", is the scene running with --metrics " << name << "?" << std::endl;
+		return NULL;
+	}
+#endif
+	return (const SEGMENT_HEADER*)pView;
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  Prints one line per metric, with rates and percentiles
+ *  over the time since the previous copy.
+ ***********************************************************/
+void PrintReport(const SEGMENT_DATA& data)
+{
+	double seconds = g_bHasPrevious ? (data.publishTimeMs - g_previous.publishTimeMs) / 1000.0 : 0.0;
+	int64_t ageMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count() - data.publishTimeMs;
+	printf("process %u, update %llu, %lld ms old\n", data.processId, (unsigned long long)data.publishCount, (long long)ageMs);
+
+	for (uint32_t i = 0; i < data.metricCount; i++)
+	{
+		const METRIC& metric = data.metrics[i];
+		const METRIC* pPrevious = FindPrevious(metric);
+		std::string name = GetName(metric);
+		std::string unit = GetUnit(metric);
+
+		if (metric.type == METRIC_COUNTER)
+		{
+			printf("  %-24s %14llu", name.c_str(), (unsigned long long)metric.count);
+			if (NULL != pPrevious && seconds > 0.0)
+				printf("  %10.1f %s/s", (metric.count - pPrevious->count) / seconds, unit.c_str());
+			printf("\n");
+		}
+		else if (metric.type == METRIC_GAUGE)
+		{
+			printf("  %-24s %14.2f %s\n", name.c_str(), metric.value, unit.c_str());
+		}
+		else if (metric.type == METRIC_HISTOGRAM)
+		{
+			// the samples since the previous copy, all of them at first
+			uint64_t buckets[HISTOGRAM_BUCKETS];
+			uint64_t count = metric.count;
+			double sum = metric.value;
+			for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+				buckets[bucket] = metric.buckets[bucket] - ((NULL != pPrevious) ? pPrevious->buckets[bucket] : 0);
+			if (NULL != pPrevious)
+			{
+				count -= pPrevious->count;
+				sum -= pPrevious->value;
+			}
+
+			printf("  %-24s %14llu samples", name.c_str(), (unsigned long long)count);
+			if (count > 0)
+			{
+				printf(", mean %.2f p50 %.2f p90 %.2f p99 %.2f %s", sum / count, GetPercentile(buckets, 0.5),
+					GetPercentile(buckets, 0.9), GetPercentile(buckets, 0.99), unit.c_str());
+			}
+			printf("\n");
+		}
+	}
+	fflush(stdout);
+}
+
+/***********************************************************
+ *  PrintPrometheus()
+ *
+ *  Prints the metrics in the Prometheus text format, the
+ *  histograms with cumulative buckets.
+ ***********************************************************/
+void PrintPrometheus(const SEGMENT_DATA& data)
+{
+	for (uint32_t i = 0; i < data.metricCount; i++)
+	{
+		const METRIC& metric = data.metrics[i];
+		std::string name = "scene_" + GetName(metric);
+		std::string unit = GetUnit(metric);
+
+		if (metric.type == METRIC_COUNTER)
+		{
+			printf("# TYPE %s_total counter\n%s_total %llu\n", name.c_str(), name.c_str(), (unsigned long long)metric.count);
+		}
+		else if (metric.type == METRIC_GAUGE)
+		{
+			printf("# TYPE %s gauge\n%s %.6g\n", name.c_str(), name.c_str(), metric.value);
+		}
+		else if (metric.type == METRIC_HISTOGRAM)
+		{
+			printf("# HELP %s in %s\n# TYPE %s histogram\n", name.c_str(), unit.c_str(), name.c_str());
+			uint64_t cumulative = 0;
+			for (int bucket = 0; bucket < HISTOGRAM_BUCKETS - 1; bucket++)
+			{
+				cumulative += metric.buckets[bucket];
+				printf("%s_bucket{le=\"%.6g\"} %llu\n", name.c_str(), GetBucketBound(bucket), (unsigned long long)cumulative);
+			}
+			printf("%s_bucket{le=\"+Inf\"} %llu\n", name.c_str(), (unsigned long long)metric.count);
+			printf("%s_sum %.6g\n%s_count %llu\n", name.c_str(), metric.value, name.c_str(), (unsigned long long)metric.count);
+		}
+	}
+	fflush(stdout);
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	if (!ParseCommandLine(argc, argv))
+		return EXIT_FAILURE;
+
+	const SEGMENT_HEADER* pSegment = MapSegment(g_SegmentName);
+	if (NULL == pSegment)
+		return EXIT_FAILURE;
+
+	for (int report = 0; g_ReportCount == 0 || report < g_ReportCount; report++)
+	{
+		if (report > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(g_IntervalMilliseconds));
+
+		SEGMENT_DATA data;
+		if (!ReadSegment(pSegment, data, g_ReadAttempts))
+		{
+			std::cerr << "Could not read a consistent copy of " << g_SegmentName << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		if (g_bPrometheus)
+		{
+			PrintPrometheus(data);
+			break;
+		}
+		PrintReport(data);
+		g_previous = data;
+		g_bHasPrevious = true;
+	}
+
+	return EXIT_SUCCESS;
+}
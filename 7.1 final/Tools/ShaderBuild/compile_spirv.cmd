@@ -0,0 +1,55 @@
+@echo off
+rem ////////////////////////////////////////////////////////////////////////////
+rem // compile_spirv.cmd
+rem // ============
+rem // compile a GLSL shader offline into optimized SPIR-V for OpenGL
+rem //
+rem //	Usage: compile_spirv.cmd SOURCE OUTPUT STAGE ["NAME=VALUE" ...]
+rem //
+rem //	glslangValidator compiles SOURCE for GL_ARB_gl_spirv with the
+rem //	passed in defines (quoted, since cmd splits arguments at =), so
+rem //	every permutation of a shader is its own binary. spirv-opt -O then
+rem //	inlines, folds the constants of the permutation and removes the
+rem //	code they disable. The instruction count before and after the
+rem //	optimization is printed for each binary.
+rem //	Uniform locations and bindings are assigned automatically and the
+rem //	debug names are kept, since the application sets uniforms by name.
+rem //	Without the Vulkan SDK the step is skipped and the application
+rem //	keeps compiling the GLSL at startup.
+rem ////////////////////////////////////////////////////////////////////////////
+setlocal EnableDelayedExpansion
+
+if "%VULKAN_SDK%"=="" (
+	echo warning: VULKAN_SDK is not set, %~nx1 is not compiled to SPIR-V
+	exit /b 0
+)
+
+set TOOLS=%VULKAN_SDK%\Bin
+set SOURCE=%~1
+set OUTPUT=%~2
+set OUTPUT_DIR=%~dp2
+set STAGE=%~3
+set DEFINES=
+
+:defines
+if "%~4"=="" goto compile
+set DEFINES=!DEFINES! -D%~4
+shift /4
+goto defines
+
+:compile
+if not exist "%OUTPUT_DIR%" mkdir "%OUTPUT_DIR%"
+
+"%TOOLS%\glslangValidator.exe" -G --auto-map-locations --auto-map-bindings -S %STAGE% %DEFINES% -o "%OUTPUT%.unopt" "%SOURCE%" || exit /b 1
+"%TOOLS%\spirv-opt.exe" -O "%OUTPUT%.unopt" -o "%OUTPUT%" || exit /b 1
+"%TOOLS%\spirv-val.exe" --target-env opengl4.5 "%OUTPUT%" || exit /b 1
+
+rem every disassembled instruction line names its Op
+"%TOOLS%\spirv-dis.exe" "%OUTPUT%.unopt" -o "%OUTPUT%.unopt.txt" || exit /b 1
+"%TOOLS%\spirv-dis.exe" "%OUTPUT%" -o "%OUTPUT%.txt" || exit /b 1
+for /f %%c in ('find /c " Op" ^< "%OUTPUT%.unopt.txt"') do set BEFORE=%%c
+for /f %%c in ('find /c " Op" ^< "%OUTPUT%.txt"') do set AFTER=%%c
+echo %~nx2: !BEFORE! instructions, !AFTER! after spirv-opt
+
+del "%OUTPUT%.unopt" "%OUTPUT%.unopt.txt" "%OUTPUT%.txt"
+exit /b 0
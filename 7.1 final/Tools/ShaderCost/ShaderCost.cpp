@@ -0,0 +1,488 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercost.cpp
+// ============
+// measure the GPU cost of each feature of shader.frag per pixel
+//
+//	Usage: ShaderCost [--shader shader.frag] [--resolutions 1280x720,...]
+//	                  [--repeat N] [--samples N] [--csv FILE]
+//
+//	Every variant of the fragment shader (texture or material color, each
+//	light type on its own, volumetrics) is compiled with the feature
+//	switches of shader.frag and draws full screen quads over a lit plane
+//	with fixed uniforms. The quads are timed with GL_TIME_ELAPSED queries
+//	and the median of the samples is reported as nanoseconds per shaded
+//	pixel. Feature costs are the differences between the variants. Works
+//	the same on llvmpipe and on hardware drivers.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+// declaration of the global variables and defines
+namespace
+{
+	// one compiled configuration of the fragment shader
+	struct VARIANT
+	{
+		const char* name;
+		const char* defines;
+		bool        bUseTexture;
+		bool        bUseLighting;
+		bool        bUseVolumetrics;
+		GLuint      program;
+	};
+
+	// feature cost derived from two variants
+	struct FEATURE
+	{
+		const char* name;
+		int         variant;
+		int         baseline;
+	};
+
+	struct RESOLUTION
+	{
+		int width;
+		int height;
+	};
+
+	VARIANT g_Variants[] = {
+		{ "unlit material", "#define USE_DIR_LIGHT 0\n#define USE_POINT_LIGHTS 0\n#define USE_SPOT_LIGHT 0\n", false, false, false, 0 },
+		{ "unlit texture",  "#define USE_DIR_LIGHT 0\n#define USE_POINT_LIGHTS 0\n#define USE_SPOT_LIGHT 0\n", true,  false, false, 0 },
+		{ "no lights",      "#define USE_DIR_LIGHT 0\n#define USE_POINT_LIGHTS 0\n#define USE_SPOT_LIGHT 0\n", false, true,  false, 0 },
+		{ "dir light",      "#define USE_DIR_LIGHT 1\n#define USE_POINT_LIGHTS 0\n#define USE_SPOT_LIGHT 0\n", false, true,  false, 0 },
+		{ "point light",    "#define USE_DIR_LIGHT 0\n#define USE_POINT_LIGHTS 1\n#define USE_SPOT_LIGHT 0\n", false, true,  false, 0 },
+		{ "spot light",     "#define USE_DIR_LIGHT 0\n#define USE_POINT_LIGHTS 0\n#define USE_SPOT_LIGHT 1\n", false, true,  false, 0 },
+		{ "all lights",     "", false, true, false, 0 },
+		{ "all + texture",  "", true,  true, false, 0 },
+		{ "all + volumetrics", "", false, true, true, 0 } };
+	const int VARIANT_COUNT = sizeof(g_Variants) / sizeof(g_Variants[0]);
+
+	const FEATURE g_Features[] = {
+		{ "texture fetch",     1, 0 },
+		{ "lighting setup",    2, 0 },
+		{ "CalcDirLight",      3, 2 },
+		{ "CalcPointLight",    4, 2 },
+		{ "CalcSpotLight",     5, 2 },
+		{ "ApplyVolumetrics",  8, 6 } };
+	const int FEATURE_COUNT = sizeof(g_Features) / sizeof(g_Features[0]);
+
+	// a plane seen from the scene camera, with the normal tilted a
+	// little over the plane so no lighting term is constant
+	const char* g_VertexShader =
+		"#version 330 core\n"
+		"out vec3 FragPos;\n"
+		"out vec3 Normal;\n"
+		"out vec2 TexCoord;\n"
+		"out vec4 CurrentClip;\n"
+		"out vec4 PreviousClip;\n"
+		"void main()\n"
+		"{\n"
+		"    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;\n"
+		"    FragPos = vec3(corner.x * 10.0, 0.0, corner.y * 10.0);\n"
+		"    Normal = normalize(vec3(corner.x * 0.2, 1.0, corner.y * 0.2));\n"
+		"    TexCoord = corner * 4.0;\n"
+		"    gl_Position = vec4(corner, 0.0, 1.0);\n"
+		"    CurrentClip = gl_Position;\n"
+		"    PreviousClip = gl_Position + vec4(0.01, 0.0, 0.0, 0.0);\n"
+		"}\n";
+
+	// command line options
+	const char* g_ShaderFile = "shader.frag";
+	const char* g_CsvFile = NULL;
+	std::vector<RESOLUTION> g_Resolutions;
+	int g_RepeatCount = 8;
+	int g_SampleCount = 11;
+
+	std::string ReadFile(const char* filename)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		std::stringstream contents;
+		contents << file.rdbuf();
+		return file ? contents.str() : std::string();
+	}
+
+	GLuint CompileShader(GLenum type, const std::string& source, const char* name)
+	{
+		GLuint shader = glCreateShader(type);
+		const GLchar* text = source.c_str();
+		glShaderSource(shader, 1, &text, NULL);
+		glCompileShader(shader);
+
+		GLint status = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			char log[2048];
+			glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+			std::cerr << "[ERROR] " << name << " did not compile:\n" << log << std::endl;
+			glDeleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+}
+
+/***********************************************************
+ *  BuildVariant()
+ *
+ *  Compiles the fragment shader with the switches of the
+ *  variant inserted after its #version line and sets the
+ *  fixed uniforms, the same values the scene uses.
+ ***********************************************************/
+bool BuildVariant(VARIANT& variant, const std::string& fragmentSource)
+{
+	size_t versionEnd = fragmentSource.find('\n');
+	std::string source = fragmentSource.substr(0, versionEnd + 1) + variant.defines +
+		fragmentSource.substr(versionEnd + 1);
+
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, g_VertexShader, "quad vertex shader");
+	GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, source, variant.name);
+	if (0 == vertexShader || 0 == fragmentShader)
+		return false;
+
+	variant.program = glCreateProgram();
+	glAttachShader(variant.program, vertexShader);
+	glAttachShader(variant.program, fragmentShader);
+	glLinkProgram(variant.program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(variant.program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char log[2048];
+		glGetProgramInfoLog(variant.program, sizeof(log), NULL, log);
+		std::cerr << "[ERROR] " << variant.name << " did not link:\n" << log << std::endl;
+		return false;
+	}
+
+	GLuint p = variant.program;
+	glUseProgram(p);
+	glUniform1i(glGetUniformLocation(p, "bUseTexture"), variant.bUseTexture);
+	glUniform1i(glGetUniformLocation(p, "bUseLighting"), variant.bUseLighting);
+	glUniform1i(glGetUniformLocation(p, "bUseVolumetrics"), variant.bUseVolumetrics);
+	glUniform1i(glGetUniformLocation(p, "objectID"), 1);
+	glUniform1i(glGetUniformLocation(p, "objectTexture"), 0);
+	glUniform1i(glGetUniformLocation(p, "volumetricTex"), 1);
+	glUniform3f(glGetUniformLocation(p, "viewPos"), 0.0f, 5.0f, 12.0f);
+
+	glUniform4f(glGetUniformLocation(p, "objectColor"), 1.0f, 1.0f, 1.0f, 1.0f);
+	glUniform2f(glGetUniformLocation(p, "UVscale"), 1.0f, 1.0f);
+	glUniform3f(glGetUniformLocation(p, "material.ambientColor"), 0.4f, 0.4f, 0.4f);
+	glUniform1f(glGetUniformLocation(p, "material.ambientStrength"), 0.5f);
+	glUniform3f(glGetUniformLocation(p, "material.diffuseColor"), 1.0f, 1.0f, 1.0f);
+	glUniform3f(glGetUniformLocation(p, "material.specularColor"), 1.2f, 1.2f, 1.2f);
+	glUniform1f(glGetUniformLocation(p, "material.shininess"), 96.0f);
+
+	glUniform3f(glGetUniformLocation(p, "dirLight.direction"), -0.2f, -1.0f, -0.1f);
+	glUniform3f(glGetUniformLocation(p, "dirLight.ambient"), 0.4f, 0.4f, 0.4f);
+	glUniform3f(glGetUniformLocation(p, "dirLight.diffuse"), 0.7f, 0.7f, 0.7f);
+	glUniform3f(glGetUniformLocation(p, "dirLight.specular"), 0.7f, 0.7f, 0.7f);
+
+	const char* pointLights[2] = { "pointLight", "pointLight2" };
+	for (int i = 0; i < 2; i++)
+	{
+		std::string prefix = pointLights[i];
+		glUniform3f(glGetUniformLocation(p, (prefix + ".position").c_str()), i ? -4.0f : 0.0f, i ? 3.0f : 4.0f, i ? -2.0f : 6.0f);
+		glUniform3f(glGetUniformLocation(p, (prefix + ".ambient").c_str()), 0.25f, 0.25f, 0.25f);
+		glUniform3f(glGetUniformLocation(p, (prefix + ".diffuse").c_str()), 0.75f, 0.75f, 0.75f);
+		glUniform3f(glGetUniformLocation(p, (prefix + ".specular").c_str()), 1.0f, 1.0f, 1.0f);
+		glUniform1f(glGetUniformLocation(p, (prefix + ".constant").c_str()), 1.0f);
+		glUniform1f(glGetUniformLocation(p, (prefix + ".linear").c_str()), 0.09f);
+		glUniform1f(glGetUniformLocation(p, (prefix + ".quadratic").c_str()), 0.032f);
+	}
+
+	glUniform3f(glGetUniformLocation(p, "spotLight.position"), 0.0f, 5.0f, 12.0f);
+	glUniform3f(glGetUniformLocation(p, "spotLight.direction"), 0.0f, -0.4f, -1.0f);
+	glUniform1f(glGetUniformLocation(p, "spotLight.cutOff"), 0.985f);
+	glUniform1f(glGetUniformLocation(p, "spotLight.outerCutOff"), 0.966f);
+	glUniform3f(glGetUniformLocation(p, "spotLight.ambient"), 0.15f, 0.15f, 0.15f);
+	glUniform3f(glGetUniformLocation(p, "spotLight.diffuse"), 0.8f, 0.8f, 0.8f);
+	glUniform3f(glGetUniformLocation(p, "spotLight.specular"), 1.0f, 1.0f, 1.0f);
+	glUniform1f(glGetUniformLocation(p, "spotLight.constant"), 1.0f);
+	glUniform1f(glGetUniformLocation(p, "spotLight.linear"), 0.09f);
+	glUniform1f(glGetUniformLocation(p, "spotLight.quadratic"), 0.032f);
+
+	glUniform1f(glGetUniformLocation(p, "volumetricNear"), 0.1f);
+	glUniform1f(glGetUniformLocation(p, "volumetricFar"), 100.0f);
+	// a camera 5 units up looking down the -z axis
+	const GLfloat view[16] = {
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, -5.0f, -12.0f, 1.0f };
+	glUniformMatrix4fv(glGetUniformLocation(p, "view"), 1, GL_FALSE, view);
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateInputTextures()
+ *
+ *  Creates the diffuse texture and the froxel volume the
+ *  shader samples, filled with noise so no fetch is uniform.
+ ***********************************************************/
+void CreateInputTextures(GLuint textures[2])
+{
+	const int size = 1024;
+	std::vector<unsigned char> pixels(size * size * 4);
+	unsigned int seed = 12345;
+	for (size_t i = 0; i < pixels.size(); i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		pixels[i] = (unsigned char)(seed >> 24);
+	}
+
+	glGenTextures(2, textures);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, textures[0]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	// the froxel grid of VolumetricLighting
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, textures[1]);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8, 160, 90, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  Creates a framebuffer with the four outputs of the scene
+ *  render target, so the shader writes what it does in the
+ *  application.
+ ***********************************************************/
+GLuint CreateTarget(int width, int height, GLuint attachments[4])
+{
+	const GLenum formats[4] = { GL_RGBA16F, GL_RGBA8, GL_RG16F, GL_R32UI };
+
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glGenTextures(4, attachments);
+	for (int i = 0; i < 4; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, attachments[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, attachments[i], 0);
+	}
+
+	const GLenum drawBuffers[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
+	glDrawBuffers(4, drawBuffers);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "[ERROR] Render target of " << width << "x" << height << " is incomplete" << std::endl;
+		return 0;
+	}
+	return framebuffer;
+}
+
+/***********************************************************
+ *  MeasureVariant()
+ *
+ *  Draws the full screen quad repeatCount times per sample
+ *  and returns the median GPU time per pixel, in ns.
+ ***********************************************************/
+double MeasureVariant(const VARIANT& variant, GLuint query, int width, int height)
+{
+	glUseProgram(variant.program);
+
+	// the first draw pays for any deferred compilation
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glFinish();
+
+	std::vector<double> samples;
+	for (int sample = 0; sample < g_SampleCount; sample++)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, query);
+		for (int i = 0; i < g_RepeatCount; i++)
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		glEndQuery(GL_TIME_ELAPSED);
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		samples.push_back((double)nanoseconds / ((double)width * height * g_RepeatCount));
+	}
+
+	std::sort(samples.begin(), samples.end());
+	return samples[samples.size() / 2];
+}
+
+/***********************************************************
+ *  ParseCommandLine()
+ *
+ *  Reads the shader file, resolutions and sample counts.
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--shader") == 0 && (i + 1) < argc)
+			g_ShaderFile = argv[++i];
+		else if (strcmp(argv[i], "--csv") == 0 && (i + 1) < argc)
+			g_CsvFile = argv[++i];
+		else if (strcmp(argv[i], "--repeat") == 0 && (i + 1) < argc)
+			g_RepeatCount = std::max(1, (int)strtol(argv[++i], NULL, 10));
+		else if (strcmp(argv[i], "--samples") == 0 && (i + 1) < argc)
+			g_SampleCount = std::max(1, (int)strtol(argv[++i], NULL, 10));
+		else if (strcmp(argv[i], "--resolutions") == 0 && (i + 1) < argc)
+		{
+			char* next = argv[++i];
+			while (*next != 0)
+			{
+				RESOLUTION resolution;
+				char* separator = NULL;
+				resolution.width = (int)strtol(next, &separator, 10);
+				resolution.height = (*separator == 'x') ? (int)strtol(separator + 1, &next, 10) : 0;
+				if (resolution.width <= 0 || resolution.height <= 0)
+				{
+					std::cerr << "Invalid resolutions: " << argv[i] << " (expected WIDTHxHEIGHT,...)" << std::endl;
+					return false;
+				}
+				g_Resolutions.push_back(resolution);
+				if (*next == ',')
+					next++;
+			}
+		}
+		else
+		{
+			std::cerr << "Unknown argument: " << argv[i] << std::endl;
+			return false;
+		}
+	}
+
+	if (g_Resolutions.empty())
+	{
+		const RESOLUTION defaults[3] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 } };
+		g_Resolutions.assign(defaults, defaults + 3);
+	}
+	return true;
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	if (!ParseCommandLine(argc, argv))
+		return EXIT_FAILURE;
+
+	std::string fragmentSource = ReadFile(g_ShaderFile);
+	if (fragmentSource.empty())
+	{
+		std::cerr << "Could not read " << g_ShaderFile << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// everything is drawn offscreen
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "ShaderCost", NULL, NULL);
+	if (NULL == window)
+	{
+		std::cerr << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return EXIT_FAILURE;
+	}
+	glfwMakeContextCurrent(window);
+
+	glewExperimental = GL_TRUE;
+	if (glewInit() != GLEW_OK)
+	{
+		std::cerr << "Failed to initialize GLEW" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")" << std::endl;
+	std::cout << g_RepeatCount << " quads per sample, median of " << g_SampleCount << " samples\n" << std::endl;
+
+	for (int i = 0; i < VARIANT_COUNT; i++)
+	{
+		if (!BuildVariant(g_Variants[i], fragmentSource))
+			return EXIT_FAILURE;
+	}
+
+	GLuint inputTextures[2];
+	CreateInputTextures(inputTextures);
+
+	GLuint vertexArray = 0;
+	GLuint query = 0;
+	glGenVertexArrays(1, &vertexArray);
+	glBindVertexArray(vertexArray);
+	glGenQueries(1, &query);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	std::ofstream csv;
+	if (NULL != g_CsvFile)
+	{
+		csv.open(g_CsvFile);
+		csv << "renderer,width,height,variant,ns_per_pixel" << std::endl;
+	}
+
+	for (size_t r = 0; r < g_Resolutions.size(); r++)
+	{
+		int width = g_Resolutions[r].width;
+		int height = g_Resolutions[r].height;
+
+		GLuint attachments[4];
+		GLuint framebuffer = CreateTarget(width, height, attachments);
+		if (0 == framebuffer)
+			return EXIT_FAILURE;
+		glViewport(0, 0, width, height);
+
+		double costs[VARIANT_COUNT];
+		std::cout << width << "x" << height << ":" << std::endl;
+		for (int i = 0; i < VARIANT_COUNT; i++)
+		{
+			costs[i] = MeasureVariant(g_Variants[i], query, width, height);
+			std::cout << "  " << g_Variants[i].name << ": " << costs[i] << " ns/pixel" << std::endl;
+			if (csv.is_open())
+				csv << '"' << glGetString(GL_RENDERER) << "\"," << width << "," << height << ","
+					<< g_Variants[i].name << "," << costs[i] << std::endl;
+		}
+
+		std::cout << "  feature costs:";
+		for (int i = 0; i < FEATURE_COUNT; i++)
+		{
+			const FEATURE& feature = g_Features[i];
+			std::cout << (i ? ", " : " ") << feature.name << " "
+				<< costs[feature.variant] - costs[feature.baseline] << " ns";
+		}
+		std::cout << "\n" << std::endl;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteTextures(4, attachments);
+	}
+
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
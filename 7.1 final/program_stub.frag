@@ -0,0 +1,10 @@
+#version 330 core
+
+// compiled by ShaderManager only to create the main program object, which
+// ComputeProgram::LoadMainProgram links the SPIR-V of shader.frag into
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(0.0);
+}
@@ -0,0 +1,8 @@
+#version 330 core
+
+// compiled by ShaderManager only to create the main program object, which
+// ComputeProgram::LoadMainProgram links the SPIR-V of shader.vert into
+void main()
+{
+    gl_Position = vec4(0.0);
+}
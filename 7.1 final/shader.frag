@@ -1,11 +1,23 @@
 #version 330 core
 
+// feature switches, Tools/ShaderCost compiles variants with some of them off
+#ifndef USE_DIR_LIGHT
+#define USE_DIR_LIGHT 1
+#endif
+#ifndef USE_POINT_LIGHTS
+#define USE_POINT_LIGHTS 2
+#endif
+#ifndef USE_SPOT_LIGHT
+#define USE_SPOT_LIGHT 1
+#endif
+
+// OBJECT_MATERIAL of SceneManager
 struct Material {
-    sampler2D diffuseTex;
-    vec3      ambient;
-    vec3      diffuse;
-    vec3      specular;
-    float     shininess;
+    vec3  ambientColor;
+    float ambientStrength;
+    vec3  diffuseColor;
+    vec3  specularColor;
+    float shininess;
 };
 
 struct DirLight {
@@ -43,27 +55,63 @@ struct SpotLight {
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
+in vec4 CurrentClip;
+in vec4 PreviousClip;
 
-out vec4 FragColor;
+layout(location = 0) out vec4 FragColor;
+// octahedral normal, roughness, reflectivity (see SceneRenderTarget)
+layout(location = 1) out vec4 SurfaceData;
+// screen space motion and object identifier for checkerboard reconstruction
+layout(location = 2) out vec2 Velocity;
+layout(location = 3) out uint ObjectID;
 
 uniform Material    material;
+// lights defined as STATIC_ are constants the compiler can fold (see
+// StaticLightBaker), the others are uploaded every frame
+#ifdef STATIC_DIR_LIGHT
+const DirLight      dirLight = STATIC_DIR_LIGHT;
+#else
 uniform DirLight    dirLight;
+#endif
+#ifdef STATIC_POINT_LIGHT
+const PointLight    pointLight = STATIC_POINT_LIGHT;
+#else
 uniform PointLight  pointLight;
+#endif
+#ifdef STATIC_POINT_LIGHT2
+const PointLight    pointLight2 = STATIC_POINT_LIGHT2;
+#else
 uniform PointLight  pointLight2;
+#endif
 uniform SpotLight   spotLight;
 uniform vec3        viewPos;
+uniform vec4        objectColor;
+uniform sampler2D   objectTexture;
+uniform vec2        UVscale;
 uniform bool        bUseTexture;
 uniform bool        bUseLighting;
+uniform int         objectID;
+
+// froxel volumetric lighting (see VolumetricLighting)
+uniform sampler3D   volumetricTex;
+uniform bool        bUseVolumetrics;
+uniform float       volumetricNear;
+uniform float       volumetricFar;
+uniform vec2        screenSize;
+uniform mat4        view;
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 baseColor);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor);
+vec3 ApplyVolumetrics(vec3 color, vec3 fragPos);
+vec2 EncodeNormal(vec3 n);
 
 void main()
 {
-    vec3 baseColor = bUseTexture
-        ? texture(material.diffuseTex, TexCoord).rgb
-        : material.diffuse;
+    vec4 surfaceColor = bUseTexture
+        ? texture(objectTexture, TexCoord * UVscale)
+        : objectColor;
+    vec3 baseColor = surfaceColor.rgb;
 
     vec3 norm    = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
@@ -72,13 +120,36 @@ void main()
 
     if (bUseLighting)
     {
-        result  = CalcDirLight(dirLight, norm, viewDir, baseColor);
+        result  = vec3(0.0);
+#if USE_DIR_LIGHT
+        result += CalcDirLight(dirLight, norm, viewDir, baseColor);
+#endif
+#if USE_POINT_LIGHTS > 0
         result += CalcPointLight(pointLight, norm, FragPos, viewDir, baseColor);
+#endif
+#if USE_POINT_LIGHTS > 1
         result += CalcPointLight(pointLight2, norm, FragPos, viewDir, baseColor);
+#endif
+#if USE_SPOT_LIGHT
         result += CalcSpotLight(spotLight, norm, FragPos, viewDir, baseColor);
+#endif
     }
 
-    FragColor = vec4(result, 1.0);
+    if (bUseVolumetrics)
+        result = ApplyVolumetrics(result, FragPos);
+
+    FragColor = vec4(result, surfaceColor.a);
+
+    // Blinn-Phong shininess mapped to roughness; the scene materials are
+    // dielectrics, so reflections use a constant 4% base reflectance
+    float roughness    = sqrt(2.0 / (material.shininess + 2.0));
+    float reflectivity = (bUseLighting && material.shininess > 0.0) ? 0.04 : 0.0;
+    SurfaceData = vec4(EncodeNormal(norm), roughness, reflectivity);
+
+    vec2 currentUV  = CurrentClip.xy / CurrentClip.w * 0.5 + 0.5;
+    vec2 previousUV = PreviousClip.xy / PreviousClip.w * 0.5 + 0.5;
+    Velocity = currentUV - previousUV;
+    ObjectID = uint(objectID);
 }
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 baseColor)
@@ -88,9 +159,9 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 baseColor)
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec      = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
 
-    vec3 ambient  = light.ambient  * material.ambient;
-    vec3 diffuse  = light.diffuse  * diff * baseColor;
-    vec3 specular = light.specular * spec * material.specular;
+    vec3 ambient  = light.ambient  * material.ambientStrength * material.ambientColor;
+    vec3 diffuse  = light.diffuse  * diff * material.diffuseColor * baseColor;
+    vec3 specular = light.specular * spec * material.specularColor;
 
     return ambient + diffuse + specular;
 }
@@ -105,9 +176,9 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, v
     float dist        = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * dist + light.quadratic * dist * dist);
 
-    vec3 ambient  = light.ambient  * material.ambient;
-    vec3 diffuse  = light.diffuse  * diff * baseColor;
-    vec3 specular = light.specular * spec * material.specular;
+    vec3 ambient  = light.ambient  * material.ambientStrength * material.ambientColor;
+    vec3 diffuse  = light.diffuse  * diff * material.diffuseColor * baseColor;
+    vec3 specular = light.specular * spec * material.specularColor;
 
     ambient  *= attenuation;
     diffuse  *= attenuation;
@@ -130,9 +201,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec
     float epsilon   = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
 
-    vec3 ambient  = light.ambient  * material.ambient;
-    vec3 diffuse  = light.diffuse  * diff * baseColor;
-    vec3 specular = light.specular * spec * material.specular;
+    vec3 ambient  = light.ambient  * material.ambientStrength * material.ambientColor;
+    vec3 diffuse  = light.diffuse  * diff * material.diffuseColor * baseColor;
+    vec3 specular = light.specular * spec * material.specularColor;
 
     ambient  *= attenuation * intensity;
     diffuse  *= attenuation * intensity;
@@ -140,3 +211,22 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec
 
     return ambient + diffuse + specular;
 }
+
+vec3 ApplyVolumetrics(vec3 color, vec3 fragPos)
+{
+    // froxel coordinate: screen position plus exponential view depth slice
+    float depth = max(-(view * vec4(fragPos, 1.0)).z, volumetricNear);
+    float slice = log(depth / volumetricNear) / log(volumetricFar / volumetricNear);
+    vec3  uvw   = vec3(gl_FragCoord.xy / screenSize, clamp(slice, 0.0, 1.0));
+
+    vec4 scattering = texture(volumetricTex, uvw);
+    return color * scattering.a + scattering.rgb;
+}
+
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.xy * 0.5 + 0.5;
+}
@@ -1,32 +1,82 @@
 #version 330 core
 
+#ifdef VERTEX_PULLING
+// every mesh lives in one storage buffer arena and is fetched by index
+// (see VertexPullingArena, which compiles this path as #version 430)
+struct PulledVertex {
+    vec4 positionU;     // position, texture u
+    vec4 normalV;       // normal, texture v
+};
+layout(std430, binding = 0) readonly buffer PulledVertices { PulledVertex pulledVertices[]; };
+layout(std430, binding = 1) readonly buffer PulledIndices  { uint pulledIndices[]; };
+// start of the drawn mesh in the arena
+uniform int firstIndex;
+uniform int baseVertex;
+// world and normal matrices composed by transform_update.comp (see
+// GpuTransforms), used instead of model while bObjectTransforms is set
+struct ObjectTransform {
+    mat4 world;
+    mat4 normal;
+};
+layout(std430, binding = 2) readonly buffer ObjectTransforms { ObjectTransform objectTransforms[]; };
+uniform bool bObjectTransforms;
+uniform int objectIndex;
+#else
 // Vertex attributes
 layout(location = 0) in vec3 aPos;       // position
 layout(location = 1) in vec3 aNormal;    // normal
 layout(location = 2) in vec2 aTexCoord;  // texture coordinate
+#endif
 
 // Matrices
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+// last frame's camera, for motion vectors (objects are static)
+uniform mat4 previousViewProjection;
 
 // Outputs to fragment shader
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
+out vec4 CurrentClip;
+out vec4 PreviousClip;
 
 void main()
 {
+#ifdef VERTEX_PULLING
+    PulledVertex pulled = pulledVertices[baseVertex + int(pulledIndices[firstIndex + gl_VertexID])];
+    vec3 aPos      = pulled.positionU.xyz;
+    vec3 aNormal   = pulled.normalV.xyz;
+    vec2 aTexCoord = vec2(pulled.positionU.w, pulled.normalV.w);
+
+    mat4 world = model;
+    mat3 normalMatrix;
+    if (bObjectTransforms)
+    {
+        world = objectTransforms[objectIndex].world;
+        normalMatrix = mat3(objectTransforms[objectIndex].normal);
+    }
+    else
+        normalMatrix = mat3(transpose(inverse(model)));
+#else
+    mat4 world = model;
+    mat3 normalMatrix = mat3(transpose(inverse(model)));
+#endif
+
     // Transform vertex position to world space
-    vec4 worldPosition = model * vec4(aPos, 1.0);
+    vec4 worldPosition = world * vec4(aPos, 1.0);
     FragPos = worldPosition.xyz;
 
     // Transform normal vector
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
 
     // Pass through texture coordinates
     TexCoord = aTexCoord;
 
     // Final vertex position in clip space
     gl_Position = projection * view * worldPosition;
+
+    CurrentClip  = gl_Position;
+    PreviousClip = previousViewProjection * worldPosition;
 }